@@ -0,0 +1,86 @@
+//
+// coalesce.h
+// latest values of the instances of one signal, held back by mapper and mpr.device
+// with @coalesce until the end of a poll so that only the last update is output.
+// Include after <mapper/mapper.h>, with MAX_LIST defined.
+// http://www.libmapper.org
+//
+
+#ifndef COALESCE_H
+#define COALESCE_H
+
+#include <stdlib.h>
+#include <string.h>
+
+// latest value of one signal instance held back until the end of a poll
+typedef struct _coalesce_slot
+{
+    mpr_id              inst;
+    int                 count;          // updates received since the last flush
+    int                 len;
+    mpr_type            type;
+    mpr_time            time;
+    float               latency;
+    union {
+        int             ints[MAX_LIST];
+        float           floats[MAX_LIST];
+    } value;
+} t_coalesce_slot;
+
+// overwrite the slot of the update's instance, adding one if it has none
+static inline void coalesce_store(t_coalesce_slot **slots, int *num_slots, mpr_id inst,
+                                  int len, mpr_type type, const void *val, mpr_time time,
+                                  float latency)
+{
+    t_coalesce_slot *slot = 0;
+    int i;
+    for (i = 0; i < *num_slots; i++) {
+        if ((*slots)[i].inst == inst) {
+            slot = &(*slots)[i];
+            break;
+        }
+    }
+    if (!slot) {
+        *slots = (t_coalesce_slot *)realloc(*slots, (*num_slots + 1) * sizeof(t_coalesce_slot));
+        slot = &(*slots)[(*num_slots)++];
+        slot->inst = inst;
+        slot->count = 0;
+    }
+    if (len > MAX_LIST)
+        len = MAX_LIST;
+    memcpy(&slot->value, val, len * (MPR_INT32 == type ? sizeof(int) : sizeof(float)));
+    slot->len = len;
+    slot->type = type;
+    slot->time = time;
+    slot->latency = latency;
+    ++slot->count;
+}
+
+// drop the slot of a released instance, moving the last slot into its place so that
+// the slots never outnumber the instances alive at once
+static inline void coalesce_remove(t_coalesce_slot **slots, int *num_slots, mpr_id inst)
+{
+    int i;
+    for (i = 0; i < *num_slots; i++) {
+        if ((*slots)[i].inst == inst) {
+            if (i != --(*num_slots))
+                (*slots)[i] = (*slots)[*num_slots];
+            if (!*num_slots) {
+                free(*slots);
+                *slots = 0;
+            }
+            return;
+        }
+    }
+}
+
+// drop every slot, pending values are lost
+static inline void coalesce_clear(t_coalesce_slot **slots, int *num_slots)
+{
+    if (*slots)
+        free(*slots);
+    *slots = 0;
+    *num_slots = 0;
+}
+
+#endif
@@ -0,0 +1,128 @@
+//
+// device_pool.h
+// devices released by freed mapper or mpr.device objects, kept on the network with
+// their signals and maps until a new object with the same name and interface adopts
+// them or their grace period ends. Each external keeps one pool. It detaches its
+// signal contexts before adding a device and creates the pool's clock, whose
+// callback calls dev_pool_poll(); the code here only uses calls that Max and Pd share.
+// Include after the Max or Pd headers and <mapper/mapper.h>.
+// http://www.libmapper.org
+//
+
+#ifndef DEVICE_POOL_H
+#define DEVICE_POOL_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#define DEV_POOL_INTERVAL 1 // ms between polls of the pooled devices
+
+typedef struct _pooled_dev
+{
+    char                *name;
+    char                *iface;
+    mpr_dev             device;
+    void                *data;          // kept for the adopting object
+    double              released;
+    int                 persist;
+    struct _pooled_dev  *next;
+} t_pooled_dev;
+
+typedef struct _dev_pool
+{
+    t_pooled_dev        *devs;
+    void                *clock;
+    int                 closed;         // the host is quitting, devices are freed straight away
+    void                (*free_dev)(t_pooled_dev *d);   // frees the device, its signals and data
+} t_dev_pool;
+
+static inline void dev_pool_free(t_dev_pool *pool, t_pooled_dev *d)
+{
+    pool->free_dev(d);
+    free(d->name);
+    if (d->iface)
+        free(d->iface);
+    free(d);
+}
+
+// hand a device over to the pool, which takes the name and interface strings too;
+// the pool's clock must exist
+static inline void dev_pool_add(t_dev_pool *pool, char *name, char *iface, mpr_dev device,
+                                void *data, int persist, double now)
+{
+    t_pooled_dev *d = (t_pooled_dev *)malloc(sizeof(t_pooled_dev));
+    d->name = name;
+    d->iface = iface;
+    d->device = device;
+    d->data = data;
+    d->released = now;
+    d->persist = persist;
+    d->next = pool->devs;
+    if (!pool->devs)
+        clock_delay(pool->clock, DEV_POOL_INTERVAL);
+    pool->devs = d;
+}
+
+// remove and return the device released with this name and interface, or 0; the
+// caller owns it and frees it with dev_pool_forget() once it has taken the device
+static inline t_pooled_dev *dev_pool_take(t_dev_pool *pool, const char *name, const char *iface)
+{
+    t_pooled_dev **prev = &pool->devs;
+    while (*prev) {
+        t_pooled_dev *d = *prev;
+        if (   strcmp(d->name, name) == 0
+            && (d->iface ? (iface && strcmp(d->iface, iface) == 0) : !iface)) {
+            *prev = d->next;
+            if (!pool->devs)
+                clock_unset(pool->clock);
+            return d;
+        }
+        prev = &d->next;
+    }
+    return 0;
+}
+
+static inline void dev_pool_forget(t_pooled_dev *d)
+{
+    free(d->name);
+    if (d->iface)
+        free(d->iface);
+    free(d);
+}
+
+// keep released devices on the network until they are adopted or expire
+static inline void dev_pool_poll(t_dev_pool *pool, double now)
+{
+    t_pooled_dev **prev = &pool->devs;
+    while (*prev) {
+        t_pooled_dev *d = *prev;
+        int count = 10;
+        if (now - d->released > d->persist) {
+            *prev = d->next;
+            dev_pool_free(pool, d);
+            continue;
+        }
+        while (count-- && mpr_dev_poll(d->device, 0)) {};
+        prev = &d->next;
+    }
+    if (pool->devs)
+        clock_delay(pool->clock, DEV_POOL_INTERVAL);
+}
+
+// free the devices still waiting when the host quits, so that they leave the network
+static inline void dev_pool_quit(t_dev_pool *pool)
+{
+    pool->closed = 1;
+    while (pool->devs) {
+        t_pooled_dev *d = pool->devs;
+        pool->devs = d->next;
+        dev_pool_free(pool, d);
+    }
+    if (pool->clock) {
+        clock_unset(pool->clock);
+        clock_free(pool->clock);
+        pool->clock = 0;
+    }
+}
+
+#endif
@@ -0,0 +1,39 @@
+//
+// latency.h
+// histogram of the latency of timestamped updates of one signal, kept by mapper and
+// mpr.device with @timestamps and read with their "latency" message
+// http://www.libmapper.org
+//
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#define LATENCY_BUCKETS 12  // latency histogram, powers of two from 1 ms
+
+// latency of timestamped updates in ms, bucket k counts latencies below 2^k ms
+// and the last one all others
+typedef struct _latency
+{
+    int                 count;
+    double              min, max, sum;
+    int                 buckets[LATENCY_BUCKETS];
+} t_latency;
+
+static inline void latency_add(t_latency *l, double ms)
+{
+    double edge = 1.;
+    int k = 0;
+    while (k < LATENCY_BUCKETS - 1 && ms >= edge) {
+        edge *= 2.;
+        ++k;
+    }
+    ++l->buckets[k];
+    if (!l->count || ms < l->min)
+        l->min = ms;
+    if (!l->count || ms > l->max)
+        l->max = ms;
+    l->sum += ms;
+    ++l->count;
+}
+
+#endif
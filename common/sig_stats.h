@@ -0,0 +1,60 @@
+//
+// sig_stats.h
+// traffic counters of one libmapper signal, read with the "stats" message of mapper
+// and mpr.device. mpr.device owns the counters of its signals and counts incoming
+// updates, mpr.out counts outgoing updates through the pointer returned by the
+// device's "sig_stats" method.
+// http://www.libmapper.org
+//
+
+#ifndef SIG_STATS_H
+#define SIG_STATS_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define STATS_WINDOW 5      // seconds in the sliding window of update rates
+
+typedef struct _sig_stats
+{
+    uint32_t            in, out;        // updates received and sent
+    uint64_t            bytes;          // value payload in both directions
+    uint32_t            coalesced;      // updates replaced by a later one before output
+    uint32_t            suppressed;     // updates received while no object could output them
+    float               max_handler;    // longest time spent outputting an update, in ms
+    double              last;           // time of the last update in ms
+    long                window_sec;     // second counted by the newest window slot
+    uint32_t            window[STATS_WINDOW];   // updates per second
+} t_sig_stats;
+
+// count an update of 'len' values at time 'now' in ms
+static inline void stats_count(t_sig_stats *st, double now, int len)
+{
+    long sec = (long)(now * 0.001), k;
+    if (sec != st->window_sec) {
+        if (sec - st->window_sec >= STATS_WINDOW || sec < st->window_sec)
+            memset(st->window, 0, sizeof(st->window));
+        else {
+            for (k = st->window_sec + 1; k <= sec; k++)
+                st->window[k % STATS_WINDOW] = 0;
+        }
+        st->window_sec = sec;
+    }
+    ++st->window[sec % STATS_WINDOW];
+    st->bytes += len * sizeof(float);
+    st->last = now;
+}
+
+// updates per second over the window, the current second counting pro rata
+static inline float stats_rate(t_sig_stats *st, double now)
+{
+    long sec = (long)(now * 0.001), k;
+    uint32_t sum = 0;
+    for (k = sec - STATS_WINDOW + 1; k <= sec; k++) {
+        if (k >= 0 && k <= st->window_sec && k > st->window_sec - STATS_WINDOW)
+            sum += st->window[k % STATS_WINDOW];
+    }
+    return sum / (float)(STATS_WINDOW - 1 + (now - sec * 1000.) * 0.001);
+}
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "BundleCache.h"
+#include "FileSystem.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <stdlib.h>
+
+#define MANIFEST_NAME       ".dylibbundler_cache"
+#define MANIFEST_HEADER     "# dylibbundler cache 1"
+
+BundleCache::BundleCache()
+{
+}
+
+void BundleCache::load(std::string folder)
+{
+    dest_folder = folder;
+    entries.clear();
+
+    std::ifstream file((dest_folder + MANIFEST_NAME).c_str());
+    std::string line;
+    if(!std::getline(file, line) or line != MANIFEST_HEADER) return;
+
+    // one library per line: name, source, then the three hashes, tab-separated
+    while(std::getline(file, line))
+    {
+        std::vector<std::string> fields;
+        std::istringstream in(line);
+        for(std::string field; std::getline(in, field, '\t'); ) fields.push_back(field);
+        if(fields.size() != 5) continue;
+
+        Entry entry;
+        entry.source = fields[1];
+        entry.source_hash = strtoull(fields[2].c_str(), NULL, 16);
+        entry.edits_hash = strtoull(fields[3].c_str(), NULL, 16);
+        entry.output_hash = strtoull(fields[4].c_str(), NULL, 16);
+        entries[fields[0]] = entry;
+    }
+}
+
+bool BundleCache::save(std::string* error)
+{
+    const std::string path = dest_folder + MANIFEST_NAME;
+    const std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path.c_str());
+        file << MANIFEST_HEADER << "\n" << std::hex;
+        for(std::map<std::string, Entry>::iterator it = entries.begin(); it != entries.end(); it++)
+        {
+            file << it->first << "\t" << it->second.source << "\t" << it->second.source_hash << "\t"
+                 << it->second.edits_hash << "\t" << it->second.output_hash << "\n";
+        }
+        if(!file.flush())
+        {
+            *error = "cannot write " + temp_path;
+            return false;
+        }
+    }
+    // replace the old manifest in one step so an interrupted run leaves a valid one
+    return renameFile(temp_path, path, error);
+}
+
+bool BundleCache::isUpToDate(std::string name, uint64_t source_hash, uint64_t edits_hash) const
+{
+    std::map<std::string, Entry>::const_iterator it = entries.find(name);
+    if(it == entries.end()) return false;
+    const Entry& entry = it->second;
+    if(entry.source_hash != source_hash or entry.edits_hash != edits_hash) return false;
+
+    uint64_t output_hash;
+    return hashFile(dest_folder + name, &output_hash) and output_hash == entry.output_hash;
+}
+
+bool BundleCache::owns(std::string name) const
+{
+    return entries.find(name) != entries.end();
+}
+
+void BundleCache::record(std::string name, std::string source, uint64_t source_hash,
+                         uint64_t edits_hash, uint64_t output_hash)
+{
+    Entry& entry = entries[name];
+    entry.source = source;
+    entry.source_hash = source_hash;
+    entry.edits_hash = edits_hash;
+    entry.output_hash = output_hash;
+}
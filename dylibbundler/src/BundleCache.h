@@ -0,0 +1,60 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef _bundle_cache_h_
+#define _bundle_cache_h_
+
+#include <string>
+#include <map>
+#include <stdint.h>
+
+// Remembers, in a manifest kept in the destination folder, what each bundled
+// library was made from: the hash of its source, of the edits applied to it
+// and of the result. Later runs then only copy and rewrite the libraries whose
+// source or edits changed, or whose copy was modified since. Libraries that
+// are no longer needed are left alone, as they always were.
+
+class BundleCache
+{
+public:
+    BundleCache();
+
+    void load(std::string dest_folder);
+    bool save(std::string* error);
+
+    // true if 'name' in the destination folder is up to date
+    bool isUpToDate(std::string name, uint64_t source_hash, uint64_t edits_hash) const;
+    // true if 'name' was produced by an earlier run, and may be replaced
+    bool owns(std::string name) const;
+    void record(std::string name, std::string source, uint64_t source_hash,
+                uint64_t edits_hash, uint64_t output_hash);
+
+
+private:
+    struct Entry
+    {
+        std::string source;
+        uint64_t source_hash;
+        uint64_t edits_hash;
+        uint64_t output_hash;
+    };
+
+    std::string dest_folder;
+    std::map<std::string, Entry> entries;
+};
+
+#endif
@@ -18,10 +18,12 @@
 #include <iostream>
 #include "Utils.h"
 #include "Settings.h"
+#include "MachO.h"
 
 #include <stdlib.h>
 #include <sstream>
 #include <vector>
+#include <unordered_map>
 
 std::string stripPrefix(std::string in)
 {
@@ -30,9 +32,31 @@ std::string stripPrefix(std::string in)
 
 //the pathes to search for dylibs, store it globally to parse the environment variables only once
 std::vector<std::string> pathes;
+bool pathes_initialized = false;
+
+//file name -> directory of the first search path that contains it
+std::unordered_map<std::string, std::string> library_index;
+
+//add the files of a search path to the index, with one scan of the directory
+void indexSearchPath(std::string path)
+{
+    std::vector<std::string> names;
+    if( !listDirectory(path, &names) ) return;
+    for( size_t i=0; i<names.size(); ++i )
+    {
+        // earlier search pathes take precedence
+        library_index.insert( std::make_pair(names[i], path) );
+    }
+}
 
 //initialize the dylib search pathes
 void initSearchPathes(){
+    pathes_initialized = true;
+    
+    //user-given pathes first
+    for( int i=0; i<Settings::searchPathAmount(); ++i )
+        pathes.push_back( Settings::searchPath(i) );
+    
     //Check the same pathes the system would search for dylibs
     std::string searchPathes;
     char *dyldLibPath = std::getenv("DYLD_LIBRARY_PATH");
@@ -56,35 +80,32 @@ void initSearchPathes(){
         std::string item;
         while(std::getline(ss, item, ':'))
         {
+            if (item.empty()) continue;
             if (item[ item.size()-1 ] != '/') item += "/";
             pathes.push_back(item);
         }
     }
+    
+    for( size_t i=0; i<pathes.size(); ++i )
+        indexSearchPath( pathes[i] );
 }
 
 // if some libs are missing prefixes, this will be set to true
 // more stuff will then be necessary to do
 bool missing_prefixes = false;
 
-Dependency::Dependency(std::string path)
+Dependency::Dependency(std::string path) : found(true)
 {
     // check if given path is a symlink
-    std::string cmd = "readlink -n " + path;
-    const bool is_symlink = system( (cmd+" > /dev/null").c_str())==0;
-    if (is_symlink)
+    if (isSymlink(path))
     {
-        char original_file_buffer[PATH_MAX];
         std::string original_file;
         
-        if (not realpath(path.c_str(), original_file_buffer))
+        if (not resolvePath(path, &original_file))
         {
             std::cerr << "\n/!\\ WARNING : Cannot resolve symlink '" << path.c_str() << "'" << std::endl;
             original_file = path;
         }
-        else
-        {
-            original_file = original_file_buffer;
-        }
         //original_file = original_file.substr(0, original_file.find("\n") );
         
         filename = stripPrefix(original_file);
@@ -101,27 +122,31 @@ Dependency::Dependency(std::string path)
     if( !prefix.empty() && prefix[ prefix.size()-1 ] != '/' ) prefix += "/";
     if( prefix.empty() || !fileExists( prefix+filename ) )
     {
-        //the paths contains at least /usr/lib so if it is empty we have not initialized it
-        if( pathes.empty() ) initSearchPathes();
+        if( !pathes_initialized ) initSearchPathes();
         
         //check if file is contained in one of the pathes
-        for( size_t i=0; i<pathes.size(); ++i)
+        std::unordered_map<std::string, std::string>::const_iterator it = library_index.find(filename);
+        if( it != library_index.end() and fileExists( it->second+filename ) )
         {
-            if (fileExists( pathes[i]+filename ))
-            {
-                std::cout << "FOUND " << filename << " in " << pathes[i] << std::endl;
-                prefix = pathes[i];
-                missing_prefixes = true; //the prefix was missing
-                break;
-            }
+            std::cout << "FOUND " << filename << " in " << it->second << std::endl;
+            prefix = it->second;
+            missing_prefixes = true; //the prefix was missing
         }
     }
     
     //If the location is still unknown, ask the user for search path
     if( prefix.empty() || !fileExists( prefix+filename ) )
     {
-        std::cerr << "\n/!\\ WARNING : Library " << filename << " has an incomplete name (location unknown)" << std::endl;
         missing_prefixes = true;
+        if( !Settings::interactive() )
+        {
+            //reported by the caller, see isFound()
+            found = false;
+            new_name = filename;
+            return;
+        }
+        
+        std::cerr << "\n/!\\ WARNING : Library " << filename << " has an incomplete name (location unknown)" << std::endl;
         
         while (true)
         {
@@ -144,6 +169,7 @@ Dependency::Dependency(std::string path)
             else
             {
                 pathes.push_back( prefix );
+                indexSearchPath( prefix );
                 std::cerr << (prefix+filename) << " was found. /!\\MANUALLY CHECK THE EXECUTABLE WITH 'otool -L', DYLIBBUNDLDER MAY NOT HANDLE CORRECTLY THIS UNSTANDARD/ILL-FORMED DEPENDENCY" << std::endl;
                 break;
             }
@@ -166,7 +192,11 @@ void Dependency::print()
 
 std::string Dependency::getInstallPath()
 {
-    return Settings::destFolder() + new_name;
+    return getInstallPath(Settings::destFolder());
+}
+std::string Dependency::getInstallPath(std::string dest_folder)
+{
+    return dest_folder + new_name;
 }
 std::string Dependency::getInnerPath()
 {
@@ -190,71 +220,39 @@ bool Dependency::mergeIfSameAs(Dependency& dep2)
     return false;
 }
 
-void Dependency::copyYourself()
+void Dependency::copyYourself(std::string dest_folder, bool replace)
+{
+    copyFile(getOriginalPath(), getInstallPath(dest_folder), replace);
+}
+
+void Dependency::fixYourIdentity(MachOEditor& copied_file)
 {
-    copyFile(getOriginalPath(), getInstallPath());
-    
     // Fix the lib's inner name
-    std::string command = std::string("install_name_tool -id ") + getInnerPath() + " " + getInstallPath();
-    if( systemp( command ) != 0 )
-    {
-        std::cerr << "\n\nError : An error occured while trying to change identity of library " << getInstallPath() << std::endl;
-        exit(1);
-    }
+    copied_file.setInstallName(getInnerPath());
 }
 
-void Dependency::fixFileThatDependsOnMe(std::string file_to_fix)
+void Dependency::fixFileThatDependsOnMe(MachOEditor& file_to_fix)
 {
     // for main lib file
-    std::string command = std::string("install_name_tool -change ") +
-    getOriginalPath() + " " + getInnerPath() + " " + file_to_fix;
-    
-    if( systemp( command ) != 0 )
-    {
-        std::cerr << "\n\nError : An error occured while trying to fix depencies of " << file_to_fix << std::endl;
-        exit(1);
-    }
+    file_to_fix.changeDependency(getOriginalPath(), getInnerPath());
     
     // for symlinks
     const int symamount = symlinks.size();
     for(int n=0; n<symamount; n++)
     {
-        std::string command = std::string("install_name_tool -change ") +
-        prefix+symlinks[n] + " " + getInnerPath() + " " + file_to_fix;
-        
-        if( systemp( command ) != 0 )
-        {
-            std::cerr << "\n\nError : An error occured while trying to fix depencies of " << file_to_fix << std::endl;
-            exit(1);
-        }
+        file_to_fix.changeDependency(prefix+symlinks[n], getInnerPath());
     }
     
-    
     // FIXME - hackish
     if(missing_prefixes)
     {
         // for main lib file
-        std::string command = std::string("install_name_tool -change ") +
-        filename + " " + getInnerPath() + " " + file_to_fix;
-        
-        if( systemp( command ) != 0 )
-        {
-            std::cerr << "\n\nError : An error occured while trying to fix depencies of " << file_to_fix << std::endl;
-            exit(1);
-        }
+        file_to_fix.changeDependency(filename, getInnerPath());
         
         // for symlinks
-        const int symamount = symlinks.size();
         for(int n=0; n<symamount; n++)
         {
-            std::string command = std::string("install_name_tool -change ") +
-            symlinks[n] + " " + getInnerPath() + " " + file_to_fix;
-            
-            if( systemp( command ) != 0 )
-            {
-                std::cerr << "\n\nError : An error occured while trying to fix depencies of " << file_to_fix << std::endl;
-                exit(1);
-            }
+            file_to_fix.changeDependency(symlinks[n], getInnerPath());
         }//next
     }// end if(missing_prefixes)
 }
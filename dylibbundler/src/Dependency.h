@@ -21,6 +21,8 @@
 #include <string>
 #include <vector>
 
+class MachOEditor;
+
 class Dependency
 {
     // origin
@@ -30,6 +32,9 @@ class Dependency
     
     // installation
     std::string new_name;
+    
+    // false if the library could not be located in non-interactive mode
+    bool found;
 public:
     Dependency(std::string path);
 
@@ -38,6 +43,7 @@ public:
     std::string getOriginalFileName() const{ return filename; }
     std::string getOriginalPath() const{ return prefix+filename; }
     std::string getInstallPath();
+    std::string getInstallPath(std::string dest_folder);
     std::string getInnerPath();
         
     void addSymlink(std::string s);
@@ -45,9 +51,14 @@ public:
 
     std::string getSymlink(const int i) const{ return symlinks[i]; }
     std::string getPrefix() const{ return prefix; }
+    bool isFound() const{ return found; }
 
-    void copyYourself();
-    void fixFileThatDependsOnMe(std::string file);
+    // 'replace' allows overwriting an earlier copy
+    void copyYourself(std::string dest_folder, bool replace = false);
+    // queue the edits on the copied file (its id) and on the files that link
+    // against this one; they are applied together by MachOEditor::apply()
+    void fixYourIdentity(MachOEditor& copied_file);
+    void fixFileThatDependsOnMe(MachOEditor& file_to_fix);
     
     // comapres the given Dependency with this one. If both refer to the same file,
     // it returns true and merges both entries into one.
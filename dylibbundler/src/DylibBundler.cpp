@@ -16,117 +16,406 @@
 
 #include "DylibBundler.h"
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+#include <map>
+#include <stdio.h>
+#include <sys/stat.h>
 #include "Utils.h"
 #include "Settings.h"
 #include "Dependency.h"
+#include "MachO.h"
+#include "BundleCache.h"
+#include "Profile.h"
 
 
 std::vector<Dependency> deps;
+// indices into 'deps' of the libraries each library links against
+std::vector<std::vector<int> > dep_links;
 
-void changeLibPathsOnFile(std::string file_to_fix)
+// files to fix, and the libraries each of them links against
+std::vector<std::string> files;
+std::vector<std::string> file_dest_folders;
+std::vector<std::vector<int> > file_links;
+size_t files_parsed = 0;
+
+// indices into 'deps'; install names map to -1 when they are not bundled
+std::unordered_map<std::string, int> deps_by_install_name;
+std::unordered_map<std::string, int> deps_by_canonical_path;
+std::unordered_map<std::string, int> deps_by_inode;
+std::unordered_map<std::string, int> deps_by_filename;
+
+// install names that could not be located (in non-interactive mode), with
+// the files that refer to them
+std::map<std::string, std::vector<std::string> > missing_libraries;
+
+// queue on 'editor' every edit a file needs: its own id if it is the copy of
+// 'self', and the new paths of the libraries in 'links' it links against
+void queueLibPathChanges(MachOEditor& editor, const std::vector<int>& links, Dependency* self = NULL)
+{
+    if(self) self->fixYourIdentity(editor);
+    
+    const int link_amount = links.size();
+    for(int n=0; n<link_amount; n++)
+    {
+        deps[ links[n] ].fixFileThatDependsOnMe(editor);
+    }
+}
+
+// 'phase' names this step in the profile
+void applyLibPathChanges(MachOEditor& editor, std::string file_to_fix, const char* phase)
 {
     std::cout << "\n* Fixing dependencies on " << file_to_fix.c_str() << std::endl;
+    Profile::Scope scope(phase, file_to_fix);
     
-    const int dep_amount = deps.size();
-    for(int n=0; n<dep_amount; n++)
+    std::string error;
+    if(!editor.apply(&error))
     {
-        deps[n].fixFileThatDependsOnMe(file_to_fix);
+        std::cerr << "\n\nError : An error occured while trying to fix depencies of " << file_to_fix << " : " << error << std::endl;
+        exit(1);
     }
+    editor.print();
+    if(editor.needsSigning()) adhocCodeSign(file_to_fix);
 }
 
-void addDependency(std::string path)
+void changeLibPathsOnFile(std::string file_to_fix, const std::vector<int>& links)
 {
-    if(path.compare(0, 9, "/usr/lib/") == 0) return;
+    // gather every edit for this file, then rewrite it once
+    MachOEditor editor(file_to_fix);
+    queueLibPathChanges(editor, links);
+    applyLibPathChanges(editor, file_to_fix, "change-fix");
+}
 
-    Dependency dep(path);
+// 'materialized' holds, for each library, its first finished copy in this run
+typedef std::unordered_map<int, std::string> MaterializedCopies;
+
+// copy and fix library 'n' into 'dest_folder', unless the copy from an earlier
+// run is still good. Once a library has been made for one destination, the
+// other destinations share that copy instead of repeating the work.
+void bundleDependency(const int n, std::string dest_folder, BundleCache& cache,
+                      const std::vector<uint64_t>& source_hashes, MaterializedCopies& materialized)
+{
+    Dependency& dep = deps[n];
+    const std::string install_path = dep.getInstallPath(dest_folder);
+    const std::string name = install_path.substr(dest_folder.size());
     
-    // we need to check if this library was already added to avoid duplicates
-    const int dep_amount = deps.size();
-    for(int n=0; n<dep_amount; n++)
+    MachOEditor editor(install_path);
+    queueLibPathChanges(editor, dep_links[n], &dep);
+    
+    const uint64_t edits_hash = hashString(editor.getEdits());
+    bool up_to_date = false;
+    if(Settings::useCache())
     {
-        if(dep.mergeIfSameAs(deps[n])) return;
+        Profile::Scope scope("cache", install_path);
+        up_to_date = cache.isUpToDate(name, source_hashes[n], edits_hash);
+    }
+    if(up_to_date)
+    {
+        std::cout << "\n* " << install_path << " is up to date" << std::endl;
+        if(materialized.find(n) == materialized.end()) materialized[n] = install_path;
+        return;
     }
     
-    if(!Settings::isPrefixBundled(dep.getPrefix())) return;
+    MaterializedCopies::iterator it = materialized.find(n);
+    if(it != materialized.end())
+    {
+        std::cout << "\n* Sharing " << it->second << " as " << install_path << std::endl;
+        Profile::Scope scope("copy", install_path);
+        Profile::countFilesShared();
+        std::string error;
+        if(!linkOrCopyFile(it->second, install_path, Settings::canOverwriteFiles() or cache.owns(name), &error))
+        {
+            std::cerr << "\n\nError : An error occured while trying to copy file " << it->second << " to " << install_path << " : " << error << std::endl;
+            exit(1);
+        }
+    }
+    else
+    {
+        {
+            Profile::Scope scope("copy", install_path);
+            dep.copyYourself(dest_folder, cache.owns(name));
+        }
+        applyLibPathChanges(editor, install_path, "id-fix");
+        materialized[n] = install_path;
+    }
     
-    deps.push_back(dep);
+    Profile::Scope scope("cache", install_path);
+    uint64_t output_hash;
+    if(Settings::useCache() and hashFile(install_path, &output_hash))
+        cache.record(name, dep.getOriginalPath(), source_hashes[n], edits_hash, output_hash);
 }
 
 /*
- *  Fill vector 'lines' with dependencies of given 'filename'
+ *  Returns the index in 'deps' of the library with install name 'path', adding it
+ *  if needed, or -1 if it is not to be bundled. Each install name is resolved once.
  */
-void collectDependencies(std::string filename, std::vector<std::string>& lines)
+int addDependency(std::string path)
 {
-    // execute "otool -L" on the given file and collect the command's output
-    std::string cmd = "otool -L " + filename;
-    std::string output = system_get_output(cmd);
+    std::unordered_map<std::string, int>::iterator it = deps_by_install_name.find(path);
+    if(it != deps_by_install_name.end()) return it->second;
+    int& memo = deps_by_install_name[path];
+    memo = -1;
+
+    if(path.compare(0, 9, "/usr/lib/") == 0) return -1;
 
-    if(output.find("can't open file")!=std::string::npos or output.find("No such file")!=std::string::npos or output.size()<1)
+    Dependency dep(path);
+    if(!dep.isFound())
     {
-        std::cerr << "Cannot find file " << filename << " to read its dependencies" << std::endl;
-        exit(1);
+        missing_libraries[path];
+        return -1;
+    }
+    
+    // the same file may be reached through symlinks or other directories
+    std::string canonical_path;
+    if(!resolvePath(dep.getOriginalPath(), &canonical_path)) canonical_path = dep.getOriginalPath();
+    struct stat st;
+    std::string inode;
+    if(stat(canonical_path.c_str(), &st) == 0)
+    {
+        std::ostringstream key;
+        key << st.st_dev << ":" << st.st_ino;
+        inode = key.str();
+    }
+
+    int index = -1;
+    if((it = deps_by_canonical_path.find(canonical_path)) != deps_by_canonical_path.end()) index = it->second;
+    else if(!inode.empty() and (it = deps_by_inode.find(inode)) != deps_by_inode.end()) index = it->second;
+    // libraries with the same file name would overwrite each other in the
+    // bundle, so they are treated as one as before
+    else if((it = deps_by_filename.find(dep.getOriginalFileName())) != deps_by_filename.end()) index = it->second;
+
+    if(index >= 0)
+    {
+        deps[index].mergeIfSameAs(dep);
+        memo = index;
+        return index;
     }
     
-    // split output
-    tokenize(output, "\n", &lines);
+    if(!Settings::isPrefixBundled(dep.getPrefix())) return -1;
+    
+    index = deps.size();
+    deps.push_back(dep);
+    dep_links.push_back(std::vector<int>());
+    deps_by_canonical_path[canonical_path] = index;
+    if(!inode.empty()) deps_by_inode[inode] = index;
+    deps_by_filename[dep.getOriginalFileName()] = index;
+    memo = index;
+    return index;
 }
 
+/*
+ *  Fill vector 'libs' with the install names of the dependencies of given 'filename'
+ */
+bool collectDependencies(std::string filename, std::vector<std::string>& libs, std::string& error)
+{
+    Profile::Scope scope("parse", filename);
+    
+    // read the load commands straight from the file instead of parsing 'otool -L'
+    MachOFile file(filename);
+    if(!file.isValid())
+    {
+        error = "Cannot read dependencies of file " + filename + " (" + file.getError() + ")";
+        return false;
+    }
+
+    libs = file.getDependencies();
+    return true;
+}
 
-void collectDependencies(std::string filename)
+/*
+ *  Parse the files in 'paths' on a pool of worker threads. Parsing only reads
+ *  the files; resolving what they depend on stays on the calling thread.
+ */
+void collectDependenciesInParallel(const std::vector<std::string>& paths, std::vector<std::vector<std::string> >& libs)
 {
-    std::vector<std::string> lines;
-    collectDependencies(filename, lines);
-       
-    std::cout << "."; fflush(stdout);
-    
-    const int line_amount = lines.size();
-    for(int n=0; n<line_amount; n++)
-    {
-        std::cout << "."; fflush(stdout);
-        if(lines[n][0] != '\t') continue; // only lines beginning with a tab interest us
-        else if (lines[n][1] == '@') {
-            std::cout << "Skipping path relative to @executable_path"; fflush(stdout);
-            continue;
+    const size_t amount = paths.size();
+    std::vector<std::string> errors(amount);
+    libs.assign(amount, std::vector<std::string>());
+
+    std::atomic<size_t> next(0);
+    size_t worker_amount = std::thread::hardware_concurrency();
+    if(worker_amount < 1) worker_amount = 1;
+    if(worker_amount > amount) worker_amount = amount;
+
+    std::function<void()> work = [&]()
+    {
+        for(size_t n; (n = next++) < amount; )
+            collectDependencies(paths[n], libs[n], errors[n]);
+    };
+    std::vector<std::thread> workers;
+    for(size_t w=1; w<worker_amount; w++) workers.push_back(std::thread(work));
+    work();
+    for(size_t w=0; w<workers.size(); w++) workers[w].join();
+
+    for(size_t n=0; n<amount; n++)
+    {
+        if(!errors[n].empty())
+        {
+            std::cerr << errors[n] << std::endl;
+            exit(1);
         }
-        
-        addDependency( // trim useless info, keep only library name
-                       lines[n].substr(1, lines[n].find(" (") )
-                       );
     }
 }
+
+void collectDependencies(std::string filename, std::string dest_folder)
+{
+    files.push_back(filename);
+    file_dest_folders.push_back(dest_folder);
+    file_links.push_back(std::vector<int>());
+}
+
 void collectSubDependencies()
 {
-    // print status to user
-    int dep_amount = deps.size();
-    
-    // recursively collect each dependencie's dependencies
-    while(true)
+    // parse breadth-first: every library found in one round is parsed in the next
+    size_t deps_parsed = 0;
+    while(files_parsed < files.size() or deps_parsed < deps.size())
     {
-        dep_amount = deps.size();
-        for(int n=0; n<dep_amount; n++)
+        Profile::Scope scope(files_parsed < files.size() ? "collect" : "sub-collect");
+        std::vector<std::string> paths;
+        for(size_t n=files_parsed; n<files.size(); n++) paths.push_back(files[n]);
+        for(size_t n=deps_parsed; n<deps.size(); n++) paths.push_back(deps[n].getOriginalPath());
+        
+        std::vector<std::vector<std::string> > libs;
+        collectDependenciesInParallel(paths, libs);
+        
+        const size_t file_amount = files.size() - files_parsed;
+        const size_t path_amount = paths.size();
+        for(size_t p=0; p<path_amount; p++)
         {
             std::cout << "."; fflush(stdout);
-            std::vector<std::string> lines;
-            collectDependencies(deps[n].getOriginalPath(), lines);
+            const bool is_file = p < file_amount;
+            // collected apart since adding dependencies grows 'dep_links'
+            std::vector<int> links;
             
-            const int line_amount = lines.size();
-            for(int n=0; n<line_amount; n++)
+            const int lib_amount = libs[p].size();
+            for(int n=0; n<lib_amount; n++)
             {
-                if(lines[n][0] != '\t') continue; // only lines beginning with a tab interest us
+                if (is_file and libs[p][n][0] == '@') {
+                    std::cout << "Skipping path relative to @executable_path"; fflush(stdout);
+                    continue;
+                }
                 
-                addDependency( // trim useless info, keep only library name
-                               lines[n].substr(1, lines[n].find(" (") )
-                               );
+                const int index = addDependency(libs[p][n]);
+                if(index >= 0 and std::find(links.begin(), links.end(), index) == links.end())
+                    links.push_back(index);
+                else if(index < 0 and missing_libraries.count(libs[p][n]))
+                    missing_libraries[ libs[p][n] ].push_back(paths[p]);
             }//next
+            
+            if(is_file) file_links[files_parsed + p] = links;
+            else dep_links[deps_parsed + p - file_amount] = links;
         }//next
         
-        if(deps.size() == dep_amount) break; // no more dependencies were added on this iteration, stop searching
+        files_parsed += file_amount;
+        deps_parsed += path_amount - file_amount;
     }
+    
+    if(!missing_libraries.empty())
+    {
+        std::cerr << "\n\nError : " << missing_libraries.size() << " libraries could not be located:" << std::endl;
+        for(std::map<std::string, std::vector<std::string> >::iterator it = missing_libraries.begin(); it != missing_libraries.end(); it++)
+        {
+            std::cerr << "  " << it->first << std::endl;
+            for(size_t n=0; n<it->second.size(); n++)
+                std::cerr << "      needed by " << it->second[n] << std::endl;
+        }
+        std::cerr << "Pass the directories that contain them with -s, or run without -ni to be asked." << std::endl;
+        exit(1);
+    }
+}
+
+static std::string jsonString(const std::string& s)
+{
+    std::string out = "\"";
+    for(size_t n=0; n<s.size(); n++)
+    {
+        const unsigned char c = s[n];
+        if(c == '"' or c == '\\') { out += '\\'; out += c; }
+        else if(c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        }
+        else out += c;
+    }
+    return out + "\"";
+}
+
+static void printLinks(std::ostream& out, const std::vector<int>& links)
+{
+    out << "[";
+    for(size_t n=0; n<links.size(); n++) out << (n ? ", " : "") << links[n];
+    out << "]";
 }
 
-void createDestDir()
+void printDependencyGraph(std::string path)
+{
+    std::ofstream file;
+    if(path != "-")
+    {
+        file.open(path.c_str());
+        if(!file)
+        {
+            std::cerr << "\n\nError : Cannot write dependency graph to " << path << std::endl;
+            exit(1);
+        }
+    }
+    std::ostream& out = (path == "-") ? std::cout : file;
+    
+    // "links" refer to indices in "libraries"
+    out << "{\n  \"files\": [";
+    for(size_t n=0; n<files.size(); n++)
+    {
+        out << (n ? "," : "") << "\n    {\"path\": " << jsonString(files[n])
+            << ", \"dest_dir\": " << jsonString(file_dest_folders[n]) << ", \"links\": ";
+        printLinks(out, file_links[n]);
+        out << "}";
+    }
+    out << "\n  ],\n  \"libraries\": [";
+    for(size_t n=0; n<deps.size(); n++)
+    {
+        out << (n ? "," : "") << "\n    {\"path\": " << jsonString(deps[n].getOriginalPath())
+            << ", \"inner_path\": " << jsonString(deps[n].getInnerPath()) << ", \"symlinks\": [";
+        for(int s=0; s<deps[n].getSymlinkAmount(); s++)
+            out << (s ? ", " : "") << jsonString(deps[n].getPrefix() + deps[n].getSymlink(s));
+        out << "], \"links\": ";
+        printLinks(out, dep_links[n]);
+        out << "}";
+    }
+    out << "\n  ]\n}" << std::endl;
+}
+
+// the libraries reachable from the files that bundle into 'dest_folder'
+std::vector<bool> librariesNeededIn(std::string dest_folder)
+{
+    std::vector<bool> needed(deps.size(), false);
+    std::vector<int> pending;
+    for(size_t n=0; n<files.size(); n++)
+    {
+        if(file_dest_folders[n] == dest_folder)
+            pending.insert(pending.end(), file_links[n].begin(), file_links[n].end());
+    }
+    if(files.empty()) needed.assign(deps.size(), true);
+    
+    while(!pending.empty())
+    {
+        const int n = pending.back();
+        pending.pop_back();
+        if(needed[n]) continue;
+        needed[n] = true;
+        pending.insert(pending.end(), dep_links[n].begin(), dep_links[n].end());
+    }
+    return needed;
+}
+
+void createDestDir(std::string dest_folder)
 {
-    std::string dest_folder = Settings::destFolder();
     std::cout << "* Checking output directory " << dest_folder.c_str() << std::endl;
 	
 	// ----------- check dest folder stuff ----------
@@ -135,10 +424,10 @@ void createDestDir()
 	if(dest_exists and Settings::canOverwriteDir())
 	{
         std::cout << "* Erasing old output directory " << dest_folder.c_str() << std::endl;
-        std::string command = std::string("rm -r ") + dest_folder;
-		if( systemp( command ) != 0)
+        std::string error;
+		if( !removeRecursively(dest_folder, &error) )
 		{
-            std::cerr << "\n\nError : An error occured while attempting to override dest folder." << std::endl;
+            std::cerr << "\n\nError : An error occured while attempting to override dest folder : " << error << std::endl;
 			exit(1);
 		}
 		dest_exists = false;
@@ -150,10 +439,10 @@ void createDestDir()
 		if(Settings::canCreateDir())
 		{
             std::cout << "* Creating output directory " << dest_folder.c_str() << std::endl;
-            std::string command = std::string("mkdir -p ") + dest_folder;
-			if( systemp( command ) != 0)
+            std::string error;
+			if( !createDirectories(dest_folder, &error) )
 			{
-                std::cerr << "\n\nError : An error occured while creating dest folder." << std::endl;
+                std::cerr << "\n\nError : An error occured while creating dest folder : " << error << std::endl;
 				exit(1);
 			}
 		}
@@ -180,18 +469,57 @@ void doneWithDeps_go()
     // copy files if requested by user
     if(Settings::bundleLibs())
     {
-        createDestDir();
+        std::vector<uint64_t> source_hashes(dep_amount, 0);
+        if(Settings::useCache())
+        {
+            Profile::Scope scope("cache", "source hashes");
+            for(int n=0; n<dep_amount; n++)
+            {
+                std::string error;
+                if(!hashFile(deps[n].getOriginalPath(), &source_hashes[n], &error))
+                {
+                    std::cerr << "\n\nError : " << error << std::endl;
+                    exit(1);
+                }
+            }
+        }
+        
+        // each destination folder gets the libraries its files need
+        std::vector<std::string> dest_folders;
+        for(size_t n=0; n<files.size(); n++)
+        {
+            if(std::find(dest_folders.begin(), dest_folders.end(), file_dest_folders[n]) == dest_folders.end())
+                dest_folders.push_back(file_dest_folders[n]);
+        }
+        // without files to fix, everything goes to the default folder as before
+        if(dest_folders.empty()) dest_folders.push_back(Settings::destFolder());
         
-        for(int n=0; n<dep_amount; n++)
+        MaterializedCopies materialized;
+        for(size_t d=0; d<dest_folders.size(); d++)
         {
-            deps[n].copyYourself();
-            changeLibPathsOnFile(deps[n].getInstallPath());
+            createDestDir(dest_folders[d]);
+            
+            BundleCache cache;
+            if(Settings::useCache()) cache.load(dest_folders[d]);
+            
+            const std::vector<bool> needed = librariesNeededIn(dest_folders[d]);
+            for(int n=0; n<dep_amount; n++)
+            {
+                if(needed[n]) bundleDependency(n, dest_folders[d], cache, source_hashes, materialized);
+            }
+            
+            if(Settings::useCache())
+            {
+                std::string error;
+                if(!cache.save(&error))
+                    std::cerr << "\n/!\\ WARNING : Cannot save bundle cache : " << error << std::endl;
+            }
         }
     }
     
-    const int fileToFixAmount = Settings::fileToFixAmount();
+    const int fileToFixAmount = files.size();
     for(int n=0; n<fileToFixAmount; n++)
     {
-        changeLibPathsOnFile(Settings::fileToFix(n));
+        changeLibPathsOnFile(files[n], file_links[n]);
     }
 }
@@ -19,8 +19,14 @@
 
 #include <string>
 
-void collectDependencies(std::string filename);
+// queue a file to fix, whose libraries are bundled into 'dest_folder'; its
+// dependencies are resolved by collectSubDependencies()
+void collectDependencies(std::string filename, std::string dest_folder);
+// parse every queued file and, recursively, every library they need, each
+// exactly once, parsing independent files in parallel
 void collectSubDependencies();
+// write the collected graph as JSON to 'path', or to stdout if it is '-'
+void printDependencyGraph(std::string path);
 void doneWithDeps_go();
 
 #endif
\ No newline at end of file
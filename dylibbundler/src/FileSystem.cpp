@@ -0,0 +1,241 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "FileSystem.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __APPLE__
+#include <copyfile.h>
+#include <sys/clonefile.h>
+#endif
+
+static bool fail(std::string* error, const std::string& what, const std::string& path)
+{
+    if(error) *error = what + " '" + path + "' : " + strerror(errno);
+    return false;
+}
+
+bool fileExists(std::string path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+bool isDirectory(std::string path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 and S_ISDIR(st.st_mode);
+}
+
+bool isSymlink(std::string path)
+{
+    struct stat st;
+    return lstat(path.c_str(), &st) == 0 and S_ISLNK(st.st_mode);
+}
+
+bool listDirectory(std::string path, std::vector<std::string>* names, std::string* error)
+{
+    DIR* dir = opendir(path.c_str());
+    if(!dir) return fail(error, "cannot read directory", path);
+    for(struct dirent* entry; (entry = readdir(dir)) != NULL; )
+    {
+        if(entry->d_type == DT_DIR) continue;
+        names->push_back(entry->d_name);
+    }
+    closedir(dir);
+    return true;
+}
+
+bool resolvePath(std::string path, std::string* resolved, std::string* error)
+{
+    char buffer[PATH_MAX];
+    if(!realpath(path.c_str(), buffer)) return fail(error, "cannot resolve", path);
+    *resolved = buffer;
+    return true;
+}
+
+// copy everything from 'in' to 'out', using the fastest path the system offers
+static bool copyData(int in, int out)
+{
+#ifdef __APPLE__
+    // may clone the file on APFS
+    return fcopyfile(in, out, NULL, COPYFILE_DATA) == 0;
+#else
+    char buffer[65536];
+    ssize_t amount;
+    while((amount = read(in, buffer, sizeof(buffer))) != 0)
+    {
+        if(amount < 0)
+        {
+            if(errno == EINTR) continue;
+            return false;
+        }
+        for(ssize_t written = 0; written < amount; )
+        {
+            const ssize_t w = write(out, buffer + written, amount - written);
+            if(w < 0)
+            {
+                if(errno == EINTR) continue;
+                return false;
+            }
+            written += w;
+        }
+    }
+    return true;
+#endif
+}
+
+bool copyFileContents(std::string from, std::string to, bool overwrite, std::string* error)
+{
+    struct stat st;
+    const int in = open(from.c_str(), O_RDONLY);
+    if(in < 0 or fstat(in, &st) != 0)
+    {
+        fail(error, "cannot open", from);
+        if(in >= 0) close(in);
+        return false;
+    }
+
+    // replace rather than truncate, so other links to the old file are kept intact
+    if(overwrite and unlink(to.c_str()) != 0 and errno != ENOENT)
+    {
+        fail(error, "cannot replace", to);
+        close(in);
+        return false;
+    }
+
+    // what 'chmod +w' used to do after 'cp'
+    const mode_t mode = (st.st_mode & 07777) | S_IWUSR;
+    const int out = open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL, mode);
+    if(out < 0)
+    {
+        fail(error, "cannot create", to);
+        close(in);
+        return false;
+    }
+
+    bool ok = copyData(in, out);
+    if(!ok) fail(error, "cannot copy to", to);
+    // the mode given to open() is subject to the umask
+    else if(fchmod(out, mode) != 0) ok = fail(error, "cannot set permissions on", to);
+    if(close(out) != 0 and ok) ok = fail(error, "cannot write", to);
+    close(in);
+    return ok;
+}
+
+bool linkOrCopyFile(std::string from, std::string to, bool overwrite, std::string* error)
+{
+    if(overwrite and unlink(to.c_str()) != 0 and errno != ENOENT) return fail(error, "cannot replace", to);
+#ifdef __APPLE__
+    if(clonefile(from.c_str(), to.c_str(), 0) == 0) return true;
+#endif
+    if(link(from.c_str(), to.c_str()) == 0) return true;
+    return copyFileContents(from, to, false, error);
+}
+
+bool renameFile(std::string from, std::string to, std::string* error)
+{
+    if(rename(from.c_str(), to.c_str()) != 0) return fail(error, "cannot rename", from);
+    return true;
+}
+
+#define FNV_OFFSET_BASIS    0xcbf29ce484222325ULL
+#define FNV_PRIME           0x100000001b3ULL
+
+static uint64_t fnv1a(uint64_t hash, const unsigned char* data, size_t size)
+{
+    for(size_t n=0; n<size; n++)
+    {
+        hash ^= data[n];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+bool hashFile(std::string path, uint64_t* hash, std::string* error)
+{
+    struct stat st;
+    const int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0 or fstat(fd, &st) != 0)
+    {
+        fail(error, "cannot open", path);
+        if(fd >= 0) close(fd);
+        return false;
+    }
+
+    *hash = FNV_OFFSET_BASIS;
+    if(st.st_size > 0)
+    {
+        void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map == MAP_FAILED)
+        {
+            fail(error, "cannot map", path);
+            close(fd);
+            return false;
+        }
+        *hash = fnv1a(*hash, (const unsigned char*)map, st.st_size);
+        munmap(map, st.st_size);
+    }
+    close(fd);
+    return true;
+}
+
+uint64_t hashString(const std::string& s)
+{
+    return fnv1a(FNV_OFFSET_BASIS, (const unsigned char*)s.data(), s.size());
+}
+
+bool createDirectories(std::string path, std::string* error)
+{
+    if(path.empty()) return true;
+
+    // create each missing component in turn
+    for(size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1))
+    {
+        const std::string part = path.substr(0, pos);
+        if(!part.empty() and mkdir(part.c_str(), 0755) != 0 and errno != EEXIST)
+            return fail(error, "cannot create directory", part);
+        if(pos == std::string::npos) break;
+    }
+    if(!isDirectory(path))
+    {
+        errno = ENOTDIR;
+        return fail(error, "cannot create directory", path);
+    }
+    return true;
+}
+
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*)
+{
+    return remove(path) == 0 ? 0 : -1;
+}
+
+bool removeRecursively(std::string path, std::string* error)
+{
+    // children first, without following symlinks out of the tree
+    if(nftw(path.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS) != 0)
+        return fail(error, "cannot remove", path);
+    return true;
+}
@@ -0,0 +1,63 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef _filesystem_h_
+#define _filesystem_h_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Thin wrappers around the file system calls dylibbundler needs, so that no
+// shell command is spawned to probe, copy or create files (and paths that
+// contain spaces work). Failing calls return false and set 'error' when given.
+
+bool fileExists(std::string path);
+bool isDirectory(std::string path);
+bool isSymlink(std::string path);
+
+// the names of the entries of a directory, except '.' and '..' and
+// subdirectories (as far as the directory listing tells)
+bool listDirectory(std::string path, std::vector<std::string>* names, std::string* error = NULL);
+
+// canonical absolute path with all symlinks resolved, like realpath(3)
+bool resolvePath(std::string path, std::string* resolved, std::string* error = NULL);
+
+// copies the contents and permission bits of 'from' and makes the copy
+// writable by its owner. Fails if 'to' exists and 'overwrite' is false;
+// otherwise 'to' is unlinked first.
+bool copyFileContents(std::string from, std::string to, bool overwrite, std::string* error = NULL);
+
+// renames 'from' to 'to', replacing 'to' atomically if it exists
+bool renameFile(std::string from, std::string to, std::string* error = NULL);
+
+// 64-bit FNV-1a hash of the contents of a file, or of a string
+bool hashFile(std::string path, uint64_t* hash, std::string* error = NULL);
+uint64_t hashString(const std::string& s);
+
+// makes 'to' a copy of 'from' that shares its storage when possible: an APFS
+// clone on macOS, else a hard link, else a plain copy. Files written this way
+// must be replaced, not modified in place, as copyFileContents() does.
+bool linkOrCopyFile(std::string from, std::string to, bool overwrite, std::string* error = NULL);
+
+// like 'mkdir -p'
+bool createDirectories(std::string path, std::string* error = NULL);
+
+// like 'rm -r', does not follow symlinks
+bool removeRecursively(std::string path, std::string* error = NULL);
+
+#endif
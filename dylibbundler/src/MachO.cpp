@@ -0,0 +1,566 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MachO.h"
+#include <algorithm>
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// values from <mach-o/loader.h> and <mach-o/fat.h>
+#define MH_MAGIC                0xfeedfaceU
+#define MH_CIGAM                0xcefaedfeU
+#define MH_MAGIC_64             0xfeedfacfU
+#define MH_CIGAM_64             0xcffaedfeU
+#define FAT_MAGIC               0xcafebabeU
+#define FAT_CIGAM               0xbebafecaU
+#define FAT_MAGIC_64            0xcafebabfU
+#define FAT_CIGAM_64            0xbfbafecaU
+
+#define LC_REQ_DYLD             0x80000000U
+#define LC_LOAD_DYLIB           0x0cU
+#define LC_ID_DYLIB             0x0dU
+#define LC_LOAD_WEAK_DYLIB      (0x18U | LC_REQ_DYLD)
+#define LC_RPATH                (0x1cU | LC_REQ_DYLD)
+#define LC_REEXPORT_DYLIB       (0x1fU | LC_REQ_DYLD)
+#define LC_LAZY_LOAD_DYLIB      0x20U
+#define LC_LOAD_UPWARD_DYLIB    (0x23U | LC_REQ_DYLD)
+#define LC_SEGMENT              0x01U
+#define LC_SEGMENT_64           0x19U
+#define LC_CODE_SIGNATURE       0x1dU
+
+#define SECTION_TYPE            0xffU
+#define S_ZEROFILL              0x01U
+#define S_GB_ZEROFILL           0x0cU
+#define S_THREAD_LOCAL_ZEROFILL 0x12U
+
+#define MACH_HEADER_SIZE        28
+#define MACH_HEADER_64_SIZE     32
+#define FAT_ARCH_SIZE           20
+#define FAT_ARCH_64_SIZE        32
+#define SEGMENT_COMMAND_SIZE    56
+#define SEGMENT_COMMAND_64_SIZE 72
+#define SECTION_SIZE            68
+#define SECTION_64_SIZE         80
+#define DYLIB_COMMAND_SIZE      24
+#define RPATH_COMMAND_SIZE      12
+
+// more architectures than this in one fat file means it is probably a Java class
+#define MAX_FAT_ARCHS           32
+
+static uint32_t swap32(uint32_t v)
+{
+    return ((v & 0xff) << 24) | ((v & 0xff00) << 8) | ((v >> 8) & 0xff00) | (v >> 24);
+}
+
+static uint32_t read32(const unsigned char* p, bool swap)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return swap ? swap32(v) : v;
+}
+
+static uint64_t read64(const unsigned char* p, bool swap)
+{
+    const uint64_t lo = read32(p, swap), hi = read32(p + 4, swap);
+    return swap ? ((lo << 32) | hi) : ((hi << 32) | lo);
+}
+
+static void write32(unsigned char* p, uint32_t v, bool swap)
+{
+    if(swap) v = swap32(v);
+    memcpy(p, &v, 4);
+}
+
+// fat headers are always big-endian
+static uint32_t readBE32(const unsigned char* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t readBE64(const unsigned char* p)
+{
+    return ((uint64_t)readBE32(p) << 32) | readBE32(p + 4);
+}
+
+static void addUnique(std::vector<std::string>& list, const std::string& s)
+{
+    if(std::find(list.begin(), list.end(), s) == list.end()) list.push_back(s);
+}
+
+MachOFile::MachOFile(std::string path) : path(path), valid(false), fd(-1), data(NULL), data_size(0), is_signed(false)
+{
+    struct stat st;
+
+    fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0 or fstat(fd, &st) != 0)
+    {
+        error = "cannot open file";
+        return;
+    }
+    if(st.st_size < 4)
+    {
+        error = "file too small";
+        return;
+    }
+    data_size = st.st_size;
+    void* map = mmap(NULL, data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(map == MAP_FAILED)
+    {
+        error = "cannot map file";
+        return;
+    }
+    data = (unsigned char*)map;
+
+    const uint32_t magic = readBE32(data);
+    if(magic == FAT_MAGIC or magic == FAT_MAGIC_64)
+    {
+        const bool fat64 = (magic == FAT_MAGIC_64);
+        const size_t arch_size = fat64 ? FAT_ARCH_64_SIZE : FAT_ARCH_SIZE;
+        if(data_size < 8)
+        {
+            error = "truncated fat header";
+            return;
+        }
+        const uint32_t nfat_arch = readBE32(data + 4);
+        if(nfat_arch == 0 or nfat_arch > MAX_FAT_ARCHS or 8 + nfat_arch * arch_size > data_size)
+        {
+            error = "not a Mach-O file";
+            return;
+        }
+        for(uint32_t n=0; n<nfat_arch; n++)
+        {
+            const unsigned char* arch = data + 8 + n * arch_size;
+            const uint32_t cputype = readBE32(arch);
+            const uint64_t offset = fat64 ? readBE64(arch + 8) : readBE32(arch + 8);
+            const uint64_t size = fat64 ? readBE64(arch + 16) : readBE32(arch + 12);
+            if(!addSlice(cputype, offset, size)) return;
+        }
+    }
+    else if(!addSlice(0, 0, data_size))
+    {
+        return;
+    }
+
+    for(size_t n=0; n<slices.size(); n++)
+    {
+        if(!parseSlice(slices[n])) return;
+    }
+    valid = true;
+}
+
+MachOFile::~MachOFile()
+{
+    if(data) munmap(data, data_size);
+    if(fd >= 0) close(fd);
+}
+
+bool MachOFile::addSlice(uint32_t cputype, size_t offset, size_t size)
+{
+    Slice slice;
+
+    if(offset > data_size or size > data_size - offset or size < 4)
+    {
+        error = "slice out of bounds";
+        return false;
+    }
+
+    uint32_t magic;
+    memcpy(&magic, data + offset, 4);
+    switch(magic)
+    {
+        case MH_MAGIC:    slice.is64 = false; slice.swap = false; break;
+        case MH_CIGAM:    slice.is64 = false; slice.swap = true;  break;
+        case MH_MAGIC_64: slice.is64 = true;  slice.swap = false; break;
+        case MH_CIGAM_64: slice.is64 = true;  slice.swap = true;  break;
+        default:
+            error = "not a Mach-O file";
+            return false;
+    }
+    if(size < (slice.is64 ? MACH_HEADER_64_SIZE : MACH_HEADER_SIZE))
+    {
+        error = "truncated mach header";
+        return false;
+    }
+    slice.offset = offset;
+    slice.size = size;
+    slice.cputype = read32(data + offset + 4, slice.swap);
+    if(cputype && cputype != slice.cputype)
+    {
+        error = "fat header does not match slice";
+        return false;
+    }
+    slices.push_back(slice);
+    return true;
+}
+
+bool MachOFile::parseSlice(const Slice& slice)
+{
+    const unsigned char* header = data + slice.offset;
+    const size_t header_size = slice.is64 ? MACH_HEADER_64_SIZE : MACH_HEADER_SIZE;
+    const uint32_t ncmds = read32(header + 16, slice.swap);
+    const uint32_t sizeofcmds = read32(header + 20, slice.swap);
+
+    if(header_size + (size_t)sizeofcmds > slice.size)
+    {
+        error = "load commands out of bounds";
+        return false;
+    }
+
+    const unsigned char* cmd = header + header_size;
+    const unsigned char* end = cmd + sizeofcmds;
+    for(uint32_t n=0; n<ncmds; n++)
+    {
+        if(end - cmd < 8)
+        {
+            error = "truncated load command";
+            return false;
+        }
+        const uint32_t type = read32(cmd, slice.swap);
+        const uint32_t cmdsize = read32(cmd + 4, slice.swap);
+        if(cmdsize < 8 or cmdsize > (size_t)(end - cmd))
+        {
+            error = "bad load command size";
+            return false;
+        }
+
+        switch(type)
+        {
+            case LC_ID_DYLIB:
+            case LC_LOAD_DYLIB:
+            case LC_LOAD_WEAK_DYLIB:
+            case LC_REEXPORT_DYLIB:
+            case LC_LAZY_LOAD_DYLIB:
+            case LC_LOAD_UPWARD_DYLIB:
+            case LC_RPATH:
+            {
+                // dylib_command and rpath_command both start with an lc_str offset
+                if(cmdsize < 12)
+                {
+                    error = "truncated load command";
+                    return false;
+                }
+                const uint32_t str_offset = read32(cmd + 8, slice.swap);
+                if(str_offset >= cmdsize)
+                {
+                    error = "bad load command string";
+                    return false;
+                }
+                const char* str = (const char*)cmd + str_offset;
+                const std::string name(str, strnlen(str, cmdsize - str_offset));
+
+                if(type == LC_ID_DYLIB)
+                {
+                    if(install_name.empty()) install_name = name;
+                }
+                else if(type == LC_RPATH) addUnique(rpaths, name);
+                else addUnique(dependencies, name);
+                break;
+            }
+            case LC_CODE_SIGNATURE:
+                is_signed = true;
+                break;
+            default:
+                break;
+        }
+        cmd += cmdsize;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+
+// the string of a dylib or rpath load command, empty if it is malformed
+static std::string loadCommandString(const unsigned char* cmd, uint32_t cmdsize, bool swap)
+{
+    if(cmdsize < 12) return "";
+    const uint32_t str_offset = read32(cmd + 8, swap);
+    if(str_offset >= cmdsize) return "";
+    const char* str = (const char*)cmd + str_offset;
+    return std::string(str, strnlen(str, cmdsize - str_offset));
+}
+
+// build a load command whose fixed part is 'fixed_size' bytes copied from
+// 'fixed', followed by 'str' padded to the pointer alignment of the slice
+static std::string buildStringCommand(const unsigned char* fixed, size_t fixed_size,
+                                      const std::string& str, bool is64, bool swap)
+{
+    const size_t align = is64 ? 8 : 4;
+    const size_t size = (fixed_size + str.size() + 1 + align - 1) & ~(align - 1);
+    std::string cmd(size, '\0');
+    unsigned char* p = (unsigned char*)&cmd[0];
+    memcpy(p, fixed, fixed_size);
+    write32(p + 4, size, swap);
+    write32(p + 8, fixed_size, swap);
+    memcpy(p + fixed_size, str.c_str(), str.size());
+    return cmd;
+}
+
+static const std::string* findChange(const std::vector<std::pair<std::string, std::string> >& changes,
+                                     const std::string& name)
+{
+    for(size_t n=0; n<changes.size(); n++)
+    {
+        if(changes[n].first == name) return &changes[n].second;
+    }
+    return NULL;
+}
+
+MachOEditor::MachOEditor(std::string path) : path(path), needs_signing(false)
+{
+}
+
+void MachOEditor::changeDependency(std::string old_name, std::string new_name)
+{
+    if(old_name != new_name and !findChange(dependency_changes, old_name))
+        dependency_changes.push_back(std::make_pair(old_name, new_name));
+}
+
+void MachOEditor::setInstallName(std::string name)
+{
+    new_install_name = name;
+}
+
+void MachOEditor::addRpath(std::string rpath)
+{
+    addUnique(rpaths_to_add, rpath);
+}
+
+void MachOEditor::deleteRpath(std::string rpath)
+{
+    addUnique(rpaths_to_delete, rpath);
+}
+
+void MachOEditor::changeRpath(std::string old_rpath, std::string new_rpath)
+{
+    if(old_rpath != new_rpath and !findChange(rpath_changes, old_rpath))
+        rpath_changes.push_back(std::make_pair(old_rpath, new_rpath));
+}
+
+bool MachOEditor::apply(std::string* error)
+{
+    applied.clear();
+    needs_signing = false;
+    if(dependency_changes.empty() and rpath_changes.empty() and rpaths_to_add.empty()
+       and rpaths_to_delete.empty() and new_install_name.empty())
+        return true;
+
+    MachOFile file(path);
+    if(!file.isValid())
+    {
+        *error = file.getError();
+        return false;
+    }
+
+    int fd = open(path.c_str(), O_RDWR);
+    struct stat st;
+    if(fd < 0 or fstat(fd, &st) != 0)
+    {
+        if(fd >= 0) close(fd);
+        *error = "cannot open file for writing";
+        return false;
+    }
+    const size_t data_size = st.st_size;
+    void* map = mmap(NULL, data_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(map == MAP_FAILED)
+    {
+        close(fd);
+        *error = "cannot map file for writing";
+        return false;
+    }
+    unsigned char* data = (unsigned char*)map;
+
+    // first build the new load commands of every slice, so that nothing is
+    // written if any of them runs out of header padding
+    std::vector<std::string> new_cmds(file.getSliceAmount());
+    std::vector<uint32_t> new_ncmds(file.getSliceAmount());
+    std::vector<uint32_t> new_sizeofcmds(file.getSliceAmount());
+    std::vector<std::string> log;
+    bool ok = true;
+
+    for(int s=0; s<file.getSliceAmount() and ok; s++)
+    {
+        const MachOFile::Slice& slice = file.getSlice(s);
+        const unsigned char* header = data + slice.offset;
+        const size_t header_size = slice.is64 ? MACH_HEADER_64_SIZE : MACH_HEADER_SIZE;
+        const uint32_t ncmds = read32(header + 16, slice.swap);
+        const uint32_t sizeofcmds = read32(header + 20, slice.swap);
+
+        // the load commands may grow up to the first byte of file content
+        // that follows them: the first non-empty section or segment
+        uint64_t limit = slice.size;
+        std::string& out = new_cmds[s];
+        uint32_t count = 0;
+        std::vector<std::string> existing_rpaths;
+
+        const unsigned char* cmd = header + header_size;
+        for(uint32_t n=0; n<ncmds; n++)
+        {
+            // bounds were checked by MachOFile
+            const uint32_t type = read32(cmd, slice.swap);
+            const uint32_t cmdsize = read32(cmd + 4, slice.swap);
+            std::string replacement((const char*)cmd, cmdsize);
+
+            if(type == LC_SEGMENT or type == LC_SEGMENT_64)
+            {
+                const bool seg64 = (type == LC_SEGMENT_64);
+                const size_t seg_size = seg64 ? SEGMENT_COMMAND_64_SIZE : SEGMENT_COMMAND_SIZE;
+                const size_t sect_size = seg64 ? SECTION_64_SIZE : SECTION_SIZE;
+                if(cmdsize >= seg_size)
+                {
+                    const uint64_t fileoff = seg64 ? read64(cmd + 40, slice.swap) : read32(cmd + 32, slice.swap);
+                    const uint64_t filesize = seg64 ? read64(cmd + 48, slice.swap) : read32(cmd + 36, slice.swap);
+                    const uint32_t nsects = read32(cmd + (seg64 ? 64 : 48), slice.swap);
+                    if(fileoff > 0 and filesize > 0 and fileoff < limit) limit = fileoff;
+                    for(uint32_t i=0; i<nsects and seg_size + (i + 1) * sect_size <= cmdsize; i++)
+                    {
+                        const unsigned char* sect = cmd + seg_size + i * sect_size;
+                        const uint32_t offset = read32(sect + (seg64 ? 48 : 40), slice.swap);
+                        const uint32_t flags = read32(sect + (seg64 ? 64 : 56), slice.swap);
+                        const uint32_t sect_type = flags & SECTION_TYPE;
+                        if(sect_type == S_ZEROFILL or sect_type == S_GB_ZEROFILL
+                           or sect_type == S_THREAD_LOCAL_ZEROFILL)
+                            continue;
+                        if(offset > 0 and offset < limit) limit = offset;
+                    }
+                }
+            }
+            else if(type == LC_ID_DYLIB)
+            {
+                const std::string name = loadCommandString(cmd, cmdsize, slice.swap);
+                if(!new_install_name.empty() and cmdsize >= DYLIB_COMMAND_SIZE and name != new_install_name)
+                {
+                    replacement = buildStringCommand(cmd, DYLIB_COMMAND_SIZE, new_install_name,
+                                                     slice.is64, slice.swap);
+                    log.push_back("-id " + new_install_name);
+                }
+            }
+            else if(type == LC_LOAD_DYLIB or type == LC_LOAD_WEAK_DYLIB or type == LC_REEXPORT_DYLIB
+                    or type == LC_LAZY_LOAD_DYLIB or type == LC_LOAD_UPWARD_DYLIB)
+            {
+                const std::string name = loadCommandString(cmd, cmdsize, slice.swap);
+                const std::string* new_name = findChange(dependency_changes, name);
+                if(new_name and cmdsize >= DYLIB_COMMAND_SIZE)
+                {
+                    replacement = buildStringCommand(cmd, DYLIB_COMMAND_SIZE, *new_name,
+                                                     slice.is64, slice.swap);
+                    log.push_back("-change " + name + " " + *new_name);
+                }
+            }
+            else if(type == LC_RPATH)
+            {
+                const std::string name = loadCommandString(cmd, cmdsize, slice.swap);
+                const std::string* new_name = findChange(rpath_changes, name);
+                if(std::find(rpaths_to_delete.begin(), rpaths_to_delete.end(), name) != rpaths_to_delete.end())
+                {
+                    log.push_back("-delete_rpath " + name);
+                    cmd += cmdsize;
+                    continue;
+                }
+                if(new_name)
+                {
+                    replacement = buildStringCommand(cmd, RPATH_COMMAND_SIZE, *new_name,
+                                                     slice.is64, slice.swap);
+                    log.push_back("-rpath " + name + " " + *new_name);
+                    addUnique(existing_rpaths, *new_name);
+                }
+                else addUnique(existing_rpaths, name);
+            }
+
+            out += replacement;
+            count++;
+            cmd += cmdsize;
+        }
+
+        for(size_t n=0; n<rpaths_to_add.size(); n++)
+        {
+            if(std::find(existing_rpaths.begin(), existing_rpaths.end(), rpaths_to_add[n]) != existing_rpaths.end())
+                continue;
+            unsigned char fixed[RPATH_COMMAND_SIZE];
+            write32(fixed, LC_RPATH, slice.swap);
+            out += buildStringCommand(fixed, RPATH_COMMAND_SIZE, rpaths_to_add[n], slice.is64, slice.swap);
+            log.push_back("-add_rpath " + rpaths_to_add[n]);
+            count++;
+        }
+
+        if(header_size + out.size() > limit)
+        {
+            char missing[32];
+            snprintf(missing, sizeof(missing), "%lu", (unsigned long)(header_size + out.size() - limit));
+            *error = std::string("not enough header padding for the new load commands (needs ")
+                + missing + " more bytes); relink the file with -headerpad_max_install_names";
+            ok = false;
+        }
+        new_ncmds[s] = count;
+        new_sizeofcmds[s] = out.size();
+        // clear what the old commands occupied beyond the new ones
+        if(out.size() < sizeofcmds) out.resize(sizeofcmds, '\0');
+    }
+
+    // leave files that need no edit untouched, modification time included
+    if(ok and !log.empty())
+    {
+        for(int s=0; s<file.getSliceAmount(); s++)
+        {
+            const MachOFile::Slice& slice = file.getSlice(s);
+            unsigned char* header = data + slice.offset;
+            const size_t header_size = slice.is64 ? MACH_HEADER_64_SIZE : MACH_HEADER_SIZE;
+            memcpy(header + header_size, new_cmds[s].data(), new_cmds[s].size());
+            write32(header + 16, new_ncmds[s], slice.swap);
+            write32(header + 20, new_sizeofcmds[s], slice.swap);
+        }
+        if(msync(data, data_size, MS_SYNC) != 0)
+        {
+            *error = "cannot write file";
+            ok = false;
+        }
+        else
+        {
+            // fat files repeat the same edits once per slice
+            for(size_t n=0; n<log.size(); n++) addUnique(applied, log[n]);
+            needs_signing = file.isSigned();
+        }
+    }
+
+    munmap(data, data_size);
+    close(fd);
+    return ok;
+}
+
+std::string MachOEditor::getEdits() const
+{
+    std::string edits;
+    if(!new_install_name.empty()) edits += "-id " + new_install_name + "\n";
+    for(size_t n=0; n<dependency_changes.size(); n++)
+        edits += "-change " + dependency_changes[n].first + " " + dependency_changes[n].second + "\n";
+    for(size_t n=0; n<rpath_changes.size(); n++)
+        edits += "-rpath " + rpath_changes[n].first + " " + rpath_changes[n].second + "\n";
+    for(size_t n=0; n<rpaths_to_delete.size(); n++) edits += "-delete_rpath " + rpaths_to_delete[n] + "\n";
+    for(size_t n=0; n<rpaths_to_add.size(); n++) edits += "-add_rpath " + rpaths_to_add[n] + "\n";
+    return edits;
+}
+
+void MachOEditor::print()
+{
+    for(size_t n=0; n<applied.size(); n++)
+    {
+        std::cout << "    " << applied[n] << std::endl;
+    }
+}
@@ -0,0 +1,134 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef _macho_h_
+#define _macho_h_
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+#include <stddef.h>
+
+// Reads the dylib-related load commands of a Mach-O file directly from a
+// memory-mapped copy, replacing 'otool -L'. Thin files and fat/universal files
+// (32 and 64-bit fat headers) are supported, for any architecture. The
+// structures are decoded by hand so this also builds and runs on non-Apple
+// systems that lack <mach-o/loader.h>.
+
+class MachOFile
+{
+public:
+    // one architecture slice of the file
+    struct Slice
+    {
+        uint32_t cputype;
+        size_t offset;      // offset of the mach header in the file
+        size_t size;
+        bool is64;
+        bool swap;          // file endianness differs from ours
+    };
+
+    MachOFile(std::string path);
+    ~MachOFile();
+
+    // false if the file could not be mapped or is not a Mach-O file
+    bool isValid() const{ return valid; }
+    std::string getError() const{ return error; }
+    std::string getPath() const{ return path; }
+
+    int getSliceAmount() const{ return slices.size(); }
+    const Slice& getSlice(const int n) const{ return slices[n]; }
+
+    // LC_ID_DYLIB, empty if the file is not a dylib
+    std::string getInstallName() const{ return install_name; }
+    // LC_LOAD_DYLIB and its weak/re-export/lazy/upward variants, in load order,
+    // merged over all slices without duplicates
+    const std::vector<std::string>& getDependencies() const{ return dependencies; }
+    // LC_RPATH, merged over all slices without duplicates
+    const std::vector<std::string>& getRpaths() const{ return rpaths; }
+    // LC_CODE_SIGNATURE in any slice
+    bool isSigned() const{ return is_signed; }
+
+private:
+    std::string path;
+    std::string error;
+    bool valid;
+
+    int fd;
+    unsigned char* data;
+    size_t data_size;
+
+    std::vector<Slice> slices;
+    std::string install_name;
+    std::vector<std::string> dependencies;
+    std::vector<std::string> rpaths;
+    bool is_signed;
+
+    bool addSlice(uint32_t cputype, size_t offset, size_t size);
+    bool parseSlice(const Slice& slice);
+
+    MachOFile(const MachOFile&);
+    MachOFile& operator=(const MachOFile&);
+};
+
+// Collects every install name edit for one file and applies them all in a
+// single pass over the memory-mapped load commands of each slice, replacing
+// one 'install_name_tool' process per edit. Nothing is written unless the
+// edits fit in the header padding of every slice.
+class MachOEditor
+{
+public:
+    MachOEditor(std::string path);
+
+    // like 'install_name_tool -change old new'
+    void changeDependency(std::string old_name, std::string new_name);
+    // like 'install_name_tool -id name'
+    void setInstallName(std::string name);
+    // like 'install_name_tool -add_rpath / -delete_rpath / -rpath old new'
+    void addRpath(std::string rpath);
+    void deleteRpath(std::string rpath);
+    void changeRpath(std::string old_rpath, std::string new_rpath);
+
+    // rewrite the file; returns false and sets 'error' if the file could not be
+    // read or the new load commands do not fit
+    bool apply(std::string* error);
+
+    // the queued edits, one per line, whether they apply or not
+    std::string getEdits() const;
+
+    // print the edits that were actually applied
+    void print();
+
+    // the last apply() changed a signed file, whose signature no longer matches;
+    // arm64 macOS will not load it until it is signed again
+    bool needsSigning() const{ return needs_signing; }
+
+private:
+    std::string path;
+
+    std::vector<std::pair<std::string, std::string> > dependency_changes;
+    std::vector<std::pair<std::string, std::string> > rpath_changes;
+    std::vector<std::string> rpaths_to_add;
+    std::vector<std::string> rpaths_to_delete;
+    std::string new_install_name;
+
+    std::vector<std::string> applied;
+    bool needs_signing;
+};
+
+#endif
@@ -0,0 +1,175 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Profile.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <stdio.h>
+
+namespace Profile
+{
+
+struct Event
+{
+    const char* phase;
+    std::string detail;
+    int64_t start;      // microseconds since enable()
+    int64_t duration;
+    int thread;
+};
+
+bool enabled_bool = false;
+std::string output_path;
+std::chrono::steady_clock::time_point origin;
+
+std::mutex mutex;
+std::vector<Event> events;
+int thread_count = 0;
+uint64_t process_spawns = 0;
+uint64_t bytes_copied = 0;
+uint64_t files_shared = 0;
+
+static int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+// small stable numbers for the trace viewer, the main thread being 0;
+// called with 'mutex' held, or from enable()
+static int threadIndex()
+{
+    static thread_local int index = -1;
+    if(index < 0) index = thread_count++;
+    return index;
+}
+
+void enable(std::string path)
+{
+    enabled_bool = true;
+    output_path = path;
+    origin = std::chrono::steady_clock::now();
+    threadIndex();
+}
+
+bool enabled(){ return enabled_bool; }
+
+Scope::Scope(const char* phase, std::string detail) : phase(phase), detail(detail), start(0)
+{
+    if(enabled_bool) start = now();
+}
+
+Scope::~Scope()
+{
+    if(!enabled_bool) return;
+    Event event;
+    event.phase = phase;
+    event.detail = detail;
+    event.start = start;
+    event.duration = now() - start;
+    std::lock_guard<std::mutex> lock(mutex);
+    event.thread = threadIndex();
+    events.push_back(event);
+}
+
+void countProcessSpawn()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    process_spawns++;
+}
+
+void countBytesCopied(uint64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    bytes_copied += bytes;
+}
+
+void countFilesShared()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    files_shared++;
+}
+
+static std::string jsonString(const std::string& s)
+{
+    std::string out = "\"";
+    for(size_t n=0; n<s.size(); n++)
+    {
+        const unsigned char c = s[n];
+        if(c == '"' or c == '\\') { out += '\\'; out += c; }
+        else if(c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        }
+        else out += c;
+    }
+    return out + "\"";
+}
+
+bool write()
+{
+    if(!enabled_bool) return true;
+    std::lock_guard<std::mutex> lock(mutex);
+    const int64_t total = now();
+
+    // per phase: number of events and their summed duration; phases running
+    // on several threads at once may add up to more than the wall time
+    std::map<std::string, std::pair<int, int64_t> > phases;
+    for(size_t n=0; n<events.size(); n++)
+    {
+        std::pair<int, int64_t>& phase = phases[events[n].phase];
+        phase.first++;
+        phase.second += events[n].duration;
+    }
+
+    std::ofstream summary(output_path.c_str());
+    summary << "{\n  \"wall_time_ms\": " << total / 1000.0 << ",\n  \"phases\": {";
+    for(std::map<std::string, std::pair<int, int64_t> >::iterator it = phases.begin(); it != phases.end(); it++)
+    {
+        summary << (it == phases.begin() ? "" : ",") << "\n    " << jsonString(it->first)
+                << ": {\"count\": " << it->second.first << ", \"time_ms\": " << it->second.second / 1000.0 << "}";
+    }
+    summary << "\n  },\n  \"process_spawns\": " << process_spawns
+            << ",\n  \"bytes_copied\": " << bytes_copied
+            << ",\n  \"files_shared\": " << files_shared << "\n}" << std::endl;
+
+    const std::string trace_path = output_path + ".trace.json";
+    std::ofstream trace(trace_path.c_str());
+    trace << "{\"traceEvents\": [";
+    for(size_t n=0; n<events.size(); n++)
+    {
+        const Event& event = events[n];
+        trace << (n ? "," : "") << "\n  {\"name\": " << jsonString(event.detail.empty() ? event.phase : event.detail)
+              << ", \"cat\": " << jsonString(event.phase) << ", \"ph\": \"X\", \"ts\": " << event.start
+              << ", \"dur\": " << event.duration << ", \"pid\": 1, \"tid\": " << event.thread << "}";
+    }
+    trace << "\n], \"displayTimeUnit\": \"ms\"}" << std::endl;
+
+    if(!summary or !trace)
+    {
+        std::cerr << "\n/!\\ WARNING : Cannot write profile to " << output_path << std::endl;
+        return false;
+    }
+    std::cout << "* Profile written to " << output_path << " and " << trace_path << std::endl;
+    return true;
+}
+
+}
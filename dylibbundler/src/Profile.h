@@ -0,0 +1,57 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef _profile_h_
+#define _profile_h_
+
+#include <string>
+#include <stdint.h>
+
+// Optional instrumentation of a run (--profile): wall time per phase, external
+// processes spawned and bytes copied. Written at the end as a JSON summary and
+// as a Chrome trace-event file (chrome://tracing, Perfetto). Everything here is
+// a no-op unless enable() was called, and may be used from any thread.
+
+namespace Profile
+{
+
+// 'path' receives the summary, 'path'.trace.json the trace events
+void enable(std::string path);
+bool enabled();
+
+// times the enclosing block as one event of 'phase', e.g. "copy"
+class Scope
+{
+public:
+    Scope(const char* phase, std::string detail = "");
+    ~Scope();
+private:
+    const char* phase;
+    std::string detail;
+    int64_t start;
+};
+
+void countProcessSpawn();
+void countBytesCopied(uint64_t bytes);
+void countFilesShared();
+
+// writes both files; returns false if they could not be written
+bool write();
+
+}
+
+#endif
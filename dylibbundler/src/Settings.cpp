@@ -48,9 +48,19 @@ void destFolder(std::string path)
 }
 
 std::vector<std::string> files;
-void addFileToFix(std::string path){ files.push_back(path); }
+std::vector<std::string> file_dest_folders;
+void addFileToFix(std::string path, std::string dest)
+{
+    if( !dest.empty() && dest[ dest.size()-1 ] != '/' ) dest += "/";
+    files.push_back(path);
+    file_dest_folders.push_back(dest);
+}
 int fileToFixAmount(){ return files.size(); }
 std::string fileToFix(const int n){ return files[n]; }
+std::string fileToFixDestFolder(const int n)
+{
+    return file_dest_folders[n].empty() ? dest_folder_str : file_dest_folders[n];
+}
 
 std::string inside_path_str = "@executable_path/../libs/";
 std::string inside_lib_path(){ return inside_path_str; }
@@ -61,6 +71,27 @@ void inside_lib_path(std::string p)
 	if( inside_path_str[ inside_path_str.size()-1 ] != '/' ) inside_path_str += "/";
 }
 
+std::vector<std::string> search_paths;
+void addSearchPath(std::string path)
+{
+    if( !path.empty() && path[ path.size()-1 ] != '/' ) path += "/";
+    search_paths.push_back(path);
+}
+int searchPathAmount(){ return search_paths.size(); }
+std::string searchPath(const int n){ return search_paths[n]; }
+
+bool interactive_bool = true;
+bool interactive(){ return interactive_bool; }
+void interactive(bool on){ interactive_bool = on; }
+
+bool use_cache_bool = true;
+bool useCache(){ return use_cache_bool; }
+void useCache(bool on){ use_cache_bool = on; }
+
+std::string graph_file_str = "";
+std::string graphFile(){ return graph_file_str; }
+void graphFile(std::string path){ graph_file_str = path; }
+
 std::vector<std::string> prefixes_to_ignore;
 void ignore_prefix(std::string prefix)
 {
@@ -40,12 +40,31 @@ void bundleLibs(bool on);
 std::string destFolder();
 void destFolder(std::string path);
 
-void addFileToFix(std::string path);
+// 'dest' is where the libraries of this file go, empty for destFolder()
+void addFileToFix(std::string path, std::string dest = "");
 int fileToFixAmount();
 std::string fileToFix(const int n);
+std::string fileToFixDestFolder(const int n);
 
 std::string inside_lib_path();
 void inside_lib_path(std::string p);
 
+// directories searched for libraries with an incomplete install name
+void addSearchPath(std::string path);
+int searchPathAmount();
+std::string searchPath(const int n);
+
+// fail with a report instead of asking where missing libraries are
+bool interactive();
+void interactive(bool on);
+
+// keep a manifest in the dest folder and only rebuild libraries that changed
+bool useCache();
+void useCache(bool on);
+
+// where to write the dependency graph as JSON ('-' for stdout), empty for none
+std::string graphFile();
+void graphFile(std::string path);
+
 }
 #endif
\ No newline at end of file
@@ -18,6 +18,8 @@
 #include "Utils.h"
 #include "Dependency.h"
 #include "Settings.h"
+#include "MachO.h"
+#include "Profile.h"
 #include <iostream>
 #include <stdio.h>
 #include <sys/stat.h>
@@ -56,29 +58,23 @@ void tokenize(const string& str, const char* delim, vector<string>* vectorarg)
 }
 
 
-bool fileExists( std::string filename )
-{
-	//struct stat buffer ;
-	//if ( stat( filename, &buffer ) == 0 ) return true;
-	//return false;
-    
-    return system( (std::string("ls ")+filename+" > /dev/null").c_str() )==0;
-}
-
 void fixLibDependency(string old_lib_path, string new_lib_name, string target_file_name)
 {
+	MachOEditor editor(target_file_name);
+	editor.changeDependency(old_lib_path, Settings::inside_lib_path() + new_lib_name);
 
-	string command = string("install_name_tool -change ") + old_lib_path + string(" ") + Settings::inside_lib_path() + new_lib_name + string(" ") + target_file_name;
-	if( systemp( command ) != 0 )
+	string error;
+	if( !editor.apply(&error) )
 	{
-		cerr << "\n\nError : An error occured while trying to fix depency of " << old_lib_path << " in " << target_file_name << endl;
+		cerr << "\n\nError : An error occured while trying to fix depency of " << old_lib_path << " in " << target_file_name << " : " << error << endl;
 		exit(1);
 	}
+	if( editor.needsSigning() ) adhocCodeSign(target_file_name);
 }
 
-void copyFile(string from, string to)
+void copyFile(string from, string to, bool replace)
 {
-	bool override = Settings::canOverwriteFiles();
+	bool override = Settings::canOverwriteFiles() or replace;
 	if(!override)
 	{
 		if(fileExists( to ))
@@ -88,23 +84,17 @@ void copyFile(string from, string to)
 		}
 	}
 	
-	string override_permission = string(override ? "-f " : "-n ");
-		
-	// copy file to local directory
-	string command = string("cp ") + override_permission + from + string(" ") + to;
-	if( systemp( command ) != 0 )
+	// copy file to local directory, giving it write permission
+	cout << "    copying " << from << " to " << to << endl;
+	string error;
+	if( !copyFileContents(from, to, override, &error) )
 	{
-		cerr << "\n\nError : An error occured while trying to copy file " << from << " to " << to << endl;
+		cerr << "\n\nError : An error occured while trying to copy file " << from << " to " << to << " : " << error << endl;
 		exit(1);
 	}
 	
-	// give it write permission
-	string command2 = string("chmod +w ") + to;
-	if( systemp( command2 ) != 0 )
-	{
-		cerr << "\n\nError : An error occured while trying to set write permissions on file " << to << endl;
-		exit(1);
-	}
+	struct stat st;
+	if( stat(to.c_str(), &st) == 0 ) Profile::countBytesCopied(st.st_size);
 }
 
 std::string system_get_output(std::string cmd)
@@ -117,6 +107,7 @@ std::string system_get_output(std::string cmd)
     
     try
     {
+        Profile::countProcessSpawn();
         command_output = popen(cmd.c_str(), "r");
         if(command_output == NULL) throw;
         
@@ -147,5 +138,17 @@ std::string system_get_output(std::string cmd)
 int systemp(std::string& cmd)
 {
     std::cout << "    " << cmd.c_str() << std::endl;
+    Profile::countProcessSpawn();
     return system(cmd.c_str());
 }
+
+void adhocCodeSign(std::string file)
+{
+    // keep the entitlements and hardened runtime flags of the old signature
+    std::string cmd = "codesign --force --preserve-metadata=entitlements,requirements,flags,runtime --sign - \"" + file + "\"";
+    if(systemp(cmd) != 0)
+    {
+        std::cerr << "\n\nError : An error occured while trying to sign " << file << std::endl;
+        exit(1);
+    }
+}
@@ -20,13 +20,14 @@
 
 #include <string>
 #include <vector>
+#include "FileSystem.h"
 
 class Library;
 
 void tokenize(const std::string& str, const char* delimiters, std::vector<std::string>*);
-bool fileExists( std::string filename );
 
-void copyFile(std::string from, std::string to);
+// 'replace' allows overwriting 'to' even if overwriting files was not enabled
+void copyFile(std::string from, std::string to, bool replace = false);
 
 // executes a command in the native shell and returns output in string
 std::string system_get_output(std::string cmd);
@@ -34,4 +35,7 @@ std::string system_get_output(std::string cmd);
 // like 'system', runs a command on the system shell, but also prints the command to stdout.
 int systemp(std::string& cmd);
 
+// sign 'file' again, ad hoc, once editing its load commands broke its signature
+void adhocCodeSign(std::string file);
+
 #endif
\ No newline at end of file
@@ -16,10 +16,12 @@
 
 #include <iostream>
 #include <vector>
+#include <string.h>
 #include "Settings.h"
 
 #include "Utils.h"
 #include "DylibBundler.h"
+#include "Profile.h"
 
 /*
  TODO
@@ -44,6 +46,7 @@ void showHelp()
 	std::cout << "dylibbundler is a utility that helps bundle dynamic libraries inside mac OS X app bundles.\n" << std::endl;
 	
 	std::cout << "-x, --fix-file <file to fix (executable or app plug-in)>" << std::endl;
+    std::cout << "-t, --target <file to fix> <directory to send its bundled libraries> (may be repeated; libraries shared by several targets are resolved and parsed once)" << std::endl;
 	std::cout << "-b, --bundle-deps" << std::endl;
 	std::cout << "-d, --dest-dir <directory to send bundled libraries (relative to cwd)>" << std::endl;
     std::cout << "-p, --install-path <'inner' path of bundled libraries (usually relative to executable, by default '@executable_path/../libs/')>" << std::endl;
@@ -51,6 +54,11 @@ void showHelp()
 	std::cout << "-od, --overwrite-dir (totally overwrite output directory if it already exists. implies --create-dir)" << std::endl;
 	std::cout << "-cd, --create-dir (creates output directory if necessary)" << std::endl;
     std::cout << "-i, --ignore <location to ignore> (will ignore libraries in this directory)" << std::endl;
+    std::cout << "-s, --search-path <directory> (also look for libraries with an incomplete name in this directory)" << std::endl;
+    std::cout << "-ni, --non-interactive (do not ask where missing libraries are; report them all and fail)" << std::endl;
+    std::cout << "-nc, --no-cache (rebuild every bundled library, even if it is unchanged since the last run)" << std::endl;
+    std::cout << "--profile <file> (write timings per phase, process spawns and bytes copied as JSON to <file>, and a Chrome trace to <file>.trace.json)" << std::endl;
+    std::cout << "-g, --graph <file> (write the dependency graph as JSON, '-' for stdout)" << std::endl;
 	std::cout << "-h, --help" << std::endl;
 }
 
@@ -66,6 +74,18 @@ int main (int argc, char * const argv[])
             Settings::addFileToFix(argv[i]);
 			continue;
 		}
+		else if(strcmp(argv[i],"-t")==0 or strcmp(argv[i],"--target")==0)
+		{
+			i += 2;
+            if(i >= argc)
+            {
+                std::cerr << "Flag " << argv[i-2] << " needs a file and a destination directory" << std::endl << std::endl;
+                showHelp();
+                exit(1);
+            }
+            Settings::addFileToFix(argv[i-1], argv[i]);
+			continue;
+		}
 		else if(strcmp(argv[i],"-b")==0 or strcmp(argv[i],"--bundle-deps")==0)
 		{
             Settings::bundleLibs(true);
@@ -83,6 +103,34 @@ int main (int argc, char * const argv[])
             Settings::ignore_prefix(argv[i]);
 			continue;
 		}
+        else if(strcmp(argv[i],"-s")==0 or strcmp(argv[i],"--search-path")==0)
+		{
+			i++;
+            Settings::addSearchPath(argv[i]);
+			continue;
+		}
+        else if(strcmp(argv[i],"-ni")==0 or strcmp(argv[i],"--non-interactive")==0)
+		{
+            Settings::interactive(false);
+			continue;
+		}
+        else if(strcmp(argv[i],"-nc")==0 or strcmp(argv[i],"--no-cache")==0)
+		{
+            Settings::useCache(false);
+			continue;
+		}
+        else if(strcmp(argv[i],"--profile")==0)
+		{
+			i++;
+            Profile::enable(argv[i]);
+			continue;
+		}
+        else if(strcmp(argv[i],"-g")==0 or strcmp(argv[i],"--graph")==0)
+		{
+			i++;
+            Settings::graphFile(argv[i]);
+			continue;
+		}
 		else if(strcmp(argv[i],"-d")==0 or strcmp(argv[i],"--dest-dir")==0)
 		{
 			i++;
@@ -130,10 +178,12 @@ int main (int argc, char * const argv[])
     
     const int amount = Settings::fileToFixAmount();
     for(int n=0; n<amount; n++)
-        collectDependencies(Settings::fileToFix(n));
+        collectDependencies(Settings::fileToFix(n), Settings::fileToFixDestFolder(n));
     
     collectSubDependencies();
+    if(not Settings::graphFile().empty()) printDependencyGraph(Settings::graphFile());
     doneWithDeps_go();
+    Profile::write();
     
     return 0;
 }
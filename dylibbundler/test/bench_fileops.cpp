@@ -0,0 +1,181 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Times the file operations dylibbundler performs per bundled library, once
+// the way it used to (a shell command per probe, copy and directory change)
+// and once through FileSystem.h. A synthetic dependency tree is generated in a
+// temporary directory: 'count' libraries built from the thin_x86_64 fixture,
+// each reached through a 'libdepN.dylib -> libdepN.1.dylib' symlink as
+// installed libraries usually are. Both paths resolve every symlink, check
+// for an existing copy, copy the library into a fresh destination directory
+// and make it writable. The in-process path also reads and edits the install
+// name with MachOFile and MachOEditor, which the shell path only does on macOS
+// where otool and install_name_tool exist.
+//
+// Run from the dylibbundler directory with 'make bench', or as
+// './bench_fileops [count] [runs]'. Writes CSV to stdout:
+//     path,libraries,run,total_ms,ms_per_library,processes
+
+#include "FileSystem.h"
+#include "MachO.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define FIXTURE "./test/fixtures/thin_x86_64.dylib"
+
+static int processes = 0;
+
+static int run(const std::string& cmd)
+{
+    processes++;
+    return system(cmd.c_str());
+}
+
+static bool haveTool(const char* name)
+{
+    return system((std::string("command -v ") + name + " > /dev/null 2>&1").c_str()) == 0;
+}
+
+static std::string libName(int n, bool versioned)
+{
+    std::ostringstream s;
+    s << "libdep" << n << (versioned ? ".1.dylib" : ".dylib");
+    return s.str();
+}
+
+static bool makeTree(const std::string& dir, int count)
+{
+    std::ifstream in(FIXTURE, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if(data.empty()) return false;
+    if(!createDirectories(dir + "/lib")) return false;
+
+    for(int n=0; n<count; n++)
+    {
+        const std::string real = dir + "/lib/" + libName(n, true);
+        std::ofstream out(real.c_str(), std::ios::binary | std::ios::trunc);
+        out << data;
+        if(!out) return false;
+        if(symlink(libName(n, true).c_str(), (dir + "/lib/" + libName(n, false)).c_str()) != 0)
+            return false;
+    }
+    return true;
+}
+
+// what Dependency, copyFile and createDestDir did before FileSystem.h
+static bool shellPath(const std::string& dir, int count, bool tools)
+{
+    const std::string dest = dir + "/libs-shell/";
+    if(run("ls " + dest + " > /dev/null 2>&1") == 0 and run("rm -r " + dest) != 0) return false;
+    if(run("mkdir -p " + dest) != 0) return false;
+
+    for(int n=0; n<count; n++)
+    {
+        std::string path = dir + "/lib/" + libName(n, false);
+        if(run("readlink -n " + path + " > /dev/null") == 0)
+        {
+            char buffer[PATH_MAX];
+            if(!realpath(path.c_str(), buffer)) return false;
+            path = buffer;
+        }
+        const std::string to = dest + libName(n, true);
+        if(run("ls " + to + " > /dev/null 2>&1") == 0) return false;
+        if(run("cp -f " + path + " " + to) != 0) return false;
+        if(run("chmod +w " + to) != 0) return false;
+        if(tools)
+        {
+            if(run("otool -L " + to + " > /dev/null") != 0) return false;
+            if(run("install_name_tool -id @executable_path/../libs/" + libName(n, true) + " " + to) != 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool inProcessPath(const std::string& dir, int count)
+{
+    const std::string dest = dir + "/libs-syscall/";
+    if(fileExists(dest) and !removeRecursively(dest)) return false;
+    if(!createDirectories(dest)) return false;
+
+    for(int n=0; n<count; n++)
+    {
+        std::string path = dir + "/lib/" + libName(n, false);
+        if(isSymlink(path) and !resolvePath(path, &path)) return false;
+        const std::string to = dest + libName(n, true);
+        if(fileExists(to)) return false;
+        if(!copyFileContents(path, to, true)) return false;
+        if(!MachOFile(to).isValid()) return false;
+        MachOEditor editor(to);
+        editor.setInstallName("@executable_path/../libs/" + libName(n, true));
+        std::string error;
+        if(!editor.apply(&error)) return false;
+    }
+    return true;
+}
+
+static void report(const char* path, int count, int run, double ms, int spawned)
+{
+    std::cout << path << "," << count << "," << run << "," << ms << "," << ms / count << "," << spawned << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    const int count = argc > 1 ? atoi(argv[1]) : 200;
+    const int runs = argc > 2 ? atoi(argv[2]) : 3;
+    if(count < 1 or runs < 1)
+    {
+        std::cerr << "usage: bench_fileops [count] [runs]" << std::endl;
+        return 1;
+    }
+
+    char dir[] = "/tmp/bench_fileops.XXXXXX";
+    if(!mkdtemp(dir) or !makeTree(dir, count))
+    {
+        std::cerr << "bench_fileops: cannot create the dependency tree" << std::endl;
+        return 1;
+    }
+    const bool tools = haveTool("otool") and haveTool("install_name_tool");
+    if(!tools) std::cerr << "bench_fileops: no otool, the shell path skips reading and editing install names" << std::endl;
+
+    int status = 0;
+    std::cout << "path,libraries,run,total_ms,ms_per_library,processes" << std::endl;
+    for(int r=0; r<runs and status == 0; r++)
+    {
+        processes = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if(!shellPath(dir, count, tools)) status = 1;
+        std::chrono::duration<double, std::milli> shell = std::chrono::steady_clock::now() - start;
+        report(tools ? "shell" : "shell-no-otool", count, r, shell.count(), processes);
+
+        start = std::chrono::steady_clock::now();
+        if(!inProcessPath(dir, count)) status = 1;
+        std::chrono::duration<double, std::milli> syscall = std::chrono::steady_clock::now() - start;
+        report("in-process", count, r, syscall.count(), 0);
+    }
+
+    removeRecursively(dir);
+    if(status) std::cerr << "bench_fileops: a file operation failed" << std::endl;
+    return status;
+}
@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+#
+# Writes the small Mach-O files in fixtures/ that the dylibbundler tests read
+# and edit. They are laid out like real dylibs (header, load commands, header
+# padding, one __TEXT section) but contain no code, so they can be built on
+# any system. Run from this directory after changing a fixture; the output is
+# checked in.
+
+import os
+import struct
+
+MH_MAGIC = 0xfeedface
+MH_MAGIC_64 = 0xfeedfacf
+FAT_MAGIC = 0xcafebabe
+MH_DYLIB = 6
+
+CPU_TYPE_X86_64 = 0x01000007
+CPU_TYPE_ARM64 = 0x0100000c
+CPU_TYPE_POWERPC = 18
+
+CSMAGIC_EMBEDDED_SIGNATURE = 0xfade0cc0
+
+LC_REQ_DYLD = 0x80000000
+LC_SEGMENT = 0x01
+LC_LOAD_DYLIB = 0x0c
+LC_ID_DYLIB = 0x0d
+LC_SEGMENT_64 = 0x19
+LC_UUID = 0x1b
+LC_CODE_SIGNATURE = 0x1d
+LC_LOAD_WEAK_DYLIB = 0x18 | LC_REQ_DYLD
+LC_RPATH = 0x1c | LC_REQ_DYLD
+LC_REEXPORT_DYLIB = 0x1f | LC_REQ_DYLD
+LC_LAZY_LOAD_DYLIB = 0x20
+LC_LOAD_UPWARD_DYLIB = 0x23 | LC_REQ_DYLD
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+OUT = os.path.join(HERE, "fixtures")
+
+# load commands shared by every slice, in file order
+COMMON = [
+    (LC_ID_DYLIB, "@rpath/libfixture.dylib"),
+    (LC_LOAD_DYLIB, "/usr/local/lib/liblo.7.dylib"),
+    (LC_LOAD_DYLIB, "/usr/lib/libSystem.B.dylib"),
+    (LC_LOAD_WEAK_DYLIB, "/usr/local/lib/libweak.dylib"),
+    (LC_REEXPORT_DYLIB, "/usr/local/lib/libreexport.dylib"),
+    (LC_LAZY_LOAD_DYLIB, "/usr/local/lib/liblazy.dylib"),
+    (LC_LOAD_UPWARD_DYLIB, "/usr/local/lib/libupward.dylib"),
+    (LC_UUID, None),
+    (LC_RPATH, "@loader_path/../lib"),
+    (LC_RPATH, "/usr/local/lib"),
+]
+
+
+class Slice:
+    def __init__(self, cputype, is64=True, big_endian=False, commands=COMMON,
+                 headerpad=512, signed=False):
+        self.cputype = cputype
+        self.is64 = is64
+        self.endian = ">" if big_endian else "<"
+        self.commands = commands
+        self.headerpad = headerpad
+        self.signed = signed
+
+    def pack(self, fmt, *values):
+        return struct.pack(self.endian + fmt, *values)
+
+    def string_command(self, cmd, fixed, name):
+        align = 8 if self.is64 else 4
+        size = (len(fixed) + 8 + len(name) + 1 + align - 1) & ~(align - 1)
+        body = self.pack("II", cmd, size) + fixed + name.encode()
+        return body + b"\0" * (size - len(body))
+
+    def command(self, cmd, name):
+        if cmd == LC_UUID:
+            return self.pack("II", cmd, 24) + bytes(range(16))
+        if cmd == LC_RPATH:
+            return self.string_command(cmd, self.pack("I", 12), name)
+        # dylib_command: name offset, timestamp, current and compatibility version
+        return self.string_command(cmd, self.pack("IIII", 24, 2, 0x10000, 0x10000), name)
+
+    def segment(self, text_offset, file_size):
+        text = b"__TEXT".ljust(16, b"\0")
+        sect = b"__text".ljust(16, b"\0")
+        if self.is64:
+            section = sect + text + self.pack("QQIIIIIIII", 0x1000 + text_offset, 16,
+                                              text_offset, 4, 0, 0, 0x80000400, 0, 0, 0)
+            return self.pack("II", LC_SEGMENT_64, 72 + 80) + text + \
+                self.pack("QQQQiiII", 0x1000, 0x1000, 0, file_size, 5, 5, 1, 0) + section
+        section = sect + text + self.pack("IIIIIIIII", 0x1000 + text_offset, 16,
+                                          text_offset, 2, 0, 0, 0x80000400, 0, 0)
+        return self.pack("II", LC_SEGMENT, 56 + 68) + text + \
+            self.pack("IIIIiiII", 0x1000, 0x1000, 0, file_size, 5, 5, 1, 0) + section
+
+    def build(self):
+        header_size = 32 if self.is64 else 28
+        cmds = b"".join(self.command(c, n) for c, n in self.commands)
+        ncmds = len(self.commands) + 1
+        seg_size = len(self.segment(0, 0))
+        sig_size = 16 if self.signed else 0
+        text_offset = header_size + seg_size + len(cmds) + sig_size + self.headerpad
+        file_size = text_offset + 16
+        if self.signed:
+            # an empty superblob after the code, where the linker puts the signature
+            cmds += self.pack("IIII", LC_CODE_SIGNATURE, 16, file_size, 16)
+            ncmds += 1
+        cmds = self.segment(text_offset, file_size) + cmds
+        if self.is64:
+            header = self.pack("IIIIIIII", MH_MAGIC_64, self.cputype, 3, MH_DYLIB,
+                               ncmds, len(cmds), 0x00100085, 0)
+        else:
+            header = self.pack("IIIIIII", MH_MAGIC, self.cputype, 0, MH_DYLIB,
+                               ncmds, len(cmds), 0x00100085)
+        data = header + cmds
+        data += b"\0" * (text_offset - len(data))
+        data += b"\xc3" * 16
+        if self.signed:
+            data += struct.pack(">IIII", CSMAGIC_EMBEDDED_SIGNATURE, 16, 0, 0)
+        return data
+
+
+def fat(slices, align=10):
+    out = struct.pack(">II", FAT_MAGIC, len(slices))
+    offset = 1 << align
+    bodies = []
+    for s in slices:
+        body = s.build()
+        out += struct.pack(">IIIII", s.cputype, 3, offset, len(body), align)
+        bodies.append((offset, body))
+        offset += (len(body) + (1 << align) - 1) & ~((1 << align) - 1)
+    for offset, body in bodies:
+        out += b"\0" * (offset - len(out)) + body
+    return out
+
+
+def write(name, data):
+    with open(os.path.join(OUT, name), "wb") as f:
+        f.write(data)
+
+
+def main():
+    os.makedirs(OUT, exist_ok=True)
+    arm64_only = COMMON + [(LC_LOAD_DYLIB, "/opt/homebrew/lib/libmapper.1.dylib")]
+
+    thin = Slice(CPU_TYPE_X86_64).build()
+    write("thin_x86_64.dylib", thin)
+    write("thin_ppc.dylib", Slice(CPU_TYPE_POWERPC, is64=False, big_endian=True).build())
+    write("fat_x86_64_arm64.dylib", fat([Slice(CPU_TYPE_X86_64),
+                                         Slice(CPU_TYPE_ARM64, commands=arm64_only)]))
+    # arm64 code is always signed, ad hoc at least
+    write("thin_arm64_signed.dylib", Slice(CPU_TYPE_ARM64, signed=True).build())
+
+    # no room for load commands to grow, only edits that keep their size fit
+    write("tight_x86_64.dylib", Slice(CPU_TYPE_X86_64, headerpad=0).build())
+    write("fat_tight_arm64.dylib", fat([Slice(CPU_TYPE_X86_64),
+                                        Slice(CPU_TYPE_ARM64, headerpad=0)]))
+
+    # malformed files that must be rejected
+    write("not_macho.dylib", b"this is not a Mach-O file\n")
+    write("truncated.dylib", thin[:100])
+    write("truncated_header.dylib", thin[:30])
+    bad_size = bytearray(thin)
+    struct.pack_into("<I", bad_size, 32 + 4, 3)
+    write("bad_cmdsize.dylib", bytes(bad_size))
+    bad_string = bytearray(thin)
+    # the name offset of LC_ID_DYLIB, right after the __TEXT segment
+    struct.pack_into("<I", bad_string, 32 + 152 + 8, 0x1000)
+    write("bad_string.dylib", bytes(bad_string))
+    bad_slice = bytearray(fat([Slice(CPU_TYPE_X86_64), Slice(CPU_TYPE_ARM64)]))
+    struct.pack_into(">I", bad_slice, 8 + 20 + 8, 0x100000)
+    write("fat_bad_offset.dylib", bytes(bad_slice))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,317 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Applies MachOEditor edits to copies of the fixtures written by
+// make_fixtures.py and reads the result back with MachOFile. Every kind of
+// edit is also applied to a fixture without header padding, where it must
+// fail and leave the file byte for byte as it was. Run from the dylibbundler
+// directory with 'make test'.
+
+#include "MachO.h"
+#include "FileSystem.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+#define FIXTURES "./test/fixtures/"
+
+// longer than any name in the fixtures, so it never fits without padding
+#define LONG_NAME "@executable_path/../Frameworks/a/rather/long/path/to/liblo.7.dylib"
+
+static int failures = 0;
+static std::string tmpdir;
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+
+static void check(bool ok, const char* what, const char* file, int line)
+{
+    if(ok) return;
+    std::cerr << file << ":" << line << ": check failed: " << what << std::endl;
+    failures++;
+}
+
+static std::string readFile(const std::string& path)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// a fresh writable copy of a fixture
+static std::string copyFixture(const std::string& name)
+{
+    const std::string path = tmpdir + "/" + name;
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    out << readFile(FIXTURES + name);
+    return path;
+}
+
+static bool contains(const std::vector<std::string>& list, const std::string& s)
+{
+    return std::find(list.begin(), list.end(), s) != list.end();
+}
+
+// the part after the load commands must never move or change
+static bool sameContent(const std::string& a, const std::string& b)
+{
+    return a.size() == b.size() and a.size() >= 16 and a.compare(a.size() - 16, 16, b, b.size() - 16, 16) == 0;
+}
+
+// apply the edits to a copy of 'fixture', which must succeed
+static bool applies(const std::string& fixture, MachOEditor& editor)
+{
+    std::string error;
+    if(editor.apply(&error)) return true;
+    std::cerr << fixture << ": apply failed: " << error << std::endl;
+    return false;
+}
+
+// apply the edits to a copy of 'fixture', which must fail on the header
+// padding without writing anything
+static void doesNotFit(const std::string& fixture, MachOEditor& editor, const std::string& path)
+{
+    const std::string before = readFile(path);
+    std::string error;
+    if(editor.apply(&error) or error.find("not enough header padding") == std::string::npos)
+    {
+        std::cerr << fixture << ": expected a header padding error, got '" << error << "'" << std::endl;
+        failures++;
+    }
+    if(readFile(path) != before)
+    {
+        std::cerr << fixture << ": file was written although the edits did not fit" << std::endl;
+        failures++;
+    }
+}
+
+static void testChange()
+{
+    const std::string path = copyFixture("thin_x86_64.dylib");
+    const std::string before = readFile(path);
+    MachOEditor editor(path);
+    editor.changeDependency("/usr/local/lib/liblo.7.dylib", LONG_NAME);
+    editor.changeDependency("/usr/local/lib/libweak.dylib", "@rpath/libweak.dylib");
+    editor.changeDependency("/usr/local/lib/libupward.dylib", "@rpath/libupward.dylib");
+    CHECK(applies("thin_x86_64.dylib", editor));
+
+    MachOFile file(path);
+    CHECK(file.isValid());
+    const std::vector<std::string>& deps = file.getDependencies();
+    CHECK(deps.size() == 6);
+    // edited in place, the load order is kept
+    CHECK(deps.size() == 6 and deps[0] == LONG_NAME);
+    CHECK(deps.size() == 6 and deps[2] == "@rpath/libweak.dylib");
+    CHECK(deps.size() == 6 and deps[5] == "@rpath/libupward.dylib");
+    CHECK(contains(deps, "/usr/lib/libSystem.B.dylib"));
+    CHECK(!contains(deps, "/usr/local/lib/liblo.7.dylib"));
+    CHECK(file.getInstallName() == "@rpath/libfixture.dylib");
+    CHECK(sameContent(before, readFile(path)));
+
+    // a change to a name of the same padded length fits without padding
+    const std::string tight = copyFixture("tight_x86_64.dylib");
+    MachOEditor same(tight);
+    same.changeDependency("/usr/local/lib/liblo.7.dylib", "/opt/local/lib/liblo.7.dylib");
+    CHECK(applies("tight_x86_64.dylib", same));
+    CHECK(contains(MachOFile(tight).getDependencies(), "/opt/local/lib/liblo.7.dylib"));
+
+    MachOEditor longer(tight);
+    longer.changeDependency("/usr/lib/libSystem.B.dylib", LONG_NAME);
+    doesNotFit("tight_x86_64.dylib", longer, tight);
+}
+
+static void testId()
+{
+    const std::string path = copyFixture("thin_x86_64.dylib");
+    MachOEditor editor(path);
+    editor.setInstallName("@loader_path/../Frameworks/libfixture.dylib");
+    CHECK(applies("thin_x86_64.dylib", editor));
+    MachOFile file(path);
+    CHECK(file.getInstallName() == "@loader_path/../Frameworks/libfixture.dylib");
+    CHECK(file.getDependencies().size() == 6);
+
+    const std::string tight = copyFixture("tight_x86_64.dylib");
+    MachOEditor longer(tight);
+    longer.setInstallName(LONG_NAME);
+    doesNotFit("tight_x86_64.dylib", longer, tight);
+}
+
+static void testRpaths()
+{
+    const std::string path = copyFixture("thin_x86_64.dylib");
+    MachOEditor editor(path);
+    editor.deleteRpath("/usr/local/lib");
+    editor.changeRpath("@loader_path/../lib", "@loader_path/../Frameworks");
+    editor.addRpath("@executable_path/../Frameworks");
+    editor.addRpath("@loader_path/../Frameworks");    // already there after the change
+    CHECK(applies("thin_x86_64.dylib", editor));
+
+    const std::vector<std::string> rpaths = MachOFile(path).getRpaths();
+    CHECK(rpaths.size() == 2);
+    CHECK(rpaths.size() == 2 and rpaths[0] == "@loader_path/../Frameworks");
+    CHECK(rpaths.size() == 2 and rpaths[1] == "@executable_path/../Frameworks");
+
+    // deleting only shrinks the load commands, so it always fits
+    const std::string tight = copyFixture("tight_x86_64.dylib");
+    MachOEditor del(tight);
+    del.deleteRpath("/usr/local/lib");
+    CHECK(applies("tight_x86_64.dylib", del));
+    CHECK(MachOFile(tight).getRpaths().size() == 1);
+
+    const std::string tight_add = copyFixture("tight_x86_64.dylib");
+    MachOEditor add(tight_add);
+    add.addRpath("@executable_path/../Frameworks");
+    doesNotFit("tight_x86_64.dylib", add, tight_add);
+
+    const std::string tight_change = copyFixture("tight_x86_64.dylib");
+    MachOEditor change(tight_change);
+    change.changeRpath("/usr/local/lib", LONG_NAME);
+    doesNotFit("tight_x86_64.dylib", change, tight_change);
+}
+
+static void testByteSwapped()
+{
+    const std::string path = copyFixture("thin_ppc.dylib");
+    MachOEditor editor(path);
+    editor.changeDependency("/usr/local/lib/liblo.7.dylib", LONG_NAME);
+    editor.setInstallName("@rpath/libppc.dylib");
+    editor.addRpath("@loader_path");
+    CHECK(applies("thin_ppc.dylib", editor));
+    MachOFile file(path);
+    CHECK(file.isValid());
+    CHECK(file.getInstallName() == "@rpath/libppc.dylib");
+    CHECK(contains(file.getDependencies(), LONG_NAME));
+    CHECK(contains(file.getRpaths(), "@loader_path"));
+}
+
+static void testFat()
+{
+    const std::string path = copyFixture("fat_x86_64_arm64.dylib");
+    const std::string before = readFile(path);
+    MachOEditor editor(path);
+    editor.changeDependency("/usr/local/lib/liblo.7.dylib", LONG_NAME);
+    editor.changeDependency("/opt/homebrew/lib/libmapper.1.dylib", "@rpath/libmapper.1.dylib");
+    editor.setInstallName("@rpath/libfat.dylib");
+    editor.addRpath("@executable_path/../Frameworks");
+    editor.deleteRpath("/usr/local/lib");
+    CHECK(applies("fat_x86_64_arm64.dylib", editor));
+
+    // the old names are gone from both slices
+    MachOFile file(path);
+    CHECK(file.isValid());
+    CHECK(file.getSliceAmount() == 2);
+    CHECK(!contains(file.getDependencies(), "/usr/local/lib/liblo.7.dylib"));
+    CHECK(!contains(file.getDependencies(), "/opt/homebrew/lib/libmapper.1.dylib"));
+    CHECK(contains(file.getDependencies(), LONG_NAME));
+    CHECK(contains(file.getDependencies(), "@rpath/libmapper.1.dylib"));
+    CHECK(file.getInstallName() == "@rpath/libfat.dylib");
+    CHECK(!contains(file.getRpaths(), "/usr/local/lib"));
+    CHECK(contains(file.getRpaths(), "@executable_path/../Frameworks"));
+    CHECK(readFile(path).size() == before.size());
+
+    // the x86_64 slice has room, the arm64 one does not: neither is written
+    const std::string tight = copyFixture("fat_tight_arm64.dylib");
+    MachOEditor longer(tight);
+    longer.changeDependency("/usr/local/lib/liblo.7.dylib", LONG_NAME);
+    doesNotFit("fat_tight_arm64.dylib", longer, tight);
+}
+
+static void testSigned()
+{
+    // the edit keeps LC_CODE_SIGNATURE, but asks for the file to be signed again
+    const std::string path = copyFixture("thin_arm64_signed.dylib");
+    const std::string before = readFile(path);
+    MachOEditor editor(path);
+    editor.changeDependency("/usr/local/lib/liblo.7.dylib", LONG_NAME);
+    editor.setInstallName("@rpath/libsigned.dylib");
+    CHECK(applies("thin_arm64_signed.dylib", editor));
+    CHECK(editor.needsSigning());
+    MachOFile file(path);
+    CHECK(file.isValid() and file.isSigned());
+    CHECK(contains(file.getDependencies(), LONG_NAME));
+    CHECK(file.getInstallName() == "@rpath/libsigned.dylib");
+    CHECK(readFile(path).size() == before.size());
+    CHECK(readFile(path).compare(before.size() - 32, 32, before, before.size() - 32, 32) == 0);
+
+    // nothing written, nothing to sign
+    MachOEditor none(path);
+    none.changeDependency("/usr/local/lib/libmissing.dylib", LONG_NAME);
+    CHECK(applies("thin_arm64_signed.dylib", none));
+    CHECK(!none.needsSigning());
+
+    // unsigned files are left unsigned
+    const std::string unsigned_path = copyFixture("thin_x86_64.dylib");
+    MachOEditor plain(unsigned_path);
+    plain.setInstallName("@rpath/libplain.dylib");
+    CHECK(applies("thin_x86_64.dylib", plain));
+    CHECK(!plain.needsSigning());
+}
+
+static void testNoEdit()
+{
+    // edits that match nothing leave the file alone
+    const std::string path = copyFixture("thin_x86_64.dylib");
+    const std::string before = readFile(path);
+    MachOEditor editor(path);
+    editor.changeDependency("/usr/local/lib/libmissing.dylib", LONG_NAME);
+    editor.deleteRpath("/no/such/rpath");
+    CHECK(applies("thin_x86_64.dylib", editor));
+    CHECK(readFile(path) == before);
+}
+
+static void testInvalid()
+{
+    const std::string path = copyFixture("not_macho.dylib");
+    const std::string before = readFile(path);
+    MachOEditor editor(path);
+    editor.setInstallName("@rpath/libfixture.dylib");
+    std::string error;
+    CHECK(!editor.apply(&error));
+    CHECK(error == "not a Mach-O file");
+    CHECK(readFile(path) == before);
+}
+
+int main()
+{
+    char dir[] = "/tmp/test_machoeditor.XXXXXX";
+    if(!mkdtemp(dir))
+    {
+        std::cerr << "test_machoeditor: cannot create a temporary directory" << std::endl;
+        return 1;
+    }
+    tmpdir = dir;
+
+    testChange();
+    testId();
+    testRpaths();
+    testByteSwapped();
+    testFat();
+    testSigned();
+    testNoEdit();
+    testInvalid();
+
+    removeRecursively(tmpdir);
+
+    if(failures)
+    {
+        std::cerr << "test_machoeditor: " << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "test_machoeditor: all checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Reads the fixtures written by make_fixtures.py with MachOFile. Run from the
+// dylibbundler directory with 'make test'.
+
+#include "MachO.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define FIXTURES "./test/fixtures/"
+
+#define CPU_TYPE_X86_64  0x01000007U
+#define CPU_TYPE_ARM64   0x0100000cU
+#define CPU_TYPE_POWERPC 18U
+
+static int failures = 0;
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+
+static void check(bool ok, const char* what, const char* file, int line)
+{
+    if(ok) return;
+    std::cerr << file << ":" << line << ": check failed: " << what << std::endl;
+    failures++;
+}
+
+static std::vector<std::string> list(const char* a, const char* b = NULL, const char* c = NULL,
+                                     const char* d = NULL, const char* e = NULL, const char* f = NULL,
+                                     const char* g = NULL)
+{
+    const char* all[] = { a, b, c, d, e, f, g };
+    std::vector<std::string> out;
+    for(int n=0; n<7 and all[n]; n++) out.push_back(all[n]);
+    return out;
+}
+
+// the dependencies every fixture slice has, in load order
+static std::vector<std::string> commonDependencies()
+{
+    return list("/usr/local/lib/liblo.7.dylib",
+                "/usr/lib/libSystem.B.dylib",
+                "/usr/local/lib/libweak.dylib",        // LC_LOAD_WEAK_DYLIB
+                "/usr/local/lib/libreexport.dylib",    // LC_REEXPORT_DYLIB
+                "/usr/local/lib/liblazy.dylib",        // LC_LAZY_LOAD_DYLIB
+                "/usr/local/lib/libupward.dylib");     // LC_LOAD_UPWARD_DYLIB
+}
+
+static void testThin()
+{
+    MachOFile file(FIXTURES "thin_x86_64.dylib");
+    CHECK(file.isValid());
+    CHECK(file.getError().empty());
+    CHECK(file.getSliceAmount() == 1);
+    if(file.getSliceAmount() != 1) return;
+
+    const MachOFile::Slice& slice = file.getSlice(0);
+    CHECK(slice.cputype == CPU_TYPE_X86_64);
+    CHECK(slice.is64);
+    CHECK(!slice.swap);
+    CHECK(slice.offset == 0);
+
+    CHECK(file.getInstallName() == "@rpath/libfixture.dylib");
+    CHECK(file.getDependencies() == commonDependencies());
+    CHECK(file.getRpaths() == list("@loader_path/../lib", "/usr/local/lib"));
+    CHECK(!file.isSigned());
+}
+
+static void testSigned()
+{
+    MachOFile file(FIXTURES "thin_arm64_signed.dylib");
+    CHECK(file.isValid());
+    CHECK(file.getSliceAmount() == 1 and file.getSlice(0).cputype == CPU_TYPE_ARM64);
+    CHECK(file.isSigned());
+    CHECK(file.getDependencies() == commonDependencies());
+}
+
+static void testBigEndian32()
+{
+    MachOFile file(FIXTURES "thin_ppc.dylib");
+    CHECK(file.isValid());
+    CHECK(file.getSliceAmount() == 1);
+    if(file.getSliceAmount() != 1) return;
+
+    const MachOFile::Slice& slice = file.getSlice(0);
+    CHECK(slice.cputype == CPU_TYPE_POWERPC);
+    CHECK(!slice.is64);
+    CHECK(slice.swap);
+
+    CHECK(file.getInstallName() == "@rpath/libfixture.dylib");
+    CHECK(file.getDependencies() == commonDependencies());
+    CHECK(file.getRpaths() == list("@loader_path/../lib", "/usr/local/lib"));
+}
+
+static void testFat()
+{
+    MachOFile file(FIXTURES "fat_x86_64_arm64.dylib");
+    CHECK(file.isValid());
+    CHECK(file.getSliceAmount() == 2);
+    if(file.getSliceAmount() != 2) return;
+
+    CHECK(file.getSlice(0).cputype == CPU_TYPE_X86_64);
+    CHECK(file.getSlice(1).cputype == CPU_TYPE_ARM64);
+    CHECK(file.getSlice(0).offset == 1024);
+    CHECK(file.getSlice(1).offset > file.getSlice(0).offset);
+    CHECK(file.getSlice(0).is64 and file.getSlice(1).is64);
+
+    // merged over both slices, without duplicates, the arm64-only one last
+    std::vector<std::string> dependencies = commonDependencies();
+    dependencies.push_back("/opt/homebrew/lib/libmapper.1.dylib");
+    CHECK(file.getInstallName() == "@rpath/libfixture.dylib");
+    CHECK(file.getDependencies() == dependencies);
+    CHECK(file.getRpaths() == list("@loader_path/../lib", "/usr/local/lib"));
+}
+
+static void testRejected(const char* name, const std::string& error)
+{
+    MachOFile file(std::string(FIXTURES) + name);
+    CHECK(!file.isValid());
+    if(file.getError() != error)
+    {
+        std::cerr << name << ": expected error '" << error << "', got '" << file.getError() << "'" << std::endl;
+        failures++;
+    }
+}
+
+int main()
+{
+    testThin();
+    testSigned();
+    testBigEndian32();
+    testFat();
+
+    testRejected("missing.dylib", "cannot open file");
+    testRejected("not_macho.dylib", "not a Mach-O file");
+    testRejected("truncated_header.dylib", "truncated mach header");
+    testRejected("truncated.dylib", "load commands out of bounds");
+    testRejected("bad_cmdsize.dylib", "bad load command size");
+    testRejected("bad_string.dylib", "bad load command string");
+    testRejected("fat_bad_offset.dylib", "slice out of bounds");
+
+    if(failures)
+    {
+        std::cerr << "test_machofile: " << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "test_machofile: all checks passed" << std::endl;
+    return 0;
+}
@@ -22,7 +22,7 @@
     #include "ext.h"            // standard Max include, always required
     #include "ext_obex.h"       // required for new style Max object
     #include "ext_critical.h"
-    #include "ext_dictionary.h"
+    #include "ext_systime.h"
     #include "jpatcher_api.h"
 #else
     #include "m_pd.h"
@@ -32,15 +32,29 @@
 #include <mapper/mapper.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <math.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #ifndef WIN32
     #include <arpa/inet.h>
     #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+#else
+    #include <io.h>
 #endif
 
 #define INTERVAL 1
 #define MAX_LIST 256
+#define UNKNOWN_CACHE_SIZE 64   // power of 2
+#define PERSIST 5000            // ms a released device is kept for adoption
+
+#include "../common/sig_stats.h"
+#include "../common/latency.h"
+#include "../common/coalesce.h"
+#include "../common/device_pool.h"
 
 #ifdef MAXMSP
 #define POST(x, ...) { object_post((t_object *)x, __VA_ARGS__); }
@@ -50,6 +64,62 @@
 
 // *********************************************************
 // -(object struct)-----------------------------------------
+struct _mapper;
+
+// per-signal context stored in the signal's MPR_PROP_DATA
+typedef struct _mapper_sig
+{
+    struct _mapper *home;
+    mpr_sig sig;
+    t_symbol *name;
+    int coalesce;
+    int queued;             // already in the home object's dirty list
+    int num_slots;
+    t_coalesce_slot *slots;
+    struct _mapper_sig *next_dirty;
+    t_latency latency;
+    t_sig_stats stats;
+} t_mapper_sig;
+
+// one signal of a device definition, strings point into the definition's
+// JSON text or mapped binary cache
+typedef struct _def_sig
+{
+    const char *name;
+    const char *units;
+    mpr_dir dir;
+    mpr_type type;
+    int length;
+    int num_inst;
+    int steal;
+    int min_len, min_idx;   // range values are stored in the definition's nums
+    int max_len, max_idx;
+    int first_prop, num_props;
+} t_def_sig;
+
+// custom signal property: string, number or boolean
+typedef struct _def_prop
+{
+    const char *key;
+    mpr_type type;
+    double num;
+    const char *str;
+} t_def_prop;
+
+typedef struct _definition
+{
+    const char *name;
+    int num_sigs, size_sigs;
+    t_def_sig *sigs;
+    int num_props, size_props;
+    t_def_prop *props;
+    int num_nums, size_nums;
+    double *nums;           // in the binary cache mapping if size_nums is 0
+    char *text;             // JSON text, decoded in place
+    void *map;              // binary cache contents
+    size_t map_size;
+} t_definition;
+
 typedef struct _mapper
 {
     t_object ob;
@@ -69,14 +139,25 @@ typedef struct _mapper
     int updated;
     int ready;
     int learn_mode;
+    int coalesce;         // default @coalesce for new input signals
+    int timestamps;       // output the timetag and latency of each update
+    t_mapper_sig *dirty;  // coalescing signals with pending values
+    // direct-mapped cache of selectors known not to name a signal
+    t_symbol *unknown[UNKNOWN_CACHE_SIZE];
     union {
         t_atom atoms[MAX_LIST];
         int ints[MAX_LIST];
         float floats[MAX_LIST];
     } buffer;
-    char *definition;
-#ifdef MAXMSP
-    t_dictionary *d;
+    char *definition;     // definition file as given
+    char *def_path;       // located definition file
+    t_definition *def;
+    int def_cache;        // read and write a binary cache next to the definition
+    char *iface;          // network interface as given
+    int persist;          // ms to keep the device for adoption after the object is freed
+    int time_handlers;    // time outputs for "stats", once it has been asked for
+#ifdef PD
+    t_canvas *canvas;     // for locating files relative to the patch
 #endif
 } t_mapper;
 
@@ -90,23 +171,49 @@ static void mapperobj_anything(t_mapper *x, t_symbol *s, int argc, t_atom *argv)
 static void mapperobj_add_signal(t_mapper *x, t_symbol *s, int argc, t_atom *argv);
 static void mapperobj_remove_signal(t_mapper *x, t_symbol *s, int argc, t_atom *argv);
 static void mapperobj_clear_signals(t_mapper *x, t_symbol *s, int argc, t_atom *argv);
+static void mapperobj_reload(t_mapper *x, t_symbol *s, int argc, t_atom *argv);
+static void mapperobj_write(t_mapper *x, t_symbol *s, int argc, t_atom *argv);
 
 static void mapperobj_poll(t_mapper *x);
 
+static t_mapper_sig *mapperobj_sig_ctx_new(t_mapper *x, mpr_sig sig, int coalesce);
+static void mapperobj_free_signal(t_mapper *x, mpr_sig sig);
+static void mapperobj_flush_signal(t_mapper_sig *ctx);
+static void mapperobj_flush_coalesced(t_mapper *x);
+
+static void mapperobj_clear_unknown(t_mapper *x);
+
+static int mapperobj_pool_release(t_mapper *x);
+#ifdef MAXMSP
+static void mapperobj_pool_quit(void *arg);
+#endif
+static void mapperobj_adopt_signals(t_mapper *x, t_definition *old_def);
+
 static void mapperobj_sig_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst,
                                   int len, mpr_type type, const void *val,
                                   mpr_time time);
+static void mapperobj_output_value(t_mapper *x, mpr_sig sig, t_symbol *name, mpr_id inst,
+                                   int len, mpr_type type, const void *val);
 
 static void mapperobj_print_properties(t_mapper *x);
 
 static void mapperobj_learn(t_mapper *x, t_symbol *s, int argc, t_atom *argv);
 static void mapperobj_set(t_mapper *x, t_symbol *s, int argc, t_atom *argv);
+static void mapperobj_get(t_mapper *x, t_symbol *s, int argc, t_atom *argv);
+static void mapperobj_setindex(t_mapper *x, t_symbol *s, int argc, t_atom *argv);
+static void mapperobj_latency(t_mapper *x, t_symbol *s, int argc, t_atom *argv);
+static void mapperobj_stats(t_mapper *x, t_symbol *s, int argc, t_atom *argv);
+static void mapperobj_count_out(mpr_sig sig, int len);
+static double mapperobj_time_ms(void);
+static void mapperobj_output_timetag(t_mapper *x, t_mapper_sig *ctx, mpr_id inst,
+                                     mpr_time time, double latency);
 
 #ifdef MAXMSP
 void mapperobj_assist(t_mapper *x, void *b, long m, long a, char *s);
+#endif
 static void mapperobj_register_signals(t_mapper *x);
 static void mapperobj_read_definition(t_mapper *x);
-#endif
+static void def_free(t_definition *def);
 
 static int maxpd_atom_strcmp(t_atom *a, const char *string);
 static const char *maxpd_atom_get_string(t_atom *a);
@@ -119,6 +226,10 @@ static void maxpd_atom_set_float(t_atom *a, float d);
 // -(global class pointer variable)-------------------------
 static void *mapperobj_class;
 
+// *********************************************************
+// -(released devices awaiting adoption)--------------------
+static t_dev_pool pool = { 0 };
+
 // *********************************************************
 // -(main)--------------------------------------------------
 
@@ -141,9 +252,16 @@ void ext_main(void *r)
         class_addmethod(c, (method)mapperobj_anything,       "anything", A_GIMME,    0);
         class_addmethod(c, (method)mapperobj_learn,          "learn",    A_GIMME,    0);
         class_addmethod(c, (method)mapperobj_set,            "set",      A_GIMME,    0);
+        class_addmethod(c, (method)mapperobj_get,            "get",      A_GIMME,    0);
+        class_addmethod(c, (method)mapperobj_setindex,       "setindex", A_GIMME,    0);
+        class_addmethod(c, (method)mapperobj_latency,        "latency",  A_GIMME,    0);
+        class_addmethod(c, (method)mapperobj_stats,          "stats",    A_GIMME,    0);
         class_addmethod(c, (method)mapperobj_clear_signals,  "clear",    A_GIMME,    0);
+        class_addmethod(c, (method)mapperobj_reload,         "reload",   A_GIMME,    0);
+        class_addmethod(c, (method)mapperobj_write,          "write",    A_GIMME,    0);
         class_register(CLASS_BOX, c); /* CLASS_NOBOX */
         mapperobj_class = c;
+        quittask_install((method)mapperobj_pool_quit, 0);
         return 0;
     }
 #else
@@ -157,7 +275,13 @@ void ext_main(void *r)
         class_addanything(c, (t_method)mapperobj_anything);
         class_addmethod(c,   (t_method)mapperobj_learn,         gensym("learn"),  A_GIMME, 0);
         class_addmethod(c,   (t_method)mapperobj_set,           gensym("set"),    A_GIMME, 0);
+        class_addmethod(c,   (t_method)mapperobj_get,           gensym("get"),    A_GIMME, 0);
+        class_addmethod(c,   (t_method)mapperobj_setindex,      gensym("setindex"), A_GIMME, 0);
+        class_addmethod(c,   (t_method)mapperobj_latency,       gensym("latency"), A_GIMME, 0);
+        class_addmethod(c,   (t_method)mapperobj_stats,         gensym("stats"), A_GIMME, 0);
         class_addmethod(c,   (t_method)mapperobj_clear_signals, gensym("clear"),  A_GIMME, 0);
+        class_addmethod(c,   (t_method)mapperobj_reload,        gensym("reload"), A_GIMME, 0);
+        class_addmethod(c,   (t_method)mapperobj_write,         gensym("write"), A_GIMME, 0);
         mapperobj_class = c;
     }
 #endif
@@ -171,6 +295,9 @@ static void *mapperobj_new(t_symbol *s, int argc, t_atom *argv)
     int learn = 0;
     const char *alias = NULL;
     const char *iface = NULL;
+    t_pooled_dev *pooled;
+    t_definition *adopted_def = 0;
+    int adopted = 0;
 
 #ifdef MAXMSP
     if ((x = object_alloc(mapperobj_class))) {
@@ -182,6 +309,20 @@ static void *mapperobj_new(t_symbol *s, int argc, t_atom *argv)
         x->outlet1 = outlet_new(&x->ob, gensym("list"));
         x->outlet2 = outlet_new(&x->ob, gensym("list"));
 #endif
+        x->coalesce = 0;
+        x->timestamps = 0;
+        x->dirty = 0;
+        x->definition = 0;
+        x->def_path = 0;
+        x->def = 0;
+        x->def_cache = 0;
+        x->iface = 0;
+        x->persist = PERSIST;
+        x->time_handlers = 0;
+#ifdef PD
+        x->canvas = canvas_getcurrent();
+#endif
+        mapperobj_clear_unknown(x);
 
         for (i = 0; i < argc; i++) {
             if ((argv+i)->a_type == A_SYM) {
@@ -191,16 +332,27 @@ static void *mapperobj_new(t_symbol *s, int argc, t_atom *argv)
                         i++;
                     }
                 }
-#ifdef MAXMSP
                 else if ((maxpd_atom_strcmp(argv+i, "@def") == 0) ||
                          (maxpd_atom_strcmp(argv+i, "@definition") == 0)) {
                     if ((argv+i+1)->a_type == A_SYM) {
+                        if (x->definition)
+                            free(x->definition);
                         x->definition = strdup(maxpd_atom_get_string(argv+i+1));
-                        mapperobj_read_definition(x);
                         i++;
                     }
                 }
+                else if (maxpd_atom_strcmp(argv+i, "@cache") == 0) {
+                    if ((argv+i+1)->a_type == A_FLOAT) {
+                        x->def_cache = maxpd_atom_get_float(argv+i+1) != 0;
+                        i++;
+                    }
+#ifdef MAXMSP
+                    else if ((argv+i+1)->a_type == A_LONG) {
+                        x->def_cache = atom_getlong(argv+i+1) != 0;
+                        i++;
+                    }
 #endif
+                }
                 else if (maxpd_atom_strcmp(argv+i, "@learn") == 0) {
                     if ((argv+i+1)->a_type == A_FLOAT) {
                         learn = (maxpd_atom_get_float(argv+i+1) > 1) ? 0 : 1;
@@ -219,9 +371,49 @@ static void *mapperobj_new(t_symbol *s, int argc, t_atom *argv)
                         i++;
                     }
                 }
+                else if (maxpd_atom_strcmp(argv+i, "@coalesce") == 0) {
+                    if ((argv+i+1)->a_type == A_FLOAT) {
+                        x->coalesce = maxpd_atom_get_float(argv+i+1) != 0;
+                        i++;
+                    }
+#ifdef MAXMSP
+                    else if ((argv+i+1)->a_type == A_LONG) {
+                        x->coalesce = atom_getlong(argv+i+1) != 0;
+                        i++;
+                    }
+#endif
+                }
+                else if (maxpd_atom_strcmp(argv+i, "@timestamps") == 0) {
+                    if ((argv+i+1)->a_type == A_FLOAT) {
+                        x->timestamps = maxpd_atom_get_float(argv+i+1) != 0;
+                        i++;
+                    }
+#ifdef MAXMSP
+                    else if ((argv+i+1)->a_type == A_LONG) {
+                        x->timestamps = atom_getlong(argv+i+1) != 0;
+                        i++;
+                    }
+#endif
+                }
+                else if (maxpd_atom_strcmp(argv+i, "@persist") == 0) {
+                    if ((argv+i+1)->a_type == A_FLOAT) {
+                        x->persist = (int)maxpd_atom_get_float(argv+i+1);
+                        i++;
+                    }
+#ifdef MAXMSP
+                    else if ((argv+i+1)->a_type == A_LONG) {
+                        x->persist = (int)atom_getlong(argv+i+1);
+                        i++;
+                    }
+#endif
+                }
             }
         }
+        if (x->definition)
+            mapperobj_read_definition(x);
         if (alias) {
+            if (x->name)
+                free(x->name);
             x->name = *alias == '/' ? strdup(alias+1) : strdup(alias);
         }
         else if (!x->name) {
@@ -235,13 +427,26 @@ static void *mapperobj_new(t_symbol *s, int argc, t_atom *argv)
         POST(x, "libmapper version %s – visit libmapper.org for more information.",
              mpr_get_version());
 
-        x->device = mpr_dev_new(x->name, 0);
+        if (iface)
+            x->iface = strdup(iface);
+
+        // adopt a device released by a recently freed object with the same name
+        if ((pooled = dev_pool_take(&pool, x->name, iface))) {
+            x->device = pooled->device;
+            adopted_def = (t_definition *)pooled->data;
+            adopted = 1;
+            dev_pool_forget(pooled);
+            POST(x, "Adopting released device '%s'.",
+                 mpr_obj_get_prop_as_str(x->device, MPR_PROP_NAME, NULL));
+        }
+        else
+            x->device = mpr_dev_new(x->name, 0);
         if (!x->device) {
             POST(x, "Error initializing libmapper device.");
             return 0;
         }
         x->graph = mpr_obj_get_graph(x->device);
-        if (iface)
+        if (iface && !adopted)
             mpr_graph_set_interface(x->graph, iface);
         POST(x, "Using network interface %s.", mpr_graph_get_interface(x->graph));
 
@@ -253,6 +458,10 @@ static void *mapperobj_new(t_symbol *s, int argc, t_atom *argv)
                 (maxpd_atom_strcmp(argv+i, "@def") == 0) ||
                 (maxpd_atom_strcmp(argv+i, "@definition") == 0) ||
                 (maxpd_atom_strcmp(argv+i, "@learn") == 0) ||
+                (maxpd_atom_strcmp(argv+i, "@coalesce") == 0) ||
+                (maxpd_atom_strcmp(argv+i, "@cache") == 0) ||
+                (maxpd_atom_strcmp(argv+i, "@persist") == 0) ||
+                (maxpd_atom_strcmp(argv+i, "@timestamps") == 0) ||
                 (maxpd_atom_strcmp(argv+i, "@interface") == 0)){
                 i++;
                 continue;
@@ -296,8 +505,11 @@ static void *mapperobj_new(t_symbol *s, int argc, t_atom *argv)
         x->ready = 0;
         x->updated = 0;
         x->learn_mode = learn;
+        if (adopted)
+            mapperobj_adopt_signals(x, adopted_def);
+        else
+            mapperobj_register_signals(x);
 #ifdef MAXMSP
-        mapperobj_register_signals(x);
         // Create the timing clock
         x->clock = clock_new(x, (method)mapperobj_poll);
 #else
@@ -316,13 +528,26 @@ static void mapperobj_free(t_mapper *x)
     clock_unset(x->clock);      // Remove clock routine from the scheduler
     clock_free(x->clock);       // Frees memeory used by clock
 
-#ifdef MAXMSP
-    object_free(x->d);          // Frees memory used by dictionary
-#endif
-
-    if (x->device) {
+    if (x->definition)
+        free(x->definition);
+    if (x->def_path)
+        free(x->def_path);
+
+    // the pool takes the device along with its definition if it has joined the network
+    if (x->device && !mapperobj_pool_release(x)) {
+        // free the per-signal contexts, the signals go with the device
+        mpr_list sigs = mpr_dev_get_sigs(x->device, MPR_DIR_ANY);
+        while (sigs) {
+            mpr_sig sig = *sigs;
+            sigs = mpr_list_get_next(sigs);
+            mapperobj_free_signal(x, sig);
+        }
         mpr_dev_free(x->device);
     }
+    if (x->def)
+        def_free(x->def);
+    if (x->iface)
+        free(x->iface);
     if (x->name) {
         free(x->name);
     }
@@ -392,10 +617,12 @@ static void mapperobj_add_signal(t_mapper *x, t_symbol *s, int argc, t_atom *arg
 {
     const char *sig_name = 0, *sig_units = 0;
     char sig_type = 0;
-    int sig_length = 1, prop_int = 0;
+    int sig_length = 1, prop_int = 0, notify = 1, reused = 0;
     long i;
     mpr_sig sig = 0;
     mpr_dir dir;
+    mpr_list sigs;
+    t_mapper_sig *ctx;
 
     if (argc < 4) {
         POST(x, "Not enough arguments for 'add' message.");
@@ -444,6 +671,18 @@ static void mapperobj_add_signal(t_mapper *x, t_symbol *s, int argc, t_atom *arg
                     i++;
                 }
             }
+            else if (maxpd_atom_strcmp(argv+i, "@notify") == 0) {
+                if ((argv+i+1)->a_type == A_FLOAT) {
+                    notify = maxpd_atom_get_float(argv+i+1) != 0;
+                    i++;
+                }
+#ifdef MAXMSP
+                else if ((argv+i+1)->a_type == A_LONG) {
+                    notify = atom_getlong(argv+i+1) != 0;
+                    i++;
+                }
+#endif
+            }
         }
     }
     if (!sig_type) {
@@ -463,13 +702,40 @@ static void mapperobj_add_signal(t_mapper *x, t_symbol *s, int argc, t_atom *arg
         sig_length = MAX_LIST;
     }
 
-    sig = mpr_sig_new(x->device, dir, sig_name, sig_length, sig_type, sig_units,
-                      0, 0, 0, mapperobj_sig_handler, MPR_SIG_ALL);
-    mpr_obj_set_prop(sig, MPR_PROP_DATA, NULL, 1, MPR_PTR, x, 0);
-    if (!sig) {
-        POST(x, "Error adding signal!");
-        return;
+    // an identical signal may already exist, e.g. on a device adopted from the pool
+    sigs = mpr_dev_get_sigs(x->device, MPR_DIR_ANY);
+    sigs = mpr_list_filter(sigs, MPR_PROP_NAME, NULL, 1, MPR_STR, sig_name, MPR_OP_EQ);
+    if (sigs) {
+        sig = *sigs;
+        mpr_list_free(sigs);
+        if (   mpr_obj_get_prop_as_int32(sig, MPR_PROP_DIR, NULL) != dir
+            || mpr_obj_get_prop_as_int32(sig, MPR_PROP_TYPE, NULL) != sig_type
+            || mpr_obj_get_prop_as_int32(sig, MPR_PROP_LEN, NULL) != sig_length
+            || !(ctx = (void*)mpr_obj_get_prop_as_ptr(sig, MPR_PROP_DATA, NULL))) {
+            mapperobj_free_signal(x, sig);
+            sig = 0;
+        }
+    }
+
+    // with @notify 0 value updates are not pushed, they are read with 'get'
+    if (sig) {
+        reused = 1;
+        mpr_sig_set_cb(sig, mapperobj_sig_handler,
+                       notify ? MPR_SIG_ALL : MPR_SIG_ALL & ~MPR_SIG_UPDATE);
+        if (sig_units)
+            mpr_obj_set_prop(sig, MPR_PROP_UNIT, NULL, 1, MPR_STR, sig_units, 1);
+    }
+    else {
+        sig = mpr_sig_new(x->device, dir, sig_name, sig_length, sig_type, sig_units, 0, 0, 0,
+                          mapperobj_sig_handler,
+                          notify ? MPR_SIG_ALL : MPR_SIG_ALL & ~MPR_SIG_UPDATE);
+        if (!sig) {
+            POST(x, "Error adding signal!");
+            return;
+        }
+        ctx = mapperobj_sig_ctx_new(x, sig, dir == MPR_DIR_IN ? x->coalesce : 0);
     }
+    mapperobj_clear_unknown(x);
 
     // add other declared properties
     for (i = 2; i < argc; i++) {
@@ -477,7 +743,8 @@ static void mapperobj_add_signal(t_mapper *x, t_symbol *s, int argc, t_atom *arg
             break;
         if ((maxpd_atom_strcmp(argv+i, "@type") == 0) ||
             (maxpd_atom_strcmp(argv+i, "@length") == 0) ||
-            (maxpd_atom_strcmp(argv+i, "@units") == 0)){
+            (maxpd_atom_strcmp(argv+i, "@units") == 0) ||
+            (maxpd_atom_strcmp(argv+i, "@notify") == 0)){
             i++;
             continue;
         }
@@ -520,8 +787,28 @@ static void mapperobj_add_signal(t_mapper *x, t_symbol *s, int argc, t_atom *arg
                 i++;
             }
 #endif
-            if (prop_int > 1)
+            if (!reused && prop_int > 1)
                 mpr_sig_reserve_inst(sig, prop_int, 0, 0);
+            else if (reused && prop_int > mpr_sig_get_num_inst(sig, MPR_STATUS_ANY))
+                mpr_sig_reserve_inst(sig, prop_int - mpr_sig_get_num_inst(sig, MPR_STATUS_ANY),
+                                     0, 0);
+        }
+        else if (maxpd_atom_strcmp(argv+i, "@coalesce") == 0) {
+            if ((argv+i+1)->a_type == A_FLOAT) {
+                ctx->coalesce = maxpd_atom_get_float(argv+i+1) != 0;
+                i++;
+            }
+#ifdef MAXMSP
+            else if ((argv+i+1)->a_type == A_LONG) {
+                ctx->coalesce = atom_getlong(argv+i+1) != 0;
+                i++;
+            }
+#endif
+            // output what is still held back and drop the slots
+            if (!ctx->coalesce && ctx->num_slots) {
+                mapperobj_flush_signal(ctx);
+                coalesce_clear(&ctx->slots, &ctx->num_slots);
+            }
         }
         else if (maxpd_atom_strcmp(argv+i, "@stealing") == 0) {
             if ((argv+i+1)->a_type == A_SYM) {
@@ -596,7 +883,7 @@ static void mapperobj_remove_signal(t_mapper *x, t_symbol *s, int argc, t_atom *
     mpr_list sigs = mpr_dev_get_sigs(x->device, MPR_DIR_ANY);
     sigs = mpr_list_filter(sigs, MPR_PROP_NAME, NULL, 1, MPR_STR, sig_name, MPR_OP_EQ);
     if (sigs && *sigs)
-        mpr_sig_free(*sigs);
+        mapperobj_free_signal(x, *sigs);
     if (strcmp(direction, "output") == 0) {
         maxpd_atom_set_int(x->buffer.atoms,
                            mpr_list_get_size(mpr_dev_get_sigs(x->device, MPR_DIR_OUT)));
@@ -631,7 +918,7 @@ static void mapperobj_clear_signals(t_mapper *x, t_symbol *s,
     while (sigs) {
         mpr_sig sig = *sigs;
         sigs = mpr_list_get_next(sigs);
-        mpr_sig_free(sig);
+        mapperobj_free_signal(x, sig);
     }
 
     if (dir & MPR_DIR_IN) {
@@ -658,6 +945,129 @@ static void mapperobj_set(t_mapper *x, t_symbol *s, int argc, t_atom *argv)
     mapperobj_anything(x, s, argc, argv);
 }
 
+// *********************************************************
+// -(get signal value)--------------------------------------
+static void mapperobj_get(t_mapper *x, t_symbol *s, int argc, t_atom *argv)
+{
+    /* This method reads the current value of a signal from libmapper and
+     * outputs it like an update, for signals registered with @notify 0. */
+    mpr_id id = 0;
+
+    if (!argc || argv->a_type != A_SYM)
+        return;
+    if (argc > 1) {
+        if ((argv+1)->a_type == A_FLOAT)
+            id = (mpr_id)maxpd_atom_get_float(argv+1);
+#ifdef MAXMSP
+        else if ((argv+1)->a_type == A_LONG)
+            id = (mpr_id)atom_getlong(argv+1);
+#endif
+    }
+
+    mpr_list sigs = mpr_dev_get_sigs(x->device, MPR_DIR_ANY);
+    sigs = mpr_list_filter(sigs, MPR_PROP_NAME, NULL, 1, MPR_STR,
+                           maxpd_atom_get_string(argv), MPR_OP_EQ);
+    if (!sigs || !*sigs)
+        return;
+    mpr_sig sig = *sigs;
+    mpr_list_free(sigs);
+
+    mpr_time time;
+    const void *val = mpr_sig_get_value(sig, id, &time);
+    if (!val)
+        return;
+    if (x->timestamps) {
+        // the value's age rather than its network latency
+        t_mapper_sig *ctx = (void*)mpr_obj_get_prop_as_ptr(sig, MPR_PROP_DATA, NULL);
+        mpr_time now;
+        mpr_time_set(&now, MPR_NOW);
+        if (ctx)
+            mapperobj_output_timetag(x, ctx, id, time, mpr_time_get_diff(now, time) * 1000.);
+    }
+    mapperobj_output_value(x, sig, gensym((char *)maxpd_atom_get_string(argv)), id,
+                           mpr_obj_get_prop_as_int32(sig, MPR_PROP_LEN, NULL),
+                           (mpr_type)mpr_obj_get_prop_as_int32(sig, MPR_PROP_TYPE, NULL), val);
+}
+
+// *********************************************************
+// -(set part of a signal vector)---------------------------
+static void mapperobj_setindex(t_mapper *x, t_symbol *s, int argc, t_atom *argv)
+{
+    /* 'setindex <name> <offset> values...' copies the signal's current
+     * vector, overwrites the given elements and updates the signal, so
+     * only the changed elements have to be converted from atoms. */
+    int i, offset, len;
+    mpr_type type;
+
+    if (!x->ready || argc < 3 || argv->a_type != A_SYM)
+        return;
+    if ((argv+1)->a_type == A_FLOAT)
+        offset = (int)maxpd_atom_get_float(argv+1);
+#ifdef MAXMSP
+    else if ((argv+1)->a_type == A_LONG)
+        offset = (int)atom_getlong(argv+1);
+#endif
+    else {
+        POST(x, "setindex offset is not int or float!");
+        return;
+    }
+
+    mpr_list sigs = mpr_dev_get_sigs(x->device, MPR_DIR_ANY);
+    sigs = mpr_list_filter(sigs, MPR_PROP_NAME, NULL, 1, MPR_STR,
+                           maxpd_atom_get_string(argv), MPR_OP_EQ);
+    if (!sigs || !*sigs)
+        return;
+    mpr_sig sig = *sigs;
+    mpr_list_free(sigs);
+
+    len = mpr_obj_get_prop_as_int32(sig, MPR_PROP_LEN, NULL);
+    type = (mpr_type)mpr_obj_get_prop_as_int32(sig, MPR_PROP_TYPE, NULL);
+    argv += 2;
+    argc -= 2;
+    if (offset < 0 || offset + argc > len) {
+        POST(x, "setindex: offset %d with %d values exceeds vector length %d.",
+             offset, argc, len);
+        return;
+    }
+
+    const void *val = mpr_sig_get_value(sig, 0, 0);
+    if (MPR_INT32 == type) {
+        int *payload = x->buffer.ints;
+        if (val)
+            memcpy(payload, val, len * sizeof(int));
+        else
+            memset(payload, 0, len * sizeof(int));
+        for (i = 0; i < argc; i++) {
+            if ((argv + i)->a_type == A_FLOAT)
+                payload[offset + i] = (int)atom_getfloat(argv + i);
+#ifdef MAXMSP
+            else if ((argv + i)->a_type == A_LONG)
+                payload[offset + i] = (int)atom_getlong(argv + i);
+#endif
+        }
+        mpr_sig_set_value(sig, 0, len, MPR_INT32, payload);
+    }
+    else if (MPR_FLT == type) {
+        float *payload = x->buffer.floats;
+        if (val)
+            memcpy(payload, val, len * sizeof(float));
+        else
+            memset(payload, 0, len * sizeof(float));
+        for (i = 0; i < argc; i++) {
+            if ((argv + i)->a_type == A_FLOAT)
+                payload[offset + i] = atom_getfloat(argv + i);
+#ifdef MAXMSP
+            else if ((argv + i)->a_type == A_LONG)
+                payload[offset + i] = (float)atom_getlong(argv + i);
+#endif
+        }
+        mpr_sig_set_value(sig, 0, len, MPR_FLT, payload);
+    }
+    else
+        return;
+    mapperobj_count_out(sig, len);
+}
+
 // *********************************************************
 // -(anything)----------------------------------------------
 static void mapperobj_anything(t_mapper *x, t_symbol *s, int argc, t_atom *argv)
@@ -669,6 +1079,11 @@ static void mapperobj_anything(t_mapper *x, t_symbol *s, int argc, t_atom *argv)
     if (!argc)
         return;
 
+    // drop selectors already known not to be signals without searching
+    size_t slot = ((size_t)s >> 4) & (UNKNOWN_CACHE_SIZE - 1);
+    if (!x->learn_mode && x->unknown[slot] == s)
+        return;
+
     //find signal
     mpr_sig sig = NULL;
     mpr_list sigs = mpr_dev_get_sigs(x->device, MPR_DIR_ANY);
@@ -677,8 +1092,10 @@ static void mapperobj_anything(t_mapper *x, t_symbol *s, int argc, t_atom *argv)
         sig = *sigs;
 
     if (!sig) {
-        if (!x->learn_mode)
+        if (!x->learn_mode) {
+            x->unknown[slot] = s;
             return;
+        }
 
         int length = argc;
         if (length > MAX_LIST) {
@@ -698,6 +1115,7 @@ static void mapperobj_anything(t_mapper *x, t_symbol *s, int argc, t_atom *argv)
         else {
             return;
         }
+        mapperobj_sig_ctx_new(x, sig, 0);
         //output updated numOutputs
         maxpd_atom_set_float(x->buffer.atoms,
                              mpr_list_get_size(mpr_dev_get_sigs(x->device, MPR_DIR_OUT)));
@@ -771,6 +1189,156 @@ static void mapperobj_anything(t_mapper *x, t_symbol *s, int argc, t_atom *argv)
     else {
         return;
     }
+    mapperobj_count_out(sig, len);
+}
+
+// *********************************************************
+// -(output signal value)-----------------------------------
+static void mapperobj_output_value(t_mapper *x, mpr_sig sig, t_symbol *name, mpr_id inst,
+                                   int len, mpr_type type, const void *val)
+{
+    int i, poly = 0;
+    if (mpr_sig_get_num_inst(sig, MPR_STATUS_ANY) > 1) {
+        maxpd_atom_set_int(x->buffer.atoms, inst);
+        poly = 1;
+    }
+    if (len > (MAX_LIST-1)) {
+        POST(x, "Maximum list length is %i!", MAX_LIST-1);
+        len = MAX_LIST-1;
+    }
+#ifdef MAXMSP
+    if (MPR_INT32 == type) {
+        int *v = (int*)val;
+        for (i = 0; i < len; i++)
+            maxpd_atom_set_int(x->buffer.atoms + i + poly, v[i]);
+    }
+    else if (MPR_FLT == type) {
+#endif
+        float *v = (float*)val;
+        for (i = 0; i < len; i++)
+            maxpd_atom_set_float(x->buffer.atoms + i + poly, v[i]);
+#ifdef MAXMSP
+    }
+#endif
+    outlet_anything(x->outlet1, name, len + poly, x->buffer.atoms);
+}
+
+// *********************************************************
+// -(statistics)--------------------------------------------
+// the clock is only read again after an output once "stats" has been asked for,
+// otherwise an update costs the one reading that stats_count() needs
+static void stats_handled(t_sig_stats *st, double start)
+{
+    float elapsed = (float)(mapperobj_time_ms() - start);
+    if (elapsed > st->max_handler)
+        st->max_handler = elapsed;
+}
+
+static void mapperobj_count_out(mpr_sig sig, int len)
+{
+    t_mapper_sig *ctx = (void*)mpr_obj_get_prop_as_ptr(sig, MPR_PROP_DATA, NULL);
+    if (ctx) {
+        ++ctx->stats.out;
+        stats_count(&ctx->stats, mapperobj_time_ms(), len);
+    }
+}
+
+static void mapperobj_stats(t_mapper *x, t_symbol *s, int argc, t_atom *argv)
+{
+    /* Output the traffic counters of one signal, or of every signal, as
+     * "stats <name> <in> <out> <rate> <bytes> <coalesced> <suppressed>
+     * <max handler ms> <age ms>". The age is -1 for signals that have not
+     * been updated yet. With "reset" as the last argument the counters are
+     * cleared instead. */
+    const char *name = (argc && argv->a_type == A_SYM) ? maxpd_atom_get_string(argv) : 0;
+    int reset = argc && maxpd_atom_strcmp(argv + argc - 1, "reset") == 0;
+    double now = mapperobj_time_ms();
+    mpr_list sigs;
+
+    if (!x->device)
+        return;
+    x->time_handlers = 1;
+    if (reset && argc == 1)
+        name = 0;
+    sigs = mpr_dev_get_sigs(x->device, MPR_DIR_ANY);
+    while (sigs) {
+        t_mapper_sig *ctx = (void*)mpr_obj_get_prop_as_ptr(*sigs, MPR_PROP_DATA, NULL);
+        t_sig_stats *st;
+        sigs = mpr_list_get_next(sigs);
+        if (!ctx || (name && strcmp(ctx->name->s_name, name)))
+            continue;
+        st = &ctx->stats;
+        if (reset) {
+            memset(st, 0, sizeof(t_sig_stats));
+            continue;
+        }
+        maxpd_atom_set_string(x->buffer.atoms, ctx->name->s_name);
+        maxpd_atom_set_int(x->buffer.atoms + 1, st->in);
+        maxpd_atom_set_int(x->buffer.atoms + 2, st->out);
+        maxpd_atom_set_float(x->buffer.atoms + 3, stats_rate(st, now));
+        maxpd_atom_set_float(x->buffer.atoms + 4, (float)st->bytes);
+        maxpd_atom_set_int(x->buffer.atoms + 5, st->coalesced);
+        maxpd_atom_set_int(x->buffer.atoms + 6, st->suppressed);
+        maxpd_atom_set_float(x->buffer.atoms + 7, st->max_handler);
+        maxpd_atom_set_float(x->buffer.atoms + 8,
+                             (st->in || st->out) ? (float)(now - st->last) : -1.f);
+        outlet_anything(x->outlet2, gensym("stats"), 9, x->buffer.atoms);
+    }
+}
+
+// *********************************************************
+// -(timestamps)--------------------------------------------
+// output "timetag <name> [instance] <seconds> <fraction> <latency>" ahead of a value;
+// the seconds are counted from midnight UTC so they fit in a float atom
+static void mapperobj_output_timetag(t_mapper *x, t_mapper_sig *ctx, mpr_id inst,
+                                     mpr_time time, double latency)
+{
+    int poly = mpr_sig_get_num_inst(ctx->sig, MPR_STATUS_ANY) > 1;
+    maxpd_atom_set_string(x->buffer.atoms, ctx->name->s_name);
+    if (poly)
+        maxpd_atom_set_int(x->buffer.atoms + 1, inst);
+    maxpd_atom_set_int(x->buffer.atoms + 1 + poly, time.sec % 86400);
+    maxpd_atom_set_float(x->buffer.atoms + 2 + poly, (float)(time.frac / 4294967296.));
+    maxpd_atom_set_float(x->buffer.atoms + 3 + poly, (float)latency);
+    outlet_anything(x->outlet2, gensym("timetag"), 4 + poly, x->buffer.atoms);
+}
+
+static void mapperobj_output_latency(t_mapper *x, t_mapper_sig *ctx)
+{
+    t_latency *l = &ctx->latency;
+    int i;
+    maxpd_atom_set_string(x->buffer.atoms, ctx->name->s_name);
+    maxpd_atom_set_int(x->buffer.atoms + 1, l->count);
+    maxpd_atom_set_float(x->buffer.atoms + 2, (float)l->min);
+    maxpd_atom_set_float(x->buffer.atoms + 3, l->count ? (float)(l->sum / l->count) : 0.f);
+    maxpd_atom_set_float(x->buffer.atoms + 4, (float)l->max);
+    for (i = 0; i < LATENCY_BUCKETS; i++)
+        maxpd_atom_set_int(x->buffer.atoms + 5 + i, l->buckets[i]);
+    outlet_anything(x->outlet2, gensym("latency"), 5 + LATENCY_BUCKETS, x->buffer.atoms);
+}
+
+static void mapperobj_latency(t_mapper *x, t_symbol *s, int argc, t_atom *argv)
+{
+    /* Output the latency histogram of one signal, or of every signal that has
+     * received timestamped updates, as "latency <name> <count> <min> <mean>
+     * <max> <buckets>...". With "reset" as the last argument the histograms
+     * are cleared instead. */
+    const char *name = (argc && argv->a_type == A_SYM) ? maxpd_atom_get_string(argv) : 0;
+    int reset = argc && maxpd_atom_strcmp(argv + argc - 1, "reset") == 0;
+    mpr_list sigs = mpr_dev_get_sigs(x->device, MPR_DIR_IN);
+
+    if (reset && argc == 1)
+        name = 0;
+    while (sigs) {
+        t_mapper_sig *ctx = (void*)mpr_obj_get_prop_as_ptr(*sigs, MPR_PROP_DATA, NULL);
+        sigs = mpr_list_get_next(sigs);
+        if (!ctx || (name && strcmp(ctx->name->s_name, name)))
+            continue;
+        if (reset)
+            memset(&ctx->latency, 0, sizeof(t_latency));
+        else if (name || ctx->latency.count)
+            mapperobj_output_latency(x, ctx);
+    }
 }
 
 // *********************************************************
@@ -779,40 +1347,61 @@ static void mapperobj_sig_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst,
                                   int len, mpr_type type, const void *val,
                                   mpr_time time)
 {
-    t_mapper *x = (void*)mpr_obj_get_prop_as_ptr(sig, MPR_PROP_DATA, NULL);
-    t_symbol *name = gensym(mpr_obj_get_prop_as_str(sig, MPR_PROP_NAME, NULL));
+    t_mapper_sig *ctx = (void*)mpr_obj_get_prop_as_ptr(sig, MPR_PROP_DATA, NULL);
+    t_mapper *x = ctx ? ctx->home : 0;
+    t_symbol *name;
+    double latency = 0, start = 0;
+
+    if (!x) {
+        // device is waiting in the pool for a new owner
+        if (ctx && MPR_SIG_UPDATE == evt && val)
+            ++ctx->stats.suppressed;
+        return;
+    }
+    name = ctx->name;
+
+    if (MPR_SIG_UPDATE == evt && val) {
+        start = mapperobj_time_ms();
+        ++ctx->stats.in;
+        stats_count(&ctx->stats, start, len);
+    }
+
+    if (x->timestamps && MPR_SIG_UPDATE == evt && val) {
+        mpr_time now;
+        mpr_time_set(&now, MPR_NOW);
+        latency = mpr_time_get_diff(now, time) * 1000.;
+        latency_add(&ctx->latency, latency);
+    }
+
+    if (ctx->coalesce) {
+        if (MPR_SIG_UPDATE == evt && val) {
+            // overwrite this instance's slot, the value is output after the poll
+            coalesce_store(&ctx->slots, &ctx->num_slots, inst, len, type, val, time,
+                           (float)latency);
+            if (!ctx->queued) {
+                ctx->queued = 1;
+                ctx->next_dirty = x->dirty;
+                x->dirty = ctx;
+            }
+            return;
+        }
+        // keep pending values ahead of releases and overflows
+        mapperobj_flush_signal(ctx);
+        if (MPR_SIG_INST_OFLW != evt)
+            coalesce_remove(&ctx->slots, &ctx->num_slots, inst);
+    }
 
     switch (evt) {
         case MPR_SIG_UPDATE: {
-            int poly = 0;
-            if (mpr_sig_get_num_inst(sig, MPR_STATUS_ANY) > 1) {
-                maxpd_atom_set_int(x->buffer.atoms, inst);
-                poly = 1;
-            }
             if (val) {
-                int i;
-
-                if (len > (MAX_LIST-1)) {
-                    POST(x, "Maximum list length is %i!", MAX_LIST-1);
-                    len = MAX_LIST-1;
-                }
-#ifdef MAXMSP
-                if (MPR_INT32 == type) {
-                    int *v = (int*)val;
-                    for (i = 0; i < len; i++)
-                        maxpd_atom_set_int(x->buffer.atoms + i + poly, v[i]);
-                }
-                else if (MPR_FLT == type) {
-#endif
-                    float *v = (float*)val;
-                    for (i = 0; i < len; i++)
-                        maxpd_atom_set_float(x->buffer.atoms + i + poly, v[i]);
-#ifdef MAXMSP
-                }
-#endif
-                outlet_anything(x->outlet1, name, len + poly, x->buffer.atoms);
+                if (x->timestamps)
+                    mapperobj_output_timetag(x, ctx, inst, time, latency);
+                mapperobj_output_value(x, sig, name, inst, len, type, val);
+                if (x->time_handlers)
+                    stats_handled(&ctx->stats, start);
             }
-            else if (poly) {
+            else if (mpr_sig_get_num_inst(sig, MPR_STATUS_ANY) > 1) {
+                maxpd_atom_set_int(x->buffer.atoms, inst);
                 maxpd_atom_set_string(x->buffer.atoms + 1, "release");
                 maxpd_atom_set_string(x->buffer.atoms + 2, "local");
                 outlet_anything(x->outlet1, name, 3, x->buffer.atoms);
@@ -837,13 +1426,17 @@ static void mapperobj_sig_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst,
             switch (mode) {
                 case MPR_STEAL_OLDEST:
                     inst = mpr_sig_get_oldest_inst_id(sig);
-                    if (inst)
+                    if (inst) {
                         mpr_sig_release_inst(sig, inst);
+                        coalesce_remove(&ctx->slots, &ctx->num_slots, inst);
+                    }
                     break;
                 case MPR_STEAL_NEWEST:
                     inst = mpr_sig_get_newest_inst_id(sig);
-                    if (inst)
+                    if (inst) {
                         mpr_sig_release_inst(sig, inst);
+                        coalesce_remove(&ctx->slots, &ctx->num_slots, inst);
+                    }
                     break;
                 case 0:
                     maxpd_atom_set_string(x->buffer.atoms + 1, "overflow");
@@ -860,195 +1453,1652 @@ static void mapperobj_sig_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst,
 }
 
 // *********************************************************
-// -(read device definition - maxmsp only)------------------
-#ifdef MAXMSP
-static void mapperobj_read_definition(t_mapper *x)
+// -(signal context)----------------------------------------
+static t_mapper_sig *mapperobj_sig_ctx_new(t_mapper *x, mpr_sig sig, int coalesce)
 {
-    if (x->d) {
-        object_free(x->d);
-    }
-    t_object *info;
-    t_symbol *sym_device = gensym("device");
-    t_symbol *sym_name = gensym("name");
-    const char *my_name = 0;
-    short path;
-    unsigned int filetype = 'JSON', outtype;
-
-    // TODO: add ".json" to end of string if missing (or pick new filetype!)
-
-    if (locatefile_extended(x->definition, &path, &outtype, &filetype, 1) == 0) {
-        POST(x, "Located file %s", x->definition);
-        if (dictionary_read(x->definition, path, &(x->d)) == 0) {
-            //check that first key is "device"
-            if (dictionary_entryisdictionary(x->d, sym_device)) {
-                //recover name from dictionary
-                dictionary_getdictionary(x->d, sym_device, &info);
-                dictionary_getstring((t_dictionary *)info, sym_name, &my_name);
-                if (my_name) {
-                    free(x->name);
-                    x->name = *my_name == '/' ? strdup(my_name+1) : strdup(my_name);
-                }
-            }
+    t_mapper_sig *ctx = (t_mapper_sig *)malloc(sizeof(t_mapper_sig));
+    ctx->home = x;
+    ctx->sig = sig;
+    ctx->name = gensym((char *)mpr_obj_get_prop_as_str(sig, MPR_PROP_NAME, NULL));
+    ctx->coalesce = coalesce;
+    ctx->queued = 0;
+    ctx->num_slots = 0;
+    ctx->slots = 0;
+    ctx->next_dirty = 0;
+    memset(&ctx->latency, 0, sizeof(t_latency));
+    memset(&ctx->stats, 0, sizeof(t_sig_stats));
+    mpr_obj_set_prop(sig, MPR_PROP_DATA, NULL, 1, MPR_PTR, ctx, 0);
+    return ctx;
+}
+
+static void mapperobj_free_signal(t_mapper *x, mpr_sig sig)
+{
+    t_mapper_sig *ctx = (void*)mpr_obj_get_prop_as_ptr(sig, MPR_PROP_DATA, NULL);
+    if (ctx) {
+        if (ctx->queued && x) {
+            t_mapper_sig **prev = &x->dirty;
+            while (*prev && *prev != ctx)
+                prev = &(*prev)->next_dirty;
+            if (*prev)
+                *prev = ctx->next_dirty;
         }
-        else {
-            POST(x, "Could not parse file %s", x->definition);
+        if (ctx->slots)
+            free(ctx->slots);
+        free(ctx);
+        mpr_obj_set_prop(sig, MPR_PROP_DATA, NULL, 1, MPR_PTR, 0, 0);
+    }
+    mpr_sig_free(sig);
+}
+
+// *********************************************************
+// -(output coalesced values)-------------------------------
+static void mapperobj_flush_signal(t_mapper_sig *ctx)
+{
+    t_mapper *x = ctx->home;
+    double start;
+    int i;
+    for (i = 0; i < ctx->num_slots; i++) {
+        t_coalesce_slot *slot = &ctx->slots[i];
+        int count = slot->count;
+        if (!count)
+            continue;
+        slot->count = 0;
+        start = x->time_handlers ? mapperobj_time_ms() : 0;
+        if (x->timestamps)
+            mapperobj_output_timetag(x, ctx, slot->inst, slot->time, slot->latency);
+        mapperobj_output_value(x, ctx->sig, ctx->name, slot->inst, slot->len, slot->type,
+                               &slot->value);
+        if (x->time_handlers)
+            stats_handled(&ctx->stats, start);
+        if (count > 1) {
+            ctx->stats.coalesced += count - 1;
+            // report how many updates were replaced by this one
+            int poly = mpr_sig_get_num_inst(ctx->sig, MPR_STATUS_ANY) > 1;
+            maxpd_atom_set_string(x->buffer.atoms, ctx->name->s_name);
+            if (poly)
+                maxpd_atom_set_int(x->buffer.atoms + 1, slot->inst);
+            maxpd_atom_set_int(x->buffer.atoms + 1 + poly, count - 1);
+            outlet_anything(x->outlet2, gensym("coalesced"), 2 + poly, x->buffer.atoms);
         }
     }
-    else {
-        POST(x, "Could not locate file %s", x->definition);
+}
+
+static void mapperobj_flush_coalesced(t_mapper *x)
+{
+    while (x->dirty) {
+        t_mapper_sig *ctx = x->dirty;
+        x->dirty = ctx->next_dirty;
+        ctx->next_dirty = 0;
+        ctx->queued = 0;
+        mapperobj_flush_signal(ctx);
     }
 }
-#endif // MAXMSP
 
 // *********************************************************
-// -(register signals from dictionary - maxmsp only)--------
-#ifdef MAXMSP
-static void mapperobj_register_signals(t_mapper *x) {
-    t_atom *signals;
-    long num_signals, i;
-    t_object *device, *inputs, *outputs, *temp;
-    t_symbol *sym_device = gensym("device");
-    t_symbol *sym_inputs = gensym("inputs");
-    t_symbol *sym_outputs = gensym("outputs");
-    t_symbol *sym_name = gensym("name");
-    t_symbol *sym_type = gensym("type");
-    t_symbol *sym_units = gensym("units");
-    t_symbol *sym_minimum = gensym("minimum");
-    t_symbol *sym_maximum = gensym("maximum");
-    t_symbol *sym_length = gensym("length");
-
-    const char *sig_name, *sig_units, *sig_type_str;
-    mpr_type sig_type = 0;
-    double val_d;
-    long long val_l, sig_length;
-
-    mpr_sig temp_sig;
-    short range_known[2];
-
-    if (!x->d)
-        return;
+// -(device definitions)------------------------------------
+/* Device definitions are read with a small single-pass JSON parser that
+ * fills a flat t_definition directly, without building a document tree.
+ * Strings are decoded in place in the file text. With @cache 1 the parsed
+ * definition is also written to "<file>.cache" in a binary layout that is
+ * mapped on the next load, as long as the size and modification time of the
+ * JSON file have not changed. Range values and strings are used in place in
+ * the mapping; only the signal and property records are converted, as they
+ * hold pointers. */
+
+#define DEF_CACHE_MAGIC "MPRDEF\0\1"
+#define DEF_CACHE_NONE 0xFFFFFFFF
+
+typedef struct _def_cache_header
+{
+    char magic[8];
+    uint32_t num_sigs, num_props, num_nums, strings_size;
+    int64_t src_size, src_mtime;
+    uint32_t name, pad;
+} t_def_cache_header;
 
-    // Get pointer to dictionary "device"
-    if (dictionary_getdictionary(x->d, sym_device, &device) != MAX_ERR_NONE)
-        return;
+typedef struct _def_cache_sig
+{
+    uint32_t name, units;
+    int32_t dir, type, length, num_inst, steal;
+    int32_t min_len, min_idx, max_len, max_idx;
+    int32_t first_prop, num_props;
+    uint32_t pad;
+} t_def_cache_sig;
+
+typedef struct _def_cache_prop
+{
+    uint32_t key, str;
+    int32_t type, pad;
+    double num;
+} t_def_cache_prop;
 
-    // Get pointer to atom array "inputs"
-    if (dictionary_getatomarray((t_dictionary *)device, sym_inputs, &inputs) == MAX_ERR_NONE) {
-        atomarray_getatoms((t_atomarray *)inputs, &num_signals, &signals);
-        // iterate through array of atoms
-        for (i=0; i<num_signals; i++) {
-            // initialize variables
-            range_known[0] = 0;
-            range_known[1] = 0;
-
-            // each atom object points to a dictionary, need to recover atoms by key
-            temp = atom_getobj(&(signals[i]));
-            if (dictionary_getstring((t_dictionary *)temp, sym_name, &sig_name) != MAX_ERR_NONE)
-                continue;
-            if (dictionary_getstring((t_dictionary *)temp, sym_type, &sig_type_str) != MAX_ERR_NONE)
-                continue;
-            if (dictionary_getlong((t_dictionary *)temp, sym_length, &sig_length) != MAX_ERR_NONE)
-                sig_length = 1;
-            if (dictionary_getstring((t_dictionary *)temp, sym_units, &sig_units) != MAX_ERR_NONE)
-                sig_units = 0;
-
-            if ((strcmp(sig_type_str, "int") == 0) || (strcmp(sig_type_str, "i") == 0))
-                sig_type = MPR_INT32;
-            else if ((strcmp(sig_type_str, "float") == 0) || (strcmp(sig_type_str, "f") == 0))
-                sig_type = MPR_FLT;
-            else {
-                POST(x, "Skipping registration of signal %s (unknown type).", sig_name);
-                continue;
-            }
+static double mapperobj_time_ms(void)
+{
+#ifdef MAXMSP
+    return systimer_gettime();
+#else
+    return sys_getrealtime() * 1000.;
+#endif
+}
 
-            if (sig_length > MAX_LIST) {
-                POST(x, "Limiting signal vector length %d.", MAX_LIST);
-                sig_length = MAX_LIST;
-            }
+static t_definition *def_new(void)
+{
+    t_definition *def = (t_definition *)calloc(1, sizeof(t_definition));
+    return def;
+}
 
-            temp_sig = mpr_sig_new(x->device, MPR_DIR_IN, sig_name, (int)sig_length, sig_type,
-                                   sig_units, 0, 0, 0, mapperobj_sig_handler, MPR_SIG_ALL);
-            mpr_obj_set_prop(temp_sig, MPR_PROP_DATA, NULL, 1, MPR_PTR, x, 0);
+static void def_free(t_definition *def)
+{
+    if (def->sigs)
+        free(def->sigs);
+    if (def->props)
+        free(def->props);
+    if (def->nums && def->size_nums)
+        free(def->nums);
+    if (def->text)
+        free(def->text);
+    if (def->map) {
+#ifndef WIN32
+        munmap(def->map, def->map_size);
+#else
+        free(def->map);
+#endif
+    }
+    free(def);
+}
 
-            if (!temp_sig)
-                continue;
+static t_def_sig *def_add_sig(t_definition *def)
+{
+    t_def_sig *sig;
+    if (def->num_sigs == def->size_sigs) {
+        def->size_sigs = def->size_sigs ? def->size_sigs * 2 : 16;
+        def->sigs = realloc(def->sigs, def->size_sigs * sizeof(t_def_sig));
+    }
+    sig = &def->sigs[def->num_sigs++];
+    memset(sig, 0, sizeof(t_def_sig));
+    sig->length = 1;
+    sig->first_prop = def->num_props;
+    return sig;
+}
 
-            if (dictionary_getfloat((t_dictionary *)temp, sym_minimum, &val_d) == MAX_ERR_NONE) {
-                mpr_obj_set_prop(temp_sig, MPR_PROP_MIN, NULL, 1, MPR_DBL, &val_d, 1);
-            }
-            else if (dictionary_getlong((t_dictionary *)temp, sym_minimum, &val_l) == MAX_ERR_NONE) {
-                int val_i = (int)val_l;
-                mpr_obj_set_prop(temp_sig, MPR_PROP_MIN, NULL, 1, MPR_INT32, &val_i, 1);
+static t_def_prop *def_add_prop(t_definition *def)
+{
+    if (def->num_props == def->size_props) {
+        def->size_props = def->size_props ? def->size_props * 2 : 16;
+        def->props = realloc(def->props, def->size_props * sizeof(t_def_prop));
+    }
+    return &def->props[def->num_props++];
+}
+
+static int def_add_num(t_definition *def, double num)
+{
+    if (def->num_nums == def->size_nums) {
+        def->size_nums = def->size_nums ? def->size_nums * 2 : 32;
+        def->nums = realloc(def->nums, def->size_nums * sizeof(double));
+    }
+    def->nums[def->num_nums] = num;
+    return def->num_nums++;
+}
+
+// -(json parser)-------------------------------------------
+typedef struct _json
+{
+    char *p;
+    const char *error;
+} t_json;
+
+static void json_ws(t_json *j)
+{
+    while (*j->p == ' ' || *j->p == '\t' || *j->p == '\n' || *j->p == '\r')
+        ++j->p;
+}
+
+static int json_expect(t_json *j, char c)
+{
+    json_ws(j);
+    if (*j->p != c) {
+        j->error = "unexpected character";
+        return 1;
+    }
+    ++j->p;
+    return 0;
+}
+
+// read the four hex digits of a \\u escape
+static int json_hex4(t_json *j, unsigned int *code)
+{
+    int k;
+    *code = 0;
+    for (k = 0; k < 4; k++) {
+        char h = *j->p++;
+        *code <<= 4;
+        if (h >= '0' && h <= '9')       *code |= h - '0';
+        else if (h >= 'a' && h <= 'f')  *code |= h - 'a' + 10;
+        else if (h >= 'A' && h <= 'F')  *code |= h - 'A' + 10;
+        else {
+            j->error = "bad unicode escape";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// decode the string at j->p in place and return it, or 0 on error
+static char *json_string(t_json *j)
+{
+    char *start, *out;
+    json_ws(j);
+    if (*j->p != '"') {
+        j->error = "expected string";
+        return 0;
+    }
+    start = out = ++j->p;
+    while (*j->p != '"') {
+        char c = *j->p++;
+        if (!c) {
+            j->error = "unterminated string";
+            return 0;
+        }
+        if (c != '\\') {
+            *out++ = c;
+            continue;
+        }
+        switch (c = *j->p++) {
+            case 'b':   *out++ = '\b';  break;
+            case 'f':   *out++ = '\f';  break;
+            case 'n':   *out++ = '\n';  break;
+            case 'r':   *out++ = '\r';  break;
+            case 't':   *out++ = '\t';  break;
+            case 'u': {
+                unsigned int code, low;
+                if (json_hex4(j, &code))
+                    return 0;
+                if (!code) {
+                    // would end the string early
+                    j->error = "null character in string";
+                    return 0;
+                }
+                if (code >= 0xDC00 && code < 0xE000) {
+                    j->error = "unpaired surrogate";
+                    return 0;
+                }
+                if (code >= 0xD800 && code < 0xDC00) {
+                    if (j->p[0] != '\\' || j->p[1] != 'u') {
+                        j->error = "unpaired surrogate";
+                        return 0;
+                    }
+                    j->p += 2;
+                    if (json_hex4(j, &low))
+                        return 0;
+                    if (low < 0xDC00 || low >= 0xE000) {
+                        j->error = "unpaired surrogate";
+                        return 0;
+                    }
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                // encode as UTF-8, never longer than the escape it replaces
+                if (code < 0x80)
+                    *out++ = (char)code;
+                else if (code < 0x800) {
+                    *out++ = (char)(0xC0 | (code >> 6));
+                    *out++ = (char)(0x80 | (code & 0x3F));
+                }
+                else if (code < 0x10000) {
+                    *out++ = (char)(0xE0 | (code >> 12));
+                    *out++ = (char)(0x80 | ((code >> 6) & 0x3F));
+                    *out++ = (char)(0x80 | (code & 0x3F));
+                }
+                else {
+                    *out++ = (char)(0xF0 | (code >> 18));
+                    *out++ = (char)(0x80 | ((code >> 12) & 0x3F));
+                    *out++ = (char)(0x80 | ((code >> 6) & 0x3F));
+                    *out++ = (char)(0x80 | (code & 0x3F));
+                }
+                break;
             }
-            if (dictionary_getfloat((t_dictionary *)temp, sym_maximum, &val_d) == MAX_ERR_NONE) {
-                mpr_obj_set_prop(temp_sig, MPR_PROP_MAX, NULL, 1, MPR_DBL, &val_d, 1);
+            case 0:
+                j->error = "unterminated string";
+                return 0;
+            default:    *out++ = c;     break;
+        }
+    }
+    ++j->p;
+    *out = 0;
+    return start;
+}
+
+static int json_number(t_json *j, double *num, int *is_int)
+{
+    char *end;
+    json_ws(j);
+    *num = strtod(j->p, &end);
+    if (end == j->p) {
+        j->error = "expected number";
+        return 1;
+    }
+    *is_int = 1;
+    for (; j->p < end; j->p++) {
+        if (*j->p == '.' || *j->p == 'e' || *j->p == 'E')
+            *is_int = 0;
+    }
+    return 0;
+}
+
+static int json_literal(t_json *j, const char *word)
+{
+    size_t len = strlen(word);
+    if (strncmp(j->p, word, len)) {
+        j->error = "unexpected literal";
+        return 1;
+    }
+    j->p += len;
+    return 0;
+}
+
+// skip over any value
+static int json_skip(t_json *j)
+{
+    double num;
+    int is_int;
+    json_ws(j);
+    switch (*j->p) {
+        case '"':
+            return !json_string(j);
+        case '{':
+        case '[': {
+            char close = (*j->p == '{') ? '}' : ']';
+            ++j->p;
+            json_ws(j);
+            if (*j->p == close) {
+                ++j->p;
+                return 0;
             }
-            else if (dictionary_getlong((t_dictionary *)temp, sym_maximum, &val_l) == MAX_ERR_NONE) {
-                int val_i = (int)val_l;
-                mpr_obj_set_prop(temp_sig, MPR_PROP_MAX, NULL, 1, MPR_INT32, &val_i, 1);
+            while (1) {
+                if (close == '}' && (!json_string(j) || json_expect(j, ':')))
+                    return 1;
+                if (json_skip(j))
+                    return 1;
+                json_ws(j);
+                if (*j->p == ',') {
+                    ++j->p;
+                    continue;
+                }
+                return json_expect(j, close);
             }
         }
+        case 't':
+            return json_literal(j, "true");
+        case 'f':
+            return json_literal(j, "false");
+        case 'n':
+            return json_literal(j, "null");
+        default:
+            return json_number(j, &num, &is_int);
     }
+}
 
-    // Get pointer to atom array "outputs"
-    if (dictionary_getatomarray((t_dictionary *)device, sym_outputs, &outputs) == MAX_ERR_NONE) {
-        atomarray_getatoms((t_atomarray *)outputs, &num_signals, &signals);
-        // iterate through array of atoms
-        for (i=0; i<num_signals; i++) {
-            // initialize variables
-            range_known[0] = 0;
-            range_known[1] = 0;
+// a number or an array of numbers, appended to the definition's nums
+static int json_range(t_json *j, t_definition *def, int *len, int *idx)
+{
+    double num;
+    int is_int;
+    json_ws(j);
+    *idx = def->num_nums;
+    *len = 0;
+    if (*j->p != '[') {
+        if (json_number(j, &num, &is_int))
+            return 1;
+        def_add_num(def, num);
+        *len = 1;
+        return 0;
+    }
+    ++j->p;
+    json_ws(j);
+    if (*j->p == ']') {
+        ++j->p;
+        return 0;
+    }
+    while (1) {
+        if (json_number(j, &num, &is_int))
+            return 1;
+        def_add_num(def, num);
+        ++*len;
+        json_ws(j);
+        if (*j->p == ',') {
+            ++j->p;
+            continue;
+        }
+        return json_expect(j, ']');
+    }
+}
+
+static int json_signal(t_json *j, t_definition *def, mpr_dir dir)
+{
+    t_def_sig *sig = def_add_sig(def);
+    const char *key, *str;
+    double num;
+    int is_int;
+
+    sig->dir = dir;
+    if (json_expect(j, '{'))
+        return 1;
+    json_ws(j);
+    if (*j->p == '}') {
+        ++j->p;
+        return 0;
+    }
+    while (1) {
+        if (!(key = json_string(j)) || json_expect(j, ':'))
+            return 1;
+        json_ws(j);
+        if (strcmp(key, "name") == 0) {
+            if (!(sig->name = json_string(j)))
+                return 1;
+        }
+        else if (strcmp(key, "type") == 0) {
+            if (!(str = json_string(j)))
+                return 1;
+            if ((strcmp(str, "int") == 0) || (strcmp(str, "i") == 0))
+                sig->type = MPR_INT32;
+            else if ((strcmp(str, "float") == 0) || (strcmp(str, "f") == 0))
+                sig->type = MPR_FLT;
+        }
+        else if (strcmp(key, "units") == 0 || strcmp(key, "unit") == 0) {
+            if (!(sig->units = json_string(j)))
+                return 1;
+        }
+        else if (strcmp(key, "length") == 0) {
+            if (json_number(j, &num, &is_int))
+                return 1;
+            sig->length = (int)num;
+        }
+        else if (strcmp(key, "instances") == 0) {
+            if (json_number(j, &num, &is_int))
+                return 1;
+            sig->num_inst = (int)num;
+        }
+        else if (strcmp(key, "stealing") == 0) {
+            if (!(str = json_string(j)))
+                return 1;
+            if (strcmp(str, "newest") == 0)
+                sig->steal = MPR_STEAL_NEWEST;
+            else if (strcmp(str, "oldest") == 0)
+                sig->steal = MPR_STEAL_OLDEST;
+        }
+        else if (strcmp(key, "minimum") == 0 || strcmp(key, "min") == 0) {
+            if (json_range(j, def, &sig->min_len, &sig->min_idx))
+                return 1;
+        }
+        else if (strcmp(key, "maximum") == 0 || strcmp(key, "max") == 0) {
+            if (json_range(j, def, &sig->max_len, &sig->max_idx))
+                return 1;
+        }
+        else if (*j->p == '"') {
+            t_def_prop *prop = def_add_prop(def);
+            prop->key = key;
+            prop->type = MPR_STR;
+            if (!(prop->str = json_string(j)))
+                return 1;
+        }
+        else if (*j->p == '-' || (*j->p >= '0' && *j->p <= '9')) {
+            t_def_prop *prop = def_add_prop(def);
+            prop->key = key;
+            prop->str = 0;
+            if (json_number(j, &prop->num, &is_int))
+                return 1;
+            prop->type = is_int ? MPR_INT32 : MPR_FLT;
+        }
+        else if (*j->p == 't' || *j->p == 'f') {
+            t_def_prop *prop = def_add_prop(def);
+            prop->key = key;
+            prop->str = 0;
+            prop->type = MPR_BOOL;
+            prop->num = (*j->p == 't');
+            if (json_literal(j, prop->num ? "true" : "false"))
+                return 1;
+        }
+        else if (json_skip(j)) {
+            return 1;
+        }
+        json_ws(j);
+        if (*j->p == ',') {
+            ++j->p;
+            continue;
+        }
+        break;
+    }
+    sig->num_props = def->num_props - sig->first_prop;
+    return json_expect(j, '}');
+}
+
+static int json_signals(t_json *j, t_definition *def, mpr_dir dir)
+{
+    if (json_expect(j, '['))
+        return 1;
+    json_ws(j);
+    if (*j->p == ']') {
+        ++j->p;
+        return 0;
+    }
+    while (1) {
+        if (json_signal(j, def, dir))
+            return 1;
+        json_ws(j);
+        if (*j->p == ',') {
+            ++j->p;
+            continue;
+        }
+        return json_expect(j, ']');
+    }
+}
+
+static int json_device(t_json *j, t_definition *def)
+{
+    const char *key;
+    if (json_expect(j, '{'))
+        return 1;
+    json_ws(j);
+    if (*j->p == '}') {
+        ++j->p;
+        return 0;
+    }
+    while (1) {
+        if (!(key = json_string(j)) || json_expect(j, ':'))
+            return 1;
+        if (strcmp(key, "name") == 0) {
+            if (!(def->name = json_string(j)))
+                return 1;
+        }
+        else if (strcmp(key, "inputs") == 0) {
+            if (json_signals(j, def, MPR_DIR_IN))
+                return 1;
+        }
+        else if (strcmp(key, "outputs") == 0) {
+            if (json_signals(j, def, MPR_DIR_OUT))
+                return 1;
+        }
+        else if (json_skip(j)) {
+            return 1;
+        }
+        json_ws(j);
+        if (*j->p == ',') {
+            ++j->p;
+            continue;
+        }
+        return json_expect(j, '}');
+    }
+}
+
+// parse a definition, taking ownership of 'text'
+static t_definition *def_parse(char *text, const char **error, int *line)
+{
+    t_definition *def = def_new();
+    t_json j;
+    const char *key;
+    char *c;
+
+    def->text = text;
+    j.p = text;
+    j.error = 0;
+    if (json_expect(&j, '{'))
+        goto fail;
+    json_ws(&j);
+    while (*j.p != '}') {
+        if (!(key = json_string(&j)) || json_expect(&j, ':'))
+            goto fail;
+        if (strcmp(key, "device") == 0) {
+            if (json_device(&j, def))
+                goto fail;
+        }
+        else if (json_skip(&j)) {
+            goto fail;
+        }
+        json_ws(&j);
+        if (*j.p == ',')
+            ++j.p;
+        else if (*j.p != '}') {
+            j.error = "expected ',' or '}'";
+            goto fail;
+        }
+    }
+    return def;
+
+fail:
+    *error = j.error;
+    *line = 1;
+    for (c = text; c < j.p; c++) {
+        if (*c == '\n')
+            ++*line;
+    }
+    def_free(def);
+    return 0;
+}
+
+// -(binary cache)------------------------------------------
+static uint32_t def_cache_string(const char *str, char **strings, uint32_t *size, uint32_t *alloc)
+{
+    uint32_t off = *size, len;
+    if (!str)
+        return DEF_CACHE_NONE;
+    len = (uint32_t)strlen(str) + 1;
+    if (*size + len > *alloc) {
+        while (*size + len > *alloc)
+            *alloc = *alloc ? *alloc * 2 : 4096;
+        *strings = realloc(*strings, *alloc);
+    }
+    memcpy(*strings + off, str, len);
+    *size += len;
+    return off;
+}
+
+static int def_cache_write(t_definition *def, const char *path, int64_t src_size, int64_t src_mtime)
+{
+    t_def_cache_header header;
+    t_def_cache_sig *sigs = 0;
+    t_def_cache_prop *props = 0;
+    char *strings = 0, tmp[1024];
+    uint32_t strings_size = 0, strings_alloc = 0;
+    int i, ok = 0;
+    FILE *f;
+
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+        return 1;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DEF_CACHE_MAGIC, 8);
+    header.num_sigs = def->num_sigs;
+    header.num_props = def->num_props;
+    header.num_nums = def->num_nums;
+    header.src_size = src_size;
+    header.src_mtime = src_mtime;
+    header.name = def_cache_string(def->name, &strings, &strings_size, &strings_alloc);
+
+    if (def->num_sigs)
+        sigs = (t_def_cache_sig *)calloc(def->num_sigs, sizeof(t_def_cache_sig));
+    for (i = 0; i < def->num_sigs; i++) {
+        t_def_sig *sig = &def->sigs[i];
+        sigs[i].name = def_cache_string(sig->name, &strings, &strings_size, &strings_alloc);
+        sigs[i].units = def_cache_string(sig->units, &strings, &strings_size, &strings_alloc);
+        sigs[i].dir = sig->dir;
+        sigs[i].type = sig->type;
+        sigs[i].length = sig->length;
+        sigs[i].num_inst = sig->num_inst;
+        sigs[i].steal = sig->steal;
+        sigs[i].min_len = sig->min_len;
+        sigs[i].min_idx = sig->min_idx;
+        sigs[i].max_len = sig->max_len;
+        sigs[i].max_idx = sig->max_idx;
+        sigs[i].first_prop = sig->first_prop;
+        sigs[i].num_props = sig->num_props;
+    }
+    if (def->num_props)
+        props = (t_def_cache_prop *)calloc(def->num_props, sizeof(t_def_cache_prop));
+    for (i = 0; i < def->num_props; i++) {
+        t_def_prop *prop = &def->props[i];
+        props[i].key = def_cache_string(prop->key, &strings, &strings_size, &strings_alloc);
+        props[i].str = def_cache_string(prop->str, &strings, &strings_size, &strings_alloc);
+        props[i].type = prop->type;
+        props[i].num = prop->num;
+    }
+    header.strings_size = strings_size;
+
+    if ((f = fopen(tmp, "wb"))) {
+        ok = (   fwrite(&header, sizeof(header), 1, f) == 1
+              && fwrite(def->nums, sizeof(double), def->num_nums, f) == (size_t)def->num_nums
+              && fwrite(sigs, sizeof(t_def_cache_sig), def->num_sigs, f) == (size_t)def->num_sigs
+              && fwrite(props, sizeof(t_def_cache_prop), def->num_props, f) == (size_t)def->num_props
+              && fwrite(strings, 1, strings_size, f) == strings_size);
+        ok = (fclose(f) == 0) && ok;
+#ifdef WIN32
+        if (ok)
+            remove(path);
+#endif
+        if (!ok || rename(tmp, path) != 0) {
+            remove(tmp);
+            ok = 0;
+        }
+    }
+
+    if (sigs)
+        free(sigs);
+    if (props)
+        free(props);
+    if (strings)
+        free(strings);
+    return !ok;
+}
+
+// a string of the cache, which must lie within the string table
+static int def_cache_get_string(const char *strings, uint32_t size, uint32_t off, const char **str)
+{
+    if (off == DEF_CACHE_NONE) {
+        *str = 0;
+        return 0;
+    }
+    if (off >= size)
+        return 1;
+    *str = strings + off;
+    return 0;
+}
+
+static t_definition *def_cache_read(const char *path, int64_t src_size, int64_t src_mtime)
+{
+    t_def_cache_header *header;
+    t_def_cache_sig *sigs;
+    t_def_cache_prop *props;
+    t_definition *def;
+    struct stat st;
+    char *data, *strings;
+    size_t size;
+    int i, bad = 0;
+
+    if (stat(path, &st) != 0 || (size_t)st.st_size < sizeof(t_def_cache_header))
+        return 0;
+    size = (size_t)st.st_size;
+
+#ifndef WIN32
+    {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            return 0;
+        data = (char *)mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+            return 0;
+    }
+#else
+    {
+        FILE *f = fopen(path, "rb");
+        if (!f)
+            return 0;
+        data = (char *)malloc(size);
+        if (fread(data, 1, size, f) != size) {
+            fclose(f);
+            free(data);
+            return 0;
+        }
+        fclose(f);
+    }
+#endif
+
+    def = def_new();
+    def->map = data;
+    def->map_size = size;
+
+    header = (t_def_cache_header *)data;
+    if (   memcmp(header->magic, DEF_CACHE_MAGIC, 8)
+        || header->src_size != src_size || header->src_mtime != src_mtime
+        || size != (  sizeof(t_def_cache_header) + header->num_nums * sizeof(double)
+                    + header->num_sigs * sizeof(t_def_cache_sig)
+                    + header->num_props * sizeof(t_def_cache_prop) + header->strings_size)) {
+        def_free(def);
+        return 0;
+    }
+    sigs = (t_def_cache_sig *)(data + sizeof(t_def_cache_header) + header->num_nums * sizeof(double));
+    props = (t_def_cache_prop *)(sigs + header->num_sigs);
+    strings = (char *)(props + header->num_props);
+    // the table ends with a terminator, so every string within it is terminated
+    if (header->strings_size && strings[header->strings_size - 1]) {
+        def_free(def);
+        return 0;
+    }
+
+#define CACHE_STRING(off, str) (bad |= def_cache_get_string(strings, header->strings_size, off, str))
+    CACHE_STRING(header->name, &def->name);
+    // the header is a multiple of 8 bytes, so the values are aligned in the mapping
+    def->num_nums = header->num_nums;
+    if (def->num_nums)
+        def->nums = (double *)(data + sizeof(t_def_cache_header));
+    def->num_sigs = def->size_sigs = header->num_sigs;
+    if (def->num_sigs)
+        def->sigs = (t_def_sig *)malloc(def->num_sigs * sizeof(t_def_sig));
+    for (i = 0; i < def->num_sigs; i++) {
+        t_def_sig *sig = &def->sigs[i];
+        CACHE_STRING(sigs[i].name, &sig->name);
+        CACHE_STRING(sigs[i].units, &sig->units);
+        sig->dir = sigs[i].dir;
+        sig->type = (mpr_type)sigs[i].type;
+        sig->length = sigs[i].length;
+        sig->num_inst = sigs[i].num_inst;
+        sig->steal = sigs[i].steal;
+        sig->min_len = sigs[i].min_len;
+        sig->min_idx = sigs[i].min_idx;
+        sig->max_len = sigs[i].max_len;
+        sig->max_idx = sigs[i].max_idx;
+        sig->first_prop = sigs[i].first_prop;
+        sig->num_props = sigs[i].num_props;
+        if (   bad || sig->min_idx < 0 || sig->min_len < 0 || sig->max_idx < 0 || sig->max_len < 0
+            || sig->first_prop < 0 || sig->num_props < 0
+            || sig->min_idx + sig->min_len > def->num_nums
+            || sig->max_idx + sig->max_len > def->num_nums
+            || sig->first_prop + sig->num_props > (int)header->num_props) {
+            def_free(def);
+            return 0;
+        }
+    }
+    def->num_props = def->size_props = header->num_props;
+    if (def->num_props)
+        def->props = (t_def_prop *)malloc(def->num_props * sizeof(t_def_prop));
+    for (i = 0; i < def->num_props; i++) {
+        CACHE_STRING(props[i].key, &def->props[i].key);
+        CACHE_STRING(props[i].str, &def->props[i].str);
+        def->props[i].type = (mpr_type)props[i].type;
+        def->props[i].num = props[i].num;
+    }
+#undef CACHE_STRING
+    if (bad) {
+        def_free(def);
+        return 0;
+    }
+    return def;
+}
+
+// *********************************************************
+// -(locate a file relative to the patch)-------------------
+static int mapperobj_locate_file(t_mapper *x, const char *name, char *path, size_t size)
+{
+#ifdef MAXMSP
+    char max_path[MAX_PATH_CHARS], filename[MAX_PATH_CHARS];
+    short path_id;
+    t_fourcc filetype = 'JSON', outtype;
+
+    strncpy(filename, name, MAX_PATH_CHARS - 1);
+    filename[MAX_PATH_CHARS - 1] = 0;
+    if (locatefile_extended(filename, &path_id, &outtype, &filetype, 1) != 0)
+        return 1;
+    if (path_toabsolutesystempath(path_id, filename, max_path) != MAX_ERR_NONE)
+        return 1;
+    return path_nameconform(max_path, path, PATH_STYLE_NATIVE, PATH_TYPE_ABSOLUTE) != MAX_ERR_NONE;
+#else
+    char dir[MAXPDSTRING], *file;
+    int fd = canvas_open(x->canvas, name, "", dir, &file, MAXPDSTRING, 1);
+    if (fd < 0)
+        return 1;
+    close(fd);
+    return snprintf(path, size, "%s/%s", dir, file) >= (int)size;
+#endif
+}
+
+// *********************************************************
+// -(read device definition)--------------------------------
+static void mapperobj_read_definition(t_mapper *x)
+{
+    char path[1024], cache_path[1040];
+    const char *error = 0;
+    struct stat st;
+    double start = mapperobj_time_ms(), loaded;
+    int line = 0, cached = 0;
+    t_definition *def = 0;
+
+    if (x->def) {
+        def_free(x->def);
+        x->def = 0;
+    }
+
+    if (mapperobj_locate_file(x, x->definition, path, sizeof(path))) {
+        POST(x, "Could not locate file %s", x->definition);
+        return;
+    }
+    POST(x, "Located file %s", path);
+    if (x->def_path)
+        free(x->def_path);
+    x->def_path = strdup(path);
+    if (stat(path, &st) != 0) {
+        POST(x, "Could not read file %s", path);
+        return;
+    }
+    snprintf(cache_path, sizeof(cache_path), "%s.cache", path);
+
+    if (x->def_cache && (def = def_cache_read(cache_path, st.st_size, st.st_mtime)))
+        cached = 1;
+    else {
+        FILE *f = fopen(path, "rb");
+        char *text;
+        size_t size = (size_t)st.st_size;
+        if (!f) {
+            POST(x, "Could not read file %s", path);
+            return;
+        }
+        text = (char *)malloc(size + 1);
+        if (fread(text, 1, size, f) != size) {
+            fclose(f);
+            free(text);
+            POST(x, "Could not read file %s", path);
+            return;
+        }
+        fclose(f);
+        text[size] = 0;
+        if (!(def = def_parse(text, &error, &line))) {
+            POST(x, "Could not parse file %s: %s on line %d", path, error, line);
+            return;
+        }
+    }
+    loaded = mapperobj_time_ms();
+
+    if (x->def_cache && !cached && def_cache_write(def, cache_path, st.st_size, st.st_mtime))
+        POST(x, "Could not write definition cache %s", cache_path);
+
+    POST(x, "%s %d signals in %.2f ms", cached ? "Mapped cache of" : "Parsed",
+         def->num_sigs, loaded - start);
+
+    if (def->name) {
+        if (x->name)
+            free(x->name);
+        x->name = *def->name == '/' ? strdup(def->name+1) : strdup(def->name);
+    }
+    x->def = def;
+}
+
+// *********************************************************
+// -(create one signal from a definition)-------------------
+static void def_fill_range(t_definition *def, int idx, int num, int length, mpr_type type,
+                           void *out)
+{
+    int i;
+    for (i = 0; i < length; i++) {
+        double val = def->nums[idx + (i % num)];
+        if (MPR_INT32 == type)
+            ((int *)out)[i] = (int)val;
+        else
+            ((float *)out)[i] = (float)val;
+    }
+}
+
+static int def_sig_length(t_def_sig *s)
+{
+    return s->length < 1 ? 1 : (s->length > MAX_LIST ? MAX_LIST : s->length);
+}
 
-            // each atom object points to a dictionary, need to recover atoms by key
-            temp = atom_getobj(&(signals[i]));
-            if (dictionary_getstring((t_dictionary *)temp, sym_name, &sig_name) != MAX_ERR_NONE)
+static mpr_sig mapperobj_def_sig_new(t_mapper *x, t_definition *def, t_def_sig *s)
+{
+    union {
+        int ints[MAX_LIST];
+        float floats[MAX_LIST];
+    } min, max;
+    int i, length = def_sig_length(s);
+    mpr_sig sig;
+
+    if (!s->name)
+        return 0;
+    if (MPR_INT32 != s->type && MPR_FLT != s->type) {
+        POST(x, "Skipping registration of signal %s (unknown type).", s->name);
+        return 0;
+    }
+    if (s->length > MAX_LIST)
+        POST(x, "Limiting signal vector length %d.", MAX_LIST);
+    if (s->min_len)
+        def_fill_range(def, s->min_idx, s->min_len, length, s->type, &min);
+    if (s->max_len)
+        def_fill_range(def, s->max_idx, s->max_len, length, s->type, &max);
+
+    // range and instances are passed at creation instead of set one at a time
+    if (MPR_DIR_IN == s->dir) {
+        sig = mpr_sig_new(x->device, MPR_DIR_IN, s->name, length, s->type, s->units,
+                          s->min_len ? &min : 0, s->max_len ? &max : 0,
+                          s->num_inst > 1 ? &s->num_inst : 0, mapperobj_sig_handler, MPR_SIG_ALL);
+    }
+    else {
+        sig = mpr_sig_new(x->device, MPR_DIR_OUT, s->name, length, s->type, s->units,
+                          s->min_len ? &min : 0, s->max_len ? &max : 0,
+                          s->num_inst > 1 ? &s->num_inst : 0, 0, 0);
+    }
+    if (!sig)
+        return 0;
+    // outputs get a context too, it holds their traffic counters
+    mapperobj_sig_ctx_new(x, sig, MPR_DIR_IN == s->dir ? x->coalesce : 0);
+
+    if (s->steal)
+        mpr_obj_set_prop(sig, MPR_PROP_STEAL_MODE, NULL, 1, MPR_INT32, &s->steal, 1);
+    for (i = 0; i < s->num_props; i++) {
+        t_def_prop *prop = &def->props[s->first_prop + i];
+        if (!prop->key)
+            continue;
+        if (MPR_STR == prop->type) {
+            if (prop->str)
+                mpr_obj_set_prop(sig, MPR_PROP_UNKNOWN, prop->key, 1, MPR_STR, prop->str, 1);
+        }
+        else if (MPR_FLT == prop->type) {
+            float val = (float)prop->num;
+            mpr_obj_set_prop(sig, MPR_PROP_UNKNOWN, prop->key, 1, MPR_FLT, &val, 1);
+        }
+        else {
+            int val = (int)prop->num;
+            mpr_obj_set_prop(sig, MPR_PROP_UNKNOWN, prop->key, 1, prop->type, &val, 1);
+        }
+    }
+    return sig;
+}
+
+// *********************************************************
+// -(register signals from definition)----------------------
+static void mapperobj_register_signals(t_mapper *x)
+{
+    double start;
+    int i, count = 0;
+
+    if (!x->def)
+        return;
+    mapperobj_clear_unknown(x);
+
+    start = mapperobj_time_ms();
+    for (i = 0; i < x->def->num_sigs; i++) {
+        if (mapperobj_def_sig_new(x, x->def, &x->def->sigs[i]))
+            ++count;
+    }
+    POST(x, "Registered %d signals in %.2f ms", count, mapperobj_time_ms() - start);
+}
+
+// *********************************************************
+// -(reload device definition)------------------------------
+typedef struct _named_sig
+{
+    const char *name;
+    mpr_sig sig;
+    t_def_sig *def;
+} t_named_sig;
+
+static int named_sig_cmp(const void *a, const void *b)
+{
+    return strcmp(((const t_named_sig *)a)->name, ((const t_named_sig *)b)->name);
+}
+
+static t_named_sig *named_sig_find(t_named_sig *sorted, int num, const char *name)
+{
+    t_named_sig key;
+    if (!num)
+        return 0;
+    key.name = name;
+    return (t_named_sig *)bsearch(&key, sorted, num, sizeof(t_named_sig), named_sig_cmp);
+}
+
+// definition signals sorted by name
+static t_named_sig *def_sort(t_definition *def, int *num)
+{
+    t_named_sig *sorted = (t_named_sig *)malloc((def->num_sigs + 1) * sizeof(t_named_sig));
+    int i;
+    *num = 0;
+    for (i = 0; i < def->num_sigs; i++) {
+        if (!def->sigs[i].name)
+            continue;
+        sorted[*num].name = def->sigs[i].name;
+        sorted[*num].sig = 0;
+        sorted[*num].def = &def->sigs[i];
+        ++*num;
+    }
+    qsort(sorted, *num, sizeof(t_named_sig), named_sig_cmp);
+    return sorted;
+}
+
+// set a range property if it differs from the signal's current one
+static int def_sig_update_range(t_definition *def, mpr_sig sig, mpr_prop prop, int num, int idx,
+                                int length, mpr_type type)
+{
+    union {
+        int ints[MAX_LIST];
+        float floats[MAX_LIST];
+    } range;
+    const void *val = 0;
+    mpr_type cur_type = 0;
+    int cur_len = 0;
+
+    mpr_obj_get_prop_by_idx(sig, prop, NULL, &cur_len, &cur_type, &val, NULL);
+    if (!num) {
+        if (!val)
+            return 0;
+        mpr_obj_remove_prop(sig, prop, NULL);
+        return 1;
+    }
+    def_fill_range(def, idx, num, length, type, &range);
+    if (val && cur_len == length && cur_type == type && !memcmp(val, &range, length * sizeof(int)))
+        return 0;
+    mpr_obj_set_prop(sig, prop, NULL, length, type, &range, 1);
+    return 1;
+}
+
+// bring an existing signal's properties in line with its definition
+static int mapperobj_def_sig_update(t_mapper *x, t_definition *def, t_def_sig *s, mpr_sig sig,
+                                    t_definition *old_def, t_def_sig *old)
+{
+    const char *units = mpr_obj_get_prop_as_str(sig, MPR_PROP_UNIT, NULL);
+    int i, j, changed = 0, length = mpr_obj_get_prop_as_int32(sig, MPR_PROP_LEN, NULL);
+
+    if (s->units ? (!units || strcmp(units, s->units)) : (units != 0)) {
+        if (s->units)
+            mpr_obj_set_prop(sig, MPR_PROP_UNIT, NULL, 1, MPR_STR, s->units, 1);
+        else
+            mpr_obj_remove_prop(sig, MPR_PROP_UNIT, NULL);
+        changed = 1;
+    }
+    changed |= def_sig_update_range(def, sig, MPR_PROP_MIN, s->min_len, s->min_idx, length, s->type);
+    changed |= def_sig_update_range(def, sig, MPR_PROP_MAX, s->max_len, s->max_idx, length, s->type);
+
+    if (s->num_inst > mpr_sig_get_num_inst(sig, MPR_STATUS_ANY)) {
+        mpr_sig_reserve_inst(sig, s->num_inst - mpr_sig_get_num_inst(sig, MPR_STATUS_ANY), 0, 0);
+        changed = 1;
+    }
+    if (s->steal != mpr_obj_get_prop_as_int32(sig, MPR_PROP_STEAL_MODE, NULL)) {
+        mpr_obj_set_prop(sig, MPR_PROP_STEAL_MODE, NULL, 1, MPR_INT32, &s->steal, 1);
+        changed = 1;
+    }
+
+    for (i = 0; i < s->num_props; i++) {
+        t_def_prop *prop = &def->props[s->first_prop + i];
+        const void *val = 0;
+        mpr_type type = 0;
+        int len = 0, num = (int)prop->num;
+        float flt = (float)prop->num;
+        if (!prop->key)
+            continue;
+        mpr_obj_get_prop_by_key(sig, prop->key, &len, &type, &val, NULL);
+        if (MPR_STR == prop->type) {
+            if (!prop->str || (val && len == 1 && type == MPR_STR && !strcmp(val, prop->str)))
                 continue;
-            if (dictionary_getstring((t_dictionary *)temp, sym_type, &sig_type_str) != MAX_ERR_NONE)
+            mpr_obj_set_prop(sig, MPR_PROP_UNKNOWN, prop->key, 1, MPR_STR, prop->str, 1);
+        }
+        else if (MPR_FLT == prop->type) {
+            if (val && len == 1 && type == MPR_FLT && *(float *)val == flt)
                 continue;
-            if (dictionary_getlong((t_dictionary *)temp, sym_length, &sig_length) != MAX_ERR_NONE)
-                sig_length = 1;
-            if (dictionary_getstring((t_dictionary *)temp, sym_units, &sig_units) != MAX_ERR_NONE)
-                sig_units = 0;
-
-            if ((strcmp(sig_type_str, "int") == 0) || (strcmp(sig_type_str, "i") == 0))
-                sig_type = MPR_INT32;
-            else if ((strcmp(sig_type_str, "float") == 0) || (strcmp(sig_type_str, "f") == 0))
-                sig_type = MPR_FLT;
-            else {
-                POST("Skipping registration of signal %s (unknown type).",
-                     sig_name);
+            mpr_obj_set_prop(sig, MPR_PROP_UNKNOWN, prop->key, 1, MPR_FLT, &flt, 1);
+        }
+        else {
+            if (val && len == 1 && type == prop->type && *(int *)val == num)
                 continue;
-            }
+            mpr_obj_set_prop(sig, MPR_PROP_UNKNOWN, prop->key, 1, prop->type, &num, 1);
+        }
+        changed = 1;
+    }
 
-            if (sig_length > MAX_LIST) {
-                POST(x, "Limiting signal vector length %d.", MAX_LIST);
-                sig_length = MAX_LIST;
-            }
+    // remove custom properties that were dropped from the definition
+    for (i = 0; old && i < old->num_props; i++) {
+        const char *key = old_def->props[old->first_prop + i].key;
+        if (!key)
+            continue;
+        for (j = 0; j < s->num_props; j++) {
+            const char *new_key = def->props[s->first_prop + j].key;
+            if (new_key && !strcmp(key, new_key))
+                break;
+        }
+        if (j == s->num_props) {
+            mpr_obj_remove_prop(sig, MPR_PROP_UNKNOWN, key);
+            changed = 1;
+        }
+    }
 
-            temp_sig = mpr_sig_new(x->device, MPR_DIR_OUT, sig_name, (int)sig_length, sig_type,
-                                   sig_units, 0, 0, 0, 0, 0);
+    if (changed)
+        mpr_obj_push(sig);
+    return changed;
+}
 
-            if (!temp_sig)
-                continue;
+// bring the device's signals in line with x->def, 'old_def' being the definition they were
+// created from: signals that were dropped are freed, new ones are created and the properties
+// of the others are updated in place so their maps are kept
+static void mapperobj_apply_definition(t_mapper *x, t_definition *old_def, int counts[4])
+{
+    t_named_sig *live, *new_sorted = 0, *old_sorted = 0;
+    int i, num_live = 0, num_new = 0, num_old = 0;
+    mpr_list sigs;
 
-            if (dictionary_getfloat((t_dictionary *)temp, sym_minimum, &val_d) == MAX_ERR_NONE) {
-                mpr_obj_set_prop(temp_sig, MPR_PROP_MIN, NULL, 1, MPR_DBL, &val_d, 1);
-            }
-            else if (dictionary_getlong((t_dictionary *)temp, sym_minimum, &val_l) == MAX_ERR_NONE) {
-                int val_i = (int)val_l;
-                mpr_obj_set_prop(temp_sig, MPR_PROP_MIN, NULL, 1, MPR_INT32, &val_i, 1);
-            }
-            if (dictionary_getfloat((t_dictionary *)temp, sym_maximum, &val_d) == MAX_ERR_NONE) {
-                mpr_obj_set_prop(temp_sig, MPR_PROP_MAX, NULL, 1, MPR_DBL, &val_d, 1);
-            }
-            else if (dictionary_getlong((t_dictionary *)temp, sym_maximum, &val_l) == MAX_ERR_NONE) {
-                int val_i = (int)val_l;
-                mpr_obj_set_prop(temp_sig, MPR_PROP_MAX, NULL, 1, MPR_INT32, &val_i, 1);
+    counts[0] = counts[1] = counts[2] = counts[3] = 0;
+
+    // index the live signals by name
+    sigs = mpr_dev_get_sigs(x->device, MPR_DIR_ANY);
+    live = (t_named_sig *)malloc((mpr_list_get_size(sigs) + 1) * sizeof(t_named_sig));
+    while (sigs) {
+        live[num_live].sig = *sigs;
+        live[num_live].name = mpr_obj_get_prop_as_str(*sigs, MPR_PROP_NAME, NULL);
+        live[num_live].def = 0;
+        ++num_live;
+        sigs = mpr_list_get_next(sigs);
+    }
+    qsort(live, num_live, sizeof(t_named_sig), named_sig_cmp);
+
+    if (x->def)
+        new_sorted = def_sort(x->def, &num_new);
+    if (old_def)
+        old_sorted = def_sort(old_def, &num_old);
+
+    // free signals that were removed from the definition
+    for (i = 0; i < num_old; i++) {
+        t_named_sig *found;
+        if (named_sig_find(new_sorted, num_new, old_sorted[i].name))
+            continue;
+        if ((found = named_sig_find(live, num_live, old_sorted[i].name)) && found->sig) {
+            mapperobj_free_signal(x, found->sig);
+            // the name went with the signal, keep the index sorted with an equal one
+            found->name = old_sorted[i].name;
+            found->sig = 0;
+            ++counts[1];
+        }
+    }
+
+    // create new signals and update existing ones
+    for (i = 0; x->def && i < x->def->num_sigs; i++) {
+        t_def_sig *sd = &x->def->sigs[i];
+        t_named_sig *found, *old = 0;
+        if (!sd->name)
+            continue;
+        found = named_sig_find(live, num_live, sd->name);
+        if (MPR_INT32 != sd->type && MPR_FLT != sd->type) {
+            POST(x, "Skipping signal %s (unknown type).", sd->name);
+            continue;
+        }
+        if (!found || !found->sig) {
+            if (mapperobj_def_sig_new(x, x->def, sd))
+                ++counts[0];
+            continue;
+        }
+        if (   mpr_obj_get_prop_as_int32(found->sig, MPR_PROP_DIR, NULL) != sd->dir
+            || mpr_obj_get_prop_as_int32(found->sig, MPR_PROP_TYPE, NULL) != sd->type
+            || mpr_obj_get_prop_as_int32(found->sig, MPR_PROP_LEN, NULL) != def_sig_length(sd)) {
+            mapperobj_free_signal(x, found->sig);
+            found->name = sd->name;
+            found->sig = 0;
+            if (mapperobj_def_sig_new(x, x->def, sd))
+                ++counts[3];
+            continue;
+        }
+        if (old_sorted)
+            old = named_sig_find(old_sorted, num_old, sd->name);
+        if (mapperobj_def_sig_update(x, x->def, sd, found->sig, old_def, old ? old->def : 0))
+            ++counts[2];
+    }
+    mapperobj_clear_unknown(x);
+
+    free(live);
+    if (new_sorted)
+        free(new_sorted);
+    if (old_sorted)
+        free(old_sorted);
+}
+
+static void mapperobj_reload(t_mapper *x, t_symbol *s, int argc, t_atom *argv)
+{
+    /* Re-read the definition file and apply only the differences, so maps to
+     * signals that did not change are kept. Signals whose direction, type or
+     * length changed have to be recreated. */
+    t_definition *old_def = x->def;
+    int counts[4];
+    double start;
+
+    if (!x->definition) {
+        POST(x, "No definition file to reload.");
+        return;
+    }
+
+    start = mapperobj_time_ms();
+    x->def = 0;
+    mapperobj_read_definition(x);
+    if (!x->def) {
+        x->def = old_def;
+        return;
+    }
+
+    mapperobj_apply_definition(x, old_def, counts);
+    POST(x, "Reloaded %s in %.2f ms: %d added, %d removed, %d updated, %d recreated.",
+         x->def_path, mapperobj_time_ms() - start, counts[0], counts[1], counts[2], counts[3]);
+    if (old_def)
+        def_free(old_def);
+
+    maxpd_atom_set_int(x->buffer.atoms, mpr_list_get_size(mpr_dev_get_sigs(x->device, MPR_DIR_IN)));
+    outlet_anything(x->outlet2, gensym("numInputs"), 1, x->buffer.atoms);
+    maxpd_atom_set_int(x->buffer.atoms, mpr_list_get_size(mpr_dev_get_sigs(x->device, MPR_DIR_OUT)));
+    outlet_anything(x->outlet2, gensym("numOutputs"), 1, x->buffer.atoms);
+}
+
+// *********************************************************
+// -(write device definition)-------------------------------
+// append a signal's range property to the definition's nums
+static void def_snapshot_range(t_definition *def, mpr_sig sig, mpr_prop prop, int *len, int *idx)
+{
+    const void *val = 0;
+    mpr_type type = 0;
+    int i, num = 0;
+
+    *idx = def->num_nums;
+    *len = 0;
+    if (!mpr_obj_get_prop_by_idx(sig, prop, NULL, &num, &type, &val, NULL) || !val)
+        return;
+    for (i = 0; i < num; i++) {
+        if (MPR_INT32 == type)
+            def_add_num(def, ((int *)val)[i]);
+        else if (MPR_FLT == type)
+            def_add_num(def, ((float *)val)[i]);
+        else if (MPR_DBL == type)
+            def_add_num(def, ((double *)val)[i]);
+        else
+            return;
+        ++*len;
+    }
+}
+
+// build a definition from the live signals, strings point into libmapper's
+// own property storage so it must be freed before any signal is changed
+static t_definition *mapperobj_snapshot(t_mapper *x)
+{
+    t_definition *def = def_new();
+    mpr_list sigs = mpr_dev_get_sigs(x->device, MPR_DIR_ANY);
+
+    def->name = x->name;
+    while (sigs) {
+        mpr_sig sig = *sigs;
+        t_def_sig *s = def_add_sig(def);
+        int i, num_props = mpr_obj_get_num_props(sig, 0);
+
+        s->name = mpr_obj_get_prop_as_str(sig, MPR_PROP_NAME, NULL);
+        s->units = mpr_obj_get_prop_as_str(sig, MPR_PROP_UNIT, NULL);
+        s->dir = mpr_obj_get_prop_as_int32(sig, MPR_PROP_DIR, NULL);
+        s->type = mpr_obj_get_prop_as_int32(sig, MPR_PROP_TYPE, NULL);
+        s->length = mpr_obj_get_prop_as_int32(sig, MPR_PROP_LEN, NULL);
+        s->num_inst = mpr_sig_get_num_inst(sig, MPR_STATUS_ANY);
+        s->steal = mpr_obj_get_prop_as_int32(sig, MPR_PROP_STEAL_MODE, NULL);
+        def_snapshot_range(def, sig, MPR_PROP_MIN, &s->min_len, &s->min_idx);
+        def_snapshot_range(def, sig, MPR_PROP_MAX, &s->max_len, &s->max_idx);
+
+        // custom properties with a single string, number or boolean value
+        for (i = 0; i < num_props; i++) {
+            const char *key = 0;
+            const void *val = 0;
+            mpr_type type = 0;
+            int len = 0;
+            t_def_prop *prop;
+            if (MPR_PROP_EXTRA != mpr_obj_get_prop_by_idx(sig, i, &key, &len, &type, &val, NULL)
+                || !key || !val || len != 1)
+                continue;
+            if (   MPR_STR != type && MPR_FLT != type && MPR_DBL != type
+                && MPR_INT32 != type && MPR_BOOL != type)
+                continue;
+            prop = def_add_prop(def);
+            prop->key = key;
+            prop->str = 0;
+            prop->num = 0;
+            prop->type = MPR_DBL == type ? MPR_FLT : type;
+            switch (type) {
+                case MPR_STR:   prop->str = (const char *)val;  break;
+                case MPR_FLT:   prop->num = *(float *)val;      break;
+                case MPR_DBL:   prop->num = *(double *)val;     break;
+                default:        prop->num = *(int *)val;        break;
             }
         }
+        s->num_props = def->num_props - s->first_prop;
+        sigs = mpr_list_get_next(sigs);
     }
+    return def;
+}
+
+static void json_write_string(FILE *f, const char *str)
+{
+    fputc('"', f);
+    for (; *str; str++) {
+        unsigned char c = (unsigned char)*str;
+        switch (c) {
+            case '"':   fputs("\\\"", f);   break;
+            case '\\':  fputs("\\\\", f);   break;
+            case '\b':  fputs("\\b", f);    break;
+            case '\f':  fputs("\\f", f);    break;
+            case '\n':  fputs("\\n", f);    break;
+            case '\r':  fputs("\\r", f);    break;
+            case '\t':  fputs("\\t", f);    break;
+            default:
+                if (c < 0x20)
+                    fprintf(f, "\\u%04x", c);
+                else
+                    fputc(c, f);
+                break;
+        }
+    }
+    fputc('"', f);
+}
+
+// floats always get a decimal point so they are not read back as ints
+static void json_write_number(FILE *f, double num, int is_int)
+{
+    char str[32];
+    if (is_int) {
+        fprintf(f, "%d", (int)num);
+        return;
+    }
+    if (num != num || num == HUGE_VAL || num == -HUGE_VAL) {
+        fputs("0.0", f);
+        return;
+    }
+    snprintf(str, sizeof(str), "%.9g", num);
+    fputs(str, f);
+    if (!strpbrk(str, ".eE"))
+        fputs(".0", f);
+}
+
+static void json_write_range(FILE *f, t_definition *def, const char *key, int len, int idx,
+                             mpr_type type)
+{
+    int i;
+    fprintf(f, ",\n                \"%s\" : ", key);
+    if (len == 1) {
+        json_write_number(f, def->nums[idx], MPR_INT32 == type);
+        return;
+    }
+    fputc('[', f);
+    for (i = 0; i < len; i++) {
+        if (i)
+            fputs(", ", f);
+        json_write_number(f, def->nums[idx + i], MPR_INT32 == type);
+    }
+    fputc(']', f);
+}
+
+static void json_write_signals(FILE *f, t_definition *def, mpr_dir dir)
+{
+    int i, j, first = 1;
+    for (i = 0; i < def->num_sigs; i++) {
+        t_def_sig *s = &def->sigs[i];
+        if (s->dir != dir || !s->name)
+            continue;
+        fputs(first ? "\n            {\n" : ",\n            {\n", f);
+        first = 0;
+        fputs("                \"name\" : ", f);
+        json_write_string(f, s->name);
+        fprintf(f, ",\n                \"type\" : \"%c\"", s->type);
+        if (s->length != 1)
+            fprintf(f, ",\n                \"length\" : %d", s->length);
+        if (s->units) {
+            fputs(",\n                \"units\" : ", f);
+            json_write_string(f, s->units);
+        }
+        if (s->min_len)
+            json_write_range(f, def, "minimum", s->min_len, s->min_idx, s->type);
+        if (s->max_len)
+            json_write_range(f, def, "maximum", s->max_len, s->max_idx, s->type);
+        if (s->num_inst > 1)
+            fprintf(f, ",\n                \"instances\" : %d", s->num_inst);
+        if (MPR_STEAL_OLDEST == s->steal)
+            fputs(",\n                \"stealing\" : \"oldest\"", f);
+        else if (MPR_STEAL_NEWEST == s->steal)
+            fputs(",\n                \"stealing\" : \"newest\"", f);
+        for (j = 0; j < s->num_props; j++) {
+            t_def_prop *prop = &def->props[s->first_prop + j];
+            fputs(",\n                ", f);
+            json_write_string(f, prop->key);
+            fputs(" : ", f);
+            if (MPR_STR == prop->type)
+                json_write_string(f, prop->str);
+            else if (MPR_BOOL == prop->type)
+                fputs(prop->num ? "true" : "false", f);
+            else
+                json_write_number(f, prop->num, MPR_INT32 == prop->type);
+        }
+        fputs("\n            }", f);
+    }
+    fputs(first ? "]" : "\n        ]", f);
+}
+
+// write a definition in the format read by def_parse()
+static int def_write_json(t_definition *def, const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return 1;
+    fputs("{\n    \"device\" : {\n        \"fileversion\" : \"dot-1\",\n", f);
+    if (def->name) {
+        fputs("        \"name\" : ", f);
+        json_write_string(f, def->name);
+        fputs(",\n", f);
+    }
+    fputs("        \"inputs\" : [", f);
+    json_write_signals(f, def, MPR_DIR_IN);
+    fputs(",\n        \"outputs\" : [", f);
+    json_write_signals(f, def, MPR_DIR_OUT);
+    fputs("\n    }\n}\n", f);
+    return fclose(f) != 0;
+}
+
+// resolve a file name for writing, relative to the patch
+static int mapperobj_write_path(t_mapper *x, const char *name, char *path, size_t size)
+{
+#ifdef MAXMSP
+    char max_path[MAX_PATH_CHARS];
+    if (name[0] == '/' || (name[0] && name[1] == ':'))
+        return path_nameconform(name, path, PATH_STYLE_NATIVE, PATH_TYPE_ABSOLUTE) != MAX_ERR_NONE;
+    if (path_toabsolutesystempath(path_getdefault(), name, max_path) != MAX_ERR_NONE)
+        return 1;
+    return path_nameconform(max_path, path, PATH_STYLE_NATIVE, PATH_TYPE_ABSOLUTE) != MAX_ERR_NONE;
+#else
+    canvas_makefilename(x->canvas, (char *)name, path, (int)size);
+    return 0;
+#endif
+}
+
+static void mapperobj_write(t_mapper *x, t_symbol *s, int argc, t_atom *argv)
+{
+    /* Save the current signals as a device definition, so that signals added
+     * with messages or learned can be loaded in bulk on the next start. With
+     * no argument the loaded definition file is overwritten. */
+    char path[1024], cache_path[1040];
+    t_definition *def;
+    struct stat st;
+
+    if (argc && argv->a_type == A_SYM) {
+        if (mapperobj_write_path(x, maxpd_atom_get_string(argv), path, sizeof(path))) {
+            POST(x, "Could not resolve file %s", maxpd_atom_get_string(argv));
+            return;
+        }
+    }
+    else if (x->def_path) {
+        snprintf(path, sizeof(path), "%s", x->def_path);
+    }
+    else {
+        POST(x, "No file given for 'write' message.");
+        return;
+    }
+
+    def = mapperobj_snapshot(x);
+    if (def_write_json(def, path)) {
+        POST(x, "Could not write file %s", path);
+        def_free(def);
+        return;
+    }
+    POST(x, "Wrote %d signals to %s", def->num_sigs, path);
+
+    if (x->def_cache && stat(path, &st) == 0) {
+        snprintf(cache_path, sizeof(cache_path), "%s.cache", path);
+        if (def_cache_write(def, cache_path, st.st_size, st.st_mtime))
+            POST(x, "Could not write definition cache %s", cache_path);
+    }
+    def_free(def);
+}
+
+// *********************************************************
+// -(device pool)-------------------------------------------
+static void mapperobj_pool_free(t_pooled_dev *d)
+{
+    mpr_list sigs = mpr_dev_get_sigs(d->device, MPR_DIR_ANY);
+    while (sigs) {
+        mpr_sig sig = *sigs;
+        sigs = mpr_list_get_next(sigs);
+        mapperobj_free_signal(0, sig);
+    }
+    mpr_dev_free(d->device);
+    if (d->data)
+        def_free((t_definition *)d->data);
+}
+
+static void mapperobj_pool_poll(void *arg)
+{
+#ifdef MAXMSP
+    critical_enter(0);
+#endif
+    dev_pool_poll(&pool, mapperobj_time_ms());
+#ifdef MAXMSP
+    critical_exit(0);
+#endif
+}
+
+// hand the device over to the pool along with its definition, returns 0 if it
+// should be freed instead
+static int mapperobj_pool_release(t_mapper *x)
+{
+    mpr_list sigs;
+
+    // a device that never joined the network has no maps worth keeping
+    if (x->persist <= 0 || !x->ready || pool.closed)
+        return 0;
+
+    // detach the signal contexts, pending coalesced values are dropped
+    sigs = mpr_dev_get_sigs(x->device, MPR_DIR_ANY);
+    while (sigs) {
+        t_mapper_sig *ctx = (void*)mpr_obj_get_prop_as_ptr(*sigs, MPR_PROP_DATA, NULL);
+        if (ctx) {
+            ctx->home = 0;
+            ctx->queued = 0;
+            ctx->next_dirty = 0;
+            coalesce_clear(&ctx->slots, &ctx->num_slots);
+        }
+        sigs = mpr_list_get_next(sigs);
+    }
+    x->dirty = 0;
+
+    if (!pool.clock) {
+        pool.free_dev = mapperobj_pool_free;
+#ifdef MAXMSP
+        pool.clock = clock_new(&pool, (method)mapperobj_pool_poll);
+#else
+        pool.clock = clock_new(&pool, (t_method)mapperobj_pool_poll);
+#endif
+    }
+    dev_pool_add(&pool, x->name, x->iface, x->device, x->def, x->persist,
+                 mapperobj_time_ms());
+    x->name = 0;
+    x->iface = 0;
+    x->device = 0;
+    x->def = 0;
+    return 1;
+}
+
+#ifdef MAXMSP
+// free the devices still waiting when Max quits, so that they leave the network; Pd
+// has no quit hook for externals, there they go with the process
+static void mapperobj_pool_quit(void *arg)
+{
+    dev_pool_quit(&pool);
+}
+#endif
+
+// take over the signals of an adopted device, reconciling them with our definition
+static void mapperobj_adopt_signals(t_mapper *x, t_definition *old_def)
+{
+    int counts[4];
+    double start = mapperobj_time_ms();
+    mpr_list sigs = mpr_dev_get_sigs(x->device, MPR_DIR_ANY);
+    while (sigs) {
+        t_mapper_sig *ctx = (void*)mpr_obj_get_prop_as_ptr(*sigs, MPR_PROP_DATA, NULL);
+        if (ctx)
+            ctx->home = x;
+        sigs = mpr_list_get_next(sigs);
+    }
+    mapperobj_apply_definition(x, old_def, counts);
+    POST(x, "Adopted signals in %.2f ms: %d added, %d removed, %d updated, %d recreated.",
+         mapperobj_time_ms() - start, counts[0], counts[1], counts[2], counts[3]);
+    if (old_def)
+        def_free(old_def);
 }
-#endif // MAXMSP
 
 // *********************************************************
 // -(poll libmapper)----------------------------------------
@@ -1062,6 +3112,8 @@ static void mapperobj_poll(t_mapper *x)
 #ifdef MAXMSP
     critical_exit(0);
 #endif
+    if (x->dirty)
+        mapperobj_flush_coalesced(x);
     if (!x->ready) {
         if (mpr_dev_get_is_ready(x->device)) {
             POST(x, "Joining mapping network as '%s'",
@@ -1077,6 +3129,13 @@ static void mapperobj_poll(t_mapper *x)
     clock_delay(x->clock, INTERVAL);  // Set clock to go off after delay
 }
 
+// *********************************************************
+// -(forget cached unknown selectors)-----------------------
+static void mapperobj_clear_unknown(t_mapper *x)
+{
+    memset(x->unknown, 0, sizeof(x->unknown));
+}
+
 // *********************************************************
 // -(toggle learning mode)----------------------------------
 static void mapperobj_learn(t_mapper *x, t_symbol *s,
@@ -1094,6 +3153,7 @@ static void mapperobj_learn(t_mapper *x, t_symbol *s,
 #endif
         if (mode != x->learn_mode) {
             x->learn_mode = mode;
+            mapperobj_clear_unknown(x);
             if (mode == 0) {
                 POST(x, "Learning mode off.");
             }
@@ -21,6 +21,7 @@
 #include "ext.h"                // standard Max include, always required
 #include "ext_obex.h"           // required for new style Max object
 #include "ext_critical.h"
+#include "ext_systime.h"
 #include "jpatcher_api.h"
 #include <mapper/mapper.h>
 #include <stdio.h>
@@ -36,9 +37,17 @@
 
 #define INTERVAL 1
 #define MAX_LIST 256
+#define PERSIST 5000    // ms a released device is kept for adoption
+
+#include "../common/sig_stats.h"
+#include "../common/latency.h"
+#include "../common/coalesce.h"
+#include "../common/device_pool.h"
 
 // *********************************************************
 // -(object struct)-----------------------------------------
+struct _mpr_ptrs;
+
 typedef struct _mpr_device
 {
     t_object            ob;
@@ -53,6 +62,13 @@ typedef struct _mpr_device
     t_atom              buffer[MAX_LIST];
     t_object            *patcher;
     int                 throttle;
+    struct _mpr_ptrs    *dirty;         // coalescing signals with pending values
+    char                *iface;         // network interface as given
+    int                 persist;        // ms to keep the device for adoption after free
+    int                 releasing;      // keep signals when their objects detach
+    int                 adopted;        // signals may be left over from the previous owner
+    int                 orphans;        // signals left without objects, freed at the next poll
+    int                 time_handlers;  // time outputs for "stats", once it has been asked for
 } t_mpr_device;
 
 typedef struct
@@ -66,6 +82,15 @@ typedef struct _mpr_ptrs
     int                 num_objs;
     t_object            **objs;
     t_mpr_device        *home;
+    mpr_sig             sig;
+    int                 coalesce;
+    int                 queued;         // already in the home device's dirty list
+    int                 num_slots;
+    t_coalesce_slot     *slots;
+    struct _mpr_ptrs    *next_dirty;
+    int                 timestamps;     // output the timetag and latency of each update
+    t_latency           latency;
+    t_sig_stats         stats;
 } t_mpr_ptrs;
 
 // *********************************************************
@@ -86,11 +111,25 @@ static void mpr_device_remove_signal_object(t_mpr_device *x, t_object *obj);
 
 static void mpr_device_poll(t_mpr_device *x);
 
+static void mpr_device_coalesce(t_mpr_device *x, mpr_sig sig, long on);
+static void mpr_device_sig_notify(t_mpr_device *x, mpr_sig sig, long on);
+static void mpr_device_timestamps(t_mpr_device *x, mpr_sig sig, long on);
+static void mpr_device_latency(t_mpr_device *x, mpr_sig sig, t_object *obj, long reset);
+static t_sig_stats *mpr_device_sig_stats(t_mpr_device *x, mpr_sig sig);
+static void mpr_device_stats(t_mpr_device *x, t_symbol *s, int argc, t_atom *argv);
+static void mpr_device_flush_signal(t_mpr_ptrs *ptrs);
+static void mpr_device_flush_coalesced(t_mpr_device *x);
+
 static void mpr_device_sig_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int length,
                                    mpr_type type, const void *value, mpr_time time);
 
 static void mpr_device_print_properties(t_mpr_device *x);
 
+static void mpr_device_free_signal(t_mpr_device *x, mpr_sig sig);
+static int mpr_device_pool_release(t_mpr_device *x);
+static void mpr_device_pool_quit(void *arg);
+static void mpr_device_free_orphans(t_mpr_device *x);
+
 static int atom_strcmp(t_atom *a, const char *string);
 static const char *atom_get_string(t_atom *a);
 static void atom_set_string(t_atom *a, const char *string);
@@ -99,6 +138,10 @@ static void atom_set_string(t_atom *a, const char *string);
 // -(global class pointer variable)-------------------------
 static void *mpr_device_class;
 
+// *********************************************************
+// -(released devices awaiting adoption)--------------------
+static t_dev_pool pool = { 0 };
+
 // *********************************************************
 
 #ifdef WIN32
@@ -116,9 +159,16 @@ int main(void)
                   (long)sizeof(t_mpr_device), 0L, A_GIMME, 0);
 
     class_addmethod(c, (method)mpr_device_notify, "notify", A_CANT, 0);
+    class_addmethod(c, (method)mpr_device_coalesce, "coalesce", A_CANT, 0);
+    class_addmethod(c, (method)mpr_device_sig_notify, "sig_notify", A_CANT, 0);
+    class_addmethod(c, (method)mpr_device_timestamps, "timestamps", A_CANT, 0);
+    class_addmethod(c, (method)mpr_device_latency, "latency", A_CANT, 0);
+    class_addmethod(c, (method)mpr_device_sig_stats, "sig_stats", A_CANT, 0);
+    class_addmethod(c, (method)mpr_device_stats, "stats", A_GIMME, 0);
 
     class_register(CLASS_BOX, c); /* CLASS_NOBOX */
     mpr_device_class = c;
+    quittask_install((method)mpr_device_pool_quit, 0);
     return 0;
 }
 
@@ -130,11 +180,19 @@ static void *mpr_device_new(t_symbol *s, int argc, t_atom *argv)
     long i;
     const char *alias = NULL;
     const char *iface = NULL;
+    t_pooled_dev *pooled;
 
     if ((x = object_alloc(mpr_device_class))) {
         x->outlet = listout((t_object *)x);
         x->name = 0;
         x->throttle = 10;
+        x->dirty = 0;
+        x->iface = 0;
+        x->persist = PERSIST;
+        x->releasing = 0;
+        x->adopted = 0;
+        x->orphans = 0;
+        x->time_handlers = 0;
 
         if (argv->a_type == A_SYM && atom_get_string(argv)[0] != '@')
             alias = atom_get_string(argv);
@@ -167,6 +225,16 @@ static void *mpr_device_new(t_symbol *s, int argc, t_atom *argv)
                         ++i;
                     }
                 }
+                else if (atom_strcmp(argv + i, "@persist") == 0) {
+                    if ((argv + i + 1)->a_type == A_LONG) {
+                        x->persist = atom_getlong(argv + i + 1);
+                        ++i;
+                    }
+                    else if ((argv + i + 1)->a_type == A_FLOAT) {
+                        x->persist = (int)atom_getfloat(argv + i + 1);
+                        ++i;
+                    }
+                }
             }
         }
         if (alias) {
@@ -176,18 +244,34 @@ static void *mpr_device_new(t_symbol *s, int argc, t_atom *argv)
             x->name = strdup("maxmsp");
         }
 
-        x->device = mpr_dev_new(x->name, 0);
+        if (iface)
+            x->iface = strdup(iface);
+
+        // adopt a device released by a recently freed object with the same name
+        if ((pooled = dev_pool_take(&pool, x->name, iface))) {
+            x->device = pooled->device;
+            x->adopted = 1;
+            dev_pool_forget(pooled);
+            object_post((t_object *)x, "Adopting released device '%s'.",
+                        mpr_obj_get_prop_as_str(x->device, MPR_PROP_NAME, NULL));
+        }
+        else
+            x->device = mpr_dev_new(x->name, 0);
         if (!x->device) {
             object_post((t_object *)x, "error initializing libmapper device.");
             return 0;
         }
         x->graph = mpr_obj_get_graph(x->device);
-        if (iface)
+        if (iface && !x->adopted)
             mpr_graph_set_interface(x->graph, iface);
 
         if (mpr_device_attach(x)) {
+            if (x->adopted)
+                mpr_device_free_orphans(x);
             mpr_dev_free(x->device);
             free(x->name);
+            if (x->iface)
+                free(x->iface);
             return 0;
         }
 
@@ -201,6 +285,7 @@ static void *mpr_device_new(t_symbol *s, int argc, t_atom *argv)
             if (i > argc - 2) // need 2 arguments for key and value
                 break;
             if ((atom_strcmp(argv + i, "@alias") == 0) ||
+                (atom_strcmp(argv + i, "@persist") == 0) ||
                 (atom_strcmp(argv + i, "@interface") == 0)){
                 ++i;
                 continue;
@@ -251,16 +336,22 @@ static void *mpr_device_new(t_symbol *s, int argc, t_atom *argv)
 // -(free)--------------------------------------------------
 static void mpr_device_free(t_mpr_device *x)
 {
+    // a device that joined the network is kept with its signals for a new owner
+    x->releasing = x->device && x->ready && x->persist > 0 && !pool.closed;
     mpr_device_detach(x);
 
     clock_unset(x->clock);      // Remove clock routine from the scheduler
     clock_free(x->clock);       // Frees memeory used by clock
-    if (x->device) {
+    if (x->device && !mpr_device_pool_release(x)) {
+        mpr_device_free_orphans(x);
         mpr_dev_free(x->device);
     }
     if (x->name) {
         free(x->name);
     }
+    if (x->iface) {
+        free(x->iface);
+    }
 }
 
 void mpr_device_notify(t_mpr_device *x, t_symbol *s, t_symbol *msg, void *sender, void *data)
@@ -407,8 +498,21 @@ static void mpr_device_add_signal(t_mpr_device *x, t_object *obj)
     mpr_list list = mpr_dev_get_sigs(x->device, MPR_DIR_ANY);
     list = mpr_list_filter(list, MPR_PROP_NAME, NULL, 1, MPR_STR, name, MPR_OP_EQ);
     if (list && (sig = *list)) {
+        t_mpr_ptrs *ptrs = (t_mpr_ptrs *)mpr_obj_get_prop_as_ptr(sig, MPR_PROP_DATA, NULL);
+        mpr_list_free(list);
+        // a signal left over from an adopted device is reused if it still matches
+        if (   !ptrs->num_objs
+            && (   mpr_obj_get_prop_as_int32(sig, MPR_PROP_DIR, NULL) != dir
+                || mpr_obj_get_prop_as_int32(sig, MPR_PROP_TYPE, NULL) != type
+                || mpr_obj_get_prop_as_int32(sig, MPR_PROP_LEN, NULL) != length)) {
+            mpr_device_free_signal(x, sig);
+            sig = 0;
+        }
+    }
+    if (sig) {
         // another max object associated with this signal exists
         t_mpr_ptrs *ptrs = (t_mpr_ptrs *)mpr_obj_get_prop_as_ptr(sig, MPR_PROP_DATA, NULL);
+        ptrs->home = x;
         ptrs->objs = realloc(ptrs->objs, (ptrs->num_objs + 1) * sizeof(t_object *));
         ptrs->objs[ptrs->num_objs] = obj;
         ++ptrs->num_objs;
@@ -419,8 +523,17 @@ static void mpr_device_add_signal(t_mpr_device *x, t_object *obj)
         ptrs->objs = (t_object **)malloc(sizeof(t_object *));
         ptrs->num_objs = 1;
         ptrs->objs[0] = obj;
+        ptrs->coalesce = 0;
+        ptrs->queued = 0;
+        ptrs->num_slots = 0;
+        ptrs->slots = 0;
+        ptrs->next_dirty = 0;
+        ptrs->timestamps = 0;
+        memset(&ptrs->latency, 0, sizeof(t_latency));
+        memset(&ptrs->stats, 0, sizeof(t_sig_stats));
         sig = mpr_sig_new(x->device, dir, name, length, type, 0, 0, 0,
                           NULL, mpr_device_sig_handler, MPR_SIG_ALL);
+        ptrs->sig = sig;
         mpr_obj_set_prop(sig, MPR_PROP_DATA, NULL, 1, MPR_PTR, ptrs, 0);
     }
 
@@ -460,10 +573,10 @@ static void mpr_device_remove_signal_object(t_mpr_device *x, t_object *obj)
             object_post((t_object *)x, "error: no PROP_DATA!");
             return;
         }
-        if (ptrs->num_objs == 1) {
-            free(ptrs->objs);
-            free(ptrs);
-            mpr_sig_free(sig);
+        // a patcher being closed may free its signal objects before the device, so one
+        // that could go to the pool keeps their signals until its next poll
+        if (ptrs->num_objs == 1 && !x->releasing && !(x->ready && x->persist > 0)) {
+            mpr_device_free_signal(x, sig);
         }
         else {
             // need to realloc obj ptr memory
@@ -480,13 +593,128 @@ static void mpr_device_remove_signal_object(t_mpr_device *x, t_object *obj)
             ++i;
             for (; i<ptrs->num_objs; i++)
                 ptrs->objs[i - 1] = ptrs->objs[i];
-            ptrs->objs = realloc(ptrs->objs, (ptrs->num_objs - 1) * sizeof(t_object *));
             --ptrs->num_objs;
+            if (ptrs->num_objs)
+                ptrs->objs = realloc(ptrs->objs, ptrs->num_objs * sizeof(t_object *));
+            else if (!x->releasing)
+                x->orphans = 1;
         }
     }
     mpr_list_free(list);
 }
 
+static void mpr_device_free_signal(t_mpr_device *x, mpr_sig sig)
+{
+    t_mpr_ptrs *ptrs = (t_mpr_ptrs *)mpr_obj_get_prop_as_ptr(sig, MPR_PROP_DATA, NULL);
+    if (ptrs) {
+        if (ptrs->queued && x) {
+            t_mpr_ptrs **prev = &x->dirty;
+            while (*prev && *prev != ptrs)
+                prev = &(*prev)->next_dirty;
+            if (*prev)
+                *prev = ptrs->next_dirty;
+        }
+        if (ptrs->slots)
+            free(ptrs->slots);
+        free(ptrs->objs);
+        free(ptrs);
+    }
+    mpr_sig_free(sig);
+}
+
+// free the lists of [mpr.in] objects kept per instance; they point at objects that
+// may go before the signal, which then must not reach them
+static void mpr_device_free_inst_ptrs(mpr_sig sig)
+{
+    int i, num_inst = mpr_sig_get_num_inst(sig, MPR_STATUS_ANY);
+    for (i = 0; i < num_inst; i++) {
+        mpr_id id = mpr_sig_get_inst_id(sig, i, MPR_STATUS_ANY);
+        t_mpr_ptrs *inst_ptrs = (t_mpr_ptrs *)mpr_sig_get_inst_data(sig, id);
+        if (inst_ptrs) {
+            free(inst_ptrs->objs);
+            free(inst_ptrs);
+            mpr_sig_set_inst_data(sig, id, 0);
+        }
+    }
+}
+
+// free signals that no longer have any objects, i.e. those the adopted device
+// had but this patcher does not declare, or those whose objects were freed
+static void mpr_device_free_orphans(t_mpr_device *x)
+{
+    mpr_list list = mpr_dev_get_sigs(x->device, MPR_DIR_ANY);
+    while (list) {
+        mpr_sig sig = *list;
+        t_mpr_ptrs *ptrs = (t_mpr_ptrs *)mpr_obj_get_prop_as_ptr(sig, MPR_PROP_DATA, NULL);
+        list = mpr_list_get_next(list);
+        if (!ptrs || !ptrs->num_objs)
+            mpr_device_free_signal(x, sig);
+    }
+    x->adopted = 0;
+    x->orphans = 0;
+}
+
+// *********************************************************
+// -(device pool)-------------------------------------------
+static void mpr_device_pool_free(t_pooled_dev *d)
+{
+    mpr_list list = mpr_dev_get_sigs(d->device, MPR_DIR_ANY);
+    while (list) {
+        mpr_sig sig = *list;
+        list = mpr_list_get_next(list);
+        mpr_device_free_signal(0, sig);
+    }
+    mpr_dev_free(d->device);
+}
+
+static void mpr_device_pool_poll(void *arg)
+{
+    critical_enter(0);
+    dev_pool_poll(&pool, systimer_gettime());
+    critical_exit(0);
+}
+
+// hand the device over to the pool, returns 0 if it should be freed instead
+static int mpr_device_pool_release(t_mpr_device *x)
+{
+    mpr_list list;
+
+    // the signals were only kept for the pool if the device is releasing
+    if (!x->releasing)
+        return 0;
+
+    // detach the signals, pending coalesced values are dropped
+    list = mpr_dev_get_sigs(x->device, MPR_DIR_ANY);
+    while (list) {
+        t_mpr_ptrs *ptrs = (t_mpr_ptrs *)mpr_obj_get_prop_as_ptr(*list, MPR_PROP_DATA, NULL);
+        if (ptrs) {
+            ptrs->home = 0;
+            ptrs->queued = 0;
+            ptrs->next_dirty = 0;
+            coalesce_clear(&ptrs->slots, &ptrs->num_slots);
+        }
+        mpr_device_free_inst_ptrs(*list);
+        list = mpr_list_get_next(list);
+    }
+    x->dirty = 0;
+
+    if (!pool.clock) {
+        pool.free_dev = mpr_device_pool_free;
+        pool.clock = clock_new(&pool, (method)mpr_device_pool_poll);
+    }
+    dev_pool_add(&pool, x->name, x->iface, x->device, 0, x->persist, systimer_gettime());
+    x->name = 0;
+    x->iface = 0;
+    x->device = 0;
+    return 1;
+}
+
+// free the devices still waiting when Max quits, so that they leave the network
+static void mpr_device_pool_quit(void *arg)
+{
+    dev_pool_quit(&pool);
+}
+
 // *********************************************************
 // -(print properties)--------------------------------------
 static void mpr_device_print_properties(t_mpr_device *x)
@@ -527,7 +755,7 @@ static void mpr_device_print_properties(t_mpr_device *x)
                 // Max does not support int64 so we will print as hex
                 char tmp[32];
                 for (j = 0; j < len; j++) {
-                    snprintf(tmp, 16, "%16llx", ((uint64_t*)val)[j]);
+                    snprintf(tmp, 32, "%16llx", (unsigned long long)((uint64_t*)val)[j]);
                     atom_set_string(x->buffer + j, tmp);
                 }
                 break;
@@ -550,46 +778,202 @@ static void outlet_data(void *outlet, mpr_type type, short length, t_atom *atoms
         outlet_float(outlet, atom_getfloat(atoms));
 }
 
+static void mpr_device_output_value(t_mpr_device *x, t_mpr_ptrs *ptrs, t_mpr_ptrs *inst_ptrs,
+                                    int len, mpr_type type, const void *val)
+{
+    if (len > (MAX_LIST)) {
+        object_post((t_object *)x, "Maximum list length is %i!", MAX_LIST);
+        len = MAX_LIST;
+    }
+
+    if (type == MPR_INT32) {
+        int *vi = (int*)val;
+        for (int i = 0; i < len; i++)
+            atom_setlong(x->buffer + i, vi[i]);
+    }
+    else if (type == MPR_FLT) {
+        float *vf = (float*)val;
+        for (int i = 0; i < len; i++)
+            atom_setfloat(x->buffer + i, vf[i]);
+    }
+
+    if (inst_ptrs) {
+        for (int i = 0; i < inst_ptrs->num_objs; i++)
+            outlet_data(((sig_obj)inst_ptrs->objs[i])->outlet, type, len, x->buffer);
+    }
+    else {
+        for (int i = 0; i < ptrs->num_objs; i++)
+            outlet_data(ptrs->objs[i]->o_outlet, type, len, x->buffer);
+    }
+}
+
+// *********************************************************
+// -(timestamps)--------------------------------------------
+// output "timetag <seconds> <fraction> <latency>" ahead of a value; the seconds
+// are counted from midnight UTC so they fit in a float atom
+static void mpr_device_output_timetag(t_mpr_device *x, t_mpr_ptrs *ptrs, t_mpr_ptrs *inst_ptrs,
+                                      mpr_time time, double latency)
+{
+    atom_setlong(x->buffer, time.sec % 86400);
+    atom_setfloat(x->buffer + 1, time.frac / 4294967296.);
+    atom_setfloat(x->buffer + 2, latency);
+    if (inst_ptrs) {
+        for (int i = 0; i < inst_ptrs->num_objs; i++)
+            outlet_anything(((sig_obj)inst_ptrs->objs[i])->outlet, gensym("timetag"), 3, x->buffer);
+    }
+    else {
+        for (int i = 0; i < ptrs->num_objs; i++)
+            outlet_anything(ptrs->objs[i]->o_outlet, gensym("timetag"), 3, x->buffer);
+    }
+}
+
+static void mpr_device_timestamps(t_mpr_device *x, mpr_sig sig, long on)
+{
+    t_mpr_ptrs *ptrs;
+    if (sig && (ptrs = (t_mpr_ptrs *)mpr_obj_get_prop_as_ptr(sig, MPR_PROP_DATA, NULL)))
+        ptrs->timestamps = (on != 0);
+}
+
+// output "latency <count> <min> <mean> <max> <buckets>..." from the signal object
+static void mpr_device_latency(t_mpr_device *x, mpr_sig sig, t_object *obj, long reset)
+{
+    t_mpr_ptrs *ptrs;
+    t_latency *l;
+    if (!sig || !(ptrs = (t_mpr_ptrs *)mpr_obj_get_prop_as_ptr(sig, MPR_PROP_DATA, NULL)))
+        return;
+    l = &ptrs->latency;
+    if (reset) {
+        memset(l, 0, sizeof(t_latency));
+        return;
+    }
+    atom_setlong(x->buffer, l->count);
+    atom_setfloat(x->buffer + 1, l->min);
+    atom_setfloat(x->buffer + 2, l->count ? l->sum / l->count : 0.);
+    atom_setfloat(x->buffer + 3, l->max);
+    for (int i = 0; i < LATENCY_BUCKETS; i++)
+        atom_setlong(x->buffer + 4 + i, l->buckets[i]);
+    outlet_anything(((sig_obj)obj)->outlet, gensym("latency"), 4 + LATENCY_BUCKETS, x->buffer);
+}
+
+// *********************************************************
+// -(statistics)--------------------------------------------
+// the clock is only read again after an output once "stats" has been asked for,
+// otherwise an update costs the one reading that stats_count() needs
+static void stats_handled(t_sig_stats *st, double start)
+{
+    float elapsed = (float)(systimer_gettime() - start);
+    if (elapsed > st->max_handler)
+        st->max_handler = elapsed;
+}
+
+static t_sig_stats *mpr_device_sig_stats(t_mpr_device *x, mpr_sig sig)
+{
+    t_mpr_ptrs *ptrs;
+    if (!sig || !(ptrs = (t_mpr_ptrs *)mpr_obj_get_prop_as_ptr(sig, MPR_PROP_DATA, NULL)))
+        return 0;
+    return &ptrs->stats;
+}
+
+// output "stats <name> <in> <out> <rate> <bytes> <coalesced> <suppressed>
+// <max handler ms> <age ms>" for one or every signal, or clear the counters
+static void mpr_device_stats(t_mpr_device *x, t_symbol *s, int argc, t_atom *argv)
+{
+    const char *name = (argc && argv->a_type == A_SYM) ? atom_get_string(argv) : 0;
+    int reset = argc && atom_strcmp(argv + argc - 1, "reset") == 0;
+    double now = systimer_gettime();
+    mpr_list sigs = mpr_dev_get_sigs(x->device, MPR_DIR_ANY);
+
+    x->time_handlers = 1;
+    if (reset && argc == 1)
+        name = 0;
+    while (sigs) {
+        mpr_sig sig = *sigs;
+        t_mpr_ptrs *ptrs = (t_mpr_ptrs *)mpr_obj_get_prop_as_ptr(sig, MPR_PROP_DATA, NULL);
+        const char *sig_name = mpr_obj_get_prop_as_str(sig, MPR_PROP_NAME, NULL);
+        t_sig_stats *st;
+        sigs = mpr_list_get_next(sigs);
+        if (!ptrs || (name && strcmp(sig_name, name)))
+            continue;
+        st = &ptrs->stats;
+        if (reset) {
+            memset(st, 0, sizeof(t_sig_stats));
+            continue;
+        }
+        atom_set_string(x->buffer, sig_name);
+        atom_setlong(x->buffer + 1, st->in);
+        atom_setlong(x->buffer + 2, st->out);
+        atom_setfloat(x->buffer + 3, stats_rate(st, now));
+        atom_setfloat(x->buffer + 4, (double)st->bytes);
+        atom_setlong(x->buffer + 5, st->coalesced);
+        atom_setlong(x->buffer + 6, st->suppressed);
+        atom_setfloat(x->buffer + 7, st->max_handler);
+        atom_setfloat(x->buffer + 8, (st->in || st->out) ? now - st->last : -1.);
+        outlet_anything(x->outlet, gensym("stats"), 9, x->buffer);
+    }
+}
+
 // *********************************************************
 // -(sig handler)-------------------------------------------
 static void mpr_device_sig_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
                                    mpr_type type, const void *val, mpr_time time)
 {
     t_mpr_ptrs *ptrs = (void*)mpr_obj_get_prop_as_ptr(sig, MPR_PROP_DATA, NULL);
-    t_mpr_ptrs *inst_ptrs = (t_mpr_ptrs*)mpr_sig_get_inst_data(sig, inst);
-    t_mpr_device *x = ptrs->home;
+    t_mpr_ptrs *inst_ptrs;
+    t_mpr_device *x = ptrs ? ptrs->home : 0;
+
+    double latency = 0, start = 0;
+
+    if (!x || !ptrs->num_objs) {
+        // device is waiting in the pool for a new owner
+        if (ptrs && MPR_SIG_UPDATE == evt && val)
+            ++ptrs->stats.suppressed;
+        return;
+    }
+    inst_ptrs = (t_mpr_ptrs*)mpr_sig_get_inst_data(sig, inst);
+
+    if (MPR_SIG_UPDATE == evt && val) {
+        start = systimer_gettime();
+        ++ptrs->stats.in;
+        stats_count(&ptrs->stats, start, len);
+    }
+
+    if (ptrs->timestamps && MPR_SIG_UPDATE == evt && val) {
+        mpr_time now;
+        mpr_time_set(&now, MPR_NOW);
+        latency = mpr_time_get_diff(now, time) * 1000.;
+        latency_add(&ptrs->latency, latency);
+    }
 
     // if the signal is not instanced and ephemeral we will only handle value updates
     if (MPR_SIG_UPDATE != evt && !mpr_obj_get_prop_as_int32(sig, MPR_PROP_EPHEM, NULL))
         return;
 
+    if (ptrs->coalesce) {
+        if (MPR_SIG_UPDATE == evt && val) {
+            // overwrite this instance's slot, the value is output after the poll
+            coalesce_store(&ptrs->slots, &ptrs->num_slots, inst, len, type, val, time,
+                           (float)latency);
+            if (!ptrs->queued) {
+                ptrs->queued = 1;
+                ptrs->next_dirty = x->dirty;
+                x->dirty = ptrs;
+            }
+            return;
+        }
+        // keep pending values ahead of releases and overflows
+        mpr_device_flush_signal(ptrs);
+        if (MPR_SIG_INST_OFLW != evt)
+            coalesce_remove(&ptrs->slots, &ptrs->num_slots, inst);
+    }
+
     switch (evt) {
         case MPR_SIG_UPDATE: {
             if (val) {
-                if (len > (MAX_LIST)) {
-                    object_post((t_object *)x, "Maximum list length is %i!", MAX_LIST);
-                    len = MAX_LIST;
-                }
-
-                if (type == MPR_INT32) {
-                    int *vi = (int*)val;
-                    for (int i = 0; i < len; i++)
-                        atom_setlong(x->buffer + i, vi[i]);
-                }
-                else if (type == MPR_FLT) {
-                    float *vf = (float*)val;
-                    for (int i = 0; i < len; i++)
-                        atom_setfloat(x->buffer + i, vf[i]);
-                }
-
-                if (inst_ptrs) {
-                    for (int i = 0; i < inst_ptrs->num_objs; i++)
-                        outlet_data(((sig_obj)inst_ptrs->objs[i])->outlet, type, len, x->buffer);
-                }
-                else {
-                    for (int i = 0; i < ptrs->num_objs; i++)
-                        outlet_data(ptrs->objs[i]->o_outlet, type, len, x->buffer);
-                }
+                if (ptrs->timestamps)
+                    mpr_device_output_timetag(x, ptrs, inst_ptrs, time, latency);
+                mpr_device_output_value(x, ptrs, inst_ptrs, len, type, val);
+                if (x->time_handlers)
+                    stats_handled(&ptrs->stats, start);
             }
             else if (inst_ptrs) {
                 atom_set_string(x->buffer, "release");
@@ -619,10 +1003,14 @@ static void mpr_device_sig_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, in
             int mode = mpr_obj_get_prop_as_int32(sig, MPR_PROP_STEAL_MODE, NULL);
             switch (mode) {
                 case MPR_STEAL_OLDEST:
-                    mpr_sig_release_inst(sig, mpr_sig_get_oldest_inst_id(sig));
+                    inst = mpr_sig_get_oldest_inst_id(sig);
+                    mpr_sig_release_inst(sig, inst);
+                    coalesce_remove(&ptrs->slots, &ptrs->num_slots, inst);
                     break;
                 case MPR_STEAL_NEWEST:
-                    mpr_sig_release_inst(sig, mpr_sig_get_newest_inst_id(sig));
+                    inst = mpr_sig_get_newest_inst_id(sig);
+                    mpr_sig_release_inst(sig, inst);
+                    coalesce_remove(&ptrs->slots, &ptrs->num_slots, inst);
                     break;
                 case MPR_STEAL_NONE:
                     atom_set_string(x->buffer, "overflow");
@@ -640,6 +1028,68 @@ static void mpr_device_sig_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, in
     }
 }
 
+// *********************************************************
+// -(coalesce updates)--------------------------------------
+static void mpr_device_coalesce(t_mpr_device *x, mpr_sig sig, long on)
+{
+    t_mpr_ptrs *ptrs;
+    if (!sig || !(ptrs = (t_mpr_ptrs *)mpr_obj_get_prop_as_ptr(sig, MPR_PROP_DATA, NULL)))
+        return;
+    ptrs->coalesce = (on != 0);
+    if (!ptrs->coalesce) {
+        // output what is still held back and drop the slots
+        mpr_device_flush_signal(ptrs);
+        coalesce_clear(&ptrs->slots, &ptrs->num_slots);
+    }
+}
+
+// *********************************************************
+// -(push or pull updates)----------------------------------
+static void mpr_device_sig_notify(t_mpr_device *x, mpr_sig sig, long on)
+{
+    // without MPR_SIG_UPDATE the value is only read on demand by the signal object
+    if (sig)
+        mpr_sig_set_cb(sig, mpr_device_sig_handler, on ? MPR_SIG_ALL : MPR_SIG_ALL & ~MPR_SIG_UPDATE);
+}
+
+static void mpr_device_flush_signal(t_mpr_ptrs *ptrs)
+{
+    t_mpr_device *x = ptrs->home;
+    for (int i = 0; i < ptrs->num_slots; i++) {
+        t_coalesce_slot *slot = &ptrs->slots[i];
+        int count = slot->count;
+        if (!count)
+            continue;
+        slot->count = 0;
+        t_mpr_ptrs *inst_ptrs = (t_mpr_ptrs*)mpr_sig_get_inst_data(ptrs->sig, slot->inst);
+        double start = x->time_handlers ? systimer_gettime() : 0;
+        if (ptrs->timestamps)
+            mpr_device_output_timetag(x, ptrs, inst_ptrs, slot->time, slot->latency);
+        mpr_device_output_value(x, ptrs, inst_ptrs, slot->len, slot->type, &slot->value);
+        if (x->time_handlers)
+            stats_handled(&ptrs->stats, start);
+        if (count > 1) {
+            ptrs->stats.coalesced += count - 1;
+            // report how many updates were replaced by this one
+            atom_set_string(x->buffer, mpr_obj_get_prop_as_str(ptrs->sig, MPR_PROP_NAME, NULL));
+            atom_setlong(x->buffer + 1, (long)slot->inst);
+            atom_setlong(x->buffer + 2, count - 1);
+            outlet_anything(x->outlet, gensym("coalesced"), 3, x->buffer);
+        }
+    }
+}
+
+static void mpr_device_flush_coalesced(t_mpr_device *x)
+{
+    while (x->dirty) {
+        t_mpr_ptrs *ptrs = x->dirty;
+        x->dirty = ptrs->next_dirty;
+        ptrs->next_dirty = 0;
+        ptrs->queued = 0;
+        mpr_device_flush_signal(ptrs);
+    }
+}
+
 // *********************************************************
 // -(poll libmapper)----------------------------------------
 static void mpr_device_poll(t_mpr_device *x)
@@ -648,6 +1098,13 @@ static void mpr_device_poll(t_mpr_device *x)
     critical_enter(0);
     while (count-- && mpr_dev_poll(x->device, 0)) {};
     critical_exit(0);
+    if (x->dirty)
+        mpr_device_flush_coalesced(x);
+    if (x->adopted || x->orphans) {
+        // the patcher has finished loading, its signal objects have all attached, or
+        // signal objects went while the device stays
+        mpr_device_free_orphans(x);
+    }
     if (!x->ready) {
         if (mpr_dev_get_is_ready(x->device)) {
             object_post((t_object *)x, "Joining mapping network as '%s'",
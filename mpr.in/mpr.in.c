@@ -80,6 +80,8 @@ static t_max_err set_sig_ptr(t_sig *x, t_object *attr, long argc, t_atom *argv);
 static t_max_err set_dev_obj(t_sig *x, t_object *attr, long argc, t_atom *argv);
 
 static void mpr_in_loadbang(t_sig *x);
+static void mpr_in_bang(t_sig *x);
+static void mpr_in_latency(t_sig *x, t_symbol *s, int argc, t_atom *argv);
 static void mpr_in_int(t_sig *x, long i);
 static void mpr_in_float(t_sig *x, double f);
 static void mpr_in_list(t_sig *x, t_symbol *s, int argc, t_atom *argv);
@@ -116,6 +118,8 @@ int main(void)
                   (long)sizeof(t_sig), 0L, A_GIMME, 0);
 
     class_addmethod(c, (method)mpr_in_loadbang, "loadbang", 0);
+    class_addmethod(c, (method)mpr_in_bang, "bang", 0);
+    class_addmethod(c, (method)mpr_in_latency, "latency", A_GIMME, 0);
     class_addmethod(c, (method)mpr_in_int, "int", A_LONG, 0);
     class_addmethod(c, (method)mpr_in_float, "float", A_FLOAT, 0);
     class_addmethod(c, (method)mpr_in_list, "list", A_GIMME, 0);
@@ -478,6 +482,27 @@ void parse_extra_properties(t_sig *x, t_symbol *s, int argc, t_atom *argv)
                 x->thru = atom_coerce_int(argv + i);
             }
         }
+        else if (strcmp(prop_name, "notify") == 0) {
+            // with notify 0 the value is only output when the object receives a bang
+            if ((type == A_LONG || type == A_FLOAT) && x->dev_obj) {
+                object_method(x->dev_obj, gensym("sig_notify"), x->sig_ptr,
+                              (long)atom_coerce_int(argv + i));
+            }
+        }
+        else if (strcmp(prop_name, "timestamps") == 0) {
+            // each value is preceded by "timetag <seconds> <fraction> <latency>"
+            if ((type == A_LONG || type == A_FLOAT) && x->dev_obj) {
+                object_method(x->dev_obj, gensym("timestamps"), x->sig_ptr,
+                              (long)atom_coerce_int(argv + i));
+            }
+        }
+        else if (strcmp(prop_name, "coalesce") == 0) {
+            // the device keeps the latest value per instance and outputs it once per poll
+            if ((type == A_LONG || type == A_FLOAT) && x->dev_obj) {
+                object_method(x->dev_obj, gensym("coalesce"), x->sig_ptr,
+                              (long)atom_coerce_int(argv + i));
+            }
+        }
         else {
             switch (type) {
                 case A_SYM: {
@@ -533,7 +558,12 @@ t_max_err set_dev_obj(t_sig *x, t_object *attr, long argc, t_atom *argv)
 // -(set the signal pointer)--------------------------------
 t_max_err set_sig_ptr(t_sig *x, t_object *attr, long argc, t_atom *argv)
 {
-    x->sig_ptr = (mpr_sig)argv->a_w.w_obj;
+    mpr_sig sig = (mpr_sig)argv->a_w.w_obj;
+    // leaving a signal, e.g. one kept by a freed device for a new owner, which must not
+    // find this object in its instance data
+    if (x->sig_ptr && sig != x->sig_ptr)
+        remove_instance_ptr(x);
+    x->sig_ptr = sig;
     if (x->sig_ptr) {
         long num_atoms;
         t_atom *atoms;
@@ -557,6 +587,50 @@ static int check_ptrs(t_sig *x)
     return 0;
 }
 
+// *********************************************************
+// -(bang: output current value)----------------------------
+static void mpr_in_bang(t_sig *x)
+{
+    t_atom atoms[MAX_LIST];
+    const void *val;
+    int i;
+
+    if (check_ptrs(x))
+        return;
+    critical_enter(0);
+    val = mpr_sig_get_value(x->sig_ptr, x->instance_id, 0);
+    if (val) {
+        if (x->type == 'i') {
+            for (i = 0; i < x->length; i++)
+                atom_setlong(atoms + i, ((int*)val)[i]);
+        }
+        else {
+            for (i = 0; i < x->length; i++)
+                atom_setfloat(atoms + i, ((float*)val)[i]);
+        }
+    }
+    critical_exit(0);
+    if (!val)
+        return;
+
+    if (x->length > 1)
+        outlet_list(x->outlet, NULL, x->length, atoms);
+    else if (x->type == 'i')
+        outlet_int(x->outlet, atom_getlong(atoms));
+    else
+        outlet_float(x->outlet, atom_getfloat(atoms));
+}
+
+// *********************************************************
+// -(latency: output or reset the latency histogram)--------
+static void mpr_in_latency(t_sig *x, t_symbol *s, int argc, t_atom *argv)
+{
+    if (check_ptrs(x))
+        return;
+    object_method(x->dev_obj, gensym("latency"), x->sig_ptr, x,
+                  (long)(argc && atom_strcmp(argv, "reset") == 0));
+}
+
 // *********************************************************
 // -(int input)---------------------------------------------
 static void mpr_in_int(t_sig *x, long l)
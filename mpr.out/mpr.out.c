@@ -22,6 +22,7 @@
 #include "ext_obex.h"           // required for new style Max object
 #include "ext_proto.h"
 #include "ext_critical.h"
+#include "ext_systime.h"
 #include "jpatcher_api.h"
 #include <mapper/mapper.h>
 #include <stdio.h>
@@ -32,6 +33,7 @@
   #include <arpa/inet.h>
   #include <unistd.h>
 #endif
+#include "../common/sig_stats.h"
 
 
 #define MAX_LIST 256
@@ -47,6 +49,7 @@ typedef struct _sig
     char                sig_type;
     mpr_dev             dev_obj;
     mpr_sig             sig_ptr;
+    t_sig_stats         *stats;         // traffic counters kept by the device
     long                is_instanced;
     mpr_id              instance_id;
     t_symbol            *myobjname;
@@ -82,12 +85,15 @@ static void mpr_out_loadbang(t_sig *x);
 static void mpr_out_int(t_sig *x, long i);
 static void mpr_out_float(t_sig *x, double f);
 static void mpr_out_list(t_sig *x, t_symbol *s, int argc, t_atom *argv);
+static void mpr_out_offset(t_sig *x, int argc, t_atom *argv);
 static void mpr_out_release(t_sig *x);
 static void mpr_out_anything(t_sig *x, t_symbol *s, int argc, t_atom *argv);
 
 t_max_err mpr_out_instance_get(t_sig *x, t_object *attr, long *argc, t_atom **argv);
 t_max_err mpr_out_instance_set(t_sig *x, t_object *attr, long argc, t_atom *argv);
 
+static void mpr_out_count(t_sig *x, int len);
+
 static int atom_strcmp(t_atom *a, const char *string);
 static const char *atom_get_string(t_atom *a);
 //static void atom_set_string(t_atom *a, const char *string);
@@ -172,6 +178,7 @@ static void *mpr_out_new(t_symbol *s, int argc, t_atom *argv)
             return 0;
 
         x->sig_ptr = 0;
+        x->stats = 0;
         x->length = 0;
         x->instance_id = 0;
         x->is_instanced = 0;
@@ -190,9 +197,9 @@ static void *mpr_out_new(t_symbol *s, int argc, t_atom *argv)
             i = 2;
         }
         if (x->sig_type == 'i')
-            x->buffer.ints = (int*)malloc(x->sig_length * sizeof(int));
+            x->buffer.ints = (int*)calloc(x->sig_length, sizeof(int));
         else
-            x->buffer.floats = (float*)malloc(x->sig_length * sizeof(float));
+            x->buffer.floats = (float*)calloc(x->sig_length, sizeof(float));
 
         // we need to cache any arguments to add later
         x->args = atomarray_new(argc - i, argv + i);
@@ -292,6 +299,7 @@ void remove_from_hashtab(t_sig *x)
     }
     x->dev_obj = 0;
     x->sig_ptr = 0;
+    x->stats = 0;
     x->length = 0;
     x->connect_state = 0;
 }
@@ -522,6 +530,9 @@ t_max_err set_dev_obj(t_sig *x, t_object *attr, long argc, t_atom *argv)
 t_max_err set_sig_ptr(t_sig *x, t_object *attr, long argc, t_atom *argv)
 {
     x->sig_ptr = (mpr_sig)argv->a_w.w_obj;
+    x->stats = 0;
+    if (x->sig_ptr && x->dev_obj)
+        x->stats = (t_sig_stats *)object_method(x->dev_obj, gensym("sig_stats"), x->sig_ptr);
     if (x->sig_ptr) {
         long num_atoms;
         t_atom *atoms;
@@ -545,6 +556,18 @@ static int check_ptrs(t_sig *x)
     return 0;
 }
 
+// *********************************************************
+// -(count outgoing updates)--------------------------------
+static void mpr_out_count(t_sig *x, int len)
+{
+    // called inside the critical section, the device's handler shares the counters
+    t_sig_stats *st = x->stats;
+    if (!st)
+        return;
+    ++st->out;
+    stats_count(st, systimer_gettime(), len);
+}
+
 // *********************************************************
 // -(int input)---------------------------------------------
 static void mpr_out_int(t_sig *x, long l)
@@ -552,6 +575,7 @@ static void mpr_out_int(t_sig *x, long l)
     if (!check_ptrs(x)) {
         critical_enter(0);
         mpr_sig_set_value(x->sig_ptr, x->instance_id, 1, MPR_INT32, &l);
+        mpr_out_count(x, 1);
         critical_exit(0);
     }
 }
@@ -563,6 +587,7 @@ static void mpr_out_float(t_sig *x, double d)
     if (!check_ptrs(x)) {
         critical_enter(0);
         mpr_sig_set_value(x->sig_ptr, x->instance_id, 1, MPR_DBL, &d);
+        mpr_out_count(x, 1);
         critical_exit(0);
     }
 }
@@ -592,6 +617,7 @@ static void mpr_out_list(t_sig *x, t_symbol *s, int argc, t_atom *argv)
             //update signal
             critical_enter(0);
             mpr_sig_set_value(x->sig_ptr, x->instance_id, argc, MPR_INT32, payload);
+            mpr_out_count(x, argc);
             critical_exit(0);
         }
         else if (x->type == 'f') {
@@ -615,15 +641,58 @@ static void mpr_out_list(t_sig *x, t_symbol *s, int argc, t_atom *argv)
             //update signal
             critical_enter(0);
             mpr_sig_set_value(x->sig_ptr, x->instance_id, argc, MPR_FLT, payload);
+            mpr_out_count(x, argc);
             critical_exit(0);
         }
     }
 }
 
+// *********************************************************
+// -(partial list input)------------------------------------
+static void mpr_out_offset(t_sig *x, int argc, t_atom *argv)
+{
+    // '@offset <index> values...' overwrites part of the last vector sent by this object
+    int i, offset;
+    if (check_ptrs(x) || argc < 2)
+        return;
+    if ((argv)->a_type != A_LONG && (argv)->a_type != A_FLOAT) {
+        object_error((t_object*) x, "offset must be a number");
+        return;
+    }
+    offset = atom_coerce_int(argv);
+    if (offset < 0 || offset + argc - 1 > x->sig_length) {
+        object_error((t_object*) x, "offset %d with %d values exceeds vector length %ld",
+                     offset, argc - 1, x->sig_length);
+        return;
+    }
+    ++argv;
+    --argc;
+    if (x->type == 'i') {
+        for (i = 0; i < argc; i++)
+            x->buffer.ints[offset + i] = atom_coerce_int(argv + i);
+        critical_enter(0);
+        mpr_sig_set_value(x->sig_ptr, x->instance_id, x->sig_length, MPR_INT32, x->buffer.ints);
+        mpr_out_count(x, x->sig_length);
+        critical_exit(0);
+    }
+    else if (x->type == 'f') {
+        for (i = 0; i < argc; i++)
+            x->buffer.floats[offset + i] = atom_coerce_float(argv + i);
+        critical_enter(0);
+        mpr_sig_set_value(x->sig_ptr, x->instance_id, x->sig_length, MPR_FLT, x->buffer.floats);
+        mpr_out_count(x, x->sig_length);
+        critical_exit(0);
+    }
+}
+
 // *********************************************************
 // -(anything)----------------------------------------------
 static void mpr_out_anything(t_sig *x, t_symbol *s, int argc, t_atom *argv)
 {
+    if (s == gensym("@offset")) {
+        mpr_out_offset(x, argc, argv);
+        return;
+    }
     if (check_ptrs(x)) {
         // we need to cache any arguments to add later
         t_atom a;
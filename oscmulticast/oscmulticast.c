@@ -13,6 +13,7 @@
 	#include "ext.h"			// standard Max include, always required
 	#include "ext_obex.h"		// required for new style Max object
 	#include "ext_dictionary.h"
+	#include "ext_buffer.h"
 	#include "jpatcher_api.h"
 #else
 	#include "m_pd.h"
@@ -29,6 +30,7 @@
     #include <iphlpapi.h>
     #define HAVE_LIBIPHLPAPI
 #else
+    #include <sys/socket.h>
     #include <arpa/inet.h>
     #include <ifaddrs.h>
     #include <net/if.h>
@@ -38,10 +40,59 @@
 #include "lo/lo.h"
 
 #define INTERVAL 1
-#define MAXSIZE 256
+#define BUFSIZE 256            // initial size of the receive buffer
+#define POLL_MAX 10             // maximum number of packets handled per poll
+#define SOURCE_CACHE_SIZE 16
 
 // *********************************************************
 // -(object struct)-----------------------------------------
+typedef struct _source_cache_entry
+{
+    char *host;
+    char *port;
+    t_symbol *url;
+} t_source_cache_entry;
+
+typedef struct _filter_node
+{
+    char *segment;
+    int terminal;
+    struct _filter_node *child;
+    struct _filter_node *next;
+} t_filter_node;
+
+typedef struct _scheduled_blob
+{
+    int atom;             // argument replaced by the number of bytes written
+    int size;
+    unsigned char *data;
+} t_scheduled_blob;
+
+typedef struct _scheduled_msg
+{
+    double deadline;      // delivery time in seconds since the NTP epoch
+    unsigned long seq;    // arrival order, keeps messages of one bundle in order
+    t_symbol *path;
+    t_symbol *url;
+    int outlet;
+    int argc;
+    t_atom *argv;
+    int num_blobs;        // blob payloads written to the buffer on delivery
+    t_scheduled_blob *blobs;
+} t_scheduled_msg;
+
+typedef struct _oscmulticast_stats
+{
+    unsigned long packets;
+    unsigned long bytes;
+    unsigned long messages;
+    unsigned long polls;
+    unsigned long busy_polls;   // polls that received at least one packet
+    unsigned long cap_hits;     // polls that stopped at POLL_MAX packets
+    unsigned long truncated;    // blobs that did not fit in their buffer
+    int max_per_poll;
+} t_oscmulticast_stats;
+
 typedef struct _oscmulticast
 {
 	t_object ob;
@@ -53,12 +104,39 @@ typedef struct _oscmulticast
     lo_server servers[2];
     lo_address address;
     void *clock;          // pointer to clock object
-	t_atom buffer[MAXSIZE];
+    int source;           // output message origin URL?
+    int source_cache_next;
+    t_source_cache_entry source_cache[SOURCE_CACHE_SIZE];
+    t_filter_node *filter;      // trie of subscribed path prefixes
+    char **filter_patterns;     // subscribed OSC patterns containing wildcards
+    int num_filter_patterns;
+    unsigned long filter_rejected;
+    int schedule;         // hold timestamped bundles until their timetag?
+    double latency;       // offset added to bundle timetags (ms)
+    void *sched_clock;    // clock for releasing scheduled messages
+    t_scheduled_msg **sched_heap;
+    int sched_size;
+    int sched_capacity;
+    unsigned long sched_seq;
+    unsigned long late;
+    t_symbol *blob_name;  // buffer~ or array used for blob payloads
+#ifdef MAXMSP
+    t_buffer_ref *blob_ref;
+#endif
+    unsigned char *blob_bytes;
+    int blob_bytes_len;
+    int rcvbuf;           // requested socket receive buffer size, 0 for default
+    t_oscmulticast_stats stats;
+	t_atom *buffer;
+    int buffer_len;
 } t_oscmulticast;
 
 static char *char_buffer;
 static int char_buffer_len = 0;
 
+/* liblo error handlers receive no user data, so errors are counted globally. */
+static unsigned long liblo_errors = 0;
+
 // *********************************************************
 // -(function prototypes)-----------------------------------
 static void *oscmulticast_new(t_symbol *s, int argc, t_atom *argv);
@@ -66,18 +144,32 @@ static void oscmulticast_free(t_oscmulticast *x);
 static void oscmulticast_group(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv);
 static void oscmulticast_port(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv);
 static void oscmulticast_interface(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv);
+static void oscmulticast_source(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv);
+static void oscmulticast_subscribe(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv);
+static void oscmulticast_unsubscribe(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv);
 static void oscmulticast_anything(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv);
+static void oscmulticast_schedule(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv);
+static void oscmulticast_latency(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv);
+static void oscmulticast_blob(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv);
+static void oscmulticast_sendblob(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv);
+static void oscmulticast_rcvbuf(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv);
+static void oscmulticast_stats(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv);
 static void oscmulticast_poll(t_oscmulticast *x);
+static void oscmulticast_deliver(t_oscmulticast *x);
 static int multicast_handler(const char *path, const char *types, lo_arg ** argv,
                              int argc, void *data, void *user_data);
 static int reply_handler(const char *path, const char *types, lo_arg ** argv,
                          int argc, void *data, void *user_data);
 #ifdef MAXMSP
 	static void oscmulticast_assist(t_oscmulticast *x, void *b, long m, long a, char *s);
+	static t_max_err oscmulticast_notify(t_oscmulticast *x, t_symbol *s, t_symbol *msg,
+	                                     void *sender, void *data);
 #endif
 
 static const char *maxpd_atom_get_string(t_atom *a);
 static void maxpd_atom_set_string(t_atom *a, const char *string);
+static t_symbol *maxpd_atom_get_symbol(t_atom *a);
+static void maxpd_atom_set_symbol(t_atom *a, t_symbol *sym);
 static void maxpd_atom_set_int(t_atom *a, int i);
 static double maxpd_atom_get_float(t_atom *a);
 static void maxpd_atom_set_float(t_atom *a, float d);
@@ -106,6 +198,16 @@ int main(void)
     class_addmethod(c, (method)oscmulticast_group,     "group",     A_GIMME, 0);
     class_addmethod(c, (method)oscmulticast_port,      "port",      A_GIMME, 0);
     class_addmethod(c, (method)oscmulticast_interface, "interface", A_GIMME, 0);
+    class_addmethod(c, (method)oscmulticast_source,    "source",    A_GIMME, 0);
+    class_addmethod(c, (method)oscmulticast_subscribe,   "subscribe",   A_GIMME, 0);
+    class_addmethod(c, (method)oscmulticast_unsubscribe, "unsubscribe", A_GIMME, 0);
+    class_addmethod(c, (method)oscmulticast_schedule,  "schedule",  A_GIMME, 0);
+    class_addmethod(c, (method)oscmulticast_latency,   "latency",   A_GIMME, 0);
+    class_addmethod(c, (method)oscmulticast_blob,      "blob",      A_GIMME, 0);
+    class_addmethod(c, (method)oscmulticast_sendblob,  "sendblob",  A_GIMME, 0);
+    class_addmethod(c, (method)oscmulticast_rcvbuf,    "rcvbuf",    A_GIMME, 0);
+    class_addmethod(c, (method)oscmulticast_stats,     "stats",     A_GIMME, 0);
+    class_addmethod(c, (method)oscmulticast_notify,    "notify",    A_CANT,  0);
     class_addmethod(c, (method)oscmulticast_anything,  "anything",  A_GIMME, 0);
     class_register(CLASS_BOX, c); /* CLASS_NOBOX */
     oscmulticast_class = c;
@@ -120,6 +222,24 @@ int oscmulticast_setup(void)
                   0L, A_GIMME, 0);
     class_addmethod(c, (t_method)oscmulticast_interface, gensym("interface"),
                     A_GIMME, 0);
+    class_addmethod(c, (t_method)oscmulticast_source, gensym("source"),
+                    A_GIMME, 0);
+    class_addmethod(c, (t_method)oscmulticast_subscribe, gensym("subscribe"),
+                    A_GIMME, 0);
+    class_addmethod(c, (t_method)oscmulticast_unsubscribe, gensym("unsubscribe"),
+                    A_GIMME, 0);
+    class_addmethod(c, (t_method)oscmulticast_schedule, gensym("schedule"),
+                    A_GIMME, 0);
+    class_addmethod(c, (t_method)oscmulticast_latency, gensym("latency"),
+                    A_GIMME, 0);
+    class_addmethod(c, (t_method)oscmulticast_blob, gensym("blob"),
+                    A_GIMME, 0);
+    class_addmethod(c, (t_method)oscmulticast_sendblob, gensym("sendblob"),
+                    A_GIMME, 0);
+    class_addmethod(c, (t_method)oscmulticast_rcvbuf, gensym("rcvbuf"),
+                    A_GIMME, 0);
+    class_addmethod(c, (t_method)oscmulticast_stats, gensym("stats"),
+                    A_GIMME, 0);
     class_addanything(c, (t_method)oscmulticast_anything);
     oscmulticast_class = c;
     return 0;
@@ -130,6 +250,7 @@ int oscmulticast_setup(void)
 /* Internal LibLo error handler */
 static void handler_error(int num, const char *msg, const char *where)
 {
+    ++liblo_errors;
     post("oscmulticast: liblo server error %d in path %s: %s\n", num, where, msg);
 }
 
@@ -269,6 +390,433 @@ static int get_interface_addr(const char* pref, struct in_addr* addr, char **ifa
     return 2;
 }
 
+/*! Grow the receive buffer so that it can hold at least len atoms. */
+static void buffer_reserve(t_oscmulticast *x, int len)
+{
+    if (len <= x->buffer_len)
+        return;
+    while (x->buffer_len < len)
+        x->buffer_len *= 2;
+    x->buffer = (t_atom *)realloc(x->buffer, x->buffer_len * sizeof(t_atom));
+}
+
+/*! Drop all cached source URL symbols. */
+static void source_cache_clear(t_oscmulticast *x)
+{
+    int i;
+    for (i = 0; i < SOURCE_CACHE_SIZE; i++) {
+        if (x->source_cache[i].host)
+            free(x->source_cache[i].host);
+        if (x->source_cache[i].port)
+            free(x->source_cache[i].port);
+    }
+    memset(x->source_cache, 0, sizeof(x->source_cache));
+    x->source_cache_next = 0;
+}
+
+/*! Look up the URL symbol for a message source, building and caching it if
+ *  necessary. liblo does not expose the raw sockaddr, so entries are keyed on
+ *  the numeric host and port strings it has already resolved. */
+static t_symbol *source_cache_lookup(t_oscmulticast *x, lo_address address)
+{
+    const char *host = lo_address_get_hostname(address);
+    const char *port = lo_address_get_port(address);
+    t_source_cache_entry *e;
+    char *url;
+    int i;
+
+    if (!host || !port)
+        return NULL;
+
+    for (i = 0; i < SOURCE_CACHE_SIZE; i++) {
+        e = &x->source_cache[i];
+        if (!e->url)
+            break;
+        if (0 == strcmp(e->host, host) && 0 == strcmp(e->port, port))
+            return e->url;
+    }
+
+    url = lo_address_get_url(address);
+    if (!url)
+        return NULL;
+
+    // replace the oldest entry once the cache is full
+    e = &x->source_cache[x->source_cache_next];
+    x->source_cache_next = (x->source_cache_next + 1) % SOURCE_CACHE_SIZE;
+    if (e->host)
+        free(e->host);
+    if (e->port)
+        free(e->port);
+    e->host = strdup(host);
+    e->port = strdup(port);
+    maxpd_atom_set_string(x->buffer, url);
+    e->url = maxpd_atom_get_symbol(x->buffer);
+    free(url);
+    return e->url;
+}
+
+/*! Return non-zero if an OSC path contains pattern-matching characters. */
+static int is_osc_pattern(const char *str)
+{
+    return strpbrk(str, "*?[]{}") != NULL;
+}
+
+static void filter_node_free(t_filter_node *node)
+{
+    while (node) {
+        t_filter_node *next = node->next;
+        filter_node_free(node->child);
+        free(node->segment);
+        free(node);
+        node = next;
+    }
+}
+
+/*! Find the sibling in list matching the path segment of length len. */
+static t_filter_node **filter_find_segment(t_filter_node **list, const char *seg, size_t len)
+{
+    while (*list) {
+        if (0 == strncmp((*list)->segment, seg, len) && !(*list)->segment[len])
+            return list;
+        list = &(*list)->next;
+    }
+    return list;
+}
+
+/*! Add a path prefix to the subscription trie, one node per path segment. */
+static void filter_add_prefix(t_oscmulticast *x, const char *path)
+{
+    t_filter_node **list = &x->filter, *node = NULL;
+    const char *seg = path, *end;
+
+    while (*seg == '/')
+        ++seg;
+    while (*seg) {
+        size_t len;
+        end = strchr(seg, '/');
+        len = end ? (size_t)(end - seg) : strlen(seg);
+        list = filter_find_segment(list, seg, len);
+        if (!*list) {
+            node = (t_filter_node *)calloc(1, sizeof(t_filter_node));
+            node->segment = (char *)malloc(len + 1);
+            memcpy(node->segment, seg, len);
+            node->segment[len] = 0;
+            *list = node;
+        }
+        node = *list;
+        list = &node->child;
+        seg += len;
+        while (*seg == '/')
+            ++seg;
+    }
+    if (node)
+        node->terminal = 1;
+}
+
+/*! Remove a path prefix from the subscription trie, pruning empty branches.
+ *  Returns non-zero if the prefix was found. */
+static int filter_remove_prefix(t_filter_node **list, const char *seg)
+{
+    t_filter_node **found, *node;
+    const char *end;
+    size_t len;
+    int ret;
+
+    while (*seg == '/')
+        ++seg;
+    if (!*seg)
+        return 0;
+    end = strchr(seg, '/');
+    len = end ? (size_t)(end - seg) : strlen(seg);
+    found = filter_find_segment(list, seg, len);
+    if (!(node = *found))
+        return 0;
+    seg += len;
+    while (*seg == '/')
+        ++seg;
+    if (*seg)
+        ret = filter_remove_prefix(&node->child, seg);
+    else {
+        ret = node->terminal;
+        node->terminal = 0;
+    }
+    if (!node->terminal && !node->child) {
+        *found = node->next;
+        node->next = NULL;
+        filter_node_free(node);
+    }
+    return ret;
+}
+
+/*! Check a raw OSC address against the subscriptions. A path is accepted if
+ *  a subscribed prefix matches it on segment boundaries or if it matches one
+ *  of the subscribed wildcard patterns. An empty filter accepts everything. */
+static int filter_accepts(t_oscmulticast *x, const char *path)
+{
+    t_filter_node *list = x->filter;
+    const char *seg = path, *end;
+    int i;
+
+    if (!x->filter && !x->num_filter_patterns)
+        return 1;
+
+    while (*seg == '/')
+        ++seg;
+    while (list && *seg) {
+        size_t len;
+        end = strchr(seg, '/');
+        len = end ? (size_t)(end - seg) : strlen(seg);
+        while (list && (strncmp(list->segment, seg, len) || list->segment[len]))
+            list = list->next;
+        if (!list)
+            break;
+        if (list->terminal)
+            return 1;
+        list = list->child;
+        seg += len;
+        while (*seg == '/')
+            ++seg;
+    }
+
+    for (i = 0; i < x->num_filter_patterns; i++) {
+        if (lo_pattern_match(path, x->filter_patterns[i]))
+            return 1;
+    }
+    return 0;
+}
+
+static void filter_clear(t_oscmulticast *x)
+{
+    int i;
+    filter_node_free(x->filter);
+    x->filter = NULL;
+    for (i = 0; i < x->num_filter_patterns; i++)
+        free(x->filter_patterns[i]);
+    if (x->filter_patterns)
+        free(x->filter_patterns);
+    x->filter_patterns = NULL;
+    x->num_filter_patterns = 0;
+}
+
+static double timetag_to_double(lo_timetag tt)
+{
+    return (double)tt.sec + (double)tt.frac / 4294967296.0;
+}
+
+/*! Heap order: earlier deadline first, then earlier arrival. */
+static int sched_before(t_scheduled_msg *a, t_scheduled_msg *b)
+{
+    return a->deadline < b->deadline || (a->deadline == b->deadline && a->seq < b->seq);
+}
+
+/*! Insert a message into the delivery min-heap, ordered by deadline and
+ *  arrival so the messages of a bundle are delivered in their bundle order. */
+static void sched_push(t_oscmulticast *x, t_scheduled_msg *m)
+{
+    int i, parent;
+
+    m->seq = x->sched_seq++;
+
+    if (x->sched_size >= x->sched_capacity) {
+        x->sched_capacity = x->sched_capacity ? x->sched_capacity * 2 : 16;
+        x->sched_heap = realloc(x->sched_heap, x->sched_capacity * sizeof(t_scheduled_msg *));
+    }
+    i = x->sched_size++;
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (!sched_before(m, x->sched_heap[parent]))
+            break;
+        x->sched_heap[i] = x->sched_heap[parent];
+        i = parent;
+    }
+    x->sched_heap[i] = m;
+}
+
+/*! Remove and return the message with the earliest deadline. */
+static t_scheduled_msg *sched_pop(t_oscmulticast *x)
+{
+    t_scheduled_msg *top, *last;
+    int i = 0, child;
+
+    if (!x->sched_size)
+        return NULL;
+    top = x->sched_heap[0];
+    last = x->sched_heap[--x->sched_size];
+    while ((child = i * 2 + 1) < x->sched_size) {
+        if (child + 1 < x->sched_size
+            && sched_before(x->sched_heap[child + 1], x->sched_heap[child]))
+            ++child;
+        if (!sched_before(x->sched_heap[child], last))
+            break;
+        x->sched_heap[i] = x->sched_heap[child];
+        i = child;
+    }
+    if (x->sched_size)
+        x->sched_heap[i] = last;
+    return top;
+}
+
+static void sched_free_msg(t_scheduled_msg *m)
+{
+    int i;
+    for (i = 0; i < m->num_blobs; i++)
+        free(m->blobs[i].data);
+    if (m->blobs)
+        free(m->blobs);
+    if (m->argv)
+        free(m->argv);
+    free(m);
+}
+
+static void sched_clear(t_oscmulticast *x)
+{
+    t_scheduled_msg *m;
+    while ((m = sched_pop(x)))
+        sched_free_msg(m);
+    if (x->sched_heap)
+        free(x->sched_heap);
+    x->sched_heap = NULL;
+    x->sched_capacity = 0;
+}
+
+/*! Set the delivery clock to go off at the earliest deadline in the heap. */
+static void sched_arm(t_oscmulticast *x, double now)
+{
+    double delay;
+    if (!x->sched_size) {
+        clock_unset(x->sched_clock);
+        return;
+    }
+    delay = (x->sched_heap[0]->deadline - now) * 1000.;
+    if (delay < 0)
+        delay = 0;
+#ifdef MAXMSP
+    clock_fdelay(x->sched_clock, delay);
+#else
+    clock_delay(x->sched_clock, delay);
+#endif
+}
+
+/*! Copy a blob payload into the named buffer~ (Max) or array (Pd), one byte
+ *  per sample starting at offset. Returns the number of bytes written. */
+static int blob_write(t_oscmulticast *x, const unsigned char *data, int size, int offset)
+{
+    int i, frames;
+
+    if (!x->blob_name || size <= 0)
+        return 0;
+#ifdef MAXMSP
+    t_buffer_obj *b = buffer_ref_getobject(x->blob_ref);
+    float *samples;
+    long chans;
+    if (!b || !(samples = buffer_locksamples(b)))
+        return 0;
+    frames = (int)buffer_getframecount(b);
+    chans = (long)buffer_getchannelcount(b);
+    if (size > frames - offset) {
+        ++x->stats.truncated;
+        size = frames - offset;
+    }
+    for (i = 0; i < size; i++)
+        samples[(offset + i) * chans] = (float)data[i];
+    buffer_unlocksamples(b);
+    buffer_setdirty(b);
+#else
+    t_garray *a = (t_garray *)pd_findbyclass(x->blob_name, garray_class);
+    t_word *vec;
+    if (!a || !garray_getfloatwords(a, &frames, &vec))
+        return 0;
+    if (size > frames - offset) {
+        ++x->stats.truncated;
+        size = frames - offset;
+    }
+    for (i = 0; i < size; i++)
+        vec[offset + i].w_float = (t_float)data[i];
+    garray_redraw(a);
+#endif
+    return size > 0 ? size : 0;
+}
+
+/*! Read count samples starting at offset from a buffer~ (Max) or array (Pd)
+ *  into the blob byte buffer. A negative count reads to the end. Returns the
+ *  number of bytes read or -1 if the buffer could not be found. */
+static int blob_read(t_oscmulticast *x, t_symbol *name, int offset, int count)
+{
+    int i, frames;
+
+#ifdef MAXMSP
+    t_buffer_ref *ref = buffer_ref_new((t_object *)x, name);
+    t_buffer_obj *b = buffer_ref_getobject(ref);
+    float *samples;
+    long chans;
+    if (!b || !(samples = buffer_locksamples(b))) {
+        object_free(ref);
+        return -1;
+    }
+    frames = (int)buffer_getframecount(b);
+    chans = (long)buffer_getchannelcount(b);
+#else
+    t_garray *a = (t_garray *)pd_findbyclass(name, garray_class);
+    t_word *vec;
+    if (!a || !garray_getfloatwords(a, &frames, &vec))
+        return -1;
+#endif
+    if (offset < 0)
+        offset = 0;
+    if (count < 0 || count > frames - offset)
+        count = frames - offset;
+    if (count < 0)
+        count = 0;
+    if (count > x->blob_bytes_len) {
+        x->blob_bytes = (unsigned char *)realloc(x->blob_bytes, count);
+        x->blob_bytes_len = count;
+    }
+    for (i = 0; i < count; i++) {
+#ifdef MAXMSP
+        x->blob_bytes[i] = (unsigned char)samples[(offset + i) * chans];
+#else
+        x->blob_bytes[i] = (unsigned char)vec[offset + i].w_float;
+#endif
+    }
+#ifdef MAXMSP
+    buffer_unlocksamples(b);
+    object_free(ref);
+#endif
+    return count;
+}
+
+/*! Get the kernel receive buffer size of a server socket, or -1 on error. */
+static int get_rcvbuf(lo_server server)
+{
+    int size = 0;
+#ifdef WIN32
+    int len = sizeof(size);
+#else
+    socklen_t len = sizeof(size);
+#endif
+    if (!server)
+        return -1;
+    if (getsockopt(lo_server_get_socket_fd(server), SOL_SOCKET, SO_RCVBUF,
+                   (char *)&size, &len))
+        return -1;
+    return size;
+}
+
+/*! Apply the requested receive buffer size to both servers. */
+static void set_rcvbuf(t_oscmulticast *x)
+{
+    int i;
+    if (x->rcvbuf <= 0)
+        return;
+    for (i = 0; i < 2; i++) {
+        if (!x->servers[i])
+            continue;
+        if (setsockopt(lo_server_get_socket_fd(x->servers[i]), SOL_SOCKET, SO_RCVBUF,
+                       (const char *)&x->rcvbuf, sizeof(x->rcvbuf)))
+            post("oscmulticast: could not set receive buffer size to %i", x->rcvbuf);
+    }
+}
+
 void startup(t_oscmulticast *x)
 {
     if (!x->group || !x->port[0])
@@ -327,6 +875,8 @@ void startup(t_oscmulticast *x)
     lo_server_add_method(x->servers[0], NULL, NULL, multicast_handler, x);
     lo_server_add_method(x->servers[1], NULL, NULL, reply_handler, x);
 
+    set_rcvbuf(x);
+
     if (!x->clock) {
 #ifdef MAXMSP
         x->clock = clock_new(x, (method)oscmulticast_poll);	// Create the timing clock
@@ -364,6 +914,35 @@ void *oscmulticast_new(t_symbol *s, int argc, t_atom *argv)
         x->port[0] = '\0';
         x->iface_pref = NULL;
         x->iface = NULL;
+        x->source = 1;
+        x->source_cache_next = 0;
+        memset(x->source_cache, 0, sizeof(x->source_cache));
+        x->filter = NULL;
+        x->filter_patterns = NULL;
+        x->num_filter_patterns = 0;
+        x->filter_rejected = 0;
+        x->schedule = 0;
+        x->latency = 0;
+        x->sched_heap = NULL;
+        x->sched_size = 0;
+        x->sched_capacity = 0;
+        x->sched_seq = 0;
+        x->late = 0;
+        x->blob_name = NULL;
+#ifdef MAXMSP
+        x->blob_ref = NULL;
+#endif
+        x->blob_bytes = NULL;
+        x->blob_bytes_len = 0;
+        x->rcvbuf = 0;
+        memset(&x->stats, 0, sizeof(x->stats));
+        x->buffer_len = BUFSIZE;
+        x->buffer = (t_atom *)malloc(x->buffer_len * sizeof(t_atom));
+#ifdef MAXMSP
+        x->sched_clock = clock_new(x, (method)oscmulticast_deliver);
+#else
+        x->sched_clock = clock_new(x, (t_method)oscmulticast_deliver);
+#endif
 
         for (i = 0; i < argc; i++) {
             if (strcmp(maxpd_atom_get_string(argv+i), "@group") == 0) {
@@ -390,6 +969,60 @@ void *oscmulticast_new(t_symbol *s, int argc, t_atom *argv)
                     i++;
                 }
             }
+            else if (strcmp(maxpd_atom_get_string(argv+i), "@schedule") == 0) {
+                if ((argv+i+1)->a_type == A_FLOAT) {
+                    x->schedule = maxpd_atom_get_float(argv+i+1) != 0;
+                    i++;
+                }
+#ifdef MAXMSP
+                else if ((argv+i+1)->a_type == A_LONG) {
+                    x->schedule = atom_getlong(argv+i+1) != 0;
+                    i++;
+                }
+#endif
+            }
+            else if (strcmp(maxpd_atom_get_string(argv+i), "@latency") == 0) {
+                if ((argv+i+1)->a_type == A_FLOAT) {
+                    x->latency = maxpd_atom_get_float(argv+i+1);
+                    i++;
+                }
+#ifdef MAXMSP
+                else if ((argv+i+1)->a_type == A_LONG) {
+                    x->latency = (double)atom_getlong(argv+i+1);
+                    i++;
+                }
+#endif
+            }
+            else if (strcmp(maxpd_atom_get_string(argv+i), "@blob") == 0) {
+                if ((argv+i+1)->a_type == A_SYM) {
+                    oscmulticast_blob(x, NULL, 1, argv+i+1);
+                    i++;
+                }
+            }
+            else if (strcmp(maxpd_atom_get_string(argv+i), "@rcvbuf") == 0) {
+                if ((argv+i+1)->a_type == A_FLOAT) {
+                    x->rcvbuf = (int)maxpd_atom_get_float(argv+i+1);
+                    i++;
+                }
+#ifdef MAXMSP
+                else if ((argv+i+1)->a_type == A_LONG) {
+                    x->rcvbuf = (int)atom_getlong(argv+i+1);
+                    i++;
+                }
+#endif
+            }
+            else if (strcmp(maxpd_atom_get_string(argv+i), "@source") == 0) {
+                if ((argv+i+1)->a_type == A_FLOAT) {
+                    x->source = maxpd_atom_get_float(argv+i+1) != 0;
+                    i++;
+                }
+#ifdef MAXMSP
+                else if ((argv+i+1)->a_type == A_LONG) {
+                    x->source = atom_getlong(argv+i+1) != 0;
+                    i++;
+                }
+#endif
+            }
         }
         startup(x);
     }
@@ -422,6 +1055,24 @@ void oscmulticast_free(t_oscmulticast *x)
     if (x->group) {
         free(x->group);
     }
+    if (x->sched_clock) {
+        clock_unset(x->sched_clock);
+        clock_free(x->sched_clock);
+    }
+    sched_clear(x);
+    source_cache_clear(x);
+    filter_clear(x);
+#ifdef MAXMSP
+    if (x->blob_ref) {
+        object_free(x->blob_ref);
+    }
+#endif
+    if (x->blob_bytes) {
+        free(x->blob_bytes);
+    }
+    if (x->buffer) {
+        free(x->buffer);
+    }
 }
 
 // *********************************************************
@@ -441,7 +1092,7 @@ void oscmulticast_assist(t_oscmulticast *x, void *b, long m, long a, char *s)
                 sprintf(s, "Messages sent directly to reply server.");
                 break;
             case 2:
-                sprintf(s, "URL of message origin.");
+                sprintf(s, "URL of message origin, late bundles, rcvbuf and stats counters.");
                 break;
             default:
                 sprintf(s, "Outlet %d.", (int)a);
@@ -449,6 +1100,16 @@ void oscmulticast_assist(t_oscmulticast *x, void *b, long m, long a, char *s)
         }
 	}
 }
+
+// *********************************************************
+// -(notify - maxmsp only)----------------------------------
+t_max_err oscmulticast_notify(t_oscmulticast *x, t_symbol *s, t_symbol *msg,
+                              void *sender, void *data)
+{
+    if (x->blob_ref)
+        return buffer_ref_notify(x->blob_ref, s, msg, sender, data);
+    return MAX_ERR_NONE;
+}
 #endif
 
 // *********************************************************
@@ -521,6 +1182,257 @@ static void oscmulticast_interface(t_oscmulticast *x, t_symbol *s, int argc, t_a
     startup(x);
 }
 
+// *********************************************************
+// -(source)------------------------------------------------
+static void oscmulticast_source(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv)
+{
+    if (argc < 1)
+        return;
+    if (argv->a_type == A_FLOAT)
+        x->source = maxpd_atom_get_float(argv) != 0;
+#ifdef MAXMSP
+    else if (argv->a_type == A_LONG)
+        x->source = atom_getlong(argv) != 0;
+#endif
+}
+
+// *********************************************************
+// -(subscribe)---------------------------------------------
+static void oscmulticast_subscribe(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv)
+{
+    int i, j;
+
+    if (argc < 1) {
+        post("oscmulticast: %i wildcard subscriptions, %lu messages rejected",
+             x->num_filter_patterns, x->filter_rejected);
+        return;
+    }
+
+    for (i = 0; i < argc; i++) {
+        const char *pattern;
+        if ((argv+i)->a_type != A_SYM)
+            continue;
+        pattern = maxpd_atom_get_string(argv+i);
+        if (pattern[0] != '/') {
+            post("oscmulticast: subscription '%s' must begin with '/'", pattern);
+            continue;
+        }
+        if (!is_osc_pattern(pattern)) {
+            if (!pattern[1]) {
+                // subscribing to '/' is the same as no filter
+                filter_clear(x);
+                continue;
+            }
+            filter_add_prefix(x, pattern);
+            continue;
+        }
+        for (j = 0; j < x->num_filter_patterns; j++) {
+            if (0 == strcmp(x->filter_patterns[j], pattern))
+                break;
+        }
+        if (j < x->num_filter_patterns)
+            continue;
+        x->filter_patterns = realloc(x->filter_patterns,
+                                     (x->num_filter_patterns + 1) * sizeof(char *));
+        x->filter_patterns[x->num_filter_patterns++] = strdup(pattern);
+    }
+}
+
+// *********************************************************
+// -(unsubscribe)-------------------------------------------
+static void oscmulticast_unsubscribe(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv)
+{
+    int i, j;
+
+    if (argc < 1) {
+        filter_clear(x);
+        return;
+    }
+
+    for (i = 0; i < argc; i++) {
+        const char *pattern;
+        if ((argv+i)->a_type != A_SYM)
+            continue;
+        pattern = maxpd_atom_get_string(argv+i);
+        if (!is_osc_pattern(pattern)) {
+            if (!filter_remove_prefix(&x->filter, pattern))
+                post("oscmulticast: not subscribed to '%s'", pattern);
+            continue;
+        }
+        for (j = 0; j < x->num_filter_patterns; j++) {
+            if (0 == strcmp(x->filter_patterns[j], pattern))
+                break;
+        }
+        if (j == x->num_filter_patterns) {
+            post("oscmulticast: not subscribed to '%s'", pattern);
+            continue;
+        }
+        free(x->filter_patterns[j]);
+        for (++j; j < x->num_filter_patterns; j++)
+            x->filter_patterns[j - 1] = x->filter_patterns[j];
+        --x->num_filter_patterns;
+    }
+}
+
+// *********************************************************
+// -(schedule)----------------------------------------------
+static void oscmulticast_schedule(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv)
+{
+    int schedule = x->schedule;
+
+    if (argc < 1) {
+        post("oscmulticast: %i messages scheduled, %lu late", x->sched_size, x->late);
+        return;
+    }
+    if (argv->a_type == A_FLOAT)
+        schedule = maxpd_atom_get_float(argv) != 0;
+#ifdef MAXMSP
+    else if (argv->a_type == A_LONG)
+        schedule = atom_getlong(argv) != 0;
+#endif
+    if (schedule == x->schedule)
+        return;
+    x->schedule = schedule;
+    if (!schedule) {
+        // flush anything still waiting
+        clock_unset(x->sched_clock);
+        oscmulticast_deliver(x);
+    }
+}
+
+// *********************************************************
+// -(latency)-----------------------------------------------
+static void oscmulticast_latency(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv)
+{
+    if (argc < 1)
+        return;
+    if (argv->a_type == A_FLOAT)
+        x->latency = maxpd_atom_get_float(argv);
+#ifdef MAXMSP
+    else if (argv->a_type == A_LONG)
+        x->latency = (double)atom_getlong(argv);
+#endif
+}
+
+// *********************************************************
+// -(blob)--------------------------------------------------
+static void oscmulticast_blob(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv)
+{
+    if (argc < 1 || argv->a_type != A_SYM) {
+        // no buffer: blob arguments will be dropped
+        x->blob_name = NULL;
+        return;
+    }
+    x->blob_name = maxpd_atom_get_symbol(argv);
+#ifdef MAXMSP
+    if (x->blob_ref)
+        buffer_ref_set(x->blob_ref, x->blob_name);
+    else
+        x->blob_ref = buffer_ref_new((t_object *)x, x->blob_name);
+#endif
+}
+
+// *********************************************************
+// -(send blob)---------------------------------------------
+static void oscmulticast_sendblob(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv)
+{
+    int offset = 0, count = -1;
+    lo_blob blob;
+
+    if (!x->address || !x->servers[1])
+        return;
+
+    if (argc < 2 || argv->a_type != A_SYM || (argv+1)->a_type != A_SYM) {
+        post("oscmulticast: usage: sendblob <path> <buffer> [offset] [count]");
+        return;
+    }
+    if (argc > 2)
+        offset = (int)maxpd_atom_get_float(argv+2);
+    if (argc > 3)
+        count = (int)maxpd_atom_get_float(argv+3);
+
+    count = blob_read(x, maxpd_atom_get_symbol(argv+1), offset, count);
+    if (count < 0) {
+        post("oscmulticast: buffer '%s' not found", maxpd_atom_get_string(argv+1));
+        return;
+    }
+
+    lo_timetag tt;
+    lo_timetag_now(&tt);
+    lo_bundle b = lo_bundle_new(tt);
+
+    lo_message m = lo_message_new();
+    if (!m) {
+        post("oscmulticast: error creating message!");
+        lo_bundle_free(b);
+        return;
+    }
+    blob = lo_blob_new(count, x->blob_bytes);
+    lo_message_add_blob(m, blob);
+
+    lo_bundle_add_message(b, maxpd_atom_get_string(argv), m);
+    lo_send_bundle_from(x->address, x->servers[1], b);
+    lo_message_free(m);
+    lo_blob_free(blob);
+    lo_bundle_free(b);
+}
+
+// *********************************************************
+// -(receive buffer size)-----------------------------------
+static void oscmulticast_rcvbuf(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv)
+{
+    if (argc > 0) {
+        if (argv->a_type == A_FLOAT)
+            x->rcvbuf = (int)maxpd_atom_get_float(argv);
+#ifdef MAXMSP
+        else if (argv->a_type == A_LONG)
+            x->rcvbuf = (int)atom_getlong(argv);
+#endif
+        set_rcvbuf(x);
+    }
+
+    // report the sizes actually granted by the kernel
+    maxpd_atom_set_int(x->buffer, get_rcvbuf(x->servers[0]));
+    maxpd_atom_set_int(x->buffer + 1, get_rcvbuf(x->servers[1]));
+    outlet_anything(x->outlets[2], gensym("rcvbuf"), 2, x->buffer);
+}
+
+// *********************************************************
+// -(statistics)--------------------------------------------
+static void output_stat(t_oscmulticast *x, const char *name, double value)
+{
+    maxpd_atom_set_float(x->buffer, value);
+    outlet_anything(x->outlets[2], gensym((char *)name), 1, x->buffer);
+}
+
+static void oscmulticast_stats(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv)
+{
+    t_oscmulticast_stats *st = &x->stats;
+
+    if (argc > 0 && argv->a_type == A_SYM && !strcmp(maxpd_atom_get_string(argv), "reset")) {
+        memset(st, 0, sizeof(t_oscmulticast_stats));
+        x->filter_rejected = 0;
+        x->late = 0;
+        return;
+    }
+
+    output_stat(x, "packets", st->packets);
+    output_stat(x, "bytes", st->bytes);
+    output_stat(x, "messages", st->messages);
+    // most 1 ms polls find nothing, so the average only counts polls with traffic
+    output_stat(x, "polls", st->polls);
+    output_stat(x, "busy_polls", st->busy_polls);
+    output_stat(x, "messages_per_poll",
+                st->busy_polls ? (double)st->messages / st->busy_polls : 0);
+    output_stat(x, "max_messages_per_poll", st->max_per_poll);
+    output_stat(x, "cap_hits", st->cap_hits);
+    output_stat(x, "truncated", st->truncated);
+    output_stat(x, "errors", liblo_errors);
+    output_stat(x, "rejected", x->filter_rejected);
+    output_stat(x, "late", x->late);
+    oscmulticast_rcvbuf(x, NULL, 0, NULL);
+}
+
 // *********************************************************
 // -(anything)----------------------------------------------
 void oscmulticast_anything(t_oscmulticast *x, t_symbol *s, int argc, t_atom *argv)
@@ -571,40 +1483,111 @@ void oscmulticast_anything(t_oscmulticast *x, t_symbol *s, int argc, t_atom *arg
 // -(poll libmapper)----------------------------------------
 void oscmulticast_poll(t_oscmulticast *x)
 {
-    int count = 0, status[2];
+    int count = 0, i, status[2];
+    unsigned long messages = x->stats.messages;
 
     if (x->servers[0]) {
-        while (count < 10 && lo_servers_recv_noblock(x->servers, status, 2, 0)) {
+        while (count < POLL_MAX && lo_servers_recv_noblock(x->servers, status, 2, 0)) {
             count++;
+            for (i = 0; i < 2; i++) {
+                if (status[i] > 0) {
+                    ++x->stats.packets;
+                    x->stats.bytes += status[i];
+                }
+            }
         }
+        if (count >= POLL_MAX)
+            ++x->stats.cap_hits;
+        ++x->stats.polls;
+        if (count)
+            ++x->stats.busy_polls;
+        messages = x->stats.messages - messages;
+        if (messages > (unsigned long)x->stats.max_per_poll)
+            x->stats.max_per_poll = (int)messages;
     }
 
 	clock_delay(x->clock, INTERVAL);  // Set clock to go off after delay
 }
 
+// *********************************************************
+// -(release scheduled messages)----------------------------
+void oscmulticast_deliver(t_oscmulticast *x)
+{
+    t_scheduled_msg *m;
+    lo_timetag tt;
+    double now;
+    int i, offset;
+
+    lo_timetag_now(&tt);
+    now = timetag_to_double(tt);
+
+    while (x->sched_size && (!x->schedule || x->sched_heap[0]->deadline <= now)) {
+        m = sched_pop(x);
+        for (i = 0, offset = 0; i < m->num_blobs; i++) {
+            t_scheduled_blob *b = &m->blobs[i];
+            int size = blob_write(x, b->data, b->size, offset);
+            offset += size;
+            maxpd_atom_set_int(m->argv + b->atom, size);
+        }
+        if (m->url) {
+            maxpd_atom_set_symbol(x->buffer, m->url);
+            outlet_anything(x->outlets[2], gensym("symbol"), 1, x->buffer);
+        }
+        outlet_anything(x->outlets[m->outlet], m->path, m->argc, m->argv);
+        sched_free_msg(m);
+    }
+    sched_arm(x, now);
+}
+
 // *********************************************************
 // -(OSC handlers)-------------------------------------------
 int generic_handler(const char *path, const char *types, lo_arg ** argv,
                     int argc, lo_message msg, void *user_data, int outlet)
 {
     t_oscmulticast *x = (t_oscmulticast *)user_data;
-    int i, j;
+    int i, j, blob_offset = 0;
     char my_string[2];
+    t_symbol *url = NULL;
+    t_scheduled_msg *m = NULL;
+    double deadline = 0, now = 0;
 
     j=0;
+    ++x->stats.messages;
 
-    lo_address address = lo_message_get_source(msg);
-    if (address) {
-        maxpd_atom_set_string(x->buffer, lo_address_get_url(address));
+    if (x->source) {
+        lo_address address = lo_message_get_source(msg);
+        url = address ? source_cache_lookup(x, address) : NULL;
+    }
+
+    if (x->schedule) {
+        lo_timetag tt = lo_message_get_timestamp(msg);
+        // messages outside of a bundle are marked "immediate"
+        if (tt.sec || tt.frac != 1) {
+            deadline = timetag_to_double(tt) + x->latency * 0.001;
+            lo_timetag_now(&tt);
+            now = timetag_to_double(tt);
+            if (deadline < now) {
+                ++x->late;
+                maxpd_atom_set_float(x->buffer, (now - deadline) * 1000.);
+                outlet_anything(x->outlets[2], gensym("late"), 1, x->buffer);
+                deadline = 0;
+            }
+        }
+    }
+
+    if (url && !deadline) {
+        maxpd_atom_set_symbol(x->buffer, url);
         outlet_anything(x->outlets[2], gensym("symbol"), 1, x->buffer);
     }
 
-    if (argc > MAXSIZE) {
-        post("oscmulticast: truncating received message to %i elements!",
-             MAXSIZE);
-        argc = MAXSIZE;
+    if (deadline) {
+        m = (t_scheduled_msg *)malloc(sizeof(t_scheduled_msg));
+        m->num_blobs = 0;
+        m->blobs = NULL;
     }
 
+    buffer_reserve(x, argc);
+
     for (i=0; i<argc; i++)
     {
         switch (types[i])
@@ -646,12 +1629,51 @@ int generic_handler(const char *path, const char *types, lo_arg ** argv,
                 maxpd_atom_set_string(x->buffer+j, "False");
                 ++j;
                 break;
+            case 'b': {
+                // output the number of bytes stored in place of the blob
+                const unsigned char *data = (const unsigned char *)lo_blob_dataptr((lo_blob)argv[i]);
+                int size = (int)lo_blob_datasize((lo_blob)argv[i]);
+                if (m) {
+                    // keep a copy, the buffer is written when the message is delivered
+                    t_scheduled_blob *b;
+                    m->blobs = realloc(m->blobs, (m->num_blobs + 1) * sizeof(t_scheduled_blob));
+                    b = &m->blobs[m->num_blobs++];
+                    b->atom = j;
+                    b->size = size > 0 ? size : 0;
+                    b->data = (unsigned char *)malloc(b->size ? b->size : 1);
+                    memcpy(b->data, data, b->size);
+                    size = 0;
+                }
+                else {
+                    size = blob_write(x, data, size, blob_offset);
+                    blob_offset += size;
+                }
+                maxpd_atom_set_int(x->buffer+j, size);
+                ++j;
+                break;
+            }
             case 't':
                 //output timetag from a second outlet?
                 break;
         }
     }
 
+    if (m) {
+        // hold the message until its timetag
+        m->deadline = deadline;
+        m->path = gensym((char *)path);
+        m->url = url;
+        m->outlet = outlet;
+        m->argc = j;
+        m->argv = j ? (t_atom *)malloc(j * sizeof(t_atom)) : NULL;
+        if (j)
+            memcpy(m->argv, x->buffer, j * sizeof(t_atom));
+        sched_push(x, m);
+        if (x->sched_heap[0] == m)
+            sched_arm(x, now);
+        return 0;
+    }
+
     outlet_anything(x->outlets[outlet], gensym((char *)path), j, x->buffer);
     return 0;
 }
@@ -659,6 +1681,13 @@ int generic_handler(const char *path, const char *types, lo_arg ** argv,
 int multicast_handler(const char *path, const char *types, lo_arg ** argv,
                       int argc, lo_message msg, void *user_data)
 {
+    t_oscmulticast *x = (t_oscmulticast *)user_data;
+
+    // drop unsubscribed paths before any atom conversion or symbol lookup
+    if (!filter_accepts(x, path)) {
+        x->filter_rejected++;
+        return 0;
+    }
     return generic_handler(path, types, argv, argc, msg, user_data, 0);
 }
 
@@ -722,6 +1751,24 @@ void maxpd_atom_set_string(t_atom *a, const char *string)
 #endif
 }
 
+t_symbol *maxpd_atom_get_symbol(t_atom *a)
+{
+#ifdef MAXMSP
+    return atom_getsym(a);
+#else
+    return atom_getsymbol(a);
+#endif
+}
+
+void maxpd_atom_set_symbol(t_atom *a, t_symbol *sym)
+{
+#ifdef MAXMSP
+    atom_setsym(a, sym);
+#else
+    SETSYMBOL(a, sym);
+#endif
+}
+
 void maxpd_atom_set_int(t_atom *a, int i)
 {
 #ifdef MAXMSP
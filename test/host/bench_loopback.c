@@ -0,0 +1,342 @@
+//
+// bench_loopback.c
+// throughput and latency of the mapper external, built for the host this file is
+// compiled for, over a libmapper network on this machine. For every combination of
+// signal count and vector length it creates two [mapper] objects with that many signals
+// of that length, maps them one to one and then, for every rate in the sweep, sends an
+// update to each source signal at that rate for the given duration. Each update carries
+// a sequence number in its first element, so the time it takes to come out of the
+// destination object is measured per update. Prints one CSV line per run:
+//
+//   host,signals,length,rate_hz,duration_s,sent,received,throughput_hz,
+//   p50_us,p99_us,p999_us,cpu_us_per_update,allocs_per_update,bytes_per_update
+//
+// rate_hz is per signal, 0 meaning as fast as possible, and throughput_hz counts the
+// updates received per second over all signals. CPU time and allocations cover the
+// whole process while sending and polling, i.e. both devices and the host, divided by
+// the updates sent. The host polls continuously between updates, so at a fixed rate
+// CPU time includes idle polling; rate 0 gives the cost of an update itself. The
+// columns are kept stable so that runs can be compared.
+//
+// usage: bench_loopback [-s signals,...] [-l lengths,...] [-r rates,...] [-d seconds]
+//
+
+#include "loopback.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef MAXMSP
+    #define HOST_NAME "max"
+#else
+    #define HOST_NAME "pd"
+#endif
+
+#define TIMEOUT_MS 10000
+#define DRAIN_MS 500
+#define MAX_LIST 32
+#define MAX_SIGNALS 1024
+#define RING_SIZE 65536             // sequence numbers in flight, exact as floats
+#define MAX_SAMPLES (1 << 22)
+
+// *********************************************************
+// -(allocation counting)-----------------------------------
+// the executable exports these, so the modules and libmapper call them too
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t num, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static int counting = 0;
+static unsigned long num_allocs = 0, num_bytes = 0;
+
+static void count(size_t size)
+{
+    if (counting) {
+        __atomic_fetch_add(&num_allocs, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&num_bytes, size, __ATOMIC_RELAXED);
+    }
+}
+
+void *malloc(size_t size)
+{
+    count(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size)
+{
+    count(num * size);
+    return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    count(size);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+    __libc_free(ptr);
+}
+
+// *********************************************************
+// -(measurement)-------------------------------------------
+
+typedef struct _run
+{
+    void *dst;
+    double sent_at[RING_SIZE];
+    unsigned long sent;
+    unsigned long received;
+    float *latencies;               // microseconds
+    unsigned long num_latencies;
+} t_run;
+
+static t_run run;
+
+static void received(void *obj, int outlet, t_symbol *msg, int argc, t_atom *argv, void *data)
+{
+    long seq;
+    if (obj != run.dst || outlet != 0 || argc < 1 || !host_is_number(argv))
+        return;
+    seq = (long)host_get_float(argv);
+    if (seq < 0 || seq >= RING_SIZE || run.sent_at[seq] < 0)
+        return;
+    run.received++;
+    if (run.num_latencies < MAX_SAMPLES)
+        run.latencies[run.num_latencies++] = (loopback_now_ms() - run.sent_at[seq]) * 1000.;
+    run.sent_at[seq] = -1;
+}
+
+static double cpu_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000. + ts.tv_nsec * 0.000001;
+}
+
+static int compare_floats(const void *a, const void *b)
+{
+    float fa = *(const float *)a, fb = *(const float *)b;
+    return fa < fb ? -1 : fa > fb;
+}
+
+static double percentile(double p)
+{
+    unsigned long i;
+    if (!run.num_latencies)
+        return 0;
+    i = (unsigned long)(p * (run.num_latencies - 1) + 0.5);
+    return run.latencies[i];
+}
+
+// *********************************************************
+// -(setup)-------------------------------------------------
+
+static void *new_mapper(const char *alias)
+{
+    t_atom args[2];
+    host_set_sym(args, "@alias");
+    host_set_sym(args + 1, alias);
+    return host_new("mapper", 2, args);
+}
+
+static void add_signal(void *x, const char *dir, const char *name, int length)
+{
+    t_atom args[6];
+    host_set_sym(args, dir);
+    host_set_sym(args + 1, name);
+    host_set_sym(args + 2, "@type");
+    host_set_sym(args + 3, "f");
+    host_set_sym(args + 4, "@length");
+    host_set_int(args + 5, length);
+    host_send(x, "add", 6, args);
+}
+
+static int num_joined;
+
+static int both_ready(void *data)
+{
+    return loopback_num_posts("Joining mapping network") >= num_joined;
+}
+
+static int all_received(void *data)
+{
+    return run.received >= run.sent;
+}
+
+static int parse_list(const char *arg, double *list)
+{
+    int n = 0;
+    char *end;
+    while (*arg && n < MAX_LIST) {
+        list[n] = strtod(arg, &end);
+        if (end == arg || list[n] < 0)
+            return 0;
+        n++;
+        arg = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',')
+            return 0;
+    }
+    return n;
+}
+
+// *********************************************************
+// -(runs)--------------------------------------------------
+
+static void measure(void *src, int num_signals, int length, double rate, double duration)
+{
+    char names[MAX_SIGNALS][16];
+    t_atom values[length];
+    double start, end, next, period = rate > 0 ? 1000. / rate : 0, cpu;
+    unsigned long allocs, bytes, updates;
+    int i;
+
+    for (i = 0; i < num_signals; i++)
+        snprintf(names[i], sizeof(names[i]), "/out%d", i);
+    for (i = 0; i < length; i++)
+        host_set_float(values + i, 0.5);
+    for (i = 0; i < RING_SIZE; i++)
+        run.sent_at[i] = -1;
+    run.sent = run.received = run.num_latencies = 0;
+
+    num_allocs = num_bytes = 0;
+    counting = 1;
+    cpu = cpu_ms();
+    start = next = loopback_now_ms();
+    end = start + duration * 1000.;
+    while (loopback_now_ms() < end) {
+        if (loopback_now_ms() >= next) {
+            for (i = 0; i < num_signals; i++) {
+                long seq = run.sent++ % RING_SIZE;
+                host_set_float(values, seq);
+                run.sent_at[seq] = loopback_now_ms();
+                host_send(src, names[i], length, values);
+            }
+            next += period;
+        }
+        host_advance(1);
+    }
+    counting = 0;
+    cpu = cpu_ms() - cpu;
+    allocs = num_allocs;
+    bytes = num_bytes;
+    end = loopback_now_ms();
+
+    // updates still in flight count as received but not towards the throughput
+    updates = run.received;
+    loopback_run(0, all_received, 0, DRAIN_MS);
+
+    qsort(run.latencies, run.num_latencies, sizeof(float), compare_floats);
+    printf("%s,%d,%d,%g,%g,%lu,%lu,%.1f,%.1f,%.1f,%.1f,%.3f,%.3f,%.1f\n",
+           HOST_NAME, num_signals, length, rate, duration, run.sent, run.received,
+           updates * 1000. / (end - start), percentile(0.5), percentile(0.99),
+           percentile(0.999), run.sent ? cpu * 1000. / run.sent : 0,
+           run.sent ? (double)allocs / run.sent : 0, run.sent ? (double)bytes / run.sent : 0);
+    fflush(stdout);
+}
+
+static int bench(mpr_graph graph, int num_signals, int length, double *rates, int num_rates,
+                 double duration)
+{
+    static int instance = 0;
+    char src_name[32], dst_name[32], out[16], in[16];
+    void *src, *dst;
+    int i;
+
+    // fresh device names, so that the graph cannot confuse them with earlier runs
+    instance++;
+    snprintf(src_name, sizeof(src_name), "benchsrc%d", instance);
+    snprintf(dst_name, sizeof(dst_name), "benchdst%d", instance);
+    src = new_mapper(src_name);
+    dst = new_mapper(dst_name);
+    if (!src || !dst) {
+        fprintf(stderr, "could not create [mapper]\n");
+        return 1;
+    }
+    for (i = 0; i < num_signals; i++) {
+        snprintf(out, sizeof(out), "/out%d", i);
+        snprintf(in, sizeof(in), "/in%d", i);
+        add_signal(src, "output", out, length);
+        add_signal(dst, "input", in, length);
+    }
+    num_joined += 2;
+    if (loopback_run(graph, both_ready, 0, TIMEOUT_MS)) {
+        fprintf(stderr, "devices did not join the network\n");
+        return 1;
+    }
+    for (i = 0; i < num_signals; i++) {
+        snprintf(out, sizeof(out), "/out%d", i);
+        snprintf(in, sizeof(in), "/in%d", i);
+        if (!loopback_map(graph, src_name, out, dst_name, in, TIMEOUT_MS)) {
+            fprintf(stderr, "could not map %s%s to %s%s\n", src_name, out, dst_name, in);
+            return 1;
+        }
+    }
+
+    run.dst = dst;
+    for (i = 0; i < num_rates; i++)
+        measure(src, num_signals, length, rates[i], duration);
+    run.dst = 0;
+
+    host_free(src);
+    host_free(dst);
+    host_advance(10);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    double signals[MAX_LIST] = {1, 8, 64}, lengths[MAX_LIST] = {1, 16};
+    double rates[MAX_LIST] = {100, 1000, 0}, duration = 2;
+    int num_signals = 3, num_lengths = 2, num_rates = 3, i, j, c, result = 0;
+    mpr_graph graph;
+
+    while ((c = getopt(argc, argv, "s:l:r:d:")) != -1) {
+        switch (c) {
+            case 's': num_signals = parse_list(optarg, signals); break;
+            case 'l': num_lengths = parse_list(optarg, lengths); break;
+            case 'r': num_rates = parse_list(optarg, rates); break;
+            case 'd': duration = atof(optarg); break;
+            default: num_signals = 0;
+        }
+        if (!num_signals || !num_lengths || !num_rates || duration <= 0)
+            break;
+    }
+    for (i = 0; i < num_signals; i++) {
+        if (signals[i] < 1 || signals[i] > MAX_SIGNALS)
+            num_signals = 0;
+    }
+    for (i = 0; i < num_lengths; i++) {
+        if (lengths[i] < 1)
+            num_lengths = 0;
+    }
+    if (!num_signals || !num_lengths || !num_rates || duration <= 0 || optind < argc) {
+        fprintf(stderr, "usage: %s [-s signals,...] [-l lengths,...] [-r rates,...] "
+                "[-d seconds]\n", argv[0]);
+        return 2;
+    }
+
+    if (host_load(MAPPER_MODULE))
+        return 1;
+    host_record(0);
+    run.latencies = (float *)malloc(MAX_SAMPLES * sizeof(float));
+    host_set_hook(received, 0);
+    graph = mpr_graph_new(MPR_OBJ);
+
+    printf("host,signals,length,rate_hz,duration_s,sent,received,throughput_hz,"
+           "p50_us,p99_us,p999_us,cpu_us_per_update,allocs_per_update,bytes_per_update\n");
+    for (i = 0; i < num_signals && !result; i++) {
+        for (j = 0; j < num_lengths && !result; j++)
+            result = bench(graph, (int)signals[i], (int)lengths[j], rates, num_rates, duration);
+    }
+
+    mpr_graph_free(graph);
+    free(run.latencies);
+    return result;
+}
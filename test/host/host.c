@@ -0,0 +1,296 @@
+//
+// host.c
+// the parts of the headless host that Max and Pd share: module loading, logical time
+// and clocks, the low priority queue, outlet records and the console
+//
+
+#include "host_internal.h"
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct _deferred
+{
+    void *obj;
+    t_host_deferred fn;
+    t_symbol *s;
+    int argc;
+    t_atom *argv;
+    struct _deferred *next;
+} t_deferred;
+
+static double now = 0;
+static unsigned long clock_seq = 0;
+static t_clock *clocks = 0;
+static t_deferred *deferred = 0, *deferred_last = 0;
+
+static int recording = 1;
+static t_host_record *records = 0;
+static int num_records = 0, max_records = 0;
+static t_host_hook *hook = 0;
+static void *hook_data = 0;
+
+static char **posts = 0;
+static int num_posts = 0, max_posts = 0;
+
+static int critical_depth = 0;
+static char search_dir[1024] = ".";
+
+// *********************************************************
+// -(externals)---------------------------------------------
+
+int host_load(const char *path)
+{
+    void *module = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!module) {
+        fprintf(stderr, "host: %s\n", dlerror());
+        return 1;
+    }
+    return host_setup(module, path);
+}
+
+// *********************************************************
+// -(time and clocks)---------------------------------------
+
+double host_time(void)
+{
+    return now;
+}
+
+t_clock *host_clock_new(void *owner, void (*fn)(void *owner))
+{
+    t_clock *c = (t_clock *)calloc(1, sizeof(t_clock));
+    c->owner = owner;
+    c->fn = fn;
+    c->next = clocks;
+    clocks = c;
+    return c;
+}
+
+void host_clock_set(t_clock *c, double delay)
+{
+    c->when = now + (delay > 0 ? delay : 0);
+    c->seq = clock_seq++;
+    c->set = 1;
+}
+
+void host_clock_unset(t_clock *c)
+{
+    c->set = 0;
+}
+
+void host_clock_free(t_clock *c)
+{
+    t_clock **p = &clocks;
+    while (*p && *p != c)
+        p = &(*p)->next;
+    if (*p)
+        *p = c->next;
+    free(c);
+}
+
+int host_num_clocks(void)
+{
+    int n = 0;
+    t_clock *c;
+    for (c = clocks; c; c = c->next)
+        n += c->set;
+    return n;
+}
+
+void host_defer(void *obj, t_host_deferred fn, t_symbol *s, int argc, t_atom *argv)
+{
+    t_deferred *d = (t_deferred *)calloc(1, sizeof(t_deferred));
+    d->obj = obj;
+    d->fn = fn;
+    d->s = s;
+    d->argc = argc;
+    if (argc) {
+        d->argv = (t_atom *)malloc(argc * sizeof(t_atom));
+        memcpy(d->argv, argv, argc * sizeof(t_atom));
+    }
+    if (deferred_last)
+        deferred_last->next = d;
+    else
+        deferred = d;
+    deferred_last = d;
+}
+
+static void run_deferred(void)
+{
+    while (deferred) {
+        t_deferred *d = deferred;
+        deferred = d->next;
+        if (!deferred)
+            deferred_last = 0;
+        d->fn(d->obj, d->s, (short)d->argc, d->argv);
+        free(d->argv);
+        free(d);
+    }
+}
+
+void host_advance(double ms)
+{
+    double until = now + ms;
+    run_deferred();
+    while (1) {
+        t_clock *c, *next = 0;
+        for (c = clocks; c; c = c->next) {
+            if (!c->set || c->when > until)
+                continue;
+            if (!next || c->when < next->when || (c->when == next->when && c->seq < next->seq))
+                next = c;
+        }
+        if (!next)
+            break;
+        if (next->when > now)
+            now = next->when;
+        next->set = 0;
+        next->fn(next->owner);
+        run_deferred();
+    }
+    now = until;
+}
+
+// *********************************************************
+// -(outlets)-----------------------------------------------
+
+void host_record(int on)
+{
+    recording = on;
+}
+
+void host_set_hook(t_host_hook *fn, void *data)
+{
+    hook = fn;
+    hook_data = data;
+}
+
+void host_emit(void *obj, int outlet, t_symbol *msg, int argc, t_atom *argv)
+{
+    if (hook)
+        hook(obj, outlet, msg, argc, argv, hook_data);
+    if (!recording)
+        return;
+    if (num_records == max_records) {
+        max_records = max_records ? max_records * 2 : 64;
+        records = (t_host_record *)realloc(records, max_records * sizeof(t_host_record));
+    }
+    t_host_record *r = records + num_records++;
+    r->obj = obj;
+    r->outlet = outlet;
+    r->msg = msg;
+    r->argc = argc;
+    r->argv = 0;
+    if (argc) {
+        r->argv = (t_atom *)malloc(argc * sizeof(t_atom));
+        memcpy(r->argv, argv, argc * sizeof(t_atom));
+    }
+    r->time = now;
+}
+
+int host_num_records(void)
+{
+    return num_records;
+}
+
+const t_host_record *host_get_record(int index)
+{
+    return index >= 0 && index < num_records ? records + index : 0;
+}
+
+void host_clear_records(void)
+{
+    int i;
+    for (i = 0; i < num_records; i++)
+        free(records[i].argv);
+    num_records = 0;
+}
+
+// *********************************************************
+// -(console)-----------------------------------------------
+
+void host_vpost(const char *prefix, const char *fmt, va_list ap)
+{
+    char line[1024];
+    int len = snprintf(line, sizeof(line), "%s", prefix ? prefix : "");
+    vsnprintf(line + len, sizeof(line) - len, fmt, ap);
+    if (getenv("HOST_VERBOSE"))
+        fprintf(stderr, "%s\n", line);
+    if (num_posts == max_posts) {
+        max_posts = max_posts ? max_posts * 2 : 64;
+        posts = (char **)realloc(posts, max_posts * sizeof(char *));
+    }
+    posts[num_posts++] = strdup(line);
+}
+
+int host_num_posts(void)
+{
+    return num_posts;
+}
+
+const char *host_get_post(int index)
+{
+    return index >= 0 && index < num_posts ? posts[index] : 0;
+}
+
+void host_clear_posts(void)
+{
+    int i;
+    for (i = 0; i < num_posts; i++)
+        free(posts[i]);
+    num_posts = 0;
+}
+
+// *********************************************************
+// -(files and critical regions)----------------------------
+
+void host_set_search_dir(const char *dir)
+{
+    snprintf(search_dir, sizeof(search_dir), "%s", dir);
+}
+
+const char *host_get_search_dir(void)
+{
+    return search_dir;
+}
+
+void host_search_path(const char *name, char *path, size_t size)
+{
+    if (name[0] == '/')
+        snprintf(path, size, "%s", name);
+    else
+        snprintf(path, size, "%s/%s", search_dir, name);
+}
+
+int host_critical_enter(void)
+{
+    return ++critical_depth;
+}
+
+int host_critical_exit(void)
+{
+    if (critical_depth <= 0) {
+        fprintf(stderr, "host: critical_exit() without critical_enter()\n");
+        return critical_depth = -1;
+    }
+    return --critical_depth;
+}
+
+int host_critical_depth(void)
+{
+    return critical_depth;
+}
+
+void host_reset(void)
+{
+    host_clear_records();
+    free(records);
+    records = 0;
+    max_records = 0;
+    host_clear_posts();
+    free(posts);
+    posts = 0;
+    max_posts = 0;
+}
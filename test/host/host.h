@@ -0,0 +1,138 @@
+//
+// host.h
+// a headless stand-in for Max and Pure Data, so that the externals in this repository
+// can be built unmodified and run in tests and benchmarks on Linux. The host loads an
+// external built as a module, creates its objects and sends them messages, drives
+// their clocks in logical time and records what they send to their outlets and post
+// to the console. Build with MAXMSP defined for the Max host (max_host.c and the
+// headers in max/) or PD for the Pd host (pd_host.c and mapper/m_pd.h).
+//
+
+#ifndef HOST_H
+#define HOST_H
+
+#ifdef MAXMSP
+    #include "ext.h"
+    #include "ext_obex.h"
+#else
+    #include "m_pd.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *********************************************************
+// -(externals and objects)---------------------------------
+
+// load an external module and run its setup function: ext_main() or main() for Max,
+// <name>_setup() for Pd. Returns 0 on success.
+int host_load(const char *path);
+
+// create an object by class name, as if typed into an object box; in Max it is
+// placed in the current patcher
+void *host_new(const char *name, int argc, t_atom *argv);
+void host_free(void *x);
+
+// send a message to the leftmost inlet; returns 0 if the object understood it
+int host_send(void *x, const char *msg, int argc, t_atom *argv);
+
+// *********************************************************
+// -(atoms)-------------------------------------------------
+// the same calls work in both hosts: Pd has no integer atoms, so there host_set_int()
+// makes a float atom
+
+void host_set_float(t_atom *a, double f);
+void host_set_int(t_atom *a, long i);
+void host_set_sym(t_atom *a, const char *s);
+double host_get_float(const t_atom *a);
+const char *host_get_sym(const t_atom *a);
+int host_is_number(const t_atom *a);
+
+// *********************************************************
+// -(time)--------------------------------------------------
+// clocks run in logical time, which only moves in host_advance(). The time functions
+// of the host APIs (systimer_gettime(), gettime(), sys_getrealtime()) report logical
+// time as well, so anything an external times is deterministic.
+
+double host_time(void);
+
+// run the low priority queue and every clock that falls due within the next 'ms'
+// milliseconds, in order of deadline and then of clock_delay() calls
+void host_advance(double ms);
+
+// number of clocks that are set
+int host_num_clocks(void);
+
+// *********************************************************
+// -(outlets)-----------------------------------------------
+
+typedef struct _host_record
+{
+    void *obj;
+    int outlet;             // index from the left
+    t_symbol *msg;          // "bang", "int", "float", "list" or the selector
+    int argc;
+    t_atom *argv;
+    double time;
+} t_host_record;
+
+// outlet traffic is recorded unless switched off, e.g. while benchmarking
+void host_record(int on);
+int host_num_records(void);
+const t_host_record *host_get_record(int index);
+void host_clear_records(void);
+
+// called for every outlet call whether or not it is recorded; the atoms are only
+// valid during the call
+typedef void t_host_hook(void *obj, int outlet, t_symbol *msg, int argc, t_atom *argv,
+                         void *data);
+void host_set_hook(t_host_hook *hook, void *data);
+
+// *********************************************************
+// -(console)-----------------------------------------------
+// post(), object_post(), object_error() and pd_error() lines, also printed to stderr
+// when HOST_VERBOSE is set in the environment
+
+int host_num_posts(void);
+const char *host_get_post(int index);
+void host_clear_posts(void);
+
+// *********************************************************
+// -(files and critical regions)----------------------------
+
+// directory in which files opened by name are looked up, by default the current one
+void host_set_search_dir(const char *dir);
+const char *host_get_search_dir(void);
+
+// critical_enter() calls not yet matched by critical_exit(), always 0 between messages
+int host_critical_depth(void);
+
+// *********************************************************
+// -(host specific)-----------------------------------------
+
+#ifdef MAXMSP
+// patchers: objects created with host_new() go into the current one, which an
+// object finds through its "#P" obex entry
+t_object *host_patcher_new(t_object *parent);
+void host_patcher_set(t_object *patcher);
+void host_patcher_free(t_object *patcher);
+
+// a buffer~ with the given name for buffer_ref_new() to find
+t_object *host_buffer_new(const char *name, long frames, long channels);
+
+// run the tasks installed with quittask_install(), as Max does when it quits
+void host_quit(void);
+#else
+// a table with the given name for pd_findbyclass(name, garray_class) to find
+t_garray *host_array_new(const char *name, int size);
+#endif
+
+// free everything the host recorded, before checking for leaks
+void host_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,45 @@
+//
+// host_internal.h
+// what host.c shares with max_host.c and pd_host.c
+//
+
+#ifndef HOST_INTERNAL_H
+#define HOST_INTERNAL_H
+
+#include "host.h"
+#include <stdarg.h>
+
+struct _clock
+{
+    void *owner;
+    void (*fn)(void *owner);
+    double when;
+    unsigned long seq;
+    int set;
+    struct _clock *next;
+};
+
+t_clock *host_clock_new(void *owner, void (*fn)(void *owner));
+void host_clock_set(t_clock *c, double delay);
+void host_clock_unset(t_clock *c);
+void host_clock_free(t_clock *c);
+
+// Max's defer_low(), run by host_advance()
+typedef void (*t_host_deferred)(void *obj, t_symbol *s, short argc, t_atom *argv);
+void host_defer(void *obj, t_host_deferred fn, t_symbol *s, int argc, t_atom *argv);
+
+// record an outlet call and pass it to the hook
+void host_emit(void *obj, int outlet, t_symbol *msg, int argc, t_atom *argv);
+
+void host_vpost(const char *prefix, const char *fmt, va_list ap);
+
+int host_critical_enter(void);
+int host_critical_exit(void);
+
+// run the setup function of a module loaded from 'path'
+int host_setup(void *module, const char *path);
+
+// path of 'name' in the search directory, or 'name' itself if it is absolute
+void host_search_path(const char *name, char *path, size_t size);
+
+#endif
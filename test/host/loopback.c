@@ -0,0 +1,92 @@
+//
+// loopback.c
+//
+
+#include "loopback.h"
+#include <string.h>
+#include <time.h>
+
+double loopback_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000. + ts.tv_nsec * 0.000001;
+}
+
+static mpr_dev device = 0;
+
+void loopback_set_device(mpr_dev dev)
+{
+    device = dev;
+}
+
+int loopback_run(mpr_graph graph, int (*done)(void *data), void *data, double timeout_ms)
+{
+    double deadline = loopback_now_ms() + timeout_ms;
+    while (!done(data)) {
+        if (loopback_now_ms() > deadline)
+            return 1;
+        host_advance(1);
+        if (graph)
+            mpr_graph_poll(graph, 1);
+        if (device)
+            mpr_dev_poll(device, 0);
+    }
+    return 0;
+}
+
+int loopback_num_posts(const char *text)
+{
+    int i, n = 0;
+    for (i = 0; i < host_num_posts(); i++)
+        n += strstr(host_get_post(i), text) != 0;
+    return n;
+}
+
+mpr_sig loopback_find_sig(mpr_graph graph, const char *device, const char *name)
+{
+    size_t len = strlen(device);
+    mpr_sig found = 0;
+    mpr_list sigs = mpr_graph_get_list(graph, MPR_SIG);
+    sigs = mpr_list_filter(sigs, MPR_PROP_NAME, NULL, 1, MPR_STR, name, MPR_OP_EQ);
+    while (sigs) {
+        const char *dev_name = mpr_obj_get_prop_as_str(mpr_sig_get_dev(*sigs), MPR_PROP_NAME, NULL);
+        if (dev_name && strncmp(dev_name, device, len) == 0 && dev_name[len] == '.') {
+            found = *sigs;
+            mpr_list_free(sigs);
+            break;
+        }
+        sigs = mpr_list_get_next(sigs);
+    }
+    return found;
+}
+
+typedef struct _map_wait
+{
+    mpr_graph graph;
+    const char *names[4];
+    mpr_map map;
+} t_map_wait;
+
+static int map_ready(void *data)
+{
+    t_map_wait *w = (t_map_wait *)data;
+    if (!w->map) {
+        mpr_sig src = loopback_find_sig(w->graph, w->names[0], w->names[1]);
+        mpr_sig dst = loopback_find_sig(w->graph, w->names[2], w->names[3]);
+        if (!src || !dst)
+            return 0;
+        w->map = mpr_map_new(1, &src, 1, &dst);
+        mpr_obj_push(w->map);
+    }
+    return mpr_map_get_is_ready(w->map);
+}
+
+mpr_map loopback_map(mpr_graph graph, const char *src_device, const char *src_name,
+                     const char *dst_device, const char *dst_name, double timeout_ms)
+{
+    t_map_wait w = {graph, {src_device, src_name, dst_device, dst_name}, 0};
+    if (loopback_run(graph, map_ready, &w, timeout_ms))
+        return 0;
+    return w.map;
+}
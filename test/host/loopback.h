@@ -0,0 +1,45 @@
+//
+// loopback.h
+// helpers for tests and benchmarks that connect externals running in the host over a
+// libmapper network on this machine: run the host and a libmapper graph until
+// something happens, find signals by device and name and map them
+//
+
+#ifndef LOOPBACK_H
+#define LOOPBACK_H
+
+#include "host.h"
+#include <mapper/mapper.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// monotonic real time in milliseconds
+double loopback_now_ms(void);
+
+// a device created by the test itself, polled along with the graph from then on so that
+// the test can send updates, instance releases or bursts in between host polls; 0 for none
+void loopback_set_device(mpr_dev dev);
+
+// advance the host by a millisecond at a time, polling the graph and the test's device if
+// there are any, until done(data) returns nonzero or 'timeout_ms' of real time has passed;
+// returns 0 if done
+int loopback_run(mpr_graph graph, int (*done)(void *data), void *data, double timeout_ms);
+
+// number of console lines containing 'text'
+int loopback_num_posts(const char *text);
+
+// the signal 'name' of the device called 'device' (without its ordinal) or 0
+mpr_sig loopback_find_sig(mpr_graph graph, const char *device, const char *name);
+
+// map one signal to another once the graph knows both, and wait until the map is ready;
+// returns 0 on timeout
+mpr_map loopback_map(mpr_graph graph, const char *src_device, const char *src_name,
+                     const char *dst_device, const char *dst_name, double timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,195 @@
+//
+// ext.h
+// the part of the Max SDK used by the externals in this repository, implemented by
+// max_host.c so that they can be built and run headless on Linux. Names, types and
+// signatures follow the Max SDK; nothing here talks to a real Max.
+//
+
+#ifndef HOST_MAX_EXT_H
+#define HOST_MAX_EXT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define C74_CONST const
+#define C74_EXPORT __attribute__((visibility("default")))
+
+typedef long long t_atom_long;
+typedef double t_atom_float;
+typedef intptr_t t_ptr_int;
+typedef uintptr_t t_ptr_uint;
+typedef long t_max_err;
+typedef unsigned int t_fourcc;
+typedef void *(*method)(void *, ...);
+
+enum {
+    MAX_ERR_NONE = 0,
+    MAX_ERR_GENERIC = -1,
+    MAX_ERR_INVALID_PTR = -2,
+    MAX_ERR_OUT_OF_MEM = -4
+};
+
+struct object;
+typedef struct object t_object;
+
+typedef struct symbol
+{
+    char *s_name;
+    t_object *s_thing;
+} t_symbol;
+
+// the fields of the Max SDK, of which externals only read o_outlet (the leftmost
+// outlet); what the host keeps about an object lives behind o_host
+struct object
+{
+    struct maxclass *o_messlist;
+    t_ptr_int o_magic;
+    void *o_inlet;
+    void *o_outlet;
+    void *o_host;
+};
+
+typedef union word
+{
+    t_atom_long w_long;
+    t_atom_float w_float;
+    t_symbol *w_sym;
+    t_object *w_obj;
+} t_word;
+
+typedef struct atom
+{
+    short a_type;
+    union word a_w;
+} t_atom;
+
+typedef enum {
+    A_NOTHING = 0,
+    A_LONG,
+    A_FLOAT,
+    A_SYM,
+    A_OBJ,
+    A_DEFLONG,
+    A_DEFFLOAT,
+    A_DEFSYM,
+    A_GIMME,
+    A_CANT,
+    A_SEMI,
+    A_COMMA,
+    A_DOLLAR,
+    A_DOLLSYM,
+    A_GIMMEBACK,
+    A_DEFER = 0x41,
+    A_USURP = 0x42,
+    A_DEFER_LOW = 0x43,
+    A_USURP_LOW = 0x44
+} e_max_atomtypes;
+
+typedef struct maxclass t_class;
+typedef struct _clock t_clock;
+typedef void *t_qelem;
+
+#define CLASS_BOX gensym("box")
+#define CLASS_NOBOX gensym("nobox")
+
+#define OBJ_FLAG_OBJ 0
+#define OBJ_FLAG_REF 1
+#define OBJ_FLAG_DATA 2
+#define OBJ_FLAG_MEMORY 4
+#define OBJ_FLAG_SILENT 8
+
+#define ASSIST_INLET 1
+#define ASSIST_OUTLET 2
+
+#define MAX_PATH_CHARS 2048
+#define MAX_FILENAME_CHARS 512
+
+#define PATH_STYLE_MAX 0
+#define PATH_STYLE_NATIVE 1
+#define PATH_STYLE_COLON 2
+#define PATH_STYLE_SLASH 3
+#define PATH_TYPE_IGNORE 0
+#define PATH_TYPE_ABSOLUTE 1
+#define PATH_TYPE_RELATIVE 2
+#define PATH_TYPE_BOOT 3
+#define PATH_TYPE_C74 4
+
+#define calcoffset(x, y) ((long)(&(((x *)0L)->y)))
+
+// symbols, console
+t_symbol *gensym(C74_CONST char *s);
+void post(C74_CONST char *fmt, ...);
+void object_post(t_object *x, C74_CONST char *s, ...);
+void object_warn(t_object *x, C74_CONST char *s, ...);
+void object_error(t_object *x, C74_CONST char *s, ...);
+
+// classes and objects
+t_class *class_new(C74_CONST char *name, C74_CONST method mnew, C74_CONST method mfree,
+                   long size, C74_CONST method mmenu, short type, ...);
+t_max_err class_addmethod(t_class *c, C74_CONST method m, C74_CONST char *name, ...);
+t_max_err class_register(t_symbol *name_space, t_class *c);
+void *object_alloc(t_class *c);
+t_max_err object_free(void *x);
+void freeobject(t_object *op);
+
+// outlets
+void *outlet_new(void *x, C74_CONST char *s);
+void *bangout(void *x);
+void *intout(void *x);
+void *floatout(void *x);
+void *listout(void *x);
+void *outlet_bang(void *o);
+void *outlet_int(void *o, t_atom_long n);
+void *outlet_float(void *o, double f);
+void *outlet_list(void *o, t_symbol *s, short ac, t_atom *av);
+void *outlet_anything(void *o, t_symbol *s, short ac, t_atom *av);
+
+// clocks and the low priority queue
+void *clock_new(void *obj, method fn);
+void clock_delay(void *x, long n);
+void clock_fdelay(void *c, double time);
+void clock_unset(void *x);
+void clock_free(void *x);
+void clock_getftime(double *time);
+long gettime(void);
+void defer(void *ob, method fn, t_symbol *sym, short argc, t_atom *argv);
+void defer_low(void *ob, method fn, t_symbol *sym, short argc, t_atom *argv);
+
+// tasks run with their argument when the application quits, see host_quit()
+void quittask_install(method m, void *a);
+
+// atoms
+t_max_err atom_setlong(t_atom *a, t_atom_long b);
+t_max_err atom_setfloat(t_atom *a, double b);
+t_max_err atom_setsym(t_atom *a, C74_CONST t_symbol *b);
+t_max_err atom_setobj(t_atom *a, void *b);
+t_atom_long atom_getlong(C74_CONST t_atom *a);
+t_atom_float atom_getfloat(C74_CONST t_atom *a);
+t_symbol *atom_getsym(C74_CONST t_atom *a);
+void *atom_getobj(C74_CONST t_atom *a);
+t_max_err atom_alloc(long *ac, t_atom **av, char *alloc);
+t_max_err atom_alloc_array(long minsize, long *ac, t_atom **av, char *alloc);
+
+// memory
+void *sysmem_newptr(long size);
+void *sysmem_newptrclear(long size);
+void *sysmem_resizeptr(void *ptr, long newsize);
+void sysmem_freeptr(void *ptr);
+
+// files, searched for in the host's search directory
+short locatefile_extended(char *name, short *outvol, t_fourcc *outtype,
+                          C74_CONST t_fourcc *filetypelist, short numtypes);
+short path_toabsolutesystempath(C74_CONST short in_path, C74_CONST char *in_filename,
+                                char *out_filepath);
+short path_nameconform(C74_CONST char *src, char *dst, long style, long type);
+short path_getdefault(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,36 @@
+//
+// ext_buffer.h
+// references to named buffer~ objects; the host keeps the buffers, created with
+// host_buffer_new(), and hands out their samples
+//
+
+#ifndef HOST_MAX_EXT_BUFFER_H
+#define HOST_MAX_EXT_BUFFER_H
+
+#include "ext_obex.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _buffer_ref t_buffer_ref;
+typedef t_object t_buffer_obj;
+
+t_buffer_ref *buffer_ref_new(t_object *self, t_symbol *name);
+void buffer_ref_set(t_buffer_ref *x, t_symbol *name);
+t_atom_long buffer_ref_exists(t_buffer_ref *x);
+t_buffer_obj *buffer_ref_getobject(t_buffer_ref *x);
+t_max_err buffer_ref_notify(t_buffer_ref *x, t_symbol *s, t_symbol *msg, void *sender, void *data);
+
+float *buffer_locksamples(t_buffer_obj *buffer_object);
+void buffer_unlocksamples(t_buffer_obj *buffer_object);
+t_atom_long buffer_getchannelcount(t_buffer_obj *buffer_object);
+t_atom_long buffer_getframecount(t_buffer_obj *buffer_object);
+t_atom_float buffer_getsamplerate(t_buffer_obj *buffer_object);
+t_max_err buffer_setdirty(t_buffer_obj *buffer_object);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
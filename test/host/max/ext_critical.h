@@ -0,0 +1,27 @@
+//
+// ext_critical.h
+// critical regions; the host runs everything on one thread and only checks that every
+// critical_enter() is matched by a critical_exit()
+//
+
+#ifndef HOST_MAX_EXT_CRITICAL_H
+#define HOST_MAX_EXT_CRITICAL_H
+
+#include "ext.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void *t_critical;
+
+void critical_new(t_critical *x);
+void critical_enter(t_critical x);
+void critical_exit(t_critical x);
+void critical_free(t_critical x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,13 @@
+//
+// ext_dictionary.h
+// dictionaries; no external in this repository uses them beyond the include
+//
+
+#ifndef HOST_MAX_EXT_DICTIONARY_H
+#define HOST_MAX_EXT_DICTIONARY_H
+
+#include "ext_obex.h"
+
+typedef struct _dictionary t_dictionary;
+
+#endif
@@ -0,0 +1,113 @@
+//
+// ext_obex.h
+// object extensions: obex storage, messages by name, notifications between attached
+// objects, attributes, hashtabs and atomarrays, as far as the externals use them
+//
+
+#ifndef HOST_MAX_EXT_OBEX_H
+#define HOST_MAX_EXT_OBEX_H
+
+#include "ext.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _hashtab t_hashtab;
+typedef struct _atomarray t_atomarray;
+
+typedef struct _hashtab_entry
+{
+    t_object ob;
+    t_symbol *key;
+    t_object *value;
+    long flags;
+    t_hashtab *parent;
+} t_hashtab_entry;
+
+#define ATTR_FLAGS_NONE 0
+#define ATTR_GET_OPAQUE 0x00000001
+#define ATTR_SET_OPAQUE 0x00000002
+#define ATTR_GET_OPAQUE_USER 0x00000100
+#define ATTR_SET_OPAQUE_USER 0x00000200
+
+// obex
+t_max_err object_obex_lookup(void *x, t_symbol *key, t_object **val);
+t_max_err object_obex_store(void *x, t_symbol *key, t_object *val);
+
+// messages by name; arguments are passed on as they are, like A_CANT methods expect
+void *object_method(void *x, t_symbol *s, ...);
+method object_getmethod(void *x, t_symbol *s);
+t_symbol *object_classname(void *x);
+#define object_method_direct(rt, sig, x, s, ...) \
+    ((rt (*)sig)object_getmethod((x), (s)))((t_object *)(x), __VA_ARGS__)
+
+// registration and notification
+void *object_register(t_symbol *name_space, t_symbol *s, void *x);
+t_max_err object_unregister(void *x);
+t_symbol *symbol_unique(void);
+void *object_attach_byptr(void *x, void *registeredobject);
+void *object_attach_byptr_register(void *x, void *object_to_attach, t_symbol *reg_name_space);
+t_max_err object_detach_byptr(void *x, void *registeredobject);
+t_max_err object_notify(void *x, t_symbol *s, void *data);
+
+// attributes, stored at an offset in the object unless an accessor is set
+t_object *attr_offset_new(C74_CONST char *name, C74_CONST t_symbol *type, long flags,
+                          C74_CONST method mget, C74_CONST method mset, long offset);
+t_max_err class_addattr(t_class *c, t_object *attr);
+t_max_err class_attr_setaccessors(t_class *c, C74_CONST char *name, method mget, method mset);
+t_symbol *object_attr_getsym(void *x, t_symbol *s);
+t_atom_long object_attr_getlong(void *x, t_symbol *s);
+t_atom_float object_attr_getfloat(void *x, t_symbol *s);
+char object_attr_getchar(void *x, t_symbol *s);
+t_max_err object_attr_setvalueof(void *x, t_symbol *s, long argc, t_atom *argv);
+t_max_err object_attr_getvalueof(void *x, t_symbol *s, long *argc, t_atom **argv);
+
+#define CLASS_ATTR_CHAR(c, attrname, flags, structname, structmember) \
+    class_addattr((c), attr_offset_new((attrname), gensym("char"), (flags), \
+                  (method)0L, (method)0L, calcoffset(structname, structmember)))
+#define CLASS_ATTR_LONG(c, attrname, flags, structname, structmember) \
+    class_addattr((c), attr_offset_new((attrname), gensym("long"), (flags), \
+                  (method)0L, (method)0L, calcoffset(structname, structmember)))
+#define CLASS_ATTR_ATOM_LONG(c, attrname, flags, structname, structmember) \
+    class_addattr((c), attr_offset_new((attrname), gensym("atom_long"), (flags), \
+                  (method)0L, (method)0L, calcoffset(structname, structmember)))
+#define CLASS_ATTR_FLOAT(c, attrname, flags, structname, structmember) \
+    class_addattr((c), attr_offset_new((attrname), gensym("float32"), (flags), \
+                  (method)0L, (method)0L, calcoffset(structname, structmember)))
+#define CLASS_ATTR_SYM(c, attrname, flags, structname, structmember) \
+    class_addattr((c), attr_offset_new((attrname), gensym("symbol"), (flags), \
+                  (method)0L, (method)0L, calcoffset(structname, structmember)))
+#define CLASS_ATTR_OBJ(c, attrname, flags, structname, structmember) \
+    class_addattr((c), attr_offset_new((attrname), gensym("object"), (flags), \
+                  (method)0L, (method)0L, calcoffset(structname, structmember)))
+#define CLASS_ATTR_ACCESSORS(c, attrname, getter, setter) \
+    class_attr_setaccessors((c), (attrname), (method)(getter), (method)(setter))
+#define CLASS_ATTR_STYLE_LABEL(c, attrname, flags, stylestr, labelstr) ((void)0)
+#define CLASS_ATTR_LABEL(c, attrname, flags, labelstr) ((void)0)
+
+// hashtabs, keyed by symbol; storing and removing notifies attached objects
+t_hashtab *hashtab_new(long slotcount);
+t_max_err hashtab_store(t_hashtab *x, t_symbol *key, t_object *val);
+t_max_err hashtab_storeflags(t_hashtab *x, t_symbol *key, t_object *val, long flags);
+t_max_err hashtab_lookup(t_hashtab *x, t_symbol *key, t_object **val);
+t_max_err hashtab_chuckkey(t_hashtab *x, t_symbol *key);
+t_max_err hashtab_delete(t_hashtab *x, t_symbol *key);
+t_max_err hashtab_clear(t_hashtab *x);
+t_max_err hashtab_chuck(t_hashtab *x);
+t_max_err hashtab_funall(t_hashtab *x, method fun, void *arg);
+t_max_err hashtab_methodall(t_hashtab *x, t_symbol *s, ...);
+t_atom_long hashtab_getsize(t_hashtab *x);
+
+// atomarrays
+t_atomarray *atomarray_new(long ac, t_atom *av);
+t_max_err atomarray_getatoms(t_atomarray *x, long *ac, t_atom **av);
+t_max_err atomarray_setatoms(t_atomarray *x, long ac, t_atom *av);
+void atomarray_appendatoms(t_atomarray *x, long ac, t_atom *av);
+t_atom_long atomarray_getsize(t_atomarray *x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,11 @@
+//
+// ext_proto.h
+// prototypes of the Max kernel functions; in this host they are all in ext.h
+//
+
+#ifndef HOST_MAX_EXT_PROTO_H
+#define HOST_MAX_EXT_PROTO_H
+
+#include "ext.h"
+
+#endif
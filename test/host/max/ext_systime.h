@@ -0,0 +1,25 @@
+//
+// ext_systime.h
+// system time; in this host it is the logical time that drives the clocks, so that
+// everything timed by an external is deterministic
+//
+
+#ifndef HOST_MAX_EXT_SYSTIME_H
+#define HOST_MAX_EXT_SYSTIME_H
+
+#include "ext.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef unsigned long long t_uint64;
+
+t_uint64 systime_ms(void);
+double systimer_gettime(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
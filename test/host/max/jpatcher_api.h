@@ -0,0 +1,30 @@
+//
+// jpatcher_api.h
+// patchers; the host creates them with host_patcher_new() and answers "iterate" and
+// "getassoc" on them
+//
+
+#ifndef HOST_MAX_JPATCHER_API_H
+#define HOST_MAX_JPATCHER_API_H
+
+#include "ext_obex.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// flags for the "iterate" message
+#define PI_WANTBOX 1
+#define PI_DEEP 2
+#define PI_REQUIREFIRST 4
+#define PI_SPANKIDS 8
+
+t_object *jpatcher_get_parentpatcher(t_object *p);
+t_object *jpatcher_get_toppatcher(t_object *p);
+t_symbol *jpatcher_get_name(t_object *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1434 @@
+//
+// max_host.c
+// the Max kernel functions declared in this directory's headers: classes and message
+// dispatch, outlets, obex, notifications, attributes, hashtabs, atomarrays, patchers
+// and buffers, enough to run the externals in this repository without Max
+//
+
+#include "host_internal.h"
+#include "ext_critical.h"
+#include "ext_systime.h"
+#include "ext_buffer.h"
+#include "jpatcher_api.h"
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_ARGS 8
+#define MAX_CANT_ARGS 4
+#define SYMBOL_BUCKETS 1024
+
+typedef void *(*t_fn_none)(void *x);
+typedef void *(*t_fn_long)(void *x, t_atom_long n);
+typedef void *(*t_fn_float)(void *x, double f);
+typedef void *(*t_fn_sym)(void *x, t_symbol *s);
+typedef void *(*t_fn_gimme)(void *x, t_symbol *s, long argc, t_atom *argv);
+typedef void *(*t_fn_new)(t_symbol *s, long argc, t_atom *argv);
+typedef void *(*t_fn_args)(void *x, void *a, void *b, void *c, void *d);
+typedef long (*t_fn_iterate)(void *arg, t_object *obj);
+typedef void (*t_fn_entry)(t_hashtab_entry *e, void *arg);
+typedef t_max_err (*t_fn_attr_get)(void *x, t_object *attr, long *argc, t_atom **argv);
+typedef t_max_err (*t_fn_attr_set)(void *x, t_object *attr, long argc, t_atom *argv);
+
+typedef struct _max_method
+{
+    t_symbol *name;
+    method fn;
+    short args[MAX_ARGS];
+    int num_args;
+} t_max_method;
+
+typedef struct _attr
+{
+    t_object ob;
+    t_symbol *name;
+    t_symbol *type;
+    long flags;
+    method get;
+    method set;
+    long offset;
+} t_attr;
+
+struct maxclass
+{
+    t_symbol *name;
+    method mnew;
+    method mfree;
+    long size;
+    short args[MAX_ARGS];
+    int num_args;
+    t_max_method *methods;
+    int num_methods;
+    t_attr **attrs;
+    int num_attrs;
+    struct maxclass *next;
+};
+
+typedef struct _link
+{
+    t_object *obj;
+    struct _link *next;
+} t_link;
+
+typedef struct _obex_entry
+{
+    t_symbol *key;
+    t_object *value;
+    struct _obex_entry *next;
+} t_obex_entry;
+
+typedef struct _outlet
+{
+    t_object *owner;
+    int created;
+    struct _outlet *next;
+} t_outlet;
+
+// what the host keeps about every object, behind o_host
+typedef struct _hostobj
+{
+    t_object *patcher;
+    t_obex_entry *obex;
+    t_link *clients;        // objects attached to this one
+    t_link *servers;        // objects this one is attached to
+    t_symbol *registered;
+    t_outlet *outlets;
+    int num_outlets;
+} t_hostobj;
+
+typedef struct _patcher
+{
+    t_object ob;
+    t_object *parent;
+    t_link *boxes;
+    t_link *children;
+} t_patcher;
+
+struct _hashtab
+{
+    t_object ob;
+    t_hashtab_entry **entries;
+    long num;
+    long max;
+    int keep_values;
+};
+
+struct _atomarray
+{
+    t_object ob;
+    long ac;
+    t_atom *av;
+};
+
+typedef struct _buffer
+{
+    t_object ob;
+    t_symbol *name;
+    long frames;
+    long channels;
+    float *samples;
+    struct _buffer *next;
+} t_buffer;
+
+struct _buffer_ref
+{
+    t_object ob;
+    t_symbol *name;
+};
+
+static t_class *classes = 0;
+static t_class *patcher_class = 0, *hashtab_class = 0, *atomarray_class = 0;
+static t_class *buffer_class = 0, *buffer_ref_class = 0;
+static t_patcher *current_patcher = 0;
+static t_buffer *buffers = 0;
+static char **paths = 0;
+static int num_paths = 0;
+
+static void init_classes(void);
+
+#define HOSTOBJ(x) ((t_hostobj *)((t_object *)(x))->o_host)
+
+// *********************************************************
+// -(symbols and console)-----------------------------------
+
+t_symbol *gensym(C74_CONST char *s)
+{
+    typedef struct _entry { t_symbol sym; struct _entry *next; } t_entry;
+    static t_entry *table[SYMBOL_BUCKETS];
+    unsigned long hash = 5381;
+    const char *c;
+    t_entry *e;
+    for (c = s; *c; c++)
+        hash = hash * 33 + (unsigned char)*c;
+    for (e = table[hash % SYMBOL_BUCKETS]; e; e = e->next) {
+        if (strcmp(e->sym.s_name, s) == 0)
+            return &e->sym;
+    }
+    e = (t_entry *)calloc(1, sizeof(t_entry));
+    e->sym.s_name = strdup(s);
+    e->next = table[hash % SYMBOL_BUCKETS];
+    table[hash % SYMBOL_BUCKETS] = e;
+    return &e->sym;
+}
+
+t_symbol *symbol_unique(void)
+{
+    static long count = 0;
+    char name[32];
+    snprintf(name, sizeof(name), "u%09ld", ++count);
+    return gensym(name);
+}
+
+void post(C74_CONST char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    host_vpost(0, fmt, ap);
+    va_end(ap);
+}
+
+static void object_vpost(t_object *x, const char *kind, const char *fmt, va_list ap)
+{
+    char prefix[256];
+    snprintf(prefix, sizeof(prefix), "%s: %s", x && x->o_messlist ? x->o_messlist->name->s_name : "",
+             kind);
+    host_vpost(prefix, fmt, ap);
+}
+
+void object_post(t_object *x, C74_CONST char *s, ...)
+{
+    va_list ap;
+    va_start(ap, s);
+    object_vpost(x, "", s, ap);
+    va_end(ap);
+}
+
+void object_warn(t_object *x, C74_CONST char *s, ...)
+{
+    va_list ap;
+    va_start(ap, s);
+    object_vpost(x, "warning: ", s, ap);
+    va_end(ap);
+}
+
+void object_error(t_object *x, C74_CONST char *s, ...)
+{
+    va_list ap;
+    va_start(ap, s);
+    object_vpost(x, "error: ", s, ap);
+    va_end(ap);
+}
+
+// *********************************************************
+// -(classes and objects)-----------------------------------
+
+static int read_arg_types(short *types, va_list ap)
+{
+    int n = 0, type;
+    while (n < MAX_ARGS && (type = va_arg(ap, int)) != A_NOTHING)
+        types[n++] = (short)type;
+    return n;
+}
+
+t_class *class_new(C74_CONST char *name, C74_CONST method mnew, C74_CONST method mfree,
+                   long size, C74_CONST method mmenu, short type, ...)
+{
+    t_class *c = (t_class *)calloc(1, sizeof(t_class));
+    va_list ap;
+    c->name = gensym(name);
+    c->mnew = mnew;
+    c->mfree = mfree;
+    c->size = size < (long)sizeof(t_object) ? (long)sizeof(t_object) : size;
+    if (type != A_NOTHING) {
+        c->args[c->num_args++] = type;
+        va_start(ap, type);
+        c->num_args += read_arg_types(c->args + 1, ap);
+        va_end(ap);
+    }
+    return c;
+}
+
+t_max_err class_addmethod(t_class *c, C74_CONST method m, C74_CONST char *name, ...)
+{
+    t_max_method *mm;
+    va_list ap;
+    c->methods = (t_max_method *)realloc(c->methods, (c->num_methods + 1) * sizeof(t_max_method));
+    mm = c->methods + c->num_methods++;
+    memset(mm, 0, sizeof(t_max_method));
+    mm->name = gensym(name);
+    mm->fn = m;
+    va_start(ap, name);
+    mm->num_args = read_arg_types(mm->args, ap);
+    va_end(ap);
+    return MAX_ERR_NONE;
+}
+
+t_max_err class_register(t_symbol *name_space, t_class *c)
+{
+    c->next = classes;
+    classes = c;
+    return MAX_ERR_NONE;
+}
+
+static t_max_method *find_method(t_class *c, t_symbol *s)
+{
+    int i;
+    for (i = 0; c && i < c->num_methods; i++) {
+        if (c->methods[i].name == s)
+            return c->methods + i;
+    }
+    return 0;
+}
+
+void *object_alloc(t_class *c)
+{
+    t_object *x = (t_object *)calloc(1, c->size);
+    t_hostobj *h = (t_hostobj *)calloc(1, sizeof(t_hostobj));
+    x->o_messlist = c;
+    h->patcher = (t_object *)current_patcher;
+    x->o_host = h;
+    return x;
+}
+
+static void unlink_obj(t_link **list, t_object *obj)
+{
+    while (*list) {
+        if ((*list)->obj == obj) {
+            t_link *l = *list;
+            *list = l->next;
+            free(l);
+            return;
+        }
+        list = &(*list)->next;
+    }
+}
+
+static void add_link(t_link **list, t_object *obj)
+{
+    t_link *l = (t_link *)calloc(1, sizeof(t_link));
+    l->obj = obj;
+    l->next = *list;
+    *list = l;
+}
+
+t_max_err object_free(void *x)
+{
+    t_object *o = (t_object *)x;
+    t_hostobj *h;
+    if (!o)
+        return MAX_ERR_INVALID_PTR;
+    h = HOSTOBJ(o);
+
+    object_notify(o, gensym("free"), 0);
+    if (o->o_messlist->mfree)
+        ((t_fn_none)o->o_messlist->mfree)(o);
+
+    while (h->servers) {
+        unlink_obj(&HOSTOBJ(h->servers->obj)->clients, o);
+        unlink_obj(&h->servers, h->servers->obj);
+    }
+    while (h->clients) {
+        unlink_obj(&HOSTOBJ(h->clients->obj)->servers, o);
+        unlink_obj(&h->clients, h->clients->obj);
+    }
+    if (h->patcher)
+        unlink_obj(&((t_patcher *)h->patcher)->boxes, o);
+    while (h->obex) {
+        t_obex_entry *e = h->obex;
+        h->obex = e->next;
+        if (e->value)
+            object_free(e->value);
+        free(e);
+    }
+    while (h->outlets) {
+        t_outlet *out = h->outlets;
+        h->outlets = out->next;
+        free(out);
+    }
+    free(h);
+    free(o);
+    return MAX_ERR_NONE;
+}
+
+void freeobject(t_object *op)
+{
+    object_free(op);
+}
+
+t_symbol *object_classname(void *x)
+{
+    return x ? ((t_object *)x)->o_messlist->name : 0;
+}
+
+method object_getmethod(void *x, t_symbol *s)
+{
+    t_max_method *m = x ? find_method(((t_object *)x)->o_messlist, s) : 0;
+    return m ? m->fn : 0;
+}
+
+void *object_method(void *x, t_symbol *s, ...)
+{
+    method fn = object_getmethod(x, s);
+    void *a[MAX_CANT_ARGS];
+    va_list ap;
+    int i;
+    if (!fn)
+        return 0;
+    // pass on as many pointer-sized arguments as any A_CANT method used here takes,
+    // all of which the caller passes in registers
+    va_start(ap, s);
+    for (i = 0; i < MAX_CANT_ARGS; i++)
+        a[i] = va_arg(ap, void *);
+    va_end(ap);
+    return ((t_fn_args)fn)(x, a[0], a[1], a[2], a[3]);
+}
+
+void *host_new(const char *name, int argc, t_atom *argv)
+{
+    t_symbol *s = gensym(name);
+    t_class *c;
+    t_object *x = 0;
+    init_classes();
+    for (c = classes; c && c->name != s; c = c->next) ;
+    if (!c) {
+        post("%s: no such object", name);
+        return 0;
+    }
+    if (c->num_args && c->args[0] == A_GIMME)
+        x = (t_object *)((t_fn_new)c->mnew)(s, argc, argv);
+    else if (!c->num_args)
+        x = (t_object *)((t_fn_new)c->mnew)(0, 0, 0);
+    else
+        post("%s: creation arguments other than A_GIMME are not supported", name);
+    if (x && current_patcher)
+        add_link(&current_patcher->boxes, x);
+    return x;
+}
+
+void host_free(void *x)
+{
+    object_free(x);
+}
+
+int host_send(void *x, const char *msg, int argc, t_atom *argv)
+{
+    t_symbol *s = gensym(msg);
+    t_object *o = (t_object *)x;
+    t_max_method *m = find_method(o->o_messlist, s);
+    if (!m || m->args[0] == A_CANT)
+        m = find_method(o->o_messlist, gensym("anything"));
+    if (!m) {
+        object_error(o, "doesn't understand \"%s\"", msg);
+        return 1;
+    }
+    if (m->name == gensym("anything") || (m->num_args && m->args[0] == A_GIMME))
+        ((t_fn_gimme)m->fn)(x, s, argc, argv);
+    else if (!m->num_args)
+        ((t_fn_none)m->fn)(x);
+    else if (m->args[0] == A_LONG || m->args[0] == A_DEFLONG)
+        ((t_fn_long)m->fn)(x, argc ? atom_getlong(argv) : 0);
+    else if (m->args[0] == A_FLOAT || m->args[0] == A_DEFFLOAT)
+        ((t_fn_float)m->fn)(x, argc ? atom_getfloat(argv) : 0);
+    else if (m->args[0] == A_SYM || m->args[0] == A_DEFSYM)
+        ((t_fn_sym)m->fn)(x, argc ? atom_getsym(argv) : gensym(""));
+    else {
+        object_error(o, "\"%s\" takes arguments the host cannot pass", msg);
+        return 1;
+    }
+    return 0;
+}
+
+// *********************************************************
+// -(outlets)-----------------------------------------------
+
+void *outlet_new(void *x, C74_CONST char *s)
+{
+    t_hostobj *h = HOSTOBJ(x);
+    t_outlet *out = (t_outlet *)calloc(1, sizeof(t_outlet));
+    out->owner = (t_object *)x;
+    out->created = h->num_outlets++;
+    out->next = h->outlets;
+    h->outlets = out;
+    // outlets are created from right to left, the last one is the leftmost
+    ((t_object *)x)->o_outlet = out;
+    return out;
+}
+
+void *bangout(void *x)
+{
+    return outlet_new(x, "bang");
+}
+
+void *intout(void *x)
+{
+    return outlet_new(x, "int");
+}
+
+void *floatout(void *x)
+{
+    return outlet_new(x, "float");
+}
+
+void *listout(void *x)
+{
+    return outlet_new(x, 0);
+}
+
+static void *emit(void *o, t_symbol *msg, int argc, t_atom *argv)
+{
+    t_outlet *out = (t_outlet *)o;
+    if (!out)
+        return 0;
+    host_emit(out->owner, HOSTOBJ(out->owner)->num_outlets - 1 - out->created, msg, argc, argv);
+    return o;
+}
+
+void *outlet_bang(void *o)
+{
+    return emit(o, gensym("bang"), 0, 0);
+}
+
+void *outlet_int(void *o, t_atom_long n)
+{
+    t_atom a;
+    atom_setlong(&a, n);
+    return emit(o, gensym("int"), 1, &a);
+}
+
+void *outlet_float(void *o, double f)
+{
+    t_atom a;
+    atom_setfloat(&a, f);
+    return emit(o, gensym("float"), 1, &a);
+}
+
+void *outlet_list(void *o, t_symbol *s, short ac, t_atom *av)
+{
+    return emit(o, gensym("list"), ac, av);
+}
+
+void *outlet_anything(void *o, t_symbol *s, short ac, t_atom *av)
+{
+    return emit(o, s, ac, av);
+}
+
+// *********************************************************
+// -(clocks, time and critical regions)---------------------
+
+void *clock_new(void *obj, method fn)
+{
+    return host_clock_new(obj, (void (*)(void *))fn);
+}
+
+void clock_delay(void *x, long n)
+{
+    host_clock_set((t_clock *)x, (double)n);
+}
+
+void clock_fdelay(void *c, double time)
+{
+    host_clock_set((t_clock *)c, time);
+}
+
+void clock_unset(void *x)
+{
+    host_clock_unset((t_clock *)x);
+}
+
+void clock_free(void *x)
+{
+    host_clock_free((t_clock *)x);
+}
+
+void clock_getftime(double *time)
+{
+    *time = host_time();
+}
+
+long gettime(void)
+{
+    return (long)host_time();
+}
+
+t_uint64 systime_ms(void)
+{
+    return (t_uint64)host_time();
+}
+
+double systimer_gettime(void)
+{
+    return host_time();
+}
+
+void defer(void *ob, method fn, t_symbol *sym, short argc, t_atom *argv)
+{
+    ((t_host_deferred)fn)(ob, sym, argc, argv);
+}
+
+void defer_low(void *ob, method fn, t_symbol *sym, short argc, t_atom *argv)
+{
+    host_defer(ob, (t_host_deferred)fn, sym, argc, argv);
+}
+
+typedef struct _quittask
+{
+    method fn;
+    void *arg;
+} t_quittask;
+
+static t_quittask *quittasks = 0;
+static int num_quittasks = 0;
+
+void quittask_install(method m, void *a)
+{
+    quittasks = (t_quittask *)realloc(quittasks, (num_quittasks + 1) * sizeof(t_quittask));
+    quittasks[num_quittasks].fn = m;
+    quittasks[num_quittasks].arg = a;
+    num_quittasks++;
+}
+
+void host_quit(void)
+{
+    int i;
+    for (i = 0; i < num_quittasks; i++)
+        quittasks[i].fn(quittasks[i].arg);
+    free(quittasks);
+    quittasks = 0;
+    num_quittasks = 0;
+}
+
+void critical_new(t_critical *x)
+{
+    *x = 0;
+}
+
+void critical_enter(t_critical x)
+{
+    host_critical_enter();
+}
+
+void critical_exit(t_critical x)
+{
+    host_critical_exit();
+}
+
+void critical_free(t_critical x)
+{
+}
+
+// *********************************************************
+// -(atoms and memory)--------------------------------------
+
+t_max_err atom_setlong(t_atom *a, t_atom_long b)
+{
+    a->a_type = A_LONG;
+    a->a_w.w_long = b;
+    return MAX_ERR_NONE;
+}
+
+t_max_err atom_setfloat(t_atom *a, double b)
+{
+    a->a_type = A_FLOAT;
+    a->a_w.w_float = b;
+    return MAX_ERR_NONE;
+}
+
+t_max_err atom_setsym(t_atom *a, C74_CONST t_symbol *b)
+{
+    a->a_type = A_SYM;
+    a->a_w.w_sym = (t_symbol *)b;
+    return MAX_ERR_NONE;
+}
+
+t_max_err atom_setobj(t_atom *a, void *b)
+{
+    a->a_type = A_OBJ;
+    a->a_w.w_obj = (t_object *)b;
+    return MAX_ERR_NONE;
+}
+
+t_atom_long atom_getlong(C74_CONST t_atom *a)
+{
+    if (a->a_type == A_LONG)
+        return a->a_w.w_long;
+    return a->a_type == A_FLOAT ? (t_atom_long)a->a_w.w_float : 0;
+}
+
+t_atom_float atom_getfloat(C74_CONST t_atom *a)
+{
+    if (a->a_type == A_FLOAT)
+        return a->a_w.w_float;
+    return a->a_type == A_LONG ? (t_atom_float)a->a_w.w_long : 0;
+}
+
+t_symbol *atom_getsym(C74_CONST t_atom *a)
+{
+    return a->a_type == A_SYM ? a->a_w.w_sym : gensym("");
+}
+
+void *atom_getobj(C74_CONST t_atom *a)
+{
+    return a->a_type == A_OBJ ? a->a_w.w_obj : 0;
+}
+
+t_max_err atom_alloc(long *ac, t_atom **av, char *alloc)
+{
+    return atom_alloc_array(1, ac, av, alloc);
+}
+
+t_max_err atom_alloc_array(long minsize, long *ac, t_atom **av, char *alloc)
+{
+    if (*ac >= minsize && *av) {
+        *alloc = 0;
+        return MAX_ERR_NONE;
+    }
+    *av = (t_atom *)sysmem_newptrclear(minsize * sizeof(t_atom));
+    *ac = minsize;
+    *alloc = 1;
+    return *av ? MAX_ERR_NONE : MAX_ERR_OUT_OF_MEM;
+}
+
+void *sysmem_newptr(long size)
+{
+    return malloc(size);
+}
+
+void *sysmem_newptrclear(long size)
+{
+    return calloc(1, size);
+}
+
+void *sysmem_resizeptr(void *ptr, long newsize)
+{
+    return realloc(ptr, newsize);
+}
+
+void sysmem_freeptr(void *ptr)
+{
+    free(ptr);
+}
+
+void host_set_float(t_atom *a, double f)
+{
+    atom_setfloat(a, f);
+}
+
+void host_set_int(t_atom *a, long i)
+{
+    atom_setlong(a, i);
+}
+
+void host_set_sym(t_atom *a, const char *s)
+{
+    atom_setsym(a, gensym(s));
+}
+
+double host_get_float(const t_atom *a)
+{
+    return atom_getfloat(a);
+}
+
+const char *host_get_sym(const t_atom *a)
+{
+    return a->a_type == A_SYM ? a->a_w.w_sym->s_name : 0;
+}
+
+int host_is_number(const t_atom *a)
+{
+    return a->a_type == A_LONG || a->a_type == A_FLOAT;
+}
+
+// *********************************************************
+// -(obex, registration and notification)-------------------
+
+t_max_err object_obex_lookup(void *x, t_symbol *key, t_object **val)
+{
+    t_hostobj *h = HOSTOBJ(x);
+    t_obex_entry *e;
+    *val = 0;
+    if (key == gensym("#P") && h->patcher) {
+        *val = h->patcher;
+        return MAX_ERR_NONE;
+    }
+    for (e = h->obex; e; e = e->next) {
+        if (e->key == key) {
+            *val = e->value;
+            return MAX_ERR_NONE;
+        }
+    }
+    return MAX_ERR_GENERIC;
+}
+
+t_max_err object_obex_store(void *x, t_symbol *key, t_object *val)
+{
+    t_hostobj *h = HOSTOBJ(x);
+    t_obex_entry **p = &h->obex;
+    while (*p && (*p)->key != key)
+        p = &(*p)->next;
+    if (!val) {
+        if (*p) {
+            t_obex_entry *e = *p;
+            *p = e->next;
+            free(e);
+        }
+        return MAX_ERR_NONE;
+    }
+    if (!*p) {
+        *p = (t_obex_entry *)calloc(1, sizeof(t_obex_entry));
+        (*p)->key = key;
+    }
+    (*p)->value = val;
+    return MAX_ERR_NONE;
+}
+
+void *object_register(t_symbol *name_space, t_symbol *s, void *x)
+{
+    HOSTOBJ(x)->registered = s;
+    return x;
+}
+
+t_max_err object_unregister(void *x)
+{
+    HOSTOBJ(x)->registered = 0;
+    return MAX_ERR_NONE;
+}
+
+void *object_attach_byptr(void *x, void *registeredobject)
+{
+    t_hostobj *server = HOSTOBJ(registeredobject);
+    t_link *l;
+    for (l = server->clients; l; l = l->next) {
+        if (l->obj == x)
+            return registeredobject;
+    }
+    add_link(&server->clients, (t_object *)x);
+    add_link(&HOSTOBJ(x)->servers, (t_object *)registeredobject);
+    return registeredobject;
+}
+
+void *object_attach_byptr_register(void *x, void *object_to_attach, t_symbol *reg_name_space)
+{
+    if (!HOSTOBJ(object_to_attach)->registered)
+        object_register(reg_name_space, symbol_unique(), object_to_attach);
+    return object_attach_byptr(x, object_to_attach);
+}
+
+t_max_err object_detach_byptr(void *x, void *registeredobject)
+{
+    unlink_obj(&HOSTOBJ(registeredobject)->clients, (t_object *)x);
+    unlink_obj(&HOSTOBJ(x)->servers, (t_object *)registeredobject);
+    return MAX_ERR_NONE;
+}
+
+t_max_err object_notify(void *x, t_symbol *s, void *data)
+{
+    t_hostobj *h = HOSTOBJ(x);
+    t_symbol *name = h->registered ? h->registered : gensym("");
+    t_object *clients[256];
+    int i, n = 0;
+    t_link *l;
+    // clients may detach while being notified
+    for (l = h->clients; l && n < 256; l = l->next)
+        clients[n++] = l->obj;
+    for (i = 0; i < n; i++)
+        object_method(clients[i], gensym("notify"), name, s, x, data);
+    return MAX_ERR_NONE;
+}
+
+// *********************************************************
+// -(attributes)--------------------------------------------
+
+t_object *attr_offset_new(C74_CONST char *name, C74_CONST t_symbol *type, long flags,
+                          C74_CONST method mget, C74_CONST method mset, long offset)
+{
+    t_attr *a = (t_attr *)calloc(1, sizeof(t_attr));
+    a->name = gensym(name);
+    a->type = (t_symbol *)type;
+    a->flags = flags;
+    a->get = mget;
+    a->set = mset;
+    a->offset = offset;
+    return (t_object *)a;
+}
+
+t_max_err class_addattr(t_class *c, t_object *attr)
+{
+    c->attrs = (t_attr **)realloc(c->attrs, (c->num_attrs + 1) * sizeof(t_attr *));
+    c->attrs[c->num_attrs++] = (t_attr *)attr;
+    return MAX_ERR_NONE;
+}
+
+static t_attr *find_attr(t_class *c, t_symbol *s)
+{
+    int i;
+    for (i = 0; c && i < c->num_attrs; i++) {
+        if (c->attrs[i]->name == s)
+            return c->attrs[i];
+    }
+    return 0;
+}
+
+t_max_err class_attr_setaccessors(t_class *c, C74_CONST char *name, method mget, method mset)
+{
+    t_attr *a = find_attr(c, gensym(name));
+    if (!a)
+        return MAX_ERR_GENERIC;
+    a->get = mget;
+    a->set = mset;
+    return MAX_ERR_NONE;
+}
+
+t_max_err object_attr_setvalueof(void *x, t_symbol *s, long argc, t_atom *argv)
+{
+    t_attr *a = find_attr(((t_object *)x)->o_messlist, s);
+    char *field;
+    if (!a || argc < 1)
+        return MAX_ERR_GENERIC;
+    if (a->set)
+        return ((t_fn_attr_set)a->set)(x, (t_object *)a, argc, argv);
+    field = (char *)x + a->offset;
+    if (a->type == gensym("char"))
+        *(char *)field = (char)atom_getlong(argv);
+    else if (a->type == gensym("long"))
+        *(long *)field = (long)atom_getlong(argv);
+    else if (a->type == gensym("atom_long"))
+        *(t_atom_long *)field = atom_getlong(argv);
+    else if (a->type == gensym("float32"))
+        *(float *)field = (float)atom_getfloat(argv);
+    else if (a->type == gensym("symbol"))
+        *(t_symbol **)field = atom_getsym(argv);
+    else if (a->type == gensym("object"))
+        *(void **)field = atom_getobj(argv);
+    return MAX_ERR_NONE;
+}
+
+t_max_err object_attr_getvalueof(void *x, t_symbol *s, long *argc, t_atom **argv)
+{
+    t_attr *a = find_attr(((t_object *)x)->o_messlist, s);
+    char alloc, *field;
+    if (!a)
+        return MAX_ERR_GENERIC;
+    if (a->get)
+        return ((t_fn_attr_get)a->get)(x, (t_object *)a, argc, argv);
+    atom_alloc(argc, argv, &alloc);
+    field = (char *)x + a->offset;
+    if (a->type == gensym("char"))
+        atom_setlong(*argv, *(char *)field);
+    else if (a->type == gensym("long"))
+        atom_setlong(*argv, *(long *)field);
+    else if (a->type == gensym("atom_long"))
+        atom_setlong(*argv, *(t_atom_long *)field);
+    else if (a->type == gensym("float32"))
+        atom_setfloat(*argv, *(float *)field);
+    else if (a->type == gensym("symbol"))
+        atom_setsym(*argv, *(t_symbol **)field);
+    else if (a->type == gensym("object"))
+        atom_setobj(*argv, *(void **)field);
+    return MAX_ERR_NONE;
+}
+
+static int attr_get(void *x, t_symbol *s, t_atom *value)
+{
+    long ac = 0;
+    t_atom *av = 0;
+    if (object_attr_getvalueof(x, s, &ac, &av) != MAX_ERR_NONE || !ac) {
+        atom_setlong(value, 0);
+        return 1;
+    }
+    *value = av[0];
+    sysmem_freeptr(av);
+    return 0;
+}
+
+t_symbol *object_attr_getsym(void *x, t_symbol *s)
+{
+    t_atom a;
+    attr_get(x, s, &a);
+    return atom_getsym(&a);
+}
+
+t_atom_long object_attr_getlong(void *x, t_symbol *s)
+{
+    t_atom a;
+    attr_get(x, s, &a);
+    return atom_getlong(&a);
+}
+
+t_atom_float object_attr_getfloat(void *x, t_symbol *s)
+{
+    t_atom a;
+    attr_get(x, s, &a);
+    return atom_getfloat(&a);
+}
+
+char object_attr_getchar(void *x, t_symbol *s)
+{
+    t_atom a;
+    attr_get(x, s, &a);
+    return (char)atom_getlong(&a);
+}
+
+// *********************************************************
+// -(hashtabs)----------------------------------------------
+
+static void hashtab_free(t_hashtab *x)
+{
+    long i;
+    for (i = 0; i < x->num; i++) {
+        if (!x->keep_values && !(x->entries[i]->flags & OBJ_FLAG_REF) && x->entries[i]->value)
+            object_free(x->entries[i]->value);
+        free(x->entries[i]);
+    }
+    free(x->entries);
+}
+
+t_hashtab *hashtab_new(long slotcount)
+{
+    init_classes();
+    return (t_hashtab *)object_alloc(hashtab_class);
+}
+
+static long hashtab_find(t_hashtab *x, t_symbol *key)
+{
+    long i;
+    for (i = 0; i < x->num; i++) {
+        if (x->entries[i]->key == key)
+            return i;
+    }
+    return -1;
+}
+
+t_max_err hashtab_storeflags(t_hashtab *x, t_symbol *key, t_object *val, long flags)
+{
+    long i = hashtab_find(x, key);
+    if (i < 0) {
+        if (x->num == x->max) {
+            x->max = x->max ? x->max * 2 : 16;
+            x->entries = (t_hashtab_entry **)realloc(x->entries, x->max * sizeof(t_hashtab_entry *));
+        }
+        i = x->num++;
+        x->entries[i] = (t_hashtab_entry *)calloc(1, sizeof(t_hashtab_entry));
+        x->entries[i]->key = key;
+        x->entries[i]->parent = x;
+    }
+    x->entries[i]->value = val;
+    x->entries[i]->flags = flags;
+    object_notify(x, gensym("hashtab_entry_new"), key);
+    return MAX_ERR_NONE;
+}
+
+t_max_err hashtab_store(t_hashtab *x, t_symbol *key, t_object *val)
+{
+    return hashtab_storeflags(x, key, val, 0);
+}
+
+t_max_err hashtab_lookup(t_hashtab *x, t_symbol *key, t_object **val)
+{
+    long i = hashtab_find(x, key);
+    *val = i < 0 ? 0 : x->entries[i]->value;
+    return i < 0 ? MAX_ERR_GENERIC : MAX_ERR_NONE;
+}
+
+static t_max_err hashtab_remove(t_hashtab *x, t_symbol *key, int free_value)
+{
+    long i;
+    t_hashtab_entry *e;
+    if (hashtab_find(x, key) < 0)
+        return MAX_ERR_GENERIC;
+    // notified while the entry can still be looked up
+    object_notify(x, gensym("hashtab_entry_free"), key);
+    if ((i = hashtab_find(x, key)) < 0)
+        return MAX_ERR_NONE;
+    e = x->entries[i];
+    memmove(x->entries + i, x->entries + i + 1, (x->num - i - 1) * sizeof(t_hashtab_entry *));
+    --x->num;
+    if (free_value && !(e->flags & OBJ_FLAG_REF) && e->value)
+        object_free(e->value);
+    free(e);
+    return MAX_ERR_NONE;
+}
+
+t_max_err hashtab_chuckkey(t_hashtab *x, t_symbol *key)
+{
+    return hashtab_remove(x, key, 0);
+}
+
+t_max_err hashtab_delete(t_hashtab *x, t_symbol *key)
+{
+    return hashtab_remove(x, key, 1);
+}
+
+t_max_err hashtab_clear(t_hashtab *x)
+{
+    while (x->num)
+        hashtab_remove(x, x->entries[x->num - 1]->key, 1);
+    return MAX_ERR_NONE;
+}
+
+t_max_err hashtab_chuck(t_hashtab *x)
+{
+    x->keep_values = 1;
+    return object_free(x);
+}
+
+// copies of the entries, as the function may store or remove some
+static long hashtab_snapshot(t_hashtab *x, t_hashtab_entry **copy)
+{
+    long i;
+    *copy = (t_hashtab_entry *)malloc((x->num ? x->num : 1) * sizeof(t_hashtab_entry));
+    for (i = 0; i < x->num; i++)
+        (*copy)[i] = *x->entries[i];
+    return x->num;
+}
+
+t_max_err hashtab_funall(t_hashtab *x, method fun, void *arg)
+{
+    t_hashtab_entry *copy;
+    long i, n = hashtab_snapshot(x, &copy);
+    for (i = 0; i < n; i++)
+        ((t_fn_entry)fun)(copy + i, arg);
+    free(copy);
+    return MAX_ERR_NONE;
+}
+
+t_max_err hashtab_methodall(t_hashtab *x, t_symbol *s, ...)
+{
+    t_hashtab_entry *copy;
+    long i, n = hashtab_snapshot(x, &copy);
+    void *a[MAX_CANT_ARGS];
+    va_list ap;
+    va_start(ap, s);
+    for (i = 0; i < MAX_CANT_ARGS; i++)
+        a[i] = va_arg(ap, void *);
+    va_end(ap);
+    for (i = 0; i < n; i++)
+        object_method(copy[i].value, s, a[0], a[1], a[2], a[3]);
+    free(copy);
+    return MAX_ERR_NONE;
+}
+
+t_atom_long hashtab_getsize(t_hashtab *x)
+{
+    return x->num;
+}
+
+// *********************************************************
+// -(atomarrays)--------------------------------------------
+
+static void atomarray_free(t_atomarray *x)
+{
+    free(x->av);
+}
+
+t_atomarray *atomarray_new(long ac, t_atom *av)
+{
+    t_atomarray *x;
+    init_classes();
+    x = (t_atomarray *)object_alloc(atomarray_class);
+    atomarray_setatoms(x, ac, av);
+    return x;
+}
+
+t_max_err atomarray_getatoms(t_atomarray *x, long *ac, t_atom **av)
+{
+    *ac = x->ac;
+    *av = x->av;
+    return MAX_ERR_NONE;
+}
+
+t_max_err atomarray_setatoms(t_atomarray *x, long ac, t_atom *av)
+{
+    free(x->av);
+    x->av = 0;
+    x->ac = ac > 0 ? ac : 0;
+    if (x->ac) {
+        x->av = (t_atom *)malloc(x->ac * sizeof(t_atom));
+        memcpy(x->av, av, x->ac * sizeof(t_atom));
+    }
+    return MAX_ERR_NONE;
+}
+
+void atomarray_appendatoms(t_atomarray *x, long ac, t_atom *av)
+{
+    if (ac <= 0)
+        return;
+    x->av = (t_atom *)realloc(x->av, (x->ac + ac) * sizeof(t_atom));
+    memcpy(x->av + x->ac, av, ac * sizeof(t_atom));
+    x->ac += ac;
+}
+
+t_atom_long atomarray_getsize(t_atomarray *x)
+{
+    return x->ac;
+}
+
+// *********************************************************
+// -(patchers)----------------------------------------------
+
+static void patcher_free(t_patcher *x)
+{
+    if (x->parent)
+        unlink_obj(&((t_patcher *)x->parent)->children, (t_object *)x);
+}
+
+static long patcher_iterate_list(t_patcher *x, t_fn_iterate fn, void *arg, long flags, long *result)
+{
+    t_link *l;
+    long ret;
+    for (l = x->boxes; l; l = l->next) {
+        if ((ret = fn(arg, l->obj))) {
+            if (result)
+                *result = ret;
+            return ret;
+        }
+    }
+    if (!(flags & PI_DEEP))
+        return 0;
+    for (l = x->children; l; l = l->next) {
+        if ((ret = patcher_iterate_list((t_patcher *)l->obj, fn, arg, flags, result)))
+            return ret;
+    }
+    return 0;
+}
+
+static void *patcher_iterate(t_patcher *x, t_fn_iterate fn, void *arg, long flags, long *result)
+{
+    if (result)
+        *result = 0;
+    patcher_iterate_list(x, fn, arg, flags, result);
+    return 0;
+}
+
+static void *patcher_getassoc(t_patcher *x, t_object **assoc)
+{
+    // no patcher is inside a poly~ or bpatcher here
+    *assoc = 0;
+    return 0;
+}
+
+t_object *host_patcher_new(t_object *parent)
+{
+    t_patcher *x;
+    t_patcher *current = current_patcher;
+    init_classes();
+    current_patcher = 0;
+    x = (t_patcher *)object_alloc(patcher_class);
+    current_patcher = current;
+    x->parent = parent;
+    if (parent)
+        add_link(&((t_patcher *)parent)->children, (t_object *)x);
+    return (t_object *)x;
+}
+
+void host_patcher_set(t_object *patcher)
+{
+    current_patcher = (t_patcher *)patcher;
+    gensym("#P")->s_thing = patcher;
+}
+
+void host_patcher_free(t_object *patcher)
+{
+    t_patcher *x = (t_patcher *)patcher;
+    while (x->children)
+        host_patcher_free(x->children->obj);
+    while (x->boxes)
+        object_free(x->boxes->obj);
+    if (current_patcher == x)
+        host_patcher_set(0);
+    object_free(x);
+}
+
+t_object *jpatcher_get_parentpatcher(t_object *p)
+{
+    return p && p->o_messlist == patcher_class ? ((t_patcher *)p)->parent : 0;
+}
+
+t_object *jpatcher_get_toppatcher(t_object *p)
+{
+    while (jpatcher_get_parentpatcher(p))
+        p = jpatcher_get_parentpatcher(p);
+    return p;
+}
+
+t_symbol *jpatcher_get_name(t_object *p)
+{
+    return gensym("host");
+}
+
+// *********************************************************
+// -(buffers)-----------------------------------------------
+
+static void buffer_free(t_buffer *x)
+{
+    t_buffer **p = &buffers;
+    while (*p && *p != x)
+        p = &(*p)->next;
+    if (*p)
+        *p = x->next;
+    free(x->samples);
+}
+
+t_object *host_buffer_new(const char *name, long frames, long channels)
+{
+    t_buffer *x;
+    init_classes();
+    x = (t_buffer *)object_alloc(buffer_class);
+    x->name = gensym(name);
+    x->frames = frames;
+    x->channels = channels;
+    x->samples = (float *)calloc(frames * channels > 0 ? frames * channels : 1, sizeof(float));
+    x->next = buffers;
+    buffers = x;
+    return (t_object *)x;
+}
+
+t_buffer_ref *buffer_ref_new(t_object *self, t_symbol *name)
+{
+    t_buffer_ref *x;
+    init_classes();
+    x = (t_buffer_ref *)object_alloc(buffer_ref_class);
+    x->name = name;
+    return x;
+}
+
+void buffer_ref_set(t_buffer_ref *x, t_symbol *name)
+{
+    x->name = name;
+}
+
+t_buffer_obj *buffer_ref_getobject(t_buffer_ref *x)
+{
+    t_buffer *b;
+    for (b = buffers; b && b->name != x->name; b = b->next) ;
+    return (t_buffer_obj *)b;
+}
+
+t_atom_long buffer_ref_exists(t_buffer_ref *x)
+{
+    return buffer_ref_getobject(x) != 0;
+}
+
+t_max_err buffer_ref_notify(t_buffer_ref *x, t_symbol *s, t_symbol *msg, void *sender, void *data)
+{
+    return MAX_ERR_NONE;
+}
+
+float *buffer_locksamples(t_buffer_obj *buffer_object)
+{
+    return buffer_object ? ((t_buffer *)buffer_object)->samples : 0;
+}
+
+void buffer_unlocksamples(t_buffer_obj *buffer_object)
+{
+}
+
+t_atom_long buffer_getchannelcount(t_buffer_obj *buffer_object)
+{
+    return ((t_buffer *)buffer_object)->channels;
+}
+
+t_atom_long buffer_getframecount(t_buffer_obj *buffer_object)
+{
+    return ((t_buffer *)buffer_object)->frames;
+}
+
+t_atom_float buffer_getsamplerate(t_buffer_obj *buffer_object)
+{
+    return 44100.;
+}
+
+t_max_err buffer_setdirty(t_buffer_obj *buffer_object)
+{
+    return MAX_ERR_NONE;
+}
+
+// *********************************************************
+// -(files)-------------------------------------------------
+// path ids index 'paths'; path 1 is the search directory
+
+static short path_id(const char *dir)
+{
+    int i;
+    for (i = 1; i < num_paths; i++) {
+        if (strcmp(paths[i], dir) == 0)
+            return (short)i;
+    }
+    if (!num_paths) {
+        paths = (char **)calloc(2, sizeof(char *));
+        num_paths = 1;
+    }
+    paths = (char **)realloc(paths, (num_paths + 1) * sizeof(char *));
+    paths[num_paths] = strdup(dir);
+    return (short)num_paths++;
+}
+
+short path_getdefault(void)
+{
+    return path_id(host_get_search_dir());
+}
+
+short locatefile_extended(char *name, short *outvol, t_fourcc *outtype,
+                          C74_CONST t_fourcc *filetypelist, short numtypes)
+{
+    char path[MAX_PATH_CHARS];
+    char *slash;
+    host_search_path(name, path, sizeof(path));
+    if (access(path, R_OK) != 0)
+        return 1;
+    slash = strrchr(path, '/');
+    *slash = 0;
+    *outvol = path_id(path);
+    memmove(name, slash + 1, strlen(slash + 1) + 1);
+    if (outtype)
+        *outtype = numtypes ? filetypelist[0] : 0;
+    return 0;
+}
+
+short path_toabsolutesystempath(C74_CONST short in_path, C74_CONST char *in_filename,
+                                char *out_filepath)
+{
+    if (in_path < 1 || in_path >= num_paths)
+        return MAX_ERR_GENERIC;
+    snprintf(out_filepath, MAX_PATH_CHARS, "%s/%s", paths[in_path], in_filename);
+    return MAX_ERR_NONE;
+}
+
+short path_nameconform(C74_CONST char *src, char *dst, long style, long type)
+{
+    snprintf(dst, MAX_PATH_CHARS, "%s", src);
+    return MAX_ERR_NONE;
+}
+
+// *********************************************************
+// -(setup)-------------------------------------------------
+
+static void init_classes(void)
+{
+    if (patcher_class)
+        return;
+    patcher_class = class_new("jpatcher", 0, (method)patcher_free, sizeof(t_patcher), 0, 0);
+    class_addmethod(patcher_class, (method)patcher_iterate, "iterate", A_CANT, 0);
+    class_addmethod(patcher_class, (method)patcher_getassoc, "getassoc", A_CANT, 0);
+    hashtab_class = class_new("hashtab", 0, (method)hashtab_free, sizeof(t_hashtab), 0, 0);
+    atomarray_class = class_new("atomarray", 0, (method)atomarray_free, sizeof(t_atomarray), 0, 0);
+    buffer_class = class_new("buffer~", 0, (method)buffer_free, sizeof(t_buffer), 0, 0);
+    buffer_ref_class = class_new("buffer_ref", 0, 0, sizeof(t_buffer_ref), 0, 0);
+}
+
+int host_setup(void *module, const char *path)
+{
+    void (*ext_main)(void *) = (void (*)(void *))dlsym(module, "ext_main");
+    int (*main_fn)(void) = (int (*)(void))dlsym(module, "main");
+    init_classes();
+    if (ext_main)
+        ext_main(0);
+    else if (main_fn)
+        main_fn();
+    else {
+        fprintf(stderr, "host: %s has neither ext_main() nor main()\n", path);
+        return 1;
+    }
+    return 0;
+}
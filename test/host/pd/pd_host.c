@@ -0,0 +1,459 @@
+//
+// pd_host.c
+// the Pd functions declared in mapper/m_pd.h that the externals in this repository
+// use: classes and message dispatch, outlets, clocks, atoms, the canvas file lookups
+// and tables, enough to run them without Pd
+//
+
+#include "host_internal.h"
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_ARGS 8
+#define SYMBOL_BUCKETS 1024
+
+typedef void (*t_fn_none)(void *x);
+typedef void (*t_fn_float)(void *x, t_floatarg f);
+typedef void (*t_fn_sym)(void *x, t_symbol *s);
+typedef void (*t_fn_gimme)(void *x, t_symbol *s, int argc, t_atom *argv);
+typedef void *(*t_fn_new)(t_symbol *s, int argc, t_atom *argv);
+
+typedef struct _pd_method
+{
+    t_symbol *name;
+    t_method fn;
+    t_atomtype args[MAX_ARGS];
+    int num_args;
+} t_pd_method;
+
+struct _class
+{
+    t_symbol *name;
+    t_newmethod mnew;
+    t_method mfree;
+    size_t size;
+    t_atomtype args[MAX_ARGS];
+    int num_args;
+    t_pd_method *methods;
+    int num_methods;
+    t_method anything;
+    struct _class *next;
+};
+
+struct _outlet
+{
+    t_object *owner;
+    struct _outlet *next;
+};
+
+struct _glist
+{
+    int dummy;
+};
+
+struct _garray
+{
+    t_pd g_pd;
+    t_symbol *name;
+    int size;
+    t_word *vec;
+    struct _garray *next;
+};
+
+static t_class *classes = 0;
+static struct _glist canvas;
+static t_class garray_host_class;
+static struct _garray *arrays = 0;
+
+t_class *garray_class = &garray_host_class;
+
+// *********************************************************
+// -(symbols and console)-----------------------------------
+
+t_symbol *gensym(const char *s)
+{
+    static t_symbol *table[SYMBOL_BUCKETS];
+    unsigned long hash = 5381;
+    const char *c;
+    t_symbol *sym;
+    for (c = s; *c; c++)
+        hash = hash * 33 + (unsigned char)*c;
+    for (sym = table[hash % SYMBOL_BUCKETS]; sym; sym = sym->s_next) {
+        if (strcmp(sym->s_name, s) == 0)
+            return sym;
+    }
+    sym = (t_symbol *)calloc(1, sizeof(t_symbol));
+    sym->s_name = strdup(s);
+    sym->s_next = table[hash % SYMBOL_BUCKETS];
+    table[hash % SYMBOL_BUCKETS] = sym;
+    return sym;
+}
+
+void post(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    host_vpost(0, fmt, ap);
+    va_end(ap);
+}
+
+void pd_error(void *object, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    host_vpost("error: ", fmt, ap);
+    va_end(ap);
+}
+
+// *********************************************************
+// -(classes and objects)-----------------------------------
+
+static int read_arg_types(t_atomtype *types, va_list ap)
+{
+    int n = 0, type;
+    while (n < MAX_ARGS && (type = va_arg(ap, int)) != A_NULL)
+        types[n++] = (t_atomtype)type;
+    return n;
+}
+
+t_class *class_new(t_symbol *name, t_newmethod newmethod, t_method freemethod, size_t size,
+                   int flags, t_atomtype arg1, ...)
+{
+    t_class *c = (t_class *)calloc(1, sizeof(t_class));
+    va_list ap;
+    c->name = name;
+    c->mnew = newmethod;
+    c->mfree = freemethod;
+    c->size = size < sizeof(t_object) ? sizeof(t_object) : size;
+    if (arg1 != A_NULL) {
+        c->args[c->num_args++] = arg1;
+        va_start(ap, arg1);
+        c->num_args += read_arg_types(c->args + 1, ap);
+        va_end(ap);
+    }
+    c->next = classes;
+    classes = c;
+    return c;
+}
+
+void class_addmethod(t_class *c, t_method fn, t_symbol *sel, t_atomtype arg1, ...)
+{
+    t_pd_method *m;
+    va_list ap;
+    c->methods = (t_pd_method *)realloc(c->methods, (c->num_methods + 1) * sizeof(t_pd_method));
+    m = c->methods + c->num_methods++;
+    memset(m, 0, sizeof(t_pd_method));
+    m->name = sel;
+    m->fn = fn;
+    if (arg1 != A_NULL) {
+        m->args[m->num_args++] = arg1;
+        va_start(ap, arg1);
+        m->num_args += read_arg_types(m->args + 1, ap);
+        va_end(ap);
+    }
+}
+
+// m_pd.h defines class_addanything() as a macro casting its argument
+#undef class_addanything
+void class_addanything(t_class *c, t_method fn)
+{
+    c->anything = fn;
+}
+
+t_pd *pd_new(t_class *cls)
+{
+    t_object *x = (t_object *)calloc(1, cls->size);
+    x->te_g.g_pd = cls;
+    return &x->te_g.g_pd;
+}
+
+void pd_free(t_pd *x)
+{
+    t_object *o = (t_object *)x;
+    if ((*x)->mfree)
+        ((t_fn_none)(*x)->mfree)(x);
+    while (o->te_outlet) {
+        t_outlet *out = o->te_outlet;
+        o->te_outlet = out->next;
+        free(out);
+    }
+    free(x);
+}
+
+void *host_new(const char *name, int argc, t_atom *argv)
+{
+    t_symbol *s = gensym(name);
+    t_class *c;
+    for (c = classes; c && c->name != s; c = c->next) ;
+    if (!c) {
+        post("%s: no such object", name);
+        return 0;
+    }
+    if (c->num_args && c->args[0] == A_GIMME)
+        return ((t_fn_new)c->mnew)(s, argc, argv);
+    if (!c->num_args)
+        return ((t_fn_new)c->mnew)(0, 0, 0);
+    post("%s: creation arguments other than A_GIMME are not supported", name);
+    return 0;
+}
+
+void host_free(void *x)
+{
+    pd_free((t_pd *)x);
+}
+
+int host_send(void *x, const char *msg, int argc, t_atom *argv)
+{
+    t_symbol *s = gensym(msg);
+    t_class *c = *(t_pd *)x;
+    t_pd_method *m = 0;
+    int i;
+    for (i = 0; i < c->num_methods; i++) {
+        if (c->methods[i].name == s) {
+            m = c->methods + i;
+            break;
+        }
+    }
+    if (!m) {
+        if (!c->anything) {
+            pd_error(x, "%s: no method for '%s'", c->name->s_name, msg);
+            return 1;
+        }
+        ((t_fn_gimme)c->anything)(x, s, argc, argv);
+    }
+    else if (m->num_args && m->args[0] == A_GIMME)
+        ((t_fn_gimme)m->fn)(x, s, argc, argv);
+    else if (!m->num_args)
+        ((t_fn_none)m->fn)(x);
+    else if (m->args[0] == A_FLOAT || m->args[0] == A_DEFFLOAT)
+        ((t_fn_float)m->fn)(x, argc ? atom_getfloat(argv) : 0);
+    else if (m->args[0] == A_SYMBOL || m->args[0] == A_DEFSYM)
+        ((t_fn_sym)m->fn)(x, argc ? atom_getsymbol(argv) : gensym(""));
+    else {
+        pd_error(x, "%s: '%s' takes arguments the host cannot pass", c->name->s_name, msg);
+        return 1;
+    }
+    return 0;
+}
+
+// *********************************************************
+// -(outlets)-----------------------------------------------
+
+t_outlet *outlet_new(t_object *owner, t_symbol *s)
+{
+    t_outlet *out = (t_outlet *)calloc(1, sizeof(t_outlet)), **p = &owner->te_outlet;
+    // outlets are created from left to right
+    while (*p)
+        p = &(*p)->next;
+    out->owner = owner;
+    *p = out;
+    return out;
+}
+
+static void emit(t_outlet *x, t_symbol *msg, int argc, t_atom *argv)
+{
+    t_outlet *out;
+    int index = 0;
+    for (out = x->owner->te_outlet; out && out != x; out = out->next)
+        ++index;
+    host_emit(x->owner, index, msg, argc, argv);
+}
+
+void outlet_bang(t_outlet *x)
+{
+    emit(x, gensym("bang"), 0, 0);
+}
+
+void outlet_float(t_outlet *x, t_float f)
+{
+    t_atom a;
+    SETFLOAT(&a, f);
+    emit(x, gensym("float"), 1, &a);
+}
+
+void outlet_symbol(t_outlet *x, t_symbol *s)
+{
+    t_atom a;
+    SETSYMBOL(&a, s);
+    emit(x, gensym("symbol"), 1, &a);
+}
+
+void outlet_list(t_outlet *x, t_symbol *s, int argc, t_atom *argv)
+{
+    emit(x, gensym("list"), argc, argv);
+}
+
+void outlet_anything(t_outlet *x, t_symbol *s, int argc, t_atom *argv)
+{
+    emit(x, s, argc, argv);
+}
+
+// *********************************************************
+// -(clocks and time)---------------------------------------
+
+t_clock *clock_new(void *owner, t_method fn)
+{
+    return host_clock_new(owner, (void (*)(void *))fn);
+}
+
+void clock_delay(t_clock *x, double delaytime)
+{
+    host_clock_set(x, delaytime);
+}
+
+void clock_unset(t_clock *x)
+{
+    host_clock_unset(x);
+}
+
+void clock_free(t_clock *x)
+{
+    host_clock_free(x);
+}
+
+double clock_getlogicaltime(void)
+{
+    return host_time();
+}
+
+double sys_getrealtime(void)
+{
+    return host_time() * 0.001;
+}
+
+// *********************************************************
+// -(atoms)-------------------------------------------------
+
+t_float atom_getfloat(t_atom *a)
+{
+    return a->a_type == A_FLOAT ? a->a_w.w_float : 0;
+}
+
+t_int atom_getint(t_atom *a)
+{
+    return (t_int)atom_getfloat(a);
+}
+
+t_symbol *atom_getsymbol(t_atom *a)
+{
+    return a->a_type == A_SYMBOL ? a->a_w.w_symbol : gensym("");
+}
+
+void host_set_float(t_atom *a, double f)
+{
+    SETFLOAT(a, (t_float)f);
+}
+
+void host_set_int(t_atom *a, long i)
+{
+    SETFLOAT(a, (t_float)i);
+}
+
+void host_set_sym(t_atom *a, const char *s)
+{
+    SETSYMBOL(a, gensym(s));
+}
+
+double host_get_float(const t_atom *a)
+{
+    return a->a_type == A_FLOAT ? a->a_w.w_float : 0;
+}
+
+const char *host_get_sym(const t_atom *a)
+{
+    return a->a_type == A_SYMBOL ? a->a_w.w_symbol->s_name : 0;
+}
+
+int host_is_number(const t_atom *a)
+{
+    return a->a_type == A_FLOAT;
+}
+
+// *********************************************************
+// -(canvases and files)------------------------------------
+// every object is in the same canvas, whose directory is the search directory
+
+t_glist *canvas_getcurrent(void)
+{
+    return &canvas;
+}
+
+int canvas_open(t_canvas *x, const char *name, const char *ext, char *dirresult,
+                char **nameresult, unsigned int size, int bin)
+{
+    char path[MAXPDSTRING], *slash;
+    int fd;
+    snprintf(path, sizeof(path), "%s", name);
+    if (ext && *ext && !strchr(name, '.'))
+        snprintf(path, sizeof(path), "%s%s", name, ext);
+    host_search_path(path, dirresult, size);
+    if ((fd = open(dirresult, O_RDONLY)) < 0)
+        return fd;
+    slash = strrchr(dirresult, '/');
+    *slash = 0;
+    *nameresult = slash + 1;
+    return fd;
+}
+
+void canvas_makefilename(t_glist *c, char *file, char *result, int resultsize)
+{
+    host_search_path(file, result, resultsize);
+}
+
+// *********************************************************
+// -(tables)------------------------------------------------
+
+t_garray *host_array_new(const char *name, int size)
+{
+    struct _garray *x = (struct _garray *)calloc(1, sizeof(struct _garray));
+    x->g_pd = garray_class;
+    x->name = gensym(name);
+    x->size = size;
+    x->vec = (t_word *)calloc(size > 0 ? size : 1, sizeof(t_word));
+    x->next = arrays;
+    arrays = x;
+    return x;
+}
+
+t_pd *pd_findbyclass(t_symbol *s, t_class *c)
+{
+    struct _garray *a;
+    if (c != garray_class)
+        return 0;
+    for (a = arrays; a && a->name != s; a = a->next) ;
+    return a ? &a->g_pd : 0;
+}
+
+int garray_getfloatwords(t_garray *x, int *size, t_word **vec)
+{
+    *size = x->size;
+    *vec = x->vec;
+    return 1;
+}
+
+void garray_redraw(t_garray *x)
+{
+}
+
+// *********************************************************
+// -(setup)-------------------------------------------------
+
+int host_setup(void *module, const char *path)
+{
+    char name[MAXPDSTRING];
+    const char *base = strrchr(path, '/');
+    void (*setup)(void);
+    snprintf(name, sizeof(name), "%s", base ? base + 1 : path);
+    name[strcspn(name, ".")] = 0;
+    strncat(name, "_setup", sizeof(name) - strlen(name) - 1);
+    if (!(setup = (void (*)(void))dlsym(module, name))) {
+        fprintf(stderr, "host: %s has no %s()\n", path, name);
+        return 1;
+    }
+    setup();
+    return 0;
+}
@@ -0,0 +1,844 @@
+//
+// test_mapper.c
+// loads the mapper external, built for the host this file is compiled for, creates two
+// [mapper] objects with a signal each, maps them over libmapper and checks that a value
+// sent to one comes out of the other, and that "setindex" sends the vector with part of
+// it changed. Also checks that a device definition is read from its binary cache, and
+// that a corrupted cache is rejected and rewritten, that "write" saves a definition
+// which loads back as the same signals, that \u escapes in it decode to UTF-8, that
+// @coalesce holds back the updates of one poll until its end, that "get" reads an input
+// added with @notify 0, that @timestamps precedes updates with their timetag and
+// latency, and that "reload" only recreates the signals whose type changed. A [mapper]
+// created with the name of a freed one adopts its device and keeps the maps of the
+// signals it defines alike.
+//
+
+#include "loopback.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TIMEOUT_MS 10000
+
+static int failures = 0;
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+
+static void check(int ok, const char *what, const char *file, int line)
+{
+    if (ok)
+        return;
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+    failures++;
+}
+
+static void *new_mapper(const char *alias)
+{
+    t_atom args[2];
+    host_set_sym(args, "@alias");
+    host_set_sym(args + 1, alias);
+    return host_new("mapper", 2, args);
+}
+
+static void add_signal(void *x, const char *dir, const char *name, int length)
+{
+    t_atom args[6];
+    host_set_sym(args, dir);
+    host_set_sym(args + 1, name);
+    host_set_sym(args + 2, "@type");
+    host_set_sym(args + 3, "f");
+    host_set_sym(args + 4, "@length");
+    host_set_int(args + 5, length);
+    host_send(x, "add", 6, args);
+}
+
+static int both_ready(void *data)
+{
+    return loopback_num_posts("Joining mapping network") >= 2;
+}
+
+static const t_host_record *find_output(void *x, const char *name)
+{
+    int i;
+    for (i = 0; i < host_num_records(); i++) {
+        const t_host_record *r = host_get_record(i);
+        if (r->obj == x && r->outlet == 0 && strcmp(r->msg->s_name, name) == 0)
+            return r;
+    }
+    return 0;
+}
+
+// the last message 'msg' from an outlet of 'x' since the records were cleared, and how
+// many there were
+static const t_host_record *last_output(void *x, int outlet, const char *msg, int *count)
+{
+    const t_host_record *last = 0;
+    int i, n = 0;
+    for (i = 0; i < host_num_records(); i++) {
+        const t_host_record *r = host_get_record(i);
+        if (r->obj == x && r->outlet == outlet && strcmp(r->msg->s_name, msg) == 0) {
+            last = r;
+            n++;
+        }
+    }
+    if (count)
+        *count = n;
+    return last;
+}
+
+static void *receiver;
+
+static int received(void *data)
+{
+    return find_output(receiver, "/in") != 0;
+}
+
+// the receiver has output the float in 'data' as the last atom of a message
+static int received_value(void *data)
+{
+    int i;
+    for (i = 0; i < host_num_records(); i++) {
+        const t_host_record *r = host_get_record(i);
+        if (   r->obj == receiver && r->outlet == 0 && r->argc
+            && host_is_number(r->argv + r->argc - 1)
+            && host_get_float(r->argv + r->argc - 1) == *(float *)data)
+            return 1;
+    }
+    return 0;
+}
+
+// the receiver has output an instance release
+static int received_release(void *data)
+{
+    int i;
+    for (i = 0; i < host_num_records(); i++) {
+        const t_host_record *r = host_get_record(i);
+        if (   r->obj == receiver && r->outlet == 0 && r->argc == 3
+            && !host_is_number(r->argv + 1) && strcmp(host_get_sym(r->argv + 1), "release") == 0)
+            return 1;
+    }
+    return 0;
+}
+
+// a device of the test's own, which can send several updates between two host polls
+static mpr_dev tester;
+
+static int tester_ready(void *data)
+{
+    return mpr_dev_get_is_ready(tester) && loopback_num_posts("Joining mapping network");
+}
+
+// send each value in its own message, and let them all arrive before the host polls
+static void send_burst(mpr_sig sig, mpr_id inst, const float *values, int num)
+{
+    int i;
+    for (i = 0; i < num; i++) {
+        mpr_sig_set_value(sig, inst, 1, MPR_FLT, values + i);
+        mpr_dev_poll(tester, 0);
+    }
+    usleep(20000);
+}
+
+static const char *definition =
+    "{\"device\": {\"name\": \"cached\", \"inputs\": [\n"
+    "  {\"name\": \"in1\", \"type\": \"f\", \"units\": \"m\", \"minimum\": 0, \"maximum\": 1},\n"
+    "  {\"name\": \"in2\", \"type\": \"i\", \"length\": 2}],\n"
+    "  \"outputs\": [{\"name\": \"out1\", \"type\": \"f\"}]}}\n";
+
+// create and free a [mapper] reading the definition, returns whether it used the cache
+static int load_definition(const char *name)
+{
+    t_atom args[4];
+    void *x;
+    int cached;
+
+    host_clear_posts();
+    host_set_sym(args, "@definition");
+    host_set_sym(args + 1, name);
+    host_set_sym(args + 2, "@cache");
+    host_set_int(args + 3, 1);
+    x = host_new("mapper", 4, args);
+    CHECK(x != 0);
+    cached = loopback_num_posts("Mapped cache of 3 signals");
+    CHECK(cached || loopback_num_posts("Parsed 3 signals"));
+    if (x)
+        host_free(x);
+    host_advance(10);
+    return cached;
+}
+
+static void write_file(const char *path, const char *text)
+{
+    FILE *f = fopen(path, "w");
+    CHECK(f != 0);
+    if (!f)
+        return;
+    fputs(text, f);
+    fclose(f);
+}
+
+// overwrite bytes of a file in place, keeping its size
+static void patch_file(const char *path, long offset, const void *bytes, size_t size)
+{
+    FILE *f = fopen(path, "r+b");
+    CHECK(f != 0);
+    if (!f)
+        return;
+    if (offset < 0)
+        fseek(f, offset, SEEK_END);
+    else
+        fseek(f, offset, SEEK_SET);
+    fwrite(bytes, 1, size, f);
+    fclose(f);
+}
+
+static void test_definition_cache(void)
+{
+    char dir[] = "/tmp/mapper_defXXXXXX", path[256], cache[272];
+    uint32_t offset = 0x7FFFFFFF;
+
+    CHECK(mkdtemp(dir) != 0);
+    host_set_search_dir(dir);
+    snprintf(path, sizeof(path), "%s/def.json", dir);
+    snprintf(cache, sizeof(cache), "%s.cache", path);
+    write_file(path, definition);
+
+    CHECK(!load_definition("def.json"));
+    CHECK(access(cache, R_OK) == 0);
+    CHECK(load_definition("def.json"));
+
+    // a string table without a terminator at its end
+    patch_file(cache, -1, "x", 1);
+    CHECK(!load_definition("def.json"));
+    CHECK(load_definition("def.json"));
+
+    // a device name outside the string table, after the magic, counts and source stamp
+    patch_file(cache, 40, &offset, sizeof(offset));
+    CHECK(!load_definition("def.json"));
+    CHECK(load_definition("def.json"));
+
+    remove(cache);
+    remove(path);
+    rmdir(dir);
+    host_set_search_dir(".");
+}
+
+static const char *written_definition =
+    "{\"device\": {\"name\": \"hostwrite\", \"inputs\": [\n"
+    "  {\"name\": \"in1\", \"type\": \"f\", \"units\": \"m\", \"minimum\": 0, \"maximum\": 1.5,\n"
+    "   \"label\": \"left\", \"gain\": 2, \"active\": true},\n"
+    "  {\"name\": \"in2\", \"type\": \"i\", \"length\": 2, \"minimum\": [0, -1],\n"
+    "   \"maximum\": [10, 20], \"instances\": 3}],\n"
+    "  \"outputs\": [{\"name\": \"out1\", \"type\": \"f\"}]}}\n";
+
+// the contents of a text file, to be freed, or 0
+static char *read_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    char *text;
+    long size;
+    if (!f)
+        return 0;
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    text = (char *)calloc(1, size + 1);
+    if (fread(text, 1, size, f) != (size_t)size) {
+        free(text);
+        text = 0;
+    }
+    fclose(f);
+    return text;
+}
+
+// "write" saves the signals and their properties in a definition that loads back as
+// the same signals, from the JSON and from the cache written beside it
+static void test_write(void)
+{
+    char dir[] = "/tmp/mapper_writeXXXXXX", path[256], written[256], rewritten[256];
+    char cache[272], post[300];
+    char *first, *second;
+    t_atom args[4];
+    void *x, *y;
+
+    CHECK(mkdtemp(dir) != 0);
+    host_set_search_dir(dir);
+    snprintf(path, sizeof(path), "%s/def.json", dir);
+    snprintf(written, sizeof(written), "%s/written.json", dir);
+    snprintf(rewritten, sizeof(rewritten), "%s/rewritten.json", dir);
+    snprintf(cache, sizeof(cache), "%s.cache", written);
+    write_file(path, written_definition);
+
+    host_clear_posts();
+    host_set_sym(args, "@definition");
+    host_set_sym(args + 1, "def.json");
+    host_set_sym(args + 2, "@cache");
+    host_set_int(args + 3, 1);
+    x = host_new("mapper", 4, args);
+    CHECK(x != 0);
+    if (!x)
+        return;
+    host_set_sym(args, "written.json");
+    host_send(x, "write", 1, args);
+    snprintf(post, sizeof(post), "Wrote 3 signals to %s", written);
+    CHECK(loopback_num_posts(post) == 1);
+    CHECK(access(cache, R_OK) == 0);
+
+    // the second object reads the cache of the written file, then writes it out again
+    host_clear_posts();
+    host_set_sym(args, "@definition");
+    host_set_sym(args + 1, "written.json");
+    y = host_new("mapper", 4, args);
+    CHECK(y != 0);
+    CHECK(loopback_num_posts("Mapped cache of 3 signals") == 1);
+    if (y) {
+        host_set_sym(args, "rewritten.json");
+        host_send(y, "write", 1, args);
+        host_free(y);
+    }
+    host_free(x);
+    host_advance(10);
+
+    first = read_file(written);
+    second = read_file(rewritten);
+    CHECK(first && second && strcmp(first, second) == 0);
+    CHECK(first && strstr(first, "\"name\" : \"hostwrite\""));
+    CHECK(first && strstr(first, "\"units\" : \"m\""));
+    CHECK(first && strstr(first, "\"minimum\" : 0.0"));
+    CHECK(first && strstr(first, "\"maximum\" : 1.5"));
+    CHECK(first && strstr(first, "\"minimum\" : [0, -1]"));
+    CHECK(first && strstr(first, "\"maximum\" : [10, 20]"));
+    CHECK(first && strstr(first, "\"instances\" : 3"));
+    CHECK(first && strstr(first, "\"label\" : \"left\""));
+    CHECK(first && strstr(first, "\"gain\" : 2"));
+    CHECK(first && strstr(first, "\"active\" : true"));
+    CHECK(first && strstr(first, "\"name\" : \"out1\""));
+    free(first);
+    free(second);
+
+    remove(cache);
+    snprintf(cache, sizeof(cache), "%s.cache", rewritten);
+    remove(cache);
+    snprintf(cache, sizeof(cache), "%s.cache", path);
+    remove(cache);
+    remove(rewritten);
+    remove(written);
+    remove(path);
+    rmdir(dir);
+    host_set_search_dir(".");
+}
+
+static void *new_defined(const char *name)
+{
+    t_atom args[2];
+    host_set_sym(args, "@definition");
+    host_set_sym(args + 1, name);
+    return host_new("mapper", 2, args);
+}
+
+static const char *unicode_definition[3] = {
+    "{\"device\": {\"name\": \"hostuni\", \"inputs\": [{\"name\": \"caf\\u00e9\\ud83c\\udfb9\", \"type\": \"f\"}]}}\n",
+    "{\"device\": {\"name\": \"hostuni\", \"inputs\": [{\"name\": \"in\\u0000\", \"type\": \"f\"}]}}\n",
+    "{\"device\": {\"name\": \"hostuni\", \"inputs\": [{\"name\": \"in\\ud83c\", \"type\": \"f\"}]}}\n",
+};
+
+// \u escapes decode to UTF-8 with surrogate pairs combined, while \u0000 and a
+// surrogate without its pair fail to parse
+static void test_unicode(void)
+{
+    static const char *errors[3] = {0, "null character in string", "unpaired surrogate"};
+    char dir[] = "/tmp/mapper_unicodeXXXXXX", path[256], written[256], post[320];
+    char *text;
+    t_atom args[2];
+    void *x;
+    int i;
+
+    CHECK(mkdtemp(dir) != 0);
+    host_set_search_dir(dir);
+    snprintf(path, sizeof(path), "%s/unicode.json", dir);
+    snprintf(written, sizeof(written), "%s/written.json", dir);
+    for (i = 0; i < 3; i++) {
+        write_file(path, unicode_definition[i]);
+        host_clear_posts();
+        x = new_defined("unicode.json");
+        CHECK(x != 0);
+        if (!x)
+            continue;
+        if (errors[i]) {
+            snprintf(post, sizeof(post), "Could not parse file %s: %s on line 1", path, errors[i]);
+            CHECK(loopback_num_posts(post) == 1);
+        }
+        else {
+            CHECK(loopback_num_posts("Parsed 1 signals") == 1);
+            host_set_sym(args, "written.json");
+            host_send(x, "write", 1, args);
+        }
+        host_free(x);
+        host_advance(10);
+    }
+    text = read_file(written);
+    CHECK(text && strstr(text, "\"name\" : \"caf\xc3\xa9\xf0\x9f\x8e\xb9\""));
+    free(text);
+
+    remove(written);
+    remove(path);
+    rmdir(dir);
+    host_set_search_dir(".");
+}
+
+typedef struct _sig_wait
+{
+    mpr_graph graph;
+    const char *device;
+    const char *name;
+    int type;           // 0 while waiting for the signal to go
+} t_sig_wait;
+
+static int sig_settled(void *data)
+{
+    t_sig_wait *w = (t_sig_wait *)data;
+    mpr_sig sig = loopback_find_sig(w->graph, w->device, w->name);
+    if (!w->type)
+        return !sig;
+    return sig && mpr_obj_get_prop_as_int32(sig, MPR_PROP_TYPE, NULL) == w->type;
+}
+
+static const char *reloaded_definition[2] = {
+    "{\"device\": {\"name\": \"hostreload\", \"inputs\": [\n"
+    "  {\"name\": \"keep\", \"type\": \"f\", \"minimum\": 0, \"maximum\": 1},\n"
+    "  {\"name\": \"retype\", \"type\": \"f\"},\n"
+    "  {\"name\": \"rename\", \"type\": \"f\"}]}}\n",
+    "{\"device\": {\"name\": \"hostreload\", \"inputs\": [\n"
+    "  {\"name\": \"keep\", \"type\": \"f\", \"minimum\": 0, \"maximum\": 2},\n"
+    "  {\"name\": \"retype\", \"type\": \"i\"},\n"
+    "  {\"name\": \"renamed\", \"type\": \"f\"}]}}\n"
+};
+
+// "reload" applies the changes of a definition in place: a changed range updates the
+// signal and keeps its map, a changed type recreates the signal and a new name replaces it
+static void test_reload(mpr_graph graph)
+{
+    char dir[] = "/tmp/mapper_reloadXXXXXX", path[256];
+    t_sig_wait renamed = {graph, "hostreload", "rename", 0};
+    t_sig_wait retyped = {graph, "hostreload", "retype", MPR_INT32};
+    float value = 0.5f;
+    mpr_sig sig;
+    void *x;
+
+    CHECK(mkdtemp(dir) != 0);
+    host_set_search_dir(dir);
+    snprintf(path, sizeof(path), "%s/reload.json", dir);
+    write_file(path, reloaded_definition[0]);
+
+    host_clear_posts();
+    x = receiver = new_defined("reload.json");
+    CHECK(x != 0);
+    if (!x)
+        return;
+    tester = mpr_dev_new("hosttest", 0);
+    sig = mpr_sig_new(tester, MPR_DIR_OUT, "/x", 1, MPR_FLT, 0, 0, 0, 0, 0, 0);
+    loopback_set_device(tester);
+    CHECK(loopback_run(graph, tester_ready, 0, TIMEOUT_MS) == 0);
+    CHECK(loopback_map(graph, "hosttest", "/x", "hostreload", "keep", TIMEOUT_MS) != 0);
+
+    write_file(path, reloaded_definition[1]);
+    host_send(x, "reload", 0, 0);
+    CHECK(loopback_num_posts("1 added, 1 removed, 1 updated, 1 recreated") == 1);
+    CHECK(loopback_run(graph, sig_settled, &renamed, TIMEOUT_MS) == 0);
+    CHECK(loopback_run(graph, sig_settled, &retyped, TIMEOUT_MS) == 0);
+    CHECK(loopback_find_sig(graph, "hostreload", "renamed") != 0);
+
+    host_clear_records();
+    send_burst(sig, 0, &value, 1);
+    CHECK(loopback_run(graph, received_value, &value, TIMEOUT_MS) == 0);
+    CHECK(find_output(x, "keep") != 0);
+
+    loopback_set_device(0);
+    mpr_dev_free(tester);
+    host_free(x);
+    remove(path);
+    rmdir(dir);
+    host_set_search_dir(".");
+}
+
+static const char *adopted_definition[2] = {
+    "{\"device\": {\"name\": \"hostadopt\", \"inputs\": [\n"
+    "  {\"name\": \"keep\", \"type\": \"f\"},\n"
+    "  {\"name\": \"change\", \"type\": \"f\"}],\n"
+    "  \"outputs\": [{\"name\": \"gone\", \"type\": \"f\"}]}}\n",
+    "{\"device\": {\"name\": \"hostadopt\", \"inputs\": [\n"
+    "  {\"name\": \"keep\", \"type\": \"f\"},\n"
+    "  {\"name\": \"change\", \"type\": \"i\"}],\n"
+    "  \"outputs\": [{\"name\": \"added\", \"type\": \"f\"}]}}\n"
+};
+
+// a [mapper] with the same name takes over the device of a freed one and reconciles it
+// with its own definition: a signal defined alike keeps its map, one defined with another
+// type is recreated without it, one left out is dropped and a new one is added
+static void test_adoption(mpr_graph graph)
+{
+    char dir[] = "/tmp/mapper_adoptXXXXXX", path[2][256];
+    t_sig_wait gone = {graph, "hostadopt", "gone", 0};
+    t_sig_wait changed = {graph, "hostadopt", "change", MPR_INT32};
+    float value = 0.5f;
+    mpr_sig sig;
+    void *x;
+    int i;
+
+    CHECK(mkdtemp(dir) != 0);
+    host_set_search_dir(dir);
+    for (i = 0; i < 2; i++) {
+        snprintf(path[i], sizeof(path[i]), "%s/adopt%d.json", dir, i);
+        write_file(path[i], adopted_definition[i]);
+    }
+
+    host_clear_posts();
+    x = receiver = new_defined("adopt0.json");
+    CHECK(x != 0);
+    if (!x)
+        return;
+    tester = mpr_dev_new("hosttest", 0);
+    sig = mpr_sig_new(tester, MPR_DIR_OUT, "/x", 1, MPR_FLT, 0, 0, 0, 0, 0, 0);
+    loopback_set_device(tester);
+    CHECK(loopback_run(graph, tester_ready, 0, TIMEOUT_MS) == 0);
+    CHECK(loopback_map(graph, "hosttest", "/x", "hostadopt", "keep", TIMEOUT_MS) != 0);
+    CHECK(loopback_map(graph, "hosttest", "/x", "hostadopt", "change", TIMEOUT_MS) != 0);
+    host_clear_records();
+    send_burst(sig, 0, &value, 1);
+    CHECK(loopback_run(graph, received_value, &value, TIMEOUT_MS) == 0);
+    host_free(x);
+
+    x = receiver = new_defined("adopt1.json");
+    CHECK(x != 0);
+    if (!x)
+        return;
+    CHECK(loopback_num_posts("Adopting released device") == 1);
+    CHECK(loopback_num_posts("1 added, 1 removed, 0 updated, 1 recreated") == 1);
+    CHECK(loopback_run(graph, sig_settled, &gone, TIMEOUT_MS) == 0);
+    CHECK(loopback_run(graph, sig_settled, &changed, TIMEOUT_MS) == 0);
+
+    // only the signal that kept its type still receives the update
+    host_clear_records();
+    value = 0.25f;
+    send_burst(sig, 0, &value, 1);
+    CHECK(loopback_run(graph, received_value, &value, TIMEOUT_MS) == 0);
+    host_advance(10);
+    CHECK(find_output(x, "keep") != 0);
+    CHECK(find_output(x, "change") == 0);
+
+    loopback_set_device(0);
+    mpr_dev_free(tester);
+    host_free(x);
+    for (i = 0; i < 2; i++)
+        remove(path[i]);
+    rmdir(dir);
+    host_set_search_dir(".");
+}
+
+static void add_held(void *x, int coalesce)
+{
+    t_atom args[8];
+    host_set_sym(args, "input");
+    host_set_sym(args + 1, "/held");
+    host_set_sym(args + 2, "@type");
+    host_set_sym(args + 3, "f");
+    host_set_sym(args + 4, "@instances");
+    host_set_int(args + 5, 2);
+    host_set_sym(args + 6, "@coalesce");
+    host_set_int(args + 7, coalesce);
+    host_send(x, "add", 8, args);
+}
+
+static void test_coalesce(mpr_graph graph)
+{
+    float burst[3] = {0.25f, 0.5f, 0.75f}, last = 1.f;
+    const t_host_record *r, *held;
+    int i, num_inst = 2, count, value_at = -1, release_at = -1;
+    mpr_sig sig;
+    void *dst;
+
+    host_clear_posts();
+    dst = receiver = new_mapper("hostheld");
+    CHECK(dst != 0);
+    if (!dst)
+        return;
+    add_held(dst, 1);
+    tester = mpr_dev_new("hosttest", 0);
+    sig = mpr_sig_new(tester, MPR_DIR_OUT, "/burst", 1, MPR_FLT, 0, 0, 0, &num_inst, 0, 0);
+    loopback_set_device(tester);
+    CHECK(loopback_run(graph, tester_ready, 0, TIMEOUT_MS) == 0);
+    CHECK(loopback_map(graph, "hosttest", "/burst", "hostheld", "/held", TIMEOUT_MS) != 0);
+
+    // updates arriving in one poll come out once, with the number of those replaced
+    host_clear_records();
+    send_burst(sig, 1, burst, 3);
+    CHECK(loopback_run(graph, received_value, &burst[2], TIMEOUT_MS) == 0);
+    held = last_output(dst, 0, "/held", &count);
+    CHECK(count == 1);
+    r = last_output(dst, 1, "coalesced", 0);
+    CHECK(r && r->argc == 3 && host_get_float(r->argv + 2) == 2);
+    CHECK(r && held && held->argc == 2 && host_get_float(r->argv + 1) == host_get_float(held->argv));
+
+    // a value held back is output ahead of the release of its instance
+    host_clear_records();
+    mpr_sig_set_value(sig, 1, 1, MPR_FLT, &last);
+    mpr_dev_poll(tester, 0);
+    mpr_sig_release_inst(sig, 1);
+    mpr_dev_poll(tester, 0);
+    CHECK(loopback_run(graph, received_release, 0, TIMEOUT_MS) == 0);
+    for (i = 0; i < host_num_records(); i++) {
+        r = host_get_record(i);
+        if (r->obj != dst || r->outlet || r->argc < 2)
+            continue;
+        if (host_is_number(r->argv + 1) && host_get_float(r->argv + 1) == last)
+            value_at = i;
+        else if (!host_is_number(r->argv + 1))
+            release_at = i;
+    }
+    CHECK(value_at >= 0 && value_at < release_at);
+
+    // with @coalesce 0 every update comes out again
+    add_held(dst, 0);
+    host_clear_records();
+    send_burst(sig, 1, burst, 3);
+    CHECK(loopback_run(graph, received_value, &burst[2], TIMEOUT_MS) == 0);
+    last_output(dst, 0, "/held", &count);
+    CHECK(count == 3);
+    CHECK(!last_output(dst, 1, "coalesced", 0));
+
+    loopback_set_device(0);
+    mpr_dev_free(tester);
+    host_free(dst);
+}
+
+static void add_notified(void *x, const char *name, int notify)
+{
+    t_atom args[6];
+    host_set_sym(args, "input");
+    host_set_sym(args + 1, name);
+    host_set_sym(args + 2, "@type");
+    host_set_sym(args + 3, "f");
+    host_set_sym(args + 4, "@notify");
+    host_set_int(args + 5, notify);
+    host_send(x, "add", 6, args);
+}
+
+// "get" outputs the current value of the signal named in 'data' and whether it did
+static int pulled(void *data)
+{
+    t_atom arg;
+    host_set_sym(&arg, (const char *)data);
+    host_send(receiver, "get", 1, &arg);
+    return last_output(receiver, 0, (const char *)data, 0) != 0;
+}
+
+// an input added with @notify 0 keeps its updates to itself until "get" reads them
+static void test_get(mpr_graph graph)
+{
+    float value = 0.5f;
+    const t_host_record *r;
+    int count;
+    mpr_sig sig;
+    void *x;
+
+    host_clear_posts();
+    x = receiver = new_mapper("hostpull");
+    CHECK(x != 0);
+    if (!x)
+        return;
+    add_notified(x, "/pull", 0);
+    add_notified(x, "/push", 1);
+    tester = mpr_dev_new("hosttest", 0);
+    sig = mpr_sig_new(tester, MPR_DIR_OUT, "/x", 1, MPR_FLT, 0, 0, 0, 0, 0, 0);
+    loopback_set_device(tester);
+    CHECK(loopback_run(graph, tester_ready, 0, TIMEOUT_MS) == 0);
+    CHECK(loopback_map(graph, "hosttest", "/x", "hostpull", "/pull", TIMEOUT_MS) != 0);
+    CHECK(loopback_map(graph, "hosttest", "/x", "hostpull", "/push", TIMEOUT_MS) != 0);
+
+    // nothing to read before the first update
+    host_clear_records();
+    CHECK(!pulled("/pull"));
+
+    host_clear_records();
+    mpr_sig_set_value(sig, 0, 1, MPR_FLT, &value);
+    mpr_dev_poll(tester, 0);
+    CHECK(loopback_run(graph, received_value, &value, TIMEOUT_MS) == 0);
+    CHECK(last_output(x, 0, "/push", 0) != 0);
+    CHECK(loopback_run(graph, pulled, "/pull", TIMEOUT_MS) == 0);
+    host_advance(10);
+    r = last_output(x, 0, "/pull", &count);
+    CHECK(count == 1);
+    CHECK(r && r->argc == 1 && host_get_float(r->argv) == value);
+
+    loopback_set_device(0);
+    mpr_dev_free(tester);
+    host_free(x);
+}
+
+// with @timestamps 1 each update is preceded by its timetag and the time it took to
+// arrive, which also go into the signal's latency histogram
+static void test_timestamps(mpr_graph graph)
+{
+    float value = 0.5f;
+    const t_host_record *stamp = 0, *r;
+    t_atom args[4];
+    int i, count, sum, value_at = -1, stamp_at = -1;
+    mpr_time sent;
+    mpr_sig sig;
+    void *x;
+
+    host_clear_posts();
+    host_set_sym(args, "@alias");
+    host_set_sym(args + 1, "hoststamp");
+    host_set_sym(args + 2, "@timestamps");
+    host_set_int(args + 3, 1);
+    x = receiver = host_new("mapper", 4, args);
+    CHECK(x != 0);
+    if (!x)
+        return;
+    add_signal(x, "input", "/stamped", 1);
+    tester = mpr_dev_new("hosttest", 0);
+    sig = mpr_sig_new(tester, MPR_DIR_OUT, "/x", 1, MPR_FLT, 0, 0, 0, 0, 0, 0);
+    loopback_set_device(tester);
+    CHECK(loopback_run(graph, tester_ready, 0, TIMEOUT_MS) == 0);
+    CHECK(loopback_map(graph, "hosttest", "/x", "hoststamp", "/stamped", TIMEOUT_MS) != 0);
+
+    // the update waits 50 ms before the host polls
+    host_clear_records();
+    mpr_time_set(&sent, MPR_NOW);
+    mpr_sig_set_value(sig, 0, 1, MPR_FLT, &value);
+    mpr_dev_poll(tester, 0);
+    usleep(50000);
+    CHECK(loopback_run(graph, received_value, &value, TIMEOUT_MS) == 0);
+    for (i = 0; i < host_num_records(); i++) {
+        r = host_get_record(i);
+        if (r->obj == x && r->outlet == 1 && strcmp(r->msg->s_name, "timetag") == 0) {
+            stamp = r;
+            stamp_at = i;
+        }
+        else if (r->obj == x && r->outlet == 0 && strcmp(r->msg->s_name, "/stamped") == 0)
+            value_at = i;
+    }
+    CHECK(stamp_at >= 0 && stamp_at < value_at);
+    CHECK(stamp && stamp->argc == 4 && strcmp(host_get_sym(stamp->argv), "/stamped") == 0);
+    if (stamp && stamp->argc == 4) {
+        long sec = (long)host_get_float(stamp->argv + 1);
+        CHECK(sec == sent.sec % 86400 || sec == (sent.sec + 1) % 86400);
+        CHECK(host_get_float(stamp->argv + 2) >= 0 && host_get_float(stamp->argv + 2) < 1);
+        CHECK(host_get_float(stamp->argv + 3) >= 40 && host_get_float(stamp->argv + 3) < TIMEOUT_MS);
+    }
+
+    // "latency" reports count, min, mean, max and a histogram that adds up to the count
+    host_clear_records();
+    host_set_sym(args, "/stamped");
+    host_send(x, "latency", 1, args);
+    r = last_output(x, 1, "latency", &count);
+    CHECK(count == 1 && r && r->argc == 17);
+    if (r && r->argc == 17) {
+        CHECK(host_get_float(r->argv + 1) == 1);
+        CHECK(host_get_float(r->argv + 2) >= 40);
+        CHECK(host_get_float(r->argv + 2) == host_get_float(r->argv + 4));
+        for (i = 5, sum = 0; i < 17; i++)
+            sum += (int)host_get_float(r->argv + i);
+        CHECK(sum == 1);
+        CHECK(host_get_float(r->argv + 5) == 0);
+    }
+
+    // and starts over after "latency reset"
+    host_clear_records();
+    host_set_sym(args + 1, "reset");
+    host_send(x, "latency", 2, args);
+    host_send(x, "latency", 1, args);
+    r = last_output(x, 1, "latency", &count);
+    CHECK(count == 1 && r && r->argc == 17 && host_get_float(r->argv + 1) == 0);
+
+    loopback_set_device(0);
+    mpr_dev_free(tester);
+    host_free(x);
+}
+
+int main(void)
+{
+    void *src, *dst;
+    mpr_graph graph;
+    mpr_map map;
+    const t_host_record *r;
+    t_atom values[2], edit[3];
+
+    if (host_load(MAPPER_MODULE))
+        return 1;
+    test_definition_cache();
+    test_write();
+    test_unicode();
+
+    src = new_mapper("hostsrc");
+    dst = new_mapper("hostdst");
+    CHECK(src && dst);
+    if (!src || !dst)
+        return 1;
+    add_signal(src, "output", "/out", 2);
+    add_signal(dst, "input", "/in", 2);
+
+    graph = mpr_graph_new(MPR_OBJ);
+    CHECK(loopback_run(graph, both_ready, 0, TIMEOUT_MS) == 0);
+    map = loopback_map(graph, "hostsrc", "/out", "hostdst", "/in", TIMEOUT_MS);
+    CHECK(map != 0);
+
+    host_clear_records();
+    receiver = dst;
+    host_set_float(values, 0.25);
+    host_set_float(values + 1, 0.5);
+    CHECK(host_send(src, "/out", 2, values) == 0);
+    CHECK(loopback_run(graph, received, 0, TIMEOUT_MS) == 0);
+    r = find_output(dst, "/in");
+    CHECK(r && r->argc == 2);
+    CHECK(r && host_get_float(r->argv) == 0.25 && host_get_float(r->argv + 1) == 0.5);
+
+    // "setindex" changes part of the vector and sends all of it
+    host_clear_records();
+    host_set_sym(edit, "/out");
+    host_set_int(edit + 1, 1);
+    host_set_float(edit + 2, 0.75);
+    host_send(src, "setindex", 3, edit);
+    CHECK(loopback_run(graph, received, 0, TIMEOUT_MS) == 0);
+    r = find_output(dst, "/in");
+    CHECK(r && r->argc == 2);
+    CHECK(r && host_get_float(r->argv) == 0.25 && host_get_float(r->argv + 1) == 0.75);
+
+    // and leaves the signal alone when the values would run past its end
+    host_clear_records();
+    host_clear_posts();
+    host_set_int(edit + 1, 2);
+    host_send(src, "setindex", 3, edit);
+    host_advance(10);
+    CHECK(loopback_num_posts("exceeds vector length 2") == 1);
+    CHECK(host_num_records() == 0);
+
+    // selectors that are not signals are dropped without output
+    host_clear_records();
+    host_send(src, "/nothing", 2, values);
+    host_advance(10);
+    CHECK(host_num_records() == 0);
+
+    test_coalesce(graph);
+    test_get(graph);
+    test_timestamps(graph);
+    test_reload(graph);
+    test_adoption(graph);
+
+    host_free(src);
+    host_free(dst);
+#ifdef MAXMSP
+    // both devices wait in the pool until Max quits
+    CHECK(host_num_clocks() == 1);
+    host_quit();
+    CHECK(host_num_clocks() == 0);
+#endif
+    mpr_graph_free(graph);
+    CHECK(host_critical_depth() == 0);
+    if (failures)
+        fprintf(stderr, "%d check(s) failed\n", failures);
+    return failures ? 1 : 0;
+}
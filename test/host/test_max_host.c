@@ -0,0 +1,243 @@
+//
+// test_max_host.c
+// checks the Max host on its own, with a class defined here: clocks in logical time,
+// outlet records, obex, hashtab notifications, attributes and patcher iteration
+//
+
+#include "host.h"
+#include "ext_critical.h"
+#include "jpatcher_api.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+
+static void check(int ok, const char *what, const char *file, int line)
+{
+    if (ok)
+        return;
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+    failures++;
+}
+
+typedef struct _probe
+{
+    t_object ob;
+    void *outlets[2];
+    void *clocks[2];
+    long ticks[2];
+    long rearm;
+    long level;
+    t_symbol *label;
+    t_critical lock;
+    t_hashtab *seen;
+    long seen_new;
+    long seen_free;
+} t_probe;
+
+static t_class *probe_class;
+
+static void probe_tick0(t_probe *x)
+{
+    ++x->ticks[0];
+    outlet_int(x->outlets[0], x->ticks[0]);
+    if (x->rearm && --x->rearm)
+        clock_delay(x->clocks[0], 10);
+}
+
+static void probe_tick1(t_probe *x)
+{
+    ++x->ticks[1];
+    outlet_anything(x->outlets[1], gensym("tick"), 0, 0);
+}
+
+static void *probe_new(t_symbol *s, long argc, t_atom *argv)
+{
+    t_probe *x = (t_probe *)object_alloc(probe_class);
+    x->outlets[1] = outlet_new(x, 0);
+    x->outlets[0] = outlet_new(x, 0);
+    x->clocks[0] = clock_new(x, (method)probe_tick0);
+    x->clocks[1] = clock_new(x, (method)probe_tick1);
+    critical_new(&x->lock);
+    return x;
+}
+
+static void probe_free(t_probe *x)
+{
+    clock_free(x->clocks[0]);
+    clock_free(x->clocks[1]);
+}
+
+static void probe_start(t_probe *x, t_symbol *s, long argc, t_atom *argv)
+{
+    x->rearm = argc ? atom_getlong(argv) : 1;
+    clock_delay(x->clocks[1], 5);
+    clock_delay(x->clocks[0], 5);
+}
+
+static void probe_locked(t_probe *x)
+{
+    critical_enter(x->lock);
+    outlet_list(x->outlets[0], 0, 0, 0);
+    critical_exit(x->lock);
+}
+
+static void probe_deferred(t_probe *x, t_symbol *s, short argc, t_atom *argv)
+{
+    outlet_anything(x->outlets[0], s, argc, argv);
+}
+
+static void probe_later(t_probe *x, t_symbol *s, long argc, t_atom *argv)
+{
+    defer_low(x, (method)probe_deferred, gensym("later"), (short)argc, argv);
+}
+
+static t_max_err probe_notify(t_probe *x, t_symbol *s, t_symbol *msg, void *sender, void *data)
+{
+    t_object *val = 0;
+    if (msg == gensym("hashtab_entry_new"))
+        x->seen_new += hashtab_lookup((t_hashtab *)sender, (t_symbol *)data, &val) == MAX_ERR_NONE;
+    else if (msg == gensym("hashtab_entry_free"))
+        x->seen_free += hashtab_lookup((t_hashtab *)sender, (t_symbol *)data, &val) == MAX_ERR_NONE;
+    return MAX_ERR_NONE;
+}
+
+static long count_probes(long *count, t_object *obj)
+{
+    if (object_classname(obj) == gensym("probe"))
+        ++*count;
+    return 0;
+}
+
+static void setup(void)
+{
+    t_class *c = class_new("probe", (method)probe_new, (method)probe_free, sizeof(t_probe), 0L,
+                           A_GIMME, 0);
+    class_addmethod(c, (method)probe_start, "start", A_GIMME, 0);
+    class_addmethod(c, (method)probe_locked, "locked", 0);
+    class_addmethod(c, (method)probe_later, "later", A_GIMME, 0);
+    class_addmethod(c, (method)probe_notify, "notify", A_CANT, 0);
+    CLASS_ATTR_LONG(c, "level", 0, t_probe, level);
+    CLASS_ATTR_SYM(c, "label", 0, t_probe, label);
+    class_register(CLASS_BOX, c);
+    probe_class = c;
+}
+
+static void test_clocks_and_outlets(void)
+{
+    t_probe *x = (t_probe *)host_new("probe", 0, 0);
+    t_atom a;
+    const t_host_record *r;
+
+    host_set_int(&a, 3);
+    CHECK(host_send(x, "start", 1, &a) == 0);
+    CHECK(host_num_clocks() == 2);
+    host_advance(4);
+    CHECK(host_num_records() == 0);
+
+    // both clocks are due at 5 and fire in the order they were set
+    host_advance(1);
+    CHECK(host_num_records() == 2);
+    r = host_get_record(0);
+    CHECK(r && r->outlet == 1 && r->msg == gensym("tick") && r->time == 5);
+    r = host_get_record(1);
+    CHECK(r && r->outlet == 0 && r->msg == gensym("int") && r->argc == 1);
+    CHECK(r && atom_getlong(r->argv) == 1);
+
+    // a clock set again from its callback fires within the same advance
+    host_advance(100);
+    CHECK(x->ticks[0] == 3 && x->ticks[1] == 1);
+    r = host_get_record(host_num_records() - 1);
+    CHECK(r && r->time == 25);
+    CHECK(host_num_clocks() == 0);
+    CHECK(host_time() == 105);
+
+    host_clear_records();
+    CHECK(host_send(x, "locked", 0, 0) == 0);
+    CHECK(host_critical_depth() == 0);
+    CHECK(host_num_records() == 1 && host_get_record(0)->msg == gensym("list"));
+
+    // defer_low() waits for the next advance
+    host_clear_records();
+    host_set_sym(&a, "x");
+    host_send(x, "later", 1, &a);
+    CHECK(host_num_records() == 0);
+    host_advance(0);
+    CHECK(host_num_records() == 1 && host_get_record(0)->msg == gensym("later"));
+    CHECK(host_get_record(0)->argc == 1 && strcmp(host_get_sym(host_get_record(0)->argv), "x") == 0);
+
+    CHECK(host_send(x, "nonsense", 0, 0) != 0);
+    host_free(x);
+    host_clear_records();
+}
+
+static void test_attributes(void)
+{
+    t_probe *x = (t_probe *)host_new("probe", 0, 0);
+    t_atom a;
+    host_set_int(&a, 7);
+    CHECK(object_attr_setvalueof(x, gensym("level"), 1, &a) == MAX_ERR_NONE);
+    CHECK(x->level == 7 && object_attr_getlong(x, gensym("level")) == 7);
+    host_set_sym(&a, "name");
+    object_attr_setvalueof(x, gensym("label"), 1, &a);
+    CHECK(object_attr_getsym(x, gensym("label")) == gensym("name"));
+    CHECK(object_attr_setvalueof(x, gensym("missing"), 1, &a) != MAX_ERR_NONE);
+    host_free(x);
+}
+
+static void test_hashtab_and_obex(void)
+{
+    t_object *patcher = host_patcher_new(0);
+    t_object *sub = host_patcher_new(patcher), *val = 0;
+    t_probe *x, *y;
+    t_hashtab *ht = hashtab_new(0);
+    long count = 0, result = 0;
+
+    host_patcher_set(patcher);
+    x = (t_probe *)host_new("probe", 0, 0);
+    host_patcher_set(sub);
+    y = (t_probe *)host_new("probe", 0, 0);
+
+    CHECK(object_obex_lookup(x, gensym("#P"), &val) == MAX_ERR_NONE && val == patcher);
+    CHECK(object_obex_lookup(y, gensym("#P"), &val) == MAX_ERR_NONE && val == sub);
+    CHECK(jpatcher_get_parentpatcher(sub) == patcher);
+    CHECK(object_obex_lookup(patcher, gensym("mprhash"), &val) != MAX_ERR_NONE && !val);
+    object_obex_store(patcher, gensym("mprhash"), (t_object *)ht);
+    CHECK(object_obex_lookup(patcher, gensym("mprhash"), &val) == MAX_ERR_NONE && val == (t_object *)ht);
+
+    // the entry can still be looked up while its removal is notified
+    object_attach_byptr_register(x, ht, CLASS_NOBOX);
+    hashtab_storeflags(ht, gensym("y"), (t_object *)y, OBJ_FLAG_REF);
+    CHECK(x->seen_new == 1);
+    CHECK(hashtab_getsize(ht) == 1);
+    hashtab_chuckkey(ht, gensym("y"));
+    CHECK(x->seen_free == 1);
+    CHECK(hashtab_getsize(ht) == 0);
+    object_detach_byptr(x, ht);
+    hashtab_storeflags(ht, gensym("y"), (t_object *)y, OBJ_FLAG_REF);
+    CHECK(x->seen_new == 1);
+
+    object_method(patcher, gensym("iterate"), count_probes, &count, PI_DEEP, &result);
+    CHECK(count == 2);
+    count = 0;
+    object_method(patcher, gensym("iterate"), count_probes, &count, 0, &result);
+    CHECK(count == 1);
+
+    // freeing the patcher frees its boxes and its obex entries, including the hashtab,
+    // which holds its value only by reference
+    host_patcher_free(patcher);
+}
+
+int main(void)
+{
+    setup();
+    test_clocks_and_outlets();
+    test_attributes();
+    test_hashtab_and_obex();
+    host_reset();
+    if (failures)
+        fprintf(stderr, "%d check(s) failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,489 @@
+//
+// test_mpr.c
+// loads mpr.device, mpr.in and mpr.out and builds two patchers, each with an
+// [mpr.device] and a signal object: [mpr.out] created before its device, which must
+// find it when it attaches, and [mpr.in] created after, which must find the device
+// itself. The signals are mapped over libmapper and a value sent to [mpr.out] must
+// come out of [mpr.in]. The devices freed with their patchers wait in the pool until
+// the host quits. A device adopted by a new patcher keeps the maps of the signals it
+// declares alike, and an instanced [mpr.in] outlived by its device must not be reached
+// through the adopted signal. An [mpr.in] with @notify 0 only outputs when banged, and
+// '@offset' makes [mpr.out] send its vector with part of it changed. With @timestamps
+// an [mpr.in] precedes each value with its timetag and latency.
+//
+
+#include "loopback.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TIMEOUT_MS 10000
+
+static int failures = 0;
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+
+static void check(int ok, const char *what, const char *file, int line)
+{
+    if (ok)
+        return;
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+    failures++;
+}
+
+static void *new_object(const char *cls, const char *arg1, const char *arg2)
+{
+    t_atom args[2];
+    host_set_sym(args, arg1);
+    if (arg2)
+        host_set_sym(args + 1, arg2);
+    return host_new(cls, arg2 ? 2 : 1, args);
+}
+
+static int both_ready(void *data)
+{
+    return loopback_num_posts("Joining mapping network") >= 2;
+}
+
+static void *receiver;
+
+// the "stats" line a device outputs for one of its signals, or 0
+static const t_host_record *get_stats(void *device, const char *name)
+{
+    t_atom arg;
+    int i;
+    host_clear_records();
+    host_set_sym(&arg, name);
+    host_send(device, "stats", 1, &arg);
+    for (i = 0; i < host_num_records(); i++) {
+        const t_host_record *r = host_get_record(i);
+        if (r->obj == device && r->msg == gensym("stats") && r->argc == 9)
+            return r;
+    }
+    return 0;
+}
+
+static int received(void *data)
+{
+    int i;
+    for (i = 0; i < host_num_records(); i++) {
+        if (host_get_record(i)->obj == receiver)
+            return 1;
+    }
+    return 0;
+}
+
+static mpr_dev tester;
+
+static int tester_ready(void *data)
+{
+    return mpr_dev_get_is_ready(tester) && loopback_num_posts("Joining mapping network");
+}
+
+// an [mpr.in] with an instance number in a patcher of its own, after its device
+static void *new_instanced_in(t_object **patcher, void **device, const char *name)
+{
+    t_atom args[4];
+    *patcher = host_patcher_new(0);
+    host_patcher_set(*patcher);
+    *device = new_object("mpr.device", "hostpoly", 0);
+    host_set_sym(args, name);
+    host_set_sym(args + 1, "f");
+    host_set_sym(args + 2, "@instance");
+    host_set_int(args + 3, 1);
+    return host_new("mpr.in", 4, args);
+}
+
+// send a value from the test's device and wait until the receiver outputs something
+static int send_value(mpr_sig sig, mpr_id inst, float value)
+{
+    mpr_sig_set_value(sig, inst, 1, MPR_FLT, &value);
+    mpr_dev_poll(tester, 0);
+    usleep(10000);
+    return loopback_run(0, received, 0, TIMEOUT_MS);
+}
+
+// a device freed before its instanced [mpr.in] leaves no per-instance list pointing at
+// the object, so that the device's new owner only outputs through its own [mpr.in]
+static void test_instanced_adoption(mpr_graph graph)
+{
+    t_object *patcher;
+    void *device, *in;
+    int i, num_inst = 2, count;
+    mpr_sig sig;
+
+    host_clear_posts();
+    in = new_instanced_in(&patcher, &device, "/poly");
+    tester = mpr_dev_new("hosttest", 0);
+    sig = mpr_sig_new(tester, MPR_DIR_OUT, "/src", 1, MPR_FLT, 0, 0, 0, &num_inst, 0, 0);
+    loopback_set_device(tester);
+    CHECK(in && device);
+    CHECK(loopback_run(graph, tester_ready, 0, TIMEOUT_MS) == 0);
+    CHECK(loopback_map(graph, "hosttest", "/src", "hostpoly", "/poly", TIMEOUT_MS) != 0);
+    host_clear_records();
+    receiver = in;
+    CHECK(send_value(sig, 1, 0.5f) == 0);
+
+    host_free(device);
+    host_free(in);
+    host_patcher_free(patcher);
+
+    in = new_instanced_in(&patcher, &device, "/poly");
+    CHECK(loopback_num_posts("Adopting released device") == 1);
+    host_clear_records();
+    receiver = in;
+    CHECK(send_value(sig, 1, 0.25f) == 0);
+    for (i = 0, count = 0; i < host_num_records(); i++) {
+        const t_host_record *r = host_get_record(i);
+        if (r->msg == gensym("float")) {
+            CHECK(r->obj == in && host_get_float(r->argv) == 0.25);
+            count++;
+        }
+    }
+    CHECK(count == 1);
+
+    loopback_set_device(0);
+    mpr_dev_free(tester);
+    host_patcher_free(patcher);
+}
+
+typedef struct _sig_wait
+{
+    mpr_graph graph;
+    const char *name;
+    int type;           // 0 while waiting for the signal to go
+} t_sig_wait;
+
+static int sig_settled(void *data)
+{
+    t_sig_wait *w = (t_sig_wait *)data;
+    mpr_sig sig = loopback_find_sig(w->graph, "hostadopt", w->name);
+    if (!w->type)
+        return !sig;
+    return sig && mpr_obj_get_prop_as_int32(sig, MPR_PROP_TYPE, NULL) == w->type;
+}
+
+// a new patcher with an [mpr.device] of the same name takes over the device of a freed
+// one: a signal it declares alike keeps its map, one declared with another type is
+// recreated without it, and one it does not declare is dropped
+static void test_adoption(mpr_graph graph)
+{
+    t_object *patcher;
+    void *keep, *change;
+    t_sig_wait gone = {graph, "/gone", 0}, changed = {graph, "/change", MPR_INT32};
+    mpr_sig sig;
+    int i;
+
+    host_clear_posts();
+    patcher = host_patcher_new(0);
+    host_patcher_set(patcher);
+    CHECK(new_object("mpr.device", "hostadopt", 0) != 0);
+    keep = new_object("mpr.in", "/keep", "f");
+    change = new_object("mpr.in", "/change", "f");
+    CHECK(new_object("mpr.in", "/gone", "f") != 0);
+    tester = mpr_dev_new("hosttest", 0);
+    sig = mpr_sig_new(tester, MPR_DIR_OUT, "/x", 1, MPR_FLT, 0, 0, 0, 0, 0, 0);
+    loopback_set_device(tester);
+    CHECK(loopback_run(graph, tester_ready, 0, TIMEOUT_MS) == 0);
+    CHECK(loopback_map(graph, "hosttest", "/x", "hostadopt", "/keep", TIMEOUT_MS) != 0);
+    CHECK(loopback_map(graph, "hosttest", "/x", "hostadopt", "/change", TIMEOUT_MS) != 0);
+    host_clear_records();
+    receiver = change;
+    CHECK(send_value(sig, 0, 0.5f) == 0);
+    host_patcher_free(patcher);
+
+    patcher = host_patcher_new(0);
+    host_patcher_set(patcher);
+    CHECK(new_object("mpr.device", "hostadopt", 0) != 0);
+    CHECK(loopback_num_posts("Adopting released device") == 1);
+    keep = new_object("mpr.in", "/keep", "f");
+    change = new_object("mpr.in", "/change", "i");
+    CHECK(loopback_run(graph, sig_settled, &gone, TIMEOUT_MS) == 0);
+    CHECK(loopback_run(graph, sig_settled, &changed, TIMEOUT_MS) == 0);
+
+    host_clear_records();
+    receiver = keep;
+    CHECK(send_value(sig, 0, 0.25f) == 0);
+    host_advance(10);
+    for (i = 0; i < host_num_records(); i++) {
+        const t_host_record *r = host_get_record(i);
+        CHECK(r->obj != change);
+        if (r->obj == keep)
+            CHECK(r->msg == gensym("float") && host_get_float(r->argv) == 0.25);
+    }
+
+    loopback_set_device(0);
+    mpr_dev_free(tester);
+    host_patcher_free(patcher);
+}
+
+// an [mpr.in] with @notify 0 outputs its signal's current value on a bang only
+static void test_bang(mpr_graph graph)
+{
+    t_object *patcher;
+    void *pull, *push;
+    t_atom args[4];
+    int i, count;
+    mpr_sig sig;
+
+    host_clear_posts();
+    patcher = host_patcher_new(0);
+    host_patcher_set(patcher);
+    CHECK(new_object("mpr.device", "hostpull", 0) != 0);
+    host_set_sym(args, "/pull");
+    host_set_sym(args + 1, "f");
+    host_set_sym(args + 2, "@notify");
+    host_set_int(args + 3, 0);
+    pull = host_new("mpr.in", 4, args);
+    push = new_object("mpr.in", "/push", "f");
+    CHECK(pull && push);
+    tester = mpr_dev_new("hosttest", 0);
+    sig = mpr_sig_new(tester, MPR_DIR_OUT, "/x", 1, MPR_FLT, 0, 0, 0, 0, 0, 0);
+    loopback_set_device(tester);
+    CHECK(loopback_run(graph, tester_ready, 0, TIMEOUT_MS) == 0);
+    CHECK(loopback_map(graph, "hosttest", "/x", "hostpull", "/pull", TIMEOUT_MS) != 0);
+    CHECK(loopback_map(graph, "hosttest", "/x", "hostpull", "/push", TIMEOUT_MS) != 0);
+
+    // nothing to read before the first update
+    host_clear_records();
+    host_send(pull, "bang", 0, 0);
+    CHECK(host_num_records() == 0);
+
+    receiver = push;
+    CHECK(send_value(sig, 0, 0.5f) == 0);
+    host_advance(10);
+    host_send(pull, "bang", 0, 0);
+    for (i = 0, count = 0; i < host_num_records(); i++) {
+        const t_host_record *r = host_get_record(i);
+        if (r->obj == pull) {
+            CHECK(r->msg == gensym("float") && host_get_float(r->argv) == 0.5);
+            count++;
+        }
+    }
+    CHECK(count == 1);
+    CHECK(host_critical_depth() == 0);
+
+    loopback_set_device(0);
+    mpr_dev_free(tester);
+    host_patcher_free(patcher);
+}
+
+// the last vector received by the test's input and how many updates brought it
+static float vector[3];
+static int vector_updates;
+
+static void vector_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
+                           mpr_type type, const void *val, mpr_time time)
+{
+    if (val && MPR_FLT == type && len == 3) {
+        memcpy(vector, val, sizeof(vector));
+        ++vector_updates;
+    }
+}
+
+static int vector_received(void *data)
+{
+    return vector_updates >= *(int *)data;
+}
+
+// send '@offset' and its arguments to an [mpr.out] and wait for the update it makes
+static int send_offset(void *out, int offset, float value)
+{
+    t_atom args[2];
+    int updates = vector_updates + 1;
+    host_set_int(args, offset);
+    host_set_float(args + 1, value);
+    host_send(out, "@offset", 2, args);
+    return loopback_run(0, vector_received, &updates, TIMEOUT_MS);
+}
+
+// '@offset' sends the last vector of an [mpr.out] with part of it changed, starting
+// from zeros when nothing was sent yet
+static void test_offset(mpr_graph graph)
+{
+    t_object *patcher;
+    t_atom args[3];
+    void *out;
+    int updates;
+
+    host_clear_posts();
+    patcher = host_patcher_new(0);
+    host_patcher_set(patcher);
+    CHECK(new_object("mpr.device", "hostvec", 0) != 0);
+    host_set_sym(args, "/vec");
+    host_set_sym(args + 1, "f");
+    host_set_int(args + 2, 3);
+    out = host_new("mpr.out", 3, args);
+    CHECK(out != 0);
+    tester = mpr_dev_new("hosttest", 0);
+    mpr_sig_new(tester, MPR_DIR_IN, "/vec", 3, MPR_FLT, 0, 0, 0, 0, vector_handler,
+                MPR_SIG_UPDATE);
+    loopback_set_device(tester);
+    CHECK(loopback_run(graph, tester_ready, 0, TIMEOUT_MS) == 0);
+    CHECK(loopback_map(graph, "hostvec", "/vec", "hosttest", "/vec", TIMEOUT_MS) != 0);
+
+    CHECK(send_offset(out, 1, 0.5f) == 0);
+    CHECK(vector[0] == 0 && vector[1] == 0.5f && vector[2] == 0);
+
+    host_set_float(args, 0.25);
+    host_set_float(args + 1, 0.5);
+    host_set_float(args + 2, 0.75);
+    host_send(out, "list", 3, args);
+    updates = vector_updates + 1;
+    CHECK(loopback_run(0, vector_received, &updates, TIMEOUT_MS) == 0);
+    CHECK(send_offset(out, 2, 1.f) == 0);
+    CHECK(vector[0] == 0.25f && vector[1] == 0.5f && vector[2] == 1.f);
+
+    // values that would run past the end of the vector are refused
+    updates = vector_updates;
+    host_set_int(args, 2);
+    host_send(out, "@offset", 3, args);
+    host_advance(10);
+    CHECK(vector_updates == updates);
+    CHECK(host_critical_depth() == 0);
+
+    loopback_set_device(0);
+    mpr_dev_free(tester);
+    host_patcher_free(patcher);
+}
+
+// an [mpr.in] with @timestamps 1 outputs each update's timetag and latency before the
+// value, and reports the latencies seen so far on "latency"
+static void test_timestamps(mpr_graph graph)
+{
+    t_object *patcher;
+    const t_host_record *r;
+    t_atom args[4];
+    int i, stamp_at = -1, value_at = -1;
+    float value = 0.5f;
+    mpr_time sent;
+    mpr_sig sig;
+    void *in;
+
+    host_clear_posts();
+    patcher = host_patcher_new(0);
+    host_patcher_set(patcher);
+    CHECK(new_object("mpr.device", "hoststamp", 0) != 0);
+    host_set_sym(args, "/stamped");
+    host_set_sym(args + 1, "f");
+    host_set_sym(args + 2, "@timestamps");
+    host_set_int(args + 3, 1);
+    in = host_new("mpr.in", 4, args);
+    CHECK(in != 0);
+    tester = mpr_dev_new("hosttest", 0);
+    sig = mpr_sig_new(tester, MPR_DIR_OUT, "/x", 1, MPR_FLT, 0, 0, 0, 0, 0, 0);
+    loopback_set_device(tester);
+    CHECK(loopback_run(graph, tester_ready, 0, TIMEOUT_MS) == 0);
+    CHECK(loopback_map(graph, "hosttest", "/x", "hoststamp", "/stamped", TIMEOUT_MS) != 0);
+
+    // the update waits 50 ms before the host polls
+    host_clear_records();
+    receiver = in;
+    mpr_time_set(&sent, MPR_NOW);
+    mpr_sig_set_value(sig, 0, 1, MPR_FLT, &value);
+    mpr_dev_poll(tester, 0);
+    usleep(50000);
+    CHECK(loopback_run(0, received, 0, TIMEOUT_MS) == 0);
+    host_advance(10);
+    for (i = 0; i < host_num_records(); i++) {
+        r = host_get_record(i);
+        if (r->obj != in)
+            continue;
+        if (r->msg == gensym("timetag") && r->argc == 3) {
+            long sec = (long)host_get_float(r->argv);
+            CHECK(sec == sent.sec % 86400 || sec == (sent.sec + 1) % 86400);
+            CHECK(host_get_float(r->argv + 2) >= 40);
+            stamp_at = i;
+        }
+        else if (r->msg == gensym("float"))
+            value_at = i;
+    }
+    CHECK(stamp_at >= 0 && stamp_at < value_at);
+
+    host_clear_records();
+    host_send(in, "latency", 0, 0);
+    r = host_num_records() ? host_get_record(0) : 0;
+    CHECK(r && r->msg == gensym("latency") && r->argc == 16);
+    CHECK(r && r->argc == 16 && host_get_float(r->argv) == 1 && host_get_float(r->argv + 1) >= 40);
+
+    host_clear_records();
+    host_set_sym(args, "reset");
+    host_send(in, "latency", 1, args);
+    host_send(in, "latency", 0, 0);
+    r = host_num_records() ? host_get_record(0) : 0;
+    CHECK(r && r->argc == 16 && host_get_float(r->argv) == 0);
+
+    loopback_set_device(0);
+    mpr_dev_free(tester);
+    host_patcher_free(patcher);
+}
+
+int main(void)
+{
+    t_object *patchers[2];
+    void *out, *in, *devices[2];
+    mpr_graph graph;
+    const t_host_record *r;
+    t_atom value;
+
+    if (host_load(MPR_DEVICE_MODULE) || host_load(MPR_IN_MODULE) || host_load(MPR_OUT_MODULE))
+        return 1;
+
+    patchers[0] = host_patcher_new(0);
+    host_patcher_set(patchers[0]);
+    out = new_object("mpr.out", "/out", "f");
+    devices[0] = new_object("mpr.device", "hostsrc", 0);
+
+    patchers[1] = host_patcher_new(0);
+    host_patcher_set(patchers[1]);
+    devices[1] = new_object("mpr.device", "hostdst", 0);
+    in = new_object("mpr.in", "/in", "f");
+
+    CHECK(out && in && devices[0] && devices[1]);
+    if (!out || !in || !devices[0] || !devices[1])
+        return 1;
+
+    graph = mpr_graph_new(MPR_OBJ);
+    CHECK(loopback_run(graph, both_ready, 0, TIMEOUT_MS) == 0);
+    CHECK(loopback_map(graph, "hostsrc", "/out", "hostdst", "/in", TIMEOUT_MS) != 0);
+
+    host_clear_records();
+    receiver = in;
+    host_set_float(&value, 0.75);
+    CHECK(host_send(out, "float", 1, &value) == 0);
+    CHECK(loopback_run(graph, received, 0, TIMEOUT_MS) == 0);
+    r = host_get_record(0);
+    CHECK(r && r->obj == in && r->outlet == 0 && r->msg == gensym("float"));
+    CHECK(r && r->argc == 1 && host_get_float(r->argv) == 0.75);
+    CHECK(host_critical_depth() == 0);
+
+    // [mpr.out] counts the update in the counters its device keeps, [mpr.in]'s device
+    // counts it on arrival
+    r = get_stats(devices[0], "/out");
+    CHECK(r && host_get_float(r->argv + 1) == 0 && host_get_float(r->argv + 2) == 1);
+    r = get_stats(devices[1], "/in");
+    CHECK(r && host_get_float(r->argv + 1) == 1 && host_get_float(r->argv + 2) == 0);
+
+    test_instanced_adoption(graph);
+    test_adoption(graph);
+    test_bang(graph);
+    test_offset(graph);
+    test_timestamps(graph);
+
+    // a signal object freed before its device detaches from it, and the device then
+    // detaches from the rest when it is freed with its patcher
+    host_free(in);
+    host_advance(10);
+    host_patcher_free(patchers[1]);
+    host_patcher_free(patchers[0]);
+
+    // the devices had joined the network, so they wait in the pool until Max quits
+    CHECK(host_num_clocks() == 1);
+    host_quit();
+    CHECK(host_num_clocks() == 0);
+    mpr_graph_free(graph);
+    CHECK(host_critical_depth() == 0);
+    if (failures)
+        fprintf(stderr, "%d check(s) failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,316 @@
+//
+// test_oscmulticast.c
+// loads the oscmulticast external, built for the host this file is compiled for, joins
+// two [oscmulticast] objects to the same group and checks that a message sent by one is
+// received by the other, that subscriptions drop the paths outside them, that @schedule
+// holds bundles until their timetag, that blobs and long messages come through, and
+// that "stats" counts what was received. Skipped when no multicast server can be
+// created, e.g. on a machine without a network interface that allows multicast.
+//
+
+#include "host.h"
+#ifdef MAXMSP
+#include "ext_buffer.h"
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define SKIP 77
+#define TIMEOUT_MS 5000
+
+static int failures = 0;
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+
+static void check(int ok, const char *what, const char *file, int line)
+{
+    if (ok)
+        return;
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+    failures++;
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000. + ts.tv_nsec * 0.000001;
+}
+
+static void *new_oscmulticast(void)
+{
+    t_atom args[4];
+    host_set_sym(args, "@group");
+    host_set_sym(args + 1, "224.0.1.250");
+    host_set_sym(args + 2, "@port");
+    host_set_int(args + 3, 7590);
+    return host_new("oscmulticast", 4, args);
+}
+
+static const t_host_record *find_output(void *x, const char *path)
+{
+    int i;
+    for (i = 0; i < host_num_records(); i++) {
+        const t_host_record *r = host_get_record(i);
+        if (r->obj == x && r->outlet == 0 && strcmp(r->msg->s_name, path) == 0)
+            return r;
+    }
+    return 0;
+}
+
+// advance the host until 'x' outputs a message to 'path' from its left outlet
+static const t_host_record *wait_output(void *x, const char *path)
+{
+    const t_host_record *r;
+    double deadline = now_ms() + TIMEOUT_MS;
+    while (!(r = find_output(x, path)) && now_ms() < deadline)
+        host_advance(1);
+    return r;
+}
+
+static void send_float(void *x, const char *path, double f)
+{
+    t_atom value;
+    host_set_float(&value, f);
+    host_send(x, path, 1, &value);
+}
+
+// subscriptions drop the paths outside them before output, and count what they drop
+static void test_subscribe(void *a, void *b)
+{
+    t_atom args[2];
+
+    host_clear_records();
+    host_set_sym(args, "/keep");
+    host_set_sym(args + 1, "/pat/*");
+    host_send(b, "subscribe", 2, args);
+    send_float(a, "/drop", 1);
+    send_float(a, "/keeper", 2);
+    send_float(a, "/keep/a", 3);
+    send_float(a, "/pat/b", 4);
+    send_float(a, "/keep", 5);
+    CHECK(wait_output(b, "/keep") != 0);
+    CHECK(find_output(b, "/keep/a") && find_output(b, "/pat/b"));
+    CHECK(!find_output(b, "/drop") && !find_output(b, "/keeper"));
+    CHECK(find_output(a, "/drop") != 0);
+
+    host_clear_posts();
+    host_send(b, "subscribe", 0, 0);
+    CHECK(host_num_posts() == 1 && strstr(host_get_post(0), "1 wildcard subscriptions, 2 messages rejected"));
+
+    // with no arguments "unsubscribe" lets everything through again
+    host_clear_records();
+    host_send(b, "unsubscribe", 0, 0);
+    send_float(a, "/drop", 1);
+    CHECK(wait_output(b, "/drop") != 0);
+}
+
+// the last message 'msg' from the right outlet of 'x', or 0
+static const t_host_record *find_status(void *x, const char *msg)
+{
+    const t_host_record *found = 0;
+    int i;
+    for (i = 0; i < host_num_records(); i++) {
+        const t_host_record *r = host_get_record(i);
+        if (r->obj == x && r->outlet == 2 && strcmp(r->msg->s_name, msg) == 0)
+            found = r;
+    }
+    return found;
+}
+
+// with @schedule a bundle comes out at its timetag plus the latency, and one already
+// past it comes out at once after a "late" notice
+static void test_schedule(void *a, void *b)
+{
+    const t_host_record *r;
+    t_atom arg;
+    double held;
+
+    host_clear_records();
+    host_set_int(&arg, 1);
+    host_send(b, "schedule", 1, &arg);
+    host_set_int(&arg, 200);
+    host_send(b, "latency", 1, &arg);
+    send_float(a, "/later", 1);
+    CHECK(wait_output(a, "/later") != 0);
+    held = now_ms();
+    CHECK(!find_output(b, "/later"));
+    host_clear_posts();
+    host_send(b, "schedule", 0, 0);
+    CHECK(host_num_posts() == 1 && strstr(host_get_post(0), "1 messages scheduled, 0 late"));
+    // timetags are in real time, which the host's logical time runs ahead of
+    CHECK(wait_output(b, "/later") != 0);
+    held = now_ms() - held;
+    CHECK(held >= 150 && held < 1000);
+
+    host_clear_records();
+    host_set_int(&arg, -1000);
+    host_send(b, "latency", 1, &arg);
+    send_float(a, "/late", 1);
+    CHECK(wait_output(b, "/late") != 0);
+    r = find_status(b, "late");
+    CHECK(r && r->argc == 1 && host_get_float(r->argv) >= 900);
+
+    // switching @schedule off delivers what is still waiting straight away
+    host_clear_records();
+    host_set_int(&arg, 1000);
+    host_send(b, "latency", 1, &arg);
+    send_float(a, "/held", 1);
+    CHECK(wait_output(a, "/held") != 0);
+    CHECK(!find_output(b, "/held"));
+    host_set_int(&arg, 0);
+    host_send(b, "schedule", 1, &arg);
+    CHECK(find_output(b, "/held") != 0);
+    host_send(b, "latency", 1, &arg);
+}
+
+// a buffer~ in Max or an array in Pd, of 'size' samples, and the address of one of them
+static void *new_table(const char *name, int size)
+{
+#ifdef MAXMSP
+    return host_buffer_new(name, size, 1);
+#else
+    return host_array_new(name, size);
+#endif
+}
+
+static float *table_sample(void *table, int index)
+{
+#ifdef MAXMSP
+    return buffer_locksamples((t_buffer_obj *)table) + index;
+#else
+    int size;
+    t_word *vec;
+    garray_getfloatwords((t_garray *)table, &size, &vec);
+    return &vec[index].w_float;
+#endif
+}
+
+// "sendblob" sends samples as bytes, which the receiver writes to its own table and
+// replaces with their count, cutting them short if the table is too small; messages
+// longer than the initial receive buffer come out whole
+static void test_blob(void *a, void *b)
+{
+    void *source = new_table("blobsource", 4), *dest = new_table("blobdest", 8);
+    void *small = new_table("blobsmall", 2);
+    const t_host_record *r;
+    t_atom args[300];
+    int i;
+
+    for (i = 0; i < 4; i++)
+        *table_sample(source, i) = i + 1;
+    host_clear_records();
+    host_set_sym(args, "blobdest");
+    host_send(b, "blob", 1, args);
+    host_set_sym(args, "/blob");
+    host_set_sym(args + 1, "blobsource");
+    host_send(a, "sendblob", 2, args);
+    r = wait_output(b, "/blob");
+    CHECK(r && r->argc == 1 && host_get_float(r->argv) == 4);
+    for (i = 0; i < 4; i++)
+        CHECK(*table_sample(dest, i) == i + 1);
+    CHECK(*table_sample(dest, 4) == 0);
+
+    // three bytes from the second sample on, into a table of two
+    host_clear_records();
+    host_set_sym(args, "blobsmall");
+    host_send(b, "blob", 1, args);
+    host_set_sym(args, "/small");
+    host_set_sym(args + 1, "blobsource");
+    host_set_int(args + 2, 1);
+    host_send(a, "sendblob", 3, args);
+    r = wait_output(b, "/small");
+    CHECK(r && r->argc == 1 && host_get_float(r->argv) == 2);
+    CHECK(*table_sample(small, 0) == 2 && *table_sample(small, 1) == 3);
+    host_send(b, "stats", 0, 0);
+    r = find_status(b, "truncated");
+    CHECK(r && host_get_float(r->argv) == 1);
+
+    host_clear_records();
+    for (i = 0; i < 300; i++)
+        host_set_float(args + i, i);
+    host_send(a, "/long", 300, args);
+    r = wait_output(b, "/long");
+    CHECK(r && r->argc == 300 && host_get_float(r->argv + 299) == 299);
+    host_send(b, "blob", 0, 0);
+}
+
+// the number in the last status message 'msg' of 'x' after a "stats" message
+static double get_stat(void *x, const char *msg)
+{
+    const t_host_record *r;
+    host_clear_records();
+    host_send(x, "stats", 0, 0);
+    r = find_status(x, msg);
+    return r && r->argc ? host_get_float(r->argv) : -1;
+}
+
+// "stats" counts the packets and messages received and the polls that hit the cap of
+// packets per poll, and "rcvbuf" reports the socket buffer sizes the kernel granted
+static void test_stats(void *a, void *b)
+{
+    const t_host_record *r;
+    t_atom arg;
+    int i;
+
+    host_set_sym(&arg, "reset");
+    host_send(b, "stats", 1, &arg);
+    for (i = 0; i < 25; i++)
+        send_float(a, i < 24 ? "/burst" : "/last", i);
+    CHECK(wait_output(b, "/last") != 0);
+    CHECK(get_stat(b, "packets") == 25);
+    CHECK(get_stat(b, "messages") == 25);
+    CHECK(get_stat(b, "bytes") > 25 * 16);
+    CHECK(get_stat(b, "busy_polls") == 3);
+    CHECK(get_stat(b, "cap_hits") == 2);
+    CHECK(get_stat(b, "max_messages_per_poll") == 10);
+    CHECK(get_stat(b, "messages_per_poll") == (float)(25. / 3.));
+    CHECK(get_stat(b, "rejected") == 0 && get_stat(b, "late") == 0);
+
+    host_clear_records();
+    host_set_int(&arg, 65536);
+    host_send(b, "rcvbuf", 1, &arg);
+    r = find_status(b, "rcvbuf");
+    CHECK(r && r->argc == 2);
+    CHECK(r && host_get_float(r->argv) >= 65536 && host_get_float(r->argv + 1) >= 65536);
+}
+
+int main(void)
+{
+    void *a, *b;
+    const t_host_record *r = 0;
+    t_atom value;
+    int i;
+
+    if (host_load(OSCMULTICAST_MODULE))
+        return 1;
+    a = new_oscmulticast();
+    b = new_oscmulticast();
+    CHECK(a && b);
+    if (!a || !b)
+        return 1;
+    for (i = 0; i < host_num_posts(); i++) {
+        if (strstr(host_get_post(i), "could not create multicast")) {
+            fprintf(stderr, "skipped: %s\n", host_get_post(i));
+            return SKIP;
+        }
+    }
+
+    host_set_float(&value, 0.5);
+    CHECK(host_send(a, "/test", 1, &value) == 0);
+    r = wait_output(b, "/test");
+    CHECK(r && r->argc >= 1 && host_get_float(r->argv) == 0.5);
+
+    test_subscribe(a, b);
+    test_schedule(a, b);
+    test_blob(a, b);
+    test_stats(a, b);
+
+    host_free(a);
+    host_free(b);
+    CHECK(host_num_clocks() == 0);
+    if (failures)
+        fprintf(stderr, "%d check(s) failed\n", failures);
+    return failures ? 1 : 0;
+}
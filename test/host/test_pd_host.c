@@ -0,0 +1,167 @@
+//
+// test_pd_host.c
+// checks the Pd host on its own, with a class defined here: clocks in logical time,
+// outlet records, dispatch to methods and to the anything method, files and tables
+//
+
+#include "host.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+
+static void check(int ok, const char *what, const char *file, int line)
+{
+    if (ok)
+        return;
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+    failures++;
+}
+
+typedef struct _probe
+{
+    t_object ob;
+    t_outlet *outlets[2];
+    t_clock *clock;
+    int ticks;
+    t_symbol *last;
+} t_probe;
+
+static t_class *probe_class;
+
+static void probe_tick(t_probe *x)
+{
+    ++x->ticks;
+    outlet_float(x->outlets[0], x->ticks);
+    if (x->ticks < 3)
+        clock_delay(x->clock, 2.5);
+}
+
+static void *probe_new(t_symbol *s, int argc, t_atom *argv)
+{
+    t_probe *x = (t_probe *)pd_new(probe_class);
+    x->outlets[0] = outlet_new(&x->ob, gensym("list"));
+    x->outlets[1] = outlet_new(&x->ob, gensym("list"));
+    x->clock = clock_new(x, (t_method)probe_tick);
+    return x;
+}
+
+static void probe_free(t_probe *x)
+{
+    clock_free(x->clock);
+}
+
+static void probe_start(t_probe *x, t_symbol *s, int argc, t_atom *argv)
+{
+    clock_delay(x->clock, argc ? atom_getfloat(argv) : 0);
+}
+
+static void probe_anything(t_probe *x, t_symbol *s, int argc, t_atom *argv)
+{
+    x->last = s;
+    outlet_anything(x->outlets[1], s, argc, argv);
+}
+
+static void probe_read(t_probe *x, t_symbol *s, int argc, t_atom *argv)
+{
+    char dir[MAXPDSTRING], *name, path[2 * MAXPDSTRING];
+    int fd = canvas_open(canvas_getcurrent(), atom_getsymbol(argv)->s_name, "", dir, &name,
+                         MAXPDSTRING, 1);
+    if (fd < 0) {
+        outlet_bang(x->outlets[1]);
+        return;
+    }
+    close(fd);
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    outlet_symbol(x->outlets[1], gensym(path));
+}
+
+static void setup(void)
+{
+    probe_class = class_new(gensym("probe"), (t_newmethod)probe_new, (t_method)probe_free,
+                            sizeof(t_probe), 0, A_GIMME, 0);
+    class_addmethod(probe_class, (t_method)probe_start, gensym("start"), A_GIMME, 0);
+    class_addmethod(probe_class, (t_method)probe_read, gensym("read"), A_GIMME, 0);
+    class_addanything(probe_class, probe_anything);
+}
+
+static void test_clocks_and_outlets(void)
+{
+    t_probe *x = (t_probe *)host_new("probe", 0, 0);
+    const t_host_record *r;
+    t_atom a[2];
+
+    host_set_float(a, 10);
+    CHECK(host_send(x, "start", 1, a) == 0);
+    host_advance(9.9);
+    CHECK(x->ticks == 0);
+    host_advance(100);
+    CHECK(x->ticks == 3);
+    CHECK(host_num_records() == 3);
+    r = host_get_record(2);
+    CHECK(r && r->outlet == 0 && r->msg == gensym("float") && r->time == 15);
+    CHECK(r && r->argc == 1 && host_get_float(r->argv) == 3);
+    CHECK(sys_getrealtime() == host_time() * 0.001);
+
+    host_clear_records();
+    host_set_sym(a, "a");
+    host_set_int(a + 1, 2);
+    CHECK(host_send(x, "whatever", 2, a) == 0);
+    CHECK(x->last == gensym("whatever"));
+    r = host_get_record(0);
+    CHECK(r && r->outlet == 1 && r->argc == 2 && host_is_number(r->argv + 1));
+    host_free(x);
+    host_clear_records();
+}
+
+static void test_files_and_tables(void)
+{
+    t_probe *x = (t_probe *)host_new("probe", 0, 0);
+    char dir[] = "/tmp/pd_hostXXXXXX", path[MAXPDSTRING];
+    t_garray *array;
+    t_word *vec;
+    t_atom a;
+    FILE *f;
+    int size;
+
+    CHECK(mkdtemp(dir) != 0);
+    host_set_search_dir(dir);
+    snprintf(path, sizeof(path), "%s/def.json", dir);
+    f = fopen(path, "w");
+    fputs("{}", f);
+    fclose(f);
+
+    host_set_sym(&a, "def.json");
+    host_send(x, "read", 1, &a);
+    CHECK(host_num_records() == 1 && host_get_record(0)->msg == gensym("symbol"));
+    CHECK(strcmp(host_get_sym(host_get_record(0)->argv), path) == 0);
+    host_clear_records();
+    host_set_sym(&a, "missing.json");
+    host_send(x, "read", 1, &a);
+    CHECK(host_num_records() == 1 && host_get_record(0)->msg == gensym("bang"));
+    remove(path);
+    rmdir(dir);
+    host_set_search_dir(".");
+
+    array = host_array_new("table", 4);
+    CHECK(pd_findbyclass(gensym("table"), garray_class) == (t_pd *)array);
+    CHECK(pd_findbyclass(gensym("other"), garray_class) == 0);
+    CHECK(garray_getfloatwords(array, &size, &vec) && size == 4);
+    host_free(x);
+    host_clear_records();
+}
+
+int main(void)
+{
+    setup();
+    test_clocks_and_outlets();
+    test_files_and_tables();
+    host_reset();
+    if (failures)
+        fprintf(stderr, "%d check(s) failed\n", failures);
+    return failures ? 1 : 0;
+}